@@ -22,6 +22,7 @@ HEADERS += \
     ../include/drumstick/alsaqueue.h \
     ../include/drumstick/alsatimer.h \
     ../include/drumstick/macros.h \
+    ../include/drumstick/notepairing.h \
     ../include/drumstick/playthread.h \
     ../include/drumstick/subscription.h \
     ../include/drumstick/sequencererror.h \
@@ -33,6 +34,7 @@ SOURCES += \
     alsaport.cpp \
     alsaqueue.cpp \
     alsatimer.cpp \
+    notepairing.cpp \
     playthread.cpp \
     sequencererror.cpp \
     subscription.cpp
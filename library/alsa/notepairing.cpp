@@ -0,0 +1,237 @@
+/*
+    MIDI Sequencer C++ library
+    Copyright (C) 2006-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QSet>
+#include <QVector>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <drumstick/notepairing.h>
+
+/**
+ * @file notepairing.cpp
+ * Implementation of the conversion between note-on/note-off pairs and notes
+ * with duration.
+ */
+
+/** @ingroup ALSAGroup */
+namespace drumstick {
+namespace ALSA {
+
+class NotePairing::NotePairingPrivate
+{
+public:
+    static const int SLOTS = 16 * 128;
+
+    NotePairingPrivate() :
+        m_paired(0),
+        m_unmatchedOns(0),
+        m_unmatchedOffs(0)
+    { }
+
+    static int slot(const KeyEvent* ev)
+    {
+        return ((ev->getChannel() & 0x0f) << 7) | (ev->getKey() & 0x7f);
+    }
+
+    static quint64 start(const SequencerEvent* ev)
+    {
+        return (quint64(ev->getTick()) << 11) | slot(static_cast<const KeyEvent*>(ev));
+    }
+
+    void reset()
+    {
+        for (QVector<int>& s : m_sounding) {
+            s.clear();
+        }
+        m_starts.clear();
+        m_paired = 0;
+        m_unmatchedOns = 0;
+        m_unmatchedOffs = 0;
+    }
+
+    // positions of the sounding note-ons for each channel and key, oldest first
+    QVector<int> m_sounding[SLOTS];
+    // ticks of the note-ons for each channel and key
+    QSet<quint64> m_starts;
+    int m_paired;
+    int m_unmatchedOns;
+    int m_unmatchedOffs;
+};
+
+/**
+ * Constructor.
+ */
+NotePairing::NotePairing() :
+    d(new NotePairingPrivate)
+{ }
+
+/**
+ * Destructor.
+ */
+NotePairing::~NotePairing() = default;
+
+/**
+ * Replaces each note-on and its matching note-off by a NoteEvent with
+ * duration, at the position of the note-on. The events must be sorted by
+ * tick, and scheduled in ticks.
+ *
+ * @param events A list of events, owning its elements
+ * @return The number of notes paired
+ */
+int NotePairing::pairNotes(QList<SequencerEvent*>& events)
+{
+    d->reset();
+    for (const SequencerEvent* ev : events) {
+        if (ev->getSequencerType() == SND_SEQ_EVENT_NOTEON && static_cast<const KeyEvent*>(ev)->getVelocity() > 0) {
+            d->m_starts.insert(NotePairingPrivate::start(ev));
+        }
+    }
+    QList<SequencerEvent*> result;
+    result.reserve(events.count());
+    for (int i = 0; i < events.count(); ++i) {
+        SequencerEvent* ev = events.at(i);
+        const snd_seq_event_type_t type = ev->getSequencerType();
+        if (type == SND_SEQ_EVENT_NOTEON || type == SND_SEQ_EVENT_NOTEOFF) {
+            KeyEvent* key = static_cast<KeyEvent*>(ev);
+            QVector<int>& sounding = d->m_sounding[NotePairingPrivate::slot(key)];
+            if (type == SND_SEQ_EVENT_NOTEON && key->getVelocity() > 0) {
+                sounding.append(result.count());
+                result.append(ev);
+                continue;
+            }
+            if (!sounding.isEmpty()) {
+                const int pos = sounding.takeFirst();
+                SequencerEvent* on = result.at(pos);
+                NoteEvent* note = new NoteEvent(on->getHandle());
+                note->setSequencerType(SND_SEQ_EVENT_NOTE);
+                unsigned long duration = ev->getTick() - on->getTick();
+                // the sequencer queues the note-off when the note is sent, so it would
+                // follow a note-on of the same key already queued at the same tick
+                if (duration > 0 && d->m_starts.contains(NotePairingPrivate::start(ev))) {
+                    duration--;
+                }
+                note->setDuration(duration);
+                note->getHandle()->data.note.off_velocity =
+                        static_cast<unsigned char>(type == SND_SEQ_EVENT_NOTEOFF ? key->getVelocity() : 0);
+                result[pos] = note;
+                delete on;
+                delete ev;
+                d->m_paired++;
+                continue;
+            }
+            d->m_unmatchedOffs++;
+        }
+        result.append(ev);
+    }
+    for (const QVector<int>& s : d->m_sounding) {
+        d->m_unmatchedOns += s.count();
+    }
+    events = result;
+    return d->m_paired;
+}
+
+/**
+ * Replaces each NoteEvent by a note-on at the same position, and a note-off
+ * after its duration. The note-offs are inserted before any other event at
+ * the same tick. The events must be sorted by tick, and scheduled in ticks.
+ *
+ * @param events A list of events, owning its elements
+ * @return The number of notes split
+ */
+int NotePairing::splitNotes(QList<SequencerEvent*>& events)
+{
+    struct Pending {
+        snd_seq_tick_time_t tick;
+        int serial;
+        SequencerEvent* ev;
+    };
+    auto later = [](const Pending& a, const Pending& b) {
+        return a.tick > b.tick || (a.tick == b.tick && a.serial > b.serial);
+    };
+    std::vector<Pending> pending;
+    QList<SequencerEvent*> result;
+    auto flush = [&](snd_seq_tick_time_t tick) {
+        while (!pending.empty() && pending.front().tick <= tick) {
+            std::pop_heap(pending.begin(), pending.end(), later);
+            result.append(pending.back().ev);
+            pending.pop_back();
+        }
+    };
+
+    d->reset();
+    result.reserve(events.count() * 2);
+    for (int i = 0; i < events.count(); ++i) {
+        SequencerEvent* ev = events.at(i);
+        flush(ev->getTick());
+        if (ev->getSequencerType() != SND_SEQ_EVENT_NOTE) {
+            result.append(ev);
+            continue;
+        }
+        NoteEvent* note = static_cast<NoteEvent*>(ev);
+        NoteOnEvent* on = new NoteOnEvent(note->getHandle());
+        on->setSequencerType(SND_SEQ_EVENT_NOTEON);
+        on->getHandle()->data.note.duration = 0;
+        NoteOffEvent* off = new NoteOffEvent(note->getHandle());
+        off->setSequencerType(SND_SEQ_EVENT_NOTEOFF);
+        off->setVelocity(note->getHandle()->data.note.off_velocity);
+        off->getHandle()->data.note.duration = 0;
+        off->getHandle()->time.tick = note->getTick() + static_cast<snd_seq_tick_time_t>(note->getDuration());
+        result.append(on);
+        pending.push_back({off->getTick(), d->m_paired, off});
+        std::push_heap(pending.begin(), pending.end(), later);
+        delete note;
+        d->m_paired++;
+    }
+    flush(std::numeric_limits<snd_seq_tick_time_t>::max());
+    events = result;
+    return d->m_paired;
+}
+
+/**
+ * Returns the number of notes converted by the last call to pairNotes() or
+ * splitNotes().
+ * @return The number of notes
+ */
+int NotePairing::pairedNotes() const
+{
+    return d->m_paired;
+}
+
+/**
+ * Returns the number of note-ons without a matching note-off found by the
+ * last call to pairNotes().
+ * @return The number of note-ons left untouched
+ */
+int NotePairing::unmatchedNoteOns() const
+{
+    return d->m_unmatchedOns;
+}
+
+/**
+ * Returns the number of note-offs without a sounding note found by the last
+ * call to pairNotes().
+ * @return The number of note-offs left untouched
+ */
+int NotePairing::unmatchedNoteOffs() const
+{
+    return d->m_unmatchedOffs;
+}
+
+} // namespace ALSA
+} // namespace drumstick
@@ -32,6 +32,7 @@
 #include <drumstick/alsaport.h>
 #include <drumstick/alsaqueue.h>
 #include <drumstick/alsatimer.h>
+#include <drumstick/notepairing.h>
 #include <drumstick/playthread.h>
 #include <drumstick/subscription.h>
 #include <drumstick/sequencererror.h>
@@ -45,11 +46,14 @@
 // RealTime interfaces
 #include <drumstick/rtmidiinput.h>
 #include <drumstick/rtmidioutput.h>
+#include <drumstick/rtmidisequencer.h>
 #include <drumstick/backendmanager.h>
 
 // Widgets
+#include <drumstick/activitymeter.h>
 #include <drumstick/pianokeybd.h>
 #include <drumstick/pianopalette.h>
+#include <drumstick/pianoroll.h>
 #include <drumstick/settingsfactory.h>
 #include <drumstick/configurationdialogs.h>
 
@@ -0,0 +1,134 @@
+/*
+    MIDI Virtual Piano Keyboard
+    Copyright (C) 2008-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ACTIVITYMETER_H
+#define ACTIVITYMETER_H
+
+#include <QScopedPointer>
+#include <QWidget>
+#include "macros.h"
+
+/**
+ * @file activitymeter.h
+ * MIDI Channel Activity Meter Widget
+ */
+
+#if defined(DRUMSTICK_STATIC)
+#define DRUMSTICK_WIDGETS_EXPORT
+#else
+#if defined(drumstick_widgets_EXPORTS)
+#define DRUMSTICK_WIDGETS_EXPORT Q_DECL_EXPORT
+#else
+#define DRUMSTICK_WIDGETS_EXPORT Q_DECL_IMPORT
+#endif
+#endif
+
+namespace drumstick {
+namespace rt {
+    class MIDIInput;
+}
+namespace widgets {
+
+    /**
+     * @addtogroup Widgets
+     * @{
+     *
+     * @brief The ActivityMeter class
+     *
+     * This widget displays, for each one of the 16 MIDI channels, the note
+     * density, the controller activity and the peak velocity of the incoming
+     * MIDI messages.
+     *
+     * The counting functions are thread safe and cheap: they only update
+     * atomic counters, so they may be called directly from the MIDI input
+     * threads, for instance with Qt::DirectConnection, or from an ALSA
+     * drumstick::ALSA::SequencerEventHandler. The widget is repainted at a
+     * capped frame rate, and only while there is some activity to display.
+     * The decay of the levels is computed at paint time.
+     *
+     * With a drumstick::rt::MIDIInput, use attachInput(). With an ALSA
+     * drumstick::ALSA::MidiClient, count the events in the input thread:
+     * @code
+     * client->setRealTimeInput(true);
+     * connect(client, &MidiClient::eventReceived, meter, [=](SequencerEvent *ev) {
+     *     if (SequencerEvent::isChannel(ev)) {
+     *         auto cev = static_cast<ChannelEvent*>(ev);
+     *         switch (ev->getSequencerType()) {
+     *         case SND_SEQ_EVENT_NOTE:
+     *         case SND_SEQ_EVENT_NOTEON:
+     *             meter->countNoteOn(cev->getChannel(), static_cast<KeyEvent*>(ev)->getVelocity());
+     *             break;
+     *         case SND_SEQ_EVENT_NOTEOFF:
+     *             break;
+     *         default:
+     *             meter->countController(cev->getChannel());
+     *         }
+     *     }
+     *     delete ev; // the receiver owns the event
+     * }, Qt::DirectConnection);
+     * @endcode
+     * @since 2.11
+     */
+    class DRUMSTICK_WIDGETS_EXPORT ActivityMeter : public QWidget
+    {
+        Q_OBJECT
+        Q_PROPERTY( int frameRate READ frameRate WRITE setFrameRate )
+        Q_PROPERTY( int decayTime READ decayTime WRITE setDecayTime )
+
+    public:
+        explicit ActivityMeter(QWidget *parent = nullptr);
+        virtual ~ActivityMeter();
+
+        void countNoteOn(int channel, int velocity);
+        void countController(int channel);
+        void countMessage(int status, int data1 = 0, int data2 = 0);
+
+        void attachInput(drumstick::rt::MIDIInput *input);
+        void detachInput(drumstick::rt::MIDIInput *input);
+
+        int frameRate() const;
+        void setFrameRate(int fps);
+        int decayTime() const;
+        void setDecayTime(int msecs);
+
+        quint64 totalNotes() const;
+        quint64 totalControllers() const;
+
+        QSize sizeHint() const override;
+        QSize minimumSizeHint() const override;
+
+        static const int DEFAULT_FRAME_RATE; ///< Default maximum frames per second
+        static const int DEFAULT_DECAY_TIME; ///< Default decay time constant in milliseconds
+
+    public Q_SLOTS:
+        void reset();
+
+    protected:
+        void paintEvent(QPaintEvent *event) override;
+        void showEvent(QShowEvent *event) override;
+
+    private:
+        class ActivityMeterPrivate;
+        QScopedPointer<ActivityMeterPrivate> d;
+    };
+
+/** @} */
+
+}} // namespace drumstick::widgets
+
+#endif // ACTIVITYMETER_H
@@ -80,17 +80,35 @@ public:
     void refresh(const QVariantMap &map);
 
     /**
-         * @brief availableInputs
+         * @brief availableInputs instantiates all the input backends
+         * the first time it is called, and returns the same instances later
          * @return list of available MIDI inputs
          */
     QList<MIDIInput *> availableInputs();
 
     /**
-         * @brief availableOutputs
+         * @brief availableOutputs instantiates all the output backends
+         * the first time it is called, and returns the same instances later
          * @return list of available MIDI outputs
          */
     QList<MIDIOutput *> availableOutputs();
 
+    /**
+         * @brief availableInputNames provides the input backend names
+         * without instantiating any backend
+         * @return list of input backend names
+         * @since 2.11
+         */
+    QStringList availableInputNames();
+
+    /**
+         * @brief availableOutputNames provides the output backend names
+         * without instantiating any backend
+         * @return list of output backend names
+         * @since 2.11
+         */
+    QStringList availableOutputNames();
+
     /**
          * @brief defaultPaths
          * @return list of paths for backends search
@@ -98,14 +116,14 @@ public:
     QStringList defaultPaths();
 
     /**
-         * @brief inputBackendByName
+         * @brief inputBackendByName instantiates the backend if needed
          * @param name The name of some input backend
          * @return Input backend instance if available
          */
     MIDIInput *inputBackendByName(const QString name);
 
     /**
-         * @brief outputBackendByName
+         * @brief outputBackendByName instantiates the backend if needed
          * @param name The name of some output backend
          * @return Output backend instance if available
          */
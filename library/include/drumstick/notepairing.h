@@ -0,0 +1,82 @@
+/*
+    MIDI Sequencer C++ library
+    Copyright (C) 2006-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DRUMSTICK_NOTEPAIRING_H
+#define DRUMSTICK_NOTEPAIRING_H
+
+#include <QList>
+#include <QScopedPointer>
+#include "alsaevent.h"
+#include "macros.h"
+
+namespace drumstick { namespace ALSA {
+
+/**
+ * @file notepairing.h
+ * Conversion between note-on/note-off pairs and notes with duration.
+ *
+ * @addtogroup ALSAEvent ALSA Sequencer Events
+ * @{
+ */
+
+/**
+ * The NotePairing class converts the note-on and note-off events of a tick
+ * sorted event list into NoteEvent objects with duration, and back.
+ *
+ * A single pass over the list keeps a FIFO of the sounding notes for each
+ * channel and key. A note-off, or a note-on with velocity zero, ends the
+ * oldest sounding note of the same channel and key, so overlapping notes of
+ * the same pitch are paired in order. The ALSA sequencer schedules the
+ * note-off of a NoteEvent by itself, so a player sends half as many events.
+ * A note ending at the tick where the same channel and key starts again ends
+ * one tick early, because that note-off is queued after the new note-on.
+ *
+ * The event lists own their events: the replaced events are deleted, and the
+ * new ones are allocated with new. Note-ons without a note-off, and note-offs
+ * without a note-on, are left untouched.
+ *
+ * @code
+ * NotePairing pairing;
+ * pairing.pairNotes(song); // a QList<SequencerEvent*> sorted by tick
+ * qDebug() << pairing.pairedNotes() << pairing.unmatchedNoteOffs();
+ * @endcode
+ * @since 2.11
+ */
+class DRUMSTICK_ALSA_EXPORT NotePairing
+{
+public:
+    NotePairing();
+    ~NotePairing();
+
+    int pairNotes(QList<SequencerEvent*>& events);
+    int splitNotes(QList<SequencerEvent*>& events);
+
+    int pairedNotes() const;
+    int unmatchedNoteOns() const;
+    int unmatchedNoteOffs() const;
+
+private:
+    class NotePairingPrivate;
+    QScopedPointer<NotePairingPrivate> d;
+};
+
+/** @} */
+
+}} /* namespace drumstick::ALSA */
+
+#endif // DRUMSTICK_NOTEPAIRING_H
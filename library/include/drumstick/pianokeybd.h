@@ -266,6 +266,8 @@ namespace drumstick { namespace widgets {
         void showNoteOn( const int note, QColor color, int vel = -1 );
         void showNoteOn( const int note, int vel = -1 );
         void showNoteOff( const int note, int vel = -1 );
+        void postNoteOn( const int note, int vel = -1 );
+        void postNoteOff( const int note, int vel = -1 );
 
         // RawKbdHandler methods
         bool handleKeyPressed(int keycode) override;
@@ -283,8 +285,14 @@ namespace drumstick { namespace widgets {
         void setOctaveSubscript(const bool enable);
         bool octaveSubscript() const;
 
+        void setBatchedDisplay(const bool enable);
+        bool isBatchedDisplay() const;
+
         void setStartKey(const int startKey);
 
+    public Q_SLOTS:
+        void flushPendingNotes();
+
     Q_SIGNALS:
         /**
          * This signal is emitted for each Note On MIDI event created using
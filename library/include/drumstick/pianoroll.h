@@ -0,0 +1,142 @@
+/*
+    MIDI Virtual Piano Keyboard
+    Copyright (C) 2008-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PIANOROLL_H
+#define PIANOROLL_H
+
+#include <QAbstractScrollArea>
+#include <QScopedPointer>
+#include <QVector>
+#include "macros.h"
+#include "pianopalette.h"
+
+/**
+ * @file pianoroll.h
+ * Piano Roll Widget
+ */
+
+#if defined(DRUMSTICK_STATIC)
+#define DRUMSTICK_WIDGETS_EXPORT
+#else
+#if defined(drumstick_widgets_EXPORTS)
+#define DRUMSTICK_WIDGETS_EXPORT Q_DECL_EXPORT
+#else
+#define DRUMSTICK_WIDGETS_EXPORT Q_DECL_IMPORT
+#endif
+#endif
+
+namespace drumstick { namespace widgets {
+
+    /**
+     * @addtogroup Widgets
+     * @{
+     *
+     * @brief PianoRollNote is a note displayed by the PianoRoll widget
+     */
+    struct PianoRollNote
+    {
+        quint64 tick;    ///< Start time in ticks
+        quint64 length;  ///< Duration in ticks
+        quint16 track;   ///< Track number
+        quint8 channel;  ///< MIDI channel
+        quint8 note;     ///< MIDI note number
+        quint8 velocity; ///< MIDI velocity
+    };
+
+    /**
+     * @brief The PianoRoll class
+     *
+     * This widget displays the notes of a song as horizontal bars, with the
+     * time in the horizontal axis and the MIDI note number in the vertical
+     * axis. It does not create any object per note: the notes are stored in
+     * a tick-sorted array, with an index of the maximum end time of the notes
+     * up to each position, so the notes overlapping any time range are found
+     * with two binary searches. Only the visible viewport is painted, from
+     * image tiles cached for the current zoom level.
+     *
+     * The position cursor may be driven by a sequencer queue, calling
+     * setPosition() periodically while playing.
+     * @since 2.11
+     */
+    class DRUMSTICK_WIDGETS_EXPORT PianoRoll : public QAbstractScrollArea
+    {
+        Q_OBJECT
+        Q_PROPERTY( quint64 position READ position WRITE setPosition )
+        Q_PROPERTY( int zoomLevel READ zoomLevel WRITE setZoomLevel )
+        Q_PROPERTY( int rowHeight READ rowHeight WRITE setRowHeight )
+        Q_PROPERTY( bool followPosition READ followPosition WRITE setFollowPosition )
+
+    public:
+        explicit PianoRoll(QWidget *parent = nullptr);
+        virtual ~PianoRoll();
+
+        void clear();
+        void addNote(quint64 tick, quint64 length, int note, int velocity, int channel = 0, int track = 0);
+        void setNotes(const QVector<PianoRollNote> &notes);
+        void finalize();
+        int count() const;
+        const PianoRollNote &noteAt(int index) const;
+        void notesInRange(quint64 from, quint64 to, QVector<int> &result) const;
+        quint64 length() const;
+
+        int division() const;
+        void setDivision(int division);
+        int zoomLevel() const;
+        void setZoomLevel(int level);
+        double pixelsPerTick() const;
+        int rowHeight() const;
+        void setRowHeight(int height);
+        bool followPosition() const;
+        void setFollowPosition(bool enable);
+        PianoPalette notePalette() const;
+        void setNotePalette(const PianoPalette &palette);
+        quint64 position() const;
+
+        QSize sizeHint() const override;
+
+        static const int MIN_ZOOM_LEVEL;  ///< Minimum zoom level
+        static const int MAX_ZOOM_LEVEL;  ///< Maximum zoom level
+
+    Q_SIGNALS:
+        /**
+         * This signal is emitted when the user clicks on the roll.
+         * @param tick The time clicked, in ticks
+         */
+        void positionRequested(quint64 tick);
+
+    public Q_SLOTS:
+        void setPosition(quint64 tick);
+        void zoomIn();
+        void zoomOut();
+
+    protected:
+        void paintEvent(QPaintEvent *event) override;
+        void resizeEvent(QResizeEvent *event) override;
+        void wheelEvent(QWheelEvent *event) override;
+        void mousePressEvent(QMouseEvent *event) override;
+
+    private:
+        class PianoRollPrivate;
+        QScopedPointer<PianoRollPrivate> d;
+    };
+
+/** @} */
+
+}} // namespace drumstick::widgets
+
+#endif // PIANOROLL_H
@@ -0,0 +1,210 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RTMIDISEQUENCER_H
+#define RTMIDISEQUENCER_H
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QThread>
+#include <QVector>
+#include "macros.h"
+#include "rtmidioutput.h"
+
+/**
+ * @file rtmidisequencer.h
+ * Realtime MIDI song sequencer for any MIDIOutput backend
+ */
+
+#if defined(DRUMSTICK_STATIC)
+#define DRUMSTICK_RT_EXPORT
+#else
+#if defined(drumstick_rt_EXPORTS)
+#define DRUMSTICK_RT_EXPORT Q_DECL_EXPORT
+#else
+#define DRUMSTICK_RT_EXPORT Q_DECL_IMPORT
+#endif
+#endif
+
+namespace drumstick { namespace rt {
+
+/**
+ * @addtogroup RT
+ * @{
+ */
+
+/**
+ * @brief SongEvent is a compact MIDI event record stored in a MIDISong
+ *
+ * Channel and system messages are stored as the raw status and data bytes.
+ * System exclusive messages keep the index of their payload in the song
+ * sysex pool in the field extra.
+ */
+struct SongEvent
+{
+    quint64 tick;   ///< Musical time in ticks
+    qint64 time;    ///< Absolute time in microseconds, according to the tempo map
+    quint16 track;  ///< Track number
+    quint8 status;  ///< MIDI status byte
+    quint8 data1;   ///< First MIDI data byte
+    quint8 data2;   ///< Second MIDI data byte
+    qint32 extra;   ///< Index of the sysex payload, or -1
+};
+
+/**
+ * @brief SongTempo is a tempo map entry of a MIDISong
+ */
+struct SongTempo
+{
+    quint64 tick;   ///< Musical time in ticks
+    qint64 time;    ///< Absolute time in microseconds
+    quint32 tempo;  ///< Tempo in microseconds per quarter note
+};
+
+/**
+ * @brief The MIDISong class is a flat, time sorted array of MIDI events
+ *
+ * MIDISong does not depend on any file format. Applications may fill it from
+ * the signals of drumstick::File::QSmf or drumstick::File::QWrk, and call
+ * finalize() after the last event to sort the events and compute the
+ * absolute time of each one. Copies are cheap, because the event storage is
+ * implicitly shared.
+ *
+ * @code
+ * MIDISong song;
+ * connect(smf, &QSmf::signalSMFHeader, [&](int, int, int division) {
+ *     song.setDivision(division);
+ * });
+ * connect(smf, &QSmf::signalSMFNoteOn, [&](int chan, int pitch, int vol) {
+ *     song.addMessage(smf->getCurrentTime(), track, MIDI_STATUS_NOTEON + chan, pitch, vol);
+ * });
+ * connect(smf, &QSmf::signalSMFTempo, [&](int tempo) {
+ *     song.addTempo(smf->getCurrentTime(), tempo);
+ * });
+ * smf->readFromFile(fileName);
+ * song.finalize();
+ * @endcode
+ * @since 2.11
+ */
+class DRUMSTICK_RT_EXPORT MIDISong
+{
+public:
+    MIDISong();
+
+    void clear();
+    void setDivision(int division);
+    int division() const;
+
+    void addMessage(quint64 tick, int track, int status, int data1 = 0, int data2 = 0);
+    void addPitchBend(quint64 tick, int track, int chan, int value);
+    void addSysex(quint64 tick, int track, const QByteArray &data);
+    void addTempo(quint64 tick, int tempo);
+    void finalize();
+
+    bool isEmpty() const;
+    int count() const;
+    int tracks() const;
+    const SongEvent &at(int index) const;
+    QByteArray sysexData(const SongEvent &ev) const;
+    int indexOf(quint64 tick) const;
+
+    quint64 lengthTicks() const;
+    qint64 lengthTime() const;
+    qint64 tickToTime(quint64 tick) const;
+    quint64 timeToTick(qint64 usecs) const;
+    int tempoAt(quint64 tick) const;
+    const QVector<SongTempo> &tempoMap() const;
+
+    static const int DEFAULT_DIVISION; ///< Ticks per quarter note assumed without a header
+    static const int DEFAULT_TEMPO;    ///< Microseconds per quarter note (120 bpm)
+
+private:
+    int m_division;
+    int m_tracks;
+    QVector<SongEvent> m_events;
+    QVector<SongTempo> m_tempos;
+    QVector<QByteArray> m_sysex;
+};
+
+/**
+ * @brief The MIDISequencer class plays a MIDISong to any MIDIOutput
+ *
+ * The playback runs on its own thread, with time critical priority by
+ * default. Events are dispatched at the time computed from the song tempo
+ * map, scaled by the tempo factor. The playback loop reads the song events
+ * in place, so it does not allocate memory. Seeking, looping, tempo scaling
+ * and track mute/solo may be changed at any time from other threads.
+ *
+ * This is the portable counterpart of drumstick::ALSA::SequencerOutputThread.
+ * @since 2.11
+ */
+class DRUMSTICK_RT_EXPORT MIDISequencer : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit MIDISequencer(QObject *parent = nullptr);
+    virtual ~MIDISequencer();
+
+    void setOutput(MIDIOutput *output);
+    MIDIOutput *output() const;
+    void setSong(const MIDISong &song);
+    MIDISong song() const;
+
+    void seek(quint64 tick);
+    quint64 position() const;
+    void setLoop(bool enabled, quint64 startTick = 0, quint64 endTick = 0);
+    bool isLooping() const;
+    void setTempoFactor(double factor);
+    double tempoFactor() const;
+    int currentTempo() const;
+
+    void setTrackMuted(int track, bool muted);
+    bool isTrackMuted(int track) const;
+    void setTrackSolo(int track, bool solo);
+    bool isTrackSolo(int track) const;
+
+    void stop();
+    virtual void run() override;
+
+Q_SIGNALS:
+    /**
+     * Signal emitted when the song play-back has reached the end.
+     */
+    void playbackFinished();
+
+    /**
+     * Signal emitted when the play-back has been stopped.
+     */
+    void playbackStopped();
+
+public Q_SLOTS:
+    void start(QThread::Priority priority = TimeCriticalPriority);
+
+private:
+    class MIDISequencerPrivate;
+    QScopedPointer<MIDISequencerPrivate> d;
+};
+
+/** @} */
+
+}} // namespace drumstick::rt
+
+Q_DECLARE_METATYPE(drumstick::rt::MIDISong)
+
+#endif // RTMIDISEQUENCER_H
@@ -5,13 +5,16 @@ static {
 }
 TARGET = drumstick-rt-alsa-in
 DESTDIR = ../../../build/lib/drumstick2
-DEPENDPATH += . ../../include
-INCLUDEPATH += . ../../include
+DEPENDPATH += . ../../include ../common
+INCLUDEPATH += . ../../include ../common
 include (../../../global.pri)
 QT -= gui
 
-HEADERS += alsamidiinput.h
-SOURCES += alsamidiinput.cpp
+HEADERS += alsamidiinput.h \
+           ../common/midiring.h \
+           ../common/midithru.h
+SOURCES += alsamidiinput.cpp \
+           ../common/midithru.cpp
 
 LIBS += -L../../../build/lib \
         -ldrumstick-rt \
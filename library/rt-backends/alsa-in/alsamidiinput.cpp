@@ -23,6 +23,7 @@
 #include <drumstick/alsaevent.h>
 #include <drumstick/alsaport.h>
 #include <drumstick/rtmidioutput.h>
+#include "midithru.h"
 
 namespace drumstick { namespace rt {
 
@@ -36,6 +37,7 @@ namespace drumstick { namespace rt {
 
         ALSAMIDIInput *m_inp;
         MIDIOutput *m_out;
+        MIDIThruForwarder m_forwarder;
         MidiClient *m_client;
         MidiPort *m_port;
         int m_portId;
@@ -221,24 +223,24 @@ namespace drumstick { namespace rt {
                 switch(ev->getSequencerType()) {
                 case SND_SEQ_EVENT_NOTEOFF: {
                         const NoteOffEvent* n = static_cast<const NoteOffEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
-                            m_out->sendNoteOff(n->getChannel(), n->getKey(), n->getVelocity());
+                        if (m_out != nullptr && m_thruEnabled) {
+                            m_forwarder.forward(m_out, MIDI_STATUS_NOTEOFF + n->getChannel(), n->getKey(), n->getVelocity());
                         }
                         Q_EMIT m_inp->midiNoteOff(n->getChannel(), n->getKey(), n->getVelocity());
                     }
                     break;
                 case SND_SEQ_EVENT_NOTEON: {
                         const NoteOnEvent* n = static_cast<const NoteOnEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
-                            m_out->sendNoteOn(n->getChannel(), n->getKey(), n->getVelocity());
+                        if (m_out != nullptr && m_thruEnabled) {
+                            m_forwarder.forward(m_out, MIDI_STATUS_NOTEON + n->getChannel(), n->getKey(), n->getVelocity());
                         }
                         Q_EMIT m_inp->midiNoteOn(n->getChannel(), n->getKey(), n->getVelocity());
                     }
                     break;
                 case SND_SEQ_EVENT_KEYPRESS: {
                         const KeyPressEvent* n = static_cast<const KeyPressEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
-                            m_out->sendKeyPressure(n->getChannel(), n->getKey(), n->getVelocity());
+                        if (m_out != nullptr && m_thruEnabled) {
+                            m_forwarder.forward(m_out, MIDI_STATUS_KEYPRESURE + n->getChannel(), n->getKey(), n->getVelocity());
                         }
                         Q_EMIT m_inp->midiKeyPressure(n->getChannel(), n->getKey(), n->getVelocity());
                     }
@@ -246,32 +248,32 @@ namespace drumstick { namespace rt {
                 case SND_SEQ_EVENT_CONTROLLER:
                 case SND_SEQ_EVENT_CONTROL14: {
                         const ControllerEvent* n = static_cast<const ControllerEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
-                            m_out->sendController(n->getChannel(), n->getParam(), n->getValue());
+                        if (m_out != nullptr && m_thruEnabled) {
+                            m_forwarder.forward(m_out, MIDI_STATUS_CONTROLCHANGE + n->getChannel(), n->getParam(), n->getValue());
                         }
                         Q_EMIT m_inp->midiController(n->getChannel(), n->getParam(), n->getValue());
                     }
                     break;
                 case SND_SEQ_EVENT_PGMCHANGE: {
                         const ProgramChangeEvent* p = static_cast<const ProgramChangeEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
-                            m_out->sendProgram(p->getChannel(), p->getValue());
+                        if (m_out != nullptr && m_thruEnabled) {
+                            m_forwarder.forward(m_out, MIDI_STATUS_PROGRAMCHANGE + p->getChannel(), p->getValue());
                         }
                         Q_EMIT m_inp->midiProgram(p->getChannel(), p->getValue());
                     }
                     break;
                 case SND_SEQ_EVENT_CHANPRESS: {
                         const ChanPressEvent* n = static_cast<const ChanPressEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
-                            m_out->sendChannelPressure(n->getChannel(), n->getValue());
+                        if (m_out != nullptr && m_thruEnabled) {
+                            m_forwarder.forward(m_out, MIDI_STATUS_CHANNELPRESSURE + n->getChannel(), n->getValue());
                         }
                         Q_EMIT m_inp->midiChannelPressure(n->getChannel(), n->getValue());
                     }
                     break;
                 case SND_SEQ_EVENT_PITCHBEND: {
                         const PitchBendEvent* n = static_cast<const PitchBendEvent*>(ev);
-                        if(m_out != nullptr && m_thruEnabled) {
-                            m_out->sendPitchBend(n->getChannel(), n->getValue());
+                        if (m_out != nullptr && m_thruEnabled) {
+                            m_forwarder.forwardPitchBend(m_out, n->getChannel(), n->getValue());
                         }
                         Q_EMIT m_inp->midiPitchBend(n->getChannel(), n->getValue());
                     }
@@ -279,8 +281,8 @@ namespace drumstick { namespace rt {
                 case SND_SEQ_EVENT_SYSEX: {
                         const SysExEvent* n = static_cast<const SysExEvent*>(ev);
                         QByteArray data(n->getData(), n->getLength());
-                        if(m_out != nullptr && m_thruEnabled) {
-                            m_out->sendSysex(data);
+                        if (m_out != nullptr && m_thruEnabled) {
+                            m_forwarder.forwardSysex(m_out, data);
                         }
                         Q_EMIT m_inp->midiSysex(data);
                     }
@@ -288,8 +290,8 @@ namespace drumstick { namespace rt {
                 case SND_SEQ_EVENT_SYSTEM: {
                         const SystemEvent* n = static_cast<const SystemEvent*>(ev);
                         int status = (int) n->getRaw8(0);
-                        if(m_out != nullptr && m_thruEnabled) {
-                            m_out->sendSystemMsg(status);
+                        if (m_out != nullptr && m_thruEnabled) {
+                            m_forwarder.forward(m_out, status);
                         }
                         if (status < 0xF7)
                             Q_EMIT m_inp->midiSystemCommon(status);
@@ -369,6 +371,7 @@ namespace drumstick { namespace rt {
     void ALSAMIDIInput::setMIDIThruDevice(MIDIOutput *device)
     {
         d->m_out = device;
+        d->m_forwarder.setOutput(device);
     }
 
     void ALSAMIDIInput::enableMIDIThru(bool enable)
@@ -391,5 +394,40 @@ namespace drumstick { namespace rt {
         return d->m_status;
     }
 
+    bool ALSAMIDIInput::getThruQueued()
+    {
+        return d->m_forwarder.isEnabled();
+    }
+
+    void ALSAMIDIInput::setThruQueued(bool queued)
+    {
+        d->m_forwarder.setEnabled(queued);
+    }
+
+    int ALSAMIDIInput::getThruLatencyBudget()
+    {
+        return d->m_forwarder.latencyBudget();
+    }
+
+    void ALSAMIDIInput::setThruLatencyBudget(int usecs)
+    {
+        d->m_forwarder.setLatencyBudget(usecs);
+    }
+
+    qulonglong ALSAMIDIInput::getThruForwarded()
+    {
+        return d->m_forwarder.forwarded();
+    }
+
+    qulonglong ALSAMIDIInput::getThruOverruns()
+    {
+        return d->m_forwarder.overruns();
+    }
+
+    qulonglong ALSAMIDIInput::getThruDropped()
+    {
+        return d->m_forwarder.dropped();
+    }
+
 } // namespace rt
 } // namespace drumstick
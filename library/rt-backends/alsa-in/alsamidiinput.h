@@ -33,6 +33,11 @@ namespace rt {
         Q_INTERFACES(drumstick::rt::MIDIInput)
         Q_PROPERTY(QStringList diagnostics READ getDiagnostics)
         Q_PROPERTY(bool status READ getStatus)
+        Q_PROPERTY(bool thruQueued READ getThruQueued WRITE setThruQueued)
+        Q_PROPERTY(int thruLatencyBudget READ getThruLatencyBudget WRITE setThruLatencyBudget)
+        Q_PROPERTY(qulonglong thruForwarded READ getThruForwarded)
+        Q_PROPERTY(qulonglong thruOverruns READ getThruOverruns)
+        Q_PROPERTY(qulonglong thruDropped READ getThruDropped)
 
     public:
         explicit ALSAMIDIInput(QObject *parent = nullptr);
@@ -62,6 +67,13 @@ namespace rt {
     private:
         QStringList getDiagnostics();
         bool getStatus();
+        bool getThruQueued();
+        void setThruQueued(bool queued);
+        int getThruLatencyBudget();
+        void setThruLatencyBudget(int usecs);
+        qulonglong getThruForwarded();
+        qulonglong getThruOverruns();
+        qulonglong getThruDropped();
     };
 
 }}
@@ -17,6 +17,7 @@
 */
 
 #include "midiparser.h"
+#include "midithru.h"
 #include <drumstick/rtmidioutput.h>
 
 namespace drumstick {
@@ -24,18 +25,34 @@ namespace rt {
 
 class MIDIParser::MIDIParserPrivate {
 public:
-    MIDIParserPrivate(): m_in(nullptr), m_out(nullptr), m_running_status(0) { }
+    MIDIParserPrivate(): m_in(nullptr), m_out(nullptr), m_forwarder(nullptr), m_running_status(0) { }
     MIDIInput *m_in;
     MIDIOutput *m_out;
+    MIDIThruForwarder *m_forwarder;
     unsigned char m_running_status;
     QByteArray m_buffer;
 
-    void processNoteOff(const int chan, const int note, const int vel)
+    void thru(const char *data, quint32 size)
     {
-        //qDebug() << "NoteOff(" << hex << chan << "," << note << "," << vel << ")";
         if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendNoteOff(chan, note, vel);
+            if (m_forwarder != nullptr) {
+                m_forwarder->forward(m_out, data, size);
+            } else {
+                MIDIThruForwarder::send(m_out, reinterpret_cast<const unsigned char *>(data), size);
+            }
         }
+    }
+
+    void thru(int status, int data1 = 0, int data2 = 0)
+    {
+        const char m[3] = { static_cast<char>(status), static_cast<char>(data1), static_cast<char>(data2) };
+        thru(m, MIDIThruForwarder::messageSize(status));
+    }
+
+    void processNoteOff(const int chan, const int note, const int vel)
+    {
+        //qDebug() << "NoteOff(" << hex << chan << "," << note << "," << vel << ")";
+        thru(MIDI_STATUS_NOTEOFF + chan, note, vel);
         if (m_in != nullptr) {
             Q_EMIT m_in->midiNoteOff(chan, note, vel);
         }
@@ -44,9 +61,7 @@ public:
     void processNoteOn(const int chan, const int note, const int vel)
     {
         //qDebug() << "NoteOn(" << hex << chan << "," << note << "," << vel << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendNoteOn(chan, note, vel);
-        }
+        thru(MIDI_STATUS_NOTEON + chan, note, vel);
         if (m_in != nullptr) {
             Q_EMIT m_in->midiNoteOn(chan, note, vel);
         }
@@ -55,9 +70,7 @@ public:
     void processKeyPressure(const int chan, const int note, const int value)
     {
         //qDebug() << "KeyPressure(" << hex << chan << "," << note << "," << value << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendKeyPressure(chan, note, value);
-        }
+        thru(MIDI_STATUS_KEYPRESURE + chan, note, value);
         if (m_in != nullptr) {
             Q_EMIT m_in->midiKeyPressure(chan, note, value);
         }
@@ -66,9 +79,7 @@ public:
     void processController(const int chan, const int control, const int value)
     {
         //qDebug() << "Controller(" << chan << "," << control << "," << value << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendController(chan, control, value);
-        }
+        thru(MIDI_STATUS_CONTROLCHANGE + chan, control, value);
         if (m_in != nullptr) {
             Q_EMIT m_in->midiController(chan, control, value);
         }
@@ -77,9 +88,7 @@ public:
     void processProgram(const int chan, const int program)
     {
         //qDebug() << "Program(" << hex << chan << "," << program << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendProgram(chan, program);
-        }
+        thru(MIDI_STATUS_PROGRAMCHANGE + chan, program);
         if (m_in != nullptr) {
             Q_EMIT m_in->midiProgram(chan, program);
         }
@@ -88,9 +97,7 @@ public:
     void processChannelPressure(const int chan, const int value)
     {
         //qDebug() << "ChannelPressure(" << chan << "," << value << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendChannelPressure(chan, value);
-        }
+        thru(MIDI_STATUS_CHANNELPRESSURE + chan, value);
         if (m_in != nullptr) {
             Q_EMIT m_in->midiChannelPressure(chan, value);
         }
@@ -99,9 +106,8 @@ public:
     void processPitchBend(const int chan, const int value)
     {
         //qDebug() << "PitchBend(" << chan << "," << value << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendPitchBend(chan, value);
-        }
+        const int v = 8192 + value; // -8192 <= value <= 8191
+        thru(MIDI_STATUS_PITCHBEND + chan, MIDI_LSB(v), MIDI_MSB(v));
         if (m_in != nullptr) {
             Q_EMIT m_in->midiPitchBend(chan, value);
         }
@@ -110,9 +116,7 @@ public:
     void processSysex(const QByteArray &data)
     {
         //qDebug() << "Sysex(" << data.toHex() << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendSysex(data);
-        }
+        thru(data.constData(), static_cast<quint32>(data.size()));
         if (m_in != nullptr) {
             Q_EMIT m_in->midiSysex(data);
         }
@@ -121,9 +125,7 @@ public:
     void processSystemCommon(const int status)
     {
         //qDebug() << "common SystemMsg(" << hex << status << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendSystemMsg(status);
-        }
+        thru(status);
         if (m_in != nullptr) {
             Q_EMIT m_in->midiSystemCommon(status);
         }
@@ -132,9 +134,7 @@ public:
     void processSystemRealtime(unsigned char byte)
     {
         //qDebug() << "realtime SystemMsg(" << hex << byte << ")";
-        if (m_in != nullptr && m_in->isEnabledMIDIThru() && m_out != nullptr) {
-            m_out->sendSystemMsg(byte);
-        }
+        thru(byte);
         if (m_in != nullptr) {
             Q_EMIT m_in->midiSystemRealtime(byte);
         }
@@ -160,6 +160,11 @@ void MIDIParser::setMIDIThruDevice(MIDIOutput *device)
     d->m_out = device;
 }
 
+void MIDIParser::setThruForwarder(MIDIThruForwarder *forwarder)
+{
+    d->m_forwarder = forwarder;
+}
+
 void MIDIParser::parse(unsigned char byte)
 {
     if (byte >= MIDI_STATUS_REALTIME) { // system realtime
@@ -247,8 +252,13 @@ void MIDIParser::parse(unsigned char byte)
 
 void MIDIParser::parse(QByteArray bytes)
 {
-    foreach(unsigned char byte, bytes) {
-        parse(byte);
+    parse(bytes.constData(), bytes.size());
+}
+
+void MIDIParser::parse(const char *data, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        parse(static_cast<unsigned char>(data[i]));
     }
 }
 
@@ -25,6 +25,8 @@
 namespace drumstick {
 namespace rt {
 
+class MIDIThruForwarder;
+
 class MIDIParser : public QObject
 {
     Q_OBJECT
@@ -32,6 +34,8 @@ public:
     explicit MIDIParser(MIDIInput *in = nullptr, QObject *parent = nullptr);
     virtual ~MIDIParser();
     void setMIDIThruDevice(MIDIOutput* device);
+    void setThruForwarder(MIDIThruForwarder* forwarder);
+    void parse(const char *data, int size);
 
 public Q_SLOTS:
     void parse(unsigned char byte);
@@ -0,0 +1,169 @@
+/*
+    Drumstick MIDI realtime input-output
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MIDIRING_H
+#define MIDIRING_H
+
+#include <QSemaphore>
+#include <QtGlobal>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+namespace drumstick {
+namespace rt {
+
+/*
+ * Single producer, single consumer byte ring of timestamped MIDI messages,
+ * used between the loopback output and input, and by the MIDI thru
+ * forwarder. Each record is a MIDIRing::Header followed by the raw MIDI
+ * bytes of one message. The producer never blocks; the consumer sleeps on
+ * a semaphore only when it has announced that it is idle.
+ */
+class MIDIRing
+{
+public:
+    static const quint32 DEFAULT_CAPACITY = 1u << 20;
+    static const quint32 MAX_MESSAGE = 1u << 16;
+
+    struct Header {
+        qint64 sent; // microseconds, see now()
+        qint64 due;  // delivery time, or deadline
+        quint32 size;
+    };
+
+    explicit MIDIRing(quint32 capacity = DEFAULT_CAPACITY)
+    {
+        // power of two, able to hold at least one maximum size message
+        quint32 size = 2 * (MAX_MESSAGE + sizeof(Header));
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_capacity = size;
+        m_buffer = new char[m_capacity];
+    }
+
+    ~MIDIRing()
+    {
+        delete[] m_buffer;
+    }
+
+    MIDIRing(const MIDIRing&) = delete;
+    MIDIRing& operator=(const MIDIRing&) = delete;
+
+    static qint64 now()
+    {
+        using namespace std::chrono;
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool write(qint64 sent, qint64 due, const char *data, quint32 size)
+    {
+        const quint64 total = sizeof(Header) + size;
+        const quint64 head = m_head.load(std::memory_order_relaxed);
+        const quint64 tail = m_tail.load(std::memory_order_acquire);
+        if (size > MAX_MESSAGE || m_capacity - (head - tail) < total) {
+            return false;
+        }
+        const Header h{sent, due, size};
+        copyIn(head, &h, sizeof(Header));
+        copyIn(head + sizeof(Header), data, size);
+        // sequentially consistent, pairs with wait(): either the producer sees
+        // the consumer sleeping, or the consumer sees the new record
+        m_head.store(head + total);
+        if (m_sleeping.load() && m_sleeping.exchange(false)) {
+            m_wakeup.release();
+        }
+        return true;
+    }
+
+    bool peek(Header &h) const
+    {
+        const quint64 tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load(std::memory_order_acquire) == tail) {
+            return false;
+        }
+        copyOut(tail, &h, sizeof(Header));
+        return true;
+    }
+
+    void read(const Header &h, char *data)
+    {
+        const quint64 tail = m_tail.load(std::memory_order_relaxed);
+        copyOut(tail + sizeof(Header), data, h.size);
+        m_tail.store(tail + sizeof(Header) + h.size, std::memory_order_release);
+    }
+
+    void wait(int msecs)
+    {
+        m_sleeping.store(true);
+        if (m_head.load() == m_tail.load(std::memory_order_relaxed)) {
+            m_wakeup.tryAcquire(1, msecs);
+        }
+        m_sleeping.store(false);
+    }
+
+    void wakeUp()
+    {
+        m_wakeup.release();
+    }
+
+    void reset()
+    {
+        m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    quint32 capacity() const
+    {
+        return m_capacity;
+    }
+
+    quint32 used() const
+    {
+        return static_cast<quint32>(m_head.load(std::memory_order_acquire)
+                                    - m_tail.load(std::memory_order_acquire));
+    }
+
+private:
+    void copyIn(quint64 pos, const void *src, size_t len)
+    {
+        const size_t offset = pos & (m_capacity - 1);
+        const size_t first = qMin(len, size_t(m_capacity - offset));
+        std::memcpy(m_buffer + offset, src, first);
+        std::memcpy(m_buffer, static_cast<const char *>(src) + first, len - first);
+    }
+
+    void copyOut(quint64 pos, void *dst, size_t len) const
+    {
+        const size_t offset = pos & (m_capacity - 1);
+        const size_t first = qMin(len, size_t(m_capacity - offset));
+        std::memcpy(dst, m_buffer + offset, first);
+        std::memcpy(static_cast<char *>(dst) + first, m_buffer, len - first);
+    }
+
+    alignas(64) std::atomic<quint64> m_head{0};
+    alignas(64) std::atomic<quint64> m_tail{0};
+    std::atomic<bool> m_sleeping{false};
+    QSemaphore m_wakeup;
+    quint32 m_capacity;
+    char *m_buffer;
+};
+
+}}
+
+#endif // MIDIRING_H
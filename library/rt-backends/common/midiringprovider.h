@@ -0,0 +1,44 @@
+/*
+    Drumstick MIDI realtime input-output
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MIDIRINGPROVIDER_H
+#define MIDIRINGPROVIDER_H
+
+#include <QtPlugin>
+
+namespace drumstick {
+namespace rt {
+
+class MIDIRing;
+
+/*
+ * Interface of a backend owning a MIDIRing that a peer backend, loaded from
+ * another plugin, may consume. The peer gets it with qobject_cast.
+ */
+class MIDIRingProvider
+{
+public:
+    virtual ~MIDIRingProvider() = default;
+    virtual MIDIRing *ring() = 0;
+};
+
+}}
+
+Q_DECLARE_INTERFACE(drumstick::rt::MIDIRingProvider, "net.sourceforge.drumstick.rt.MIDIRingProvider/1.0")
+
+#endif // MIDIRINGPROVIDER_H
@@ -0,0 +1,211 @@
+/*
+    Drumstick MIDI realtime input-output
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "midithru.h"
+
+namespace drumstick {
+namespace rt {
+
+MIDIThruForwarder::MIDIThruForwarder(QObject *parent) : QThread(parent),
+    m_ring(QUEUE_CAPACITY),
+    m_out(nullptr),
+    m_latencyBudget(0),
+    m_enabled(false),
+    m_running(false),
+    m_forwarded(0),
+    m_overruns(0),
+    m_dropped(0)
+{
+    m_buffer.resize(MIDIRing::MAX_MESSAGE);
+}
+
+MIDIThruForwarder::~MIDIThruForwarder()
+{
+    setEnabled(false);
+}
+
+void MIDIThruForwarder::setOutput(MIDIOutput *device)
+{
+    m_out = device;
+}
+
+MIDIOutput *MIDIThruForwarder::output() const
+{
+    return m_out;
+}
+
+void MIDIThruForwarder::setLatencyBudget(int usecs)
+{
+    m_latencyBudget = qMax(0, usecs);
+}
+
+int MIDIThruForwarder::latencyBudget() const
+{
+    return m_latencyBudget;
+}
+
+void MIDIThruForwarder::setEnabled(bool enable)
+{
+    if (enable && !m_enabled) {
+        m_ring.reset();
+        m_running = true;
+        m_enabled = true;
+        start(QThread::HighPriority);
+    } else if (!enable && m_enabled) {
+        m_enabled = false;
+        m_running = false;
+        m_ring.wakeUp();
+        wait();
+    }
+}
+
+bool MIDIThruForwarder::isEnabled() const
+{
+    return m_enabled;
+}
+
+quint32 MIDIThruForwarder::messageSize(int status)
+{
+    switch (status & MIDI_STATUS_MASK) {
+    case MIDI_STATUS_PROGRAMCHANGE:
+    case MIDI_STATUS_CHANNELPRESSURE:
+        return 2;
+    case MIDI_STATUS_SYSEX:
+        return 1;
+    default:
+        return 3;
+    }
+}
+
+bool MIDIThruForwarder::forward(MIDIOutput *out, int status, int data1, int data2)
+{
+    const char m[3] = { static_cast<char>(status), static_cast<char>(data1), static_cast<char>(data2) };
+    return forward(out, m, messageSize(status));
+}
+
+bool MIDIThruForwarder::forwardPitchBend(MIDIOutput *out, int chan, int value)
+{
+    // -8192 <= value <= 8191
+    const int v = 8192 + value;
+    return forward(out, MIDI_STATUS_PITCHBEND + chan, MIDI_LSB(v), MIDI_MSB(v));
+}
+
+bool MIDIThruForwarder::forwardSysex(MIDIOutput *out, const QByteArray &data)
+{
+    return forward(out, data.constData(), static_cast<quint32>(data.size()));
+}
+
+bool MIDIThruForwarder::forward(MIDIOutput *out, const char *data, quint32 size)
+{
+    if (m_enabled.load(std::memory_order_acquire)) {
+        return postMessage(data, size);
+    }
+    send(out, reinterpret_cast<const unsigned char *>(data), size);
+    return true;
+}
+
+quint64 MIDIThruForwarder::forwarded() const
+{
+    return m_forwarded;
+}
+
+quint64 MIDIThruForwarder::overruns() const
+{
+    return m_overruns;
+}
+
+quint64 MIDIThruForwarder::dropped() const
+{
+    return m_dropped;
+}
+
+bool MIDIThruForwarder::postMessage(const char *data, quint32 size)
+{
+    const qint64 now = MIDIRing::now();
+    const int budget = m_latencyBudget.load(std::memory_order_relaxed);
+    const qint64 deadline = budget > 0 ? now + budget : 0;
+    if (m_ring.write(now, deadline, data, size)) {
+        return true;
+    }
+    m_overruns.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void MIDIThruForwarder::run()
+{
+    MIDIRing::Header h;
+    unsigned char *data = reinterpret_cast<unsigned char *>(m_buffer.data());
+    while (m_running.load(std::memory_order_acquire)) {
+        if (!m_ring.peek(h)) {
+            m_ring.wait(100);
+            continue;
+        }
+        m_ring.read(h, m_buffer.data());
+        if (h.due > 0 && MIDIRing::now() > h.due) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        MIDIOutput *out = m_out.load(std::memory_order_acquire);
+        if (out != nullptr) {
+            send(out, data, h.size);
+            m_forwarded.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void MIDIThruForwarder::send(MIDIOutput *out, const unsigned char *data, quint32 size)
+{
+    if (out == nullptr || size == 0) {
+        return;
+    }
+    const int status = data[0];
+    const int chan = status & MIDI_CHANNEL_MASK;
+    switch (status & MIDI_STATUS_MASK) {
+    case MIDI_STATUS_NOTEOFF:
+        out->sendNoteOff(chan, data[1], data[2]);
+        break;
+    case MIDI_STATUS_NOTEON:
+        out->sendNoteOn(chan, data[1], data[2]);
+        break;
+    case MIDI_STATUS_KEYPRESURE:
+        out->sendKeyPressure(chan, data[1], data[2]);
+        break;
+    case MIDI_STATUS_CONTROLCHANGE:
+        out->sendController(chan, data[1], data[2]);
+        break;
+    case MIDI_STATUS_PROGRAMCHANGE:
+        out->sendProgram(chan, data[1]);
+        break;
+    case MIDI_STATUS_CHANNELPRESSURE:
+        out->sendChannelPressure(chan, data[1]);
+        break;
+    case MIDI_STATUS_PITCHBEND:
+        out->sendPitchBend(chan, data[1] + data[2] * 0x80 - 8192);
+        break;
+    default:
+        if (status == MIDI_STATUS_SYSEX) {
+            out->sendSysex(QByteArray(reinterpret_cast<const char *>(data), static_cast<int>(size)));
+        } else {
+            out->sendSystemMsg(status);
+        }
+        break;
+    }
+}
+
+} // namespace rt
+} // namespace drumstick
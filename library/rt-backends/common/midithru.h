@@ -0,0 +1,92 @@
+/*
+    Drumstick MIDI realtime input-output
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MIDITHRU_H
+#define MIDITHRU_H
+
+#include <QByteArray>
+#include <QThread>
+#include <atomic>
+#include <drumstick/rtmidioutput.h>
+#include "midiring.h"
+
+namespace drumstick {
+namespace rt {
+
+/*
+ * MIDIThruForwarder moves the MIDI thru traffic of an input backend to a
+ * dedicated thread, so a slow output device never stalls the input
+ * handling. The forward functions send the message to the output directly
+ * while the forwarder is disabled. Otherwise they are non-blocking and must
+ * be called from a single thread: a message is counted as an overrun when
+ * the queue is full. Messages waiting longer than the latency budget are
+ * dropped, unless the budget is zero.
+ *
+ * While enabled, the output send functions are called from the forwarder
+ * thread, so the output must accept calls from any thread. Outputs owning
+ * thread-affine objects, like sockets, must queue the calls to their own
+ * thread.
+ */
+class MIDIThruForwarder : public QThread
+{
+public:
+    static const quint32 QUEUE_CAPACITY = 1u << 18;
+
+    explicit MIDIThruForwarder(QObject *parent = nullptr);
+    virtual ~MIDIThruForwarder();
+
+    void setOutput(MIDIOutput *device);
+    MIDIOutput *output() const;
+    void setLatencyBudget(int usecs);
+    int latencyBudget() const;
+
+    void setEnabled(bool enable);
+    bool isEnabled() const;
+
+    bool forward(MIDIOutput *out, int status, int data1 = 0, int data2 = 0);
+    bool forwardPitchBend(MIDIOutput *out, int chan, int value);
+    bool forwardSysex(MIDIOutput *out, const QByteArray &data);
+    bool forward(MIDIOutput *out, const char *data, quint32 size);
+
+    static quint32 messageSize(int status);
+    static void send(MIDIOutput *out, const unsigned char *data, quint32 size);
+
+    quint64 forwarded() const;
+    quint64 overruns() const;
+    quint64 dropped() const;
+
+protected:
+    void run() override;
+
+private:
+    bool postMessage(const char *data, quint32 size);
+
+    MIDIRing m_ring;
+    std::atomic<MIDIOutput *> m_out;
+    std::atomic<int> m_latencyBudget;
+    std::atomic<bool> m_enabled;
+    std::atomic<bool> m_running;
+    std::atomic<quint64> m_forwarded;
+    std::atomic<quint64> m_overruns;
+    std::atomic<quint64> m_dropped;
+    QByteArray m_buffer;
+};
+
+}}
+
+#endif // MIDITHRU_H
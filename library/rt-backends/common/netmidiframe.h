@@ -0,0 +1,78 @@
+/*
+    Drumstick MIDI realtime input-output
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NETMIDIFRAME_H
+#define NETMIDIFRAME_H
+
+#include <QtEndian>
+#include <QtGlobal>
+#include <chrono>
+#include <cstring>
+
+namespace drumstick {
+namespace rt {
+
+/*
+ * Framed datagrams of the Network backends. In raw mode a datagram contains
+ * only MIDI bytes, compatible with ipMIDI and older Drumstick versions.
+ * A framed datagram starts with this header, followed by one or more
+ * complete MIDI messages. The magic number begins with a zero byte, which
+ * is never sent first in raw mode.
+ */
+struct NetMIDIFrame
+{
+    static const int HEADER_SIZE = 16;
+    static const int DEFAULT_MAX_DATAGRAM = 1400;
+    static const int DEFAULT_WINDOW = 1000;
+
+    quint32 sequence;
+    qint64 timestamp; // sender clock, microseconds
+
+    static qint64 now()
+    {
+        using namespace std::chrono;
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    static bool isFramed(const char *data, qint64 size)
+    {
+        return size >= HEADER_SIZE && std::memcmp(data, magic(), 4) == 0;
+    }
+
+    static const char *magic()
+    {
+        return "\0DSF";
+    }
+
+    void write(char *data) const
+    {
+        std::memcpy(data, magic(), 4);
+        qToBigEndian<quint32>(sequence, data + 4);
+        qToBigEndian<qint64>(timestamp, data + 8);
+    }
+
+    void read(const char *data)
+    {
+        sequence = qFromBigEndian<quint32>(data + 4);
+        timestamp = qFromBigEndian<qint64>(data + 8);
+    }
+};
+
+}}
+
+#endif // NETMIDIFRAME_H
@@ -0,0 +1,151 @@
+/*
+    Drumstick MIDI realtime input-output
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WAVEWRITER_H
+#define WAVEWRITER_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+
+namespace drumstick {
+namespace rt {
+
+/*
+ * Minimal RIFF/WAVE writer of 16 bit PCM samples, used by the offline
+ * rendering of the software synthesizer backends. The chunk sizes are
+ * written when the file is closed.
+ */
+class WaveWriter
+{
+public:
+    static const int HEADER_SIZE = 44;
+
+    WaveWriter(const QString &fileName, int sampleRate, int channels = 2):
+        m_file(fileName),
+        m_sampleRate(sampleRate),
+        m_channels(channels),
+        m_frames(0)
+    { }
+
+    ~WaveWriter()
+    {
+        close();
+    }
+
+    bool open()
+    {
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return false;
+        }
+        writeHeader();
+        return m_file.error() == QFileDevice::NoError;
+    }
+
+    bool isOpen() const
+    {
+        return m_file.isOpen();
+    }
+
+    QString errorString() const
+    {
+        return m_file.errorString();
+    }
+
+    qint64 frames() const
+    {
+        return m_frames;
+    }
+
+    int sampleRate() const
+    {
+        return m_sampleRate;
+    }
+
+    void write(const qint16 *samples, int frames)
+    {
+        const int count = frames * m_channels;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        m_file.write(reinterpret_cast<const char *>(samples), count * qint64(sizeof(qint16)));
+#else
+        m_buffer.resize(count);
+        for (int i = 0; i < count; ++i) {
+            m_buffer[i] = qToLittleEndian(samples[i]);
+        }
+        m_file.write(reinterpret_cast<const char *>(m_buffer.constData()), count * qint64(sizeof(qint16)));
+#endif
+        m_frames += frames;
+    }
+
+    void write(const float *samples, int frames)
+    {
+        const int count = frames * m_channels;
+        m_buffer.resize(count);
+        for (int i = 0; i < count; ++i) {
+            const float s = qBound(-1.0f, samples[i], 1.0f) * 32767.0f;
+            m_buffer[i] = qToLittleEndian(static_cast<qint16>(std::lrint(s)));
+        }
+        m_file.write(reinterpret_cast<const char *>(m_buffer.constData()), count * qint64(sizeof(qint16)));
+        m_frames += frames;
+    }
+
+    bool close()
+    {
+        if (!m_file.isOpen()) {
+            return false;
+        }
+        m_file.seek(0);
+        writeHeader();
+        const bool ok = m_file.error() == QFileDevice::NoError;
+        m_file.close();
+        return ok;
+    }
+
+private:
+    void writeHeader()
+    {
+        const quint32 dataSize = static_cast<quint32>(m_frames * m_channels * 2);
+        char h[HEADER_SIZE];
+        std::memcpy(h, "RIFF", 4);
+        qToLittleEndian<quint32>(36 + dataSize, h + 4);
+        std::memcpy(h + 8, "WAVEfmt ", 8);
+        qToLittleEndian<quint32>(16, h + 16);
+        qToLittleEndian<quint16>(1, h + 20); // PCM
+        qToLittleEndian<quint16>(static_cast<quint16>(m_channels), h + 22);
+        qToLittleEndian<quint32>(static_cast<quint32>(m_sampleRate), h + 24);
+        qToLittleEndian<quint32>(static_cast<quint32>(m_sampleRate * m_channels * 2), h + 28);
+        qToLittleEndian<quint16>(static_cast<quint16>(m_channels * 2), h + 32);
+        qToLittleEndian<quint16>(16, h + 34);
+        std::memcpy(h + 36, "data", 4);
+        qToLittleEndian<quint32>(dataSize, h + 40);
+        m_file.write(h, HEADER_SIZE);
+    }
+
+    QFile m_file;
+    int m_sampleRate;
+    int m_channels;
+    qint64 m_frames;
+    QVector<qint16> m_buffer;
+};
+
+}}
+
+#endif // WAVEWRITER_H
@@ -6,14 +6,16 @@ CONFIG += c++11 plugin link_prl
 static {
     CONFIG += staticlib create_prl
 }
-DEPENDPATH += . ../../include
-INCLUDEPATH += . ../../include
+DEPENDPATH += . ../../include ../common
+INCLUDEPATH += . ../../include ../common
 QT -= gui
 LIBS += -L$$OUT_PWD/../../../build/lib -ldrumstick-rt
 
 HEADERS += synthcontroller.h \
            synthrenderer.h \
-           filewrapper.h
+           filewrapper.h \
+           ../common/midiring.h \
+           ../common/wavewriter.h
 
 SOURCES += synthcontroller.cpp \
            synthrenderer.cpp \
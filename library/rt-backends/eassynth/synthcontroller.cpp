@@ -158,6 +158,30 @@ void SynthController::sendSystemMsg(const int status)
     Q_UNUSED(status)
 }
 
+/**
+ * Renders a song into a WAVE file, without PulseAudio. Each call uses its
+ * own EAS instance with the settings of this backend, so it may be invoked
+ * from several threads at once.
+ */
+bool SynthController::renderSong(const MIDISong &song, const QString &fileName)
+{
+    SynthRenderer renderer;
+    renderer.copySettings(m_renderer);
+    renderer.initEngine();
+    bool ok = renderer.renderSong(song, fileName);
+    renderer.stop();
+    return ok;
+}
+
+/**
+ * Reads the settings without starting the synthesizer, which is useful
+ * before renderSong() on hosts without a PulseAudio server.
+ */
+void SynthController::readSettings(QSettings *settings)
+{
+    m_renderer->readSettings(settings);
+}
+
 void SynthController::writeSettings(QSettings *settings)
 {
     m_renderer->writeSettings(settings);
@@ -183,5 +207,20 @@ QString SynthController::getSoundFont()
     return m_renderer->getSoundFont();
 }
 
+int SynthController::getQueueDepth()
+{
+    return m_renderer->getQueueDepth();
+}
+
+qulonglong SynthController::getLateMessages()
+{
+    return m_renderer->getLateMessages();
+}
+
+qulonglong SynthController::getOverruns()
+{
+    return m_renderer->getOverruns();
+}
+
 } // namespace rt
 } // namespace drumstick
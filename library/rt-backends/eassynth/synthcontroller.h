@@ -37,6 +37,9 @@ namespace rt {
         Q_PROPERTY(bool status READ getStatus)
         Q_PROPERTY(QString libversion READ getLibVersion)
         Q_PROPERTY(QString soundfont READ getSoundFont)
+        Q_PROPERTY(int queueDepth READ getQueueDepth)
+        Q_PROPERTY(qulonglong lateMessages READ getLateMessages)
+        Q_PROPERTY(qulonglong overruns READ getOverruns)
 
     public:
         explicit SynthController(QObject *parent = nullptr);
@@ -45,6 +48,8 @@ namespace rt {
         void start();
         void stop();
 
+        Q_INVOKABLE bool renderSong(const drumstick::rt::MIDISong &song, const QString &fileName);
+
         // MIDIOutput interface
     public:
         virtual void initialize(QSettings* settings) override;
@@ -68,6 +73,7 @@ namespace rt {
         virtual void sendSysex(const QByteArray &data) override;
         virtual void sendSystemMsg(const int status) override;
 
+        void readSettings(QSettings *settings);
         void writeSettings(QSettings *settings);
 
     private:
@@ -80,6 +86,9 @@ namespace rt {
         bool getStatus();
         QString getLibVersion();
         QString getSoundFont();
+        int getQueueDepth();
+        qulonglong getLateMessages();
+        qulonglong getOverruns();
     };
 
 }}
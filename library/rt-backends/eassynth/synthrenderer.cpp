@@ -16,8 +16,8 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <QCoreApplication>
 #include <QObject>
+#include <QVector>
 #include <QReadLocker>
 #include <QString>
 #include <QSysInfo>
@@ -28,8 +28,11 @@
 #include <eas_chorus.h>
 #include <eas_reverb.h>
 #include <pulse/simple.h>
+#include <cmath>
+#include <cstdlib>
 #include "synthrenderer.h"
 #include "filewrapper.h"
+#include "wavewriter.h"
 
 namespace drumstick {
 namespace rt {
@@ -42,19 +45,28 @@ const QString SynthRenderer::QSTR_CHORUSTYPE = QStringLiteral("ChorusType");
 const QString SynthRenderer::QSTR_CHORUSAMT = QStringLiteral("ChorusAmt");
 const QString SynthRenderer::QSTR_SONIVOXEAS = QStringLiteral("SonivoxEAS");
 const QString SynthRenderer::QSTR_SOUNDFONT = QStringLiteral("InstrumentsDefinition");
+const QString SynthRenderer::QSTR_TIMESTAMPED = QStringLiteral("TimestampedMIDI");
 
 const int SynthRenderer::DEF_BUFFERTIME = 60;
 const int SynthRenderer::DEF_REVERBTYPE = EAS_PARAM_REVERB_HALL;
 const int SynthRenderer::DEF_REVERBAMT = 25800;
 const int SynthRenderer::DEF_CHORUSTYPE = -1;
 const int SynthRenderer::DEF_CHORUSAMT = 0;
+const int SynthRenderer::MAX_RENDER_TAIL = 10;
+const bool SynthRenderer::DEF_TIMESTAMPED = false;
+
+static const quint32 MIDI_QUEUE_CAPACITY = 1u << 18;
 
 SynthRenderer::SynthRenderer(QObject *parent) : QObject(parent),
     m_Stopped(true),
     m_rendering(nullptr),
     m_easData(nullptr),
     m_streamHandle(nullptr),
-    m_bufferTime(60)
+    m_queue(MIDI_QUEUE_CAPACITY),
+    m_message(MIDIRing::MAX_MESSAGE),
+    m_bufferTime(60),
+    m_pulseHandle(nullptr),
+    m_status(false)
 { }
 
 void
@@ -76,6 +88,7 @@ SynthRenderer::initEAS()
     m_bufferSize = easConfig->mixBufferSize;
     m_channels = easConfig->numChannels;
     m_libVersion = easConfig->libVersion;
+    m_period = qint64(m_bufferSize) * 1000000 / m_sampleRate;
 
     eas_res = EAS_Init(&dataHandle);
     if (eas_res != EAS_SUCCESS) {
@@ -183,22 +196,147 @@ void
 SynthRenderer::initialize(QSettings *settings)
 {
     //qDebug() << Q_FUNC_INFO;
+    readSettings(settings);
+    initEngine();
+}
 
+/**
+ * Initializes the synthesizer with the current preferences.
+ */
+void
+SynthRenderer::initEngine()
+{
+    int reverbType = m_reverbType;
+    int chorusType = m_chorusType;
+    initEAS();
+    initSoundfont();
+    initReverb(reverbType);
+    setReverbWet(m_reverbAmt);
+    initChorus(chorusType);
+    setChorusLevel(m_chorusAmt);
+}
+
+/**
+ * Reads the preferences without initializing the synthesizer.
+ */
+void
+SynthRenderer::readSettings(QSettings *settings)
+{
     settings->beginGroup(QSTR_PREFERENCES);
     m_bufferTime = settings->value(QSTR_BUFFERTIME, DEF_BUFFERTIME).toInt();
-    int reverbType = settings->value(QSTR_REVERBTYPE, DEF_REVERBTYPE).toInt();
-    int reverbAmt = settings->value(QSTR_REVERBAMT, DEF_REVERBAMT).toInt();
-    int chorusType = settings->value(QSTR_CHORUSTYPE, DEF_CHORUSTYPE).toInt();
-    int chorusAmt = settings->value(QSTR_CHORUSAMT, DEF_CHORUSAMT).toInt();
+    m_reverbType = settings->value(QSTR_REVERBTYPE, DEF_REVERBTYPE).toInt();
+    m_reverbAmt = settings->value(QSTR_REVERBAMT, DEF_REVERBAMT).toInt();
+    m_chorusType = settings->value(QSTR_CHORUSTYPE, DEF_CHORUSTYPE).toInt();
+    m_chorusAmt = settings->value(QSTR_CHORUSAMT, DEF_CHORUSAMT).toInt();
     m_soundfont = settings->value(QSTR_SOUNDFONT, QString()).toString();
+    m_timestamped = settings->value(QSTR_TIMESTAMPED, DEF_TIMESTAMPED).toBool();
     settings->endGroup();
+}
 
-    initEAS();
-    initSoundfont();
-    initReverb(reverbType);
-    setReverbWet(reverbAmt);
-    initChorus(chorusType);
-    setChorusLevel(chorusAmt);
+/**
+ * Copies the preferences of another renderer, without initializing this one.
+ */
+void
+SynthRenderer::copySettings(const SynthRenderer *other)
+{
+    m_bufferTime = other->m_bufferTime;
+    m_reverbType = other->m_reverbType;
+    m_reverbAmt = other->m_reverbAmt;
+    m_chorusType = other->m_chorusType;
+    m_chorusAmt = other->m_chorusAmt;
+    m_soundfont = other->m_soundfont;
+    m_timestamped = other->m_timestamped;
+}
+
+/**
+ * Renders a song into a WAVE file as fast as possible, without PulseAudio.
+ * The synthesizer must be initialized, but not running. EAS renders blocks
+ * of mixBufferSize frames, so each event is written to the MIDI stream at
+ * the block boundary nearest to its sample offset. After the last event, the
+ * rendering continues until the output is silent, up to MAX_RENDER_TAIL
+ * seconds. Each renderer owns its EAS instance, so several songs may be
+ * rendered in parallel with different renderers.
+ */
+bool
+SynthRenderer::renderSong(const MIDISong &song, const QString &fileName)
+{
+    if (!m_status || m_easData == nullptr) {
+        m_diagnostics << "The synthesizer is not ready for offline rendering";
+        return false;
+    }
+    WaveWriter writer(fileName, m_sampleRate, m_channels);
+    if (!writer.open()) {
+        m_diagnostics << QString("Error: %1").arg(writer.errorString());
+        return false;
+    }
+    // the bank and program setup from initSoundfont()
+    processQueue();
+    QVector<EAS_PCM> buffer(m_bufferSize * m_channels);
+    qint64 position = 0;
+    bool ok = true;
+    auto render = [&]() {
+        EAS_I32 numGen = 0;
+        EAS_RESULT eas_res = EAS_Render(m_easData, buffer.data(), m_bufferSize, &numGen);
+        if (eas_res != EAS_SUCCESS) {
+            m_diagnostics << QString("EAS_Render error: %1").arg(eas_res);
+            ok = false;
+            return 0;
+        }
+        writer.write(buffer.constData(), numGen);
+        position += numGen;
+        return int(numGen);
+    };
+    for (int i = 0; ok && i < song.count(); ++i) {
+        const SongEvent &ev = song.at(i);
+        const qint64 frame = std::llround(ev.time * double(m_sampleRate) / 1000000.0);
+        while (ok && position + m_bufferSize / 2 <= frame) {
+            render();
+        }
+        sendEvent(song, ev);
+    }
+    // release tail: stop after 100 ms of silence
+    const qint64 tailEnd = position + qint64(m_sampleRate) * MAX_RENDER_TAIL;
+    const qint64 silence = m_sampleRate / 10;
+    qint64 quiet = 0;
+    while (ok && position < tailEnd && quiet < silence) {
+        const int frames = render();
+        bool silent = true;
+        for (int i = 0; silent && i < frames * m_channels; ++i) {
+            silent = std::abs(buffer[i]) < 4;
+        }
+        quiet = silent ? quiet + frames : 0;
+    }
+    return writer.close() && ok;
+}
+
+void
+SynthRenderer::sendEvent(const MIDISong &song, const SongEvent &ev)
+{
+    EAS_U8 data[3] = { ev.status, ev.data1, ev.data2 };
+    EAS_I32 length = 0;
+    switch (ev.status & MIDI_STATUS_MASK) {
+    case MIDI_STATUS_NOTEOFF:
+    case MIDI_STATUS_NOTEON:
+    case MIDI_STATUS_KEYPRESURE:
+    case MIDI_STATUS_CONTROLCHANGE:
+    case MIDI_STATUS_PITCHBEND:
+        length = 3;
+        break;
+    case MIDI_STATUS_PROGRAMCHANGE:
+    case MIDI_STATUS_CHANNELPRESSURE:
+        length = 2;
+        break;
+    default:
+        if (ev.status == MIDI_STATUS_SYSEX) {
+            QByteArray sysex = song.sysexData(ev);
+            writeMIDIData(sysex.constData(), sysex.size());
+        }
+        return;
+    }
+    EAS_RESULT eas_res = EAS_WriteMIDIStream(m_easData, m_streamHandle, data, length);
+    if (eas_res != EAS_SUCCESS) {
+        m_diagnostics << QString("EAS_WriteMIDIStream error: %1").arg(eas_res);
+    }
 }
 
 bool
@@ -230,18 +368,29 @@ SynthRenderer::run()
         if (m_rendering != nullptr) {
             m_rendering->wakeAll();
         }
+        // audio clock: the time when the next rendered block will be heard
+        qint64 clockBase = MIDIRing::now();
+        qint64 clockFrames = 0;
         while (!stopped() && m_status) {
             EAS_RESULT eas_res;
             EAS_I32 numGen = 0;
             size_t bytes = 0;
-            QCoreApplication::sendPostedEvents();
             if (m_easData != nullptr)
             {
+                qint64 clock = clockBase + clockFrames * 1000000 / m_sampleRate;
+                const qint64 now = MIDIRing::now();
+                if (clock < now) {
+                    // underrun, or the stream has just started
+                    clockBase = clock = now;
+                    clockFrames = 0;
+                }
+                processQueue(m_timestamped ? clock : 0);
                 EAS_PCM *buffer = (EAS_PCM *) data;
                 eas_res = EAS_Render(m_easData, buffer, m_bufferSize, &numGen);
                 if (eas_res != EAS_SUCCESS) {
                     m_diagnostics << QString("EAS_Render error: %1").arg(eas_res);
                 }
+                clockFrames += numGen;
                 bytes += (size_t) numGen * sizeof(EAS_PCM) * m_channels;
                 // hand over to pulseaudio the rendered buffer
                 if (pa_simple_write (m_pulseHandle, data, bytes, &pa_err) < 0)
@@ -260,14 +409,13 @@ SynthRenderer::run()
 }
 
 void
-SynthRenderer::writeMIDIData(const QByteArray& message)
+SynthRenderer::writeMIDIData(const char *data, int size)
 {
     EAS_RESULT eas_res = EAS_ERROR_ALREADY_STOPPED;
     if (m_easData != nullptr && m_streamHandle != nullptr)
     {
-        if (message.length() > 0) {
-            //qDebug() << Q_FUNC_INFO << message.toHex();
-            eas_res = EAS_WriteMIDIStream(m_easData, m_streamHandle, (EAS_U8 *)message.data(), message.length());
+        if (size > 0) {
+            eas_res = EAS_WriteMIDIStream(m_easData, m_streamHandle, (EAS_U8 *)data, size);
             if (eas_res != EAS_SUCCESS) {
                 m_diagnostics << QString("EAS_WriteMIDIStream error: %1").arg(eas_res);
             }
@@ -275,6 +423,60 @@ SynthRenderer::writeMIDIData(const QByteArray& message)
     }
 }
 
+/*
+ * Producer side of the MIDI queue. It is called by the controller slots,
+ * maybe from several threads, so the producers are serialized by a mutex
+ * that the rendering loop never takes. It does not allocate memory, and a
+ * full queue drops the message.
+ */
+void
+SynthRenderer::enqueue(const char *data, int size)
+{
+    QMutexLocker locker(&m_producer);
+    if (m_queue.write(MIDIRing::now(), 0, data, size)) {
+        m_queued.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        m_overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/*
+ * Consumer side of the MIDI queue, called by the rendering loop before each
+ * EAS_Render(). Without a clock, every pending message is applied, and the
+ * messages older than one rendering period are counted as late. With
+ * timestamped MIDI, the clock is the time when the next block will be heard,
+ * and each message is applied at the block nearest to its reception time
+ * plus the buffer time, so the relative timing of the messages is kept
+ * with a resolution of one block, regardless of the bursts of the loop
+ * while filling the PulseAudio buffer. Messages that missed their block
+ * are late.
+ */
+void
+SynthRenderer::processQueue(qint64 clock)
+{
+    MIDIRing::Header h;
+    const qint64 now = MIDIRing::now();
+    const qint64 latency = qint64(m_bufferTime) * 1000;
+    while (m_queue.peek(h)) {
+        bool late;
+        if (clock > 0) {
+            const qint64 due = h.sent + latency;
+            if (due >= clock + m_period / 2) {
+                break;
+            }
+            late = due < clock - m_period;
+        } else {
+            late = now - h.sent > m_period;
+        }
+        m_queue.read(h, m_message.data());
+        if (late) {
+            m_late.fetch_add(1, std::memory_order_relaxed);
+        }
+        writeMIDIData(m_message.constData(), int(h.size));
+        m_dequeued.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
 void SynthRenderer::initSoundfont()
 {
     //qDebug() << Q_FUNC_INFO;
@@ -323,6 +525,21 @@ QString SynthRenderer::getSoundFont()
     return m_soundfont;
 }
 
+int SynthRenderer::getQueueDepth() const
+{
+    return int(m_queued.load(std::memory_order_relaxed) - m_dequeued.load(std::memory_order_relaxed));
+}
+
+quint64 SynthRenderer::getLateMessages() const
+{
+    return m_late.load(std::memory_order_relaxed);
+}
+
+quint64 SynthRenderer::getOverruns() const
+{
+    return m_overruns.load(std::memory_order_relaxed);
+}
+
 void SynthRenderer::writeSettings(QSettings *settings)
 {
     if (settings != nullptr) {
@@ -333,6 +550,7 @@ void SynthRenderer::writeSettings(QSettings *settings)
         settings->setValue(QSTR_CHORUSTYPE, m_chorusType);
         settings->setValue(QSTR_CHORUSAMT, m_chorusAmt);
         settings->setValue(QSTR_SOUNDFONT, m_soundfont);
+        settings->setValue(QSTR_TIMESTAMPED, m_timestamped);
         settings->endGroup();
     }
 }
@@ -402,31 +620,22 @@ SynthRenderer::setChorusLevel(int amount)
 void
 SynthRenderer::sendMessage(int m0)
 {
-    QByteArray m;
-    m.resize(1);
-    m[0] = m0;
-    writeMIDIData(m);
+    const char m[1] = { char(m0) };
+    enqueue(m, sizeof(m));
 }
 
 void
 SynthRenderer::sendMessage(int m0, int m1)
 {
-    QByteArray m;
-    m.resize(2);
-    m[0] = m0;
-    m[1] = m1;
-    writeMIDIData(m);
+    const char m[2] = { char(m0), char(m1) };
+    enqueue(m, sizeof(m));
 }
 
 void
 SynthRenderer::sendMessage(int m0, int m1, int m2)
 {
-    QByteArray m;
-    m.resize(3);
-    m[0] = m0;
-    m[1] = m1;
-    m[2] = m2;
-    writeMIDIData(m);
+    const char m[3] = { char(m0), char(m1), char(m2) };
+    enqueue(m, sizeof(m));
 }
 
 MIDIConnection
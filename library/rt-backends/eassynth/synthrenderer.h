@@ -19,13 +19,20 @@
 #ifndef SYNTHRENDERER_H_
 #define SYNTHRENDERER_H_
 
+#include <QMutex>
 #include <QObject>
 #include <QReadWriteLock>
 #include <QWaitCondition>
 #include <QSettings>
+#include <QVector>
+#include <atomic>
 #include <pulse/simple.h>
 #include <drumstick/rtmidioutput.h>
+#include <drumstick/rtmidisequencer.h>
 #include "eas.h"
+#include "midiring.h"
+
+class RtTest;
 
 namespace drumstick { namespace rt {
 
@@ -49,11 +56,18 @@ namespace drumstick { namespace rt {
         MIDIConnection connection();
         void setBufferTime(int milliseconds);
         void initialize(QSettings* settings);
+        void readSettings(QSettings* settings);
+        void initEngine();
+        void copySettings(const SynthRenderer *other);
+        bool renderSong(const MIDISong &song, const QString &fileName);
         bool getStatus() const;
         QStringList getDiagnostics() const;
         void setCondition(QWaitCondition *cond);
         QString getLibVersion();
         QString getSoundFont();
+        int getQueueDepth() const;
+        quint64 getLateMessages() const;
+        quint64 getOverruns() const;
         void writeSettings(QSettings *settings);
 
         static const QString QSTR_PREFERENCES;
@@ -64,20 +78,28 @@ namespace drumstick { namespace rt {
         static const QString QSTR_CHORUSAMT;
         static const QString QSTR_SONIVOXEAS;
         static const QString QSTR_SOUNDFONT;
+        static const QString QSTR_TIMESTAMPED;
 
         static const int DEF_BUFFERTIME;
         static const int DEF_REVERBTYPE;
         static const int DEF_REVERBAMT;
         static const int DEF_CHORUSTYPE;
         static const int DEF_CHORUSAMT;
+        static const int MAX_RENDER_TAIL;
+        static const bool DEF_TIMESTAMPED;
 
     private:
+        friend class ::RtTest;
+
         void initEAS();
         void initPulse();
         void uninitEAS();
         void uninitPulse();
-        void writeMIDIData(const QByteArray& message);
+        void writeMIDIData(const char *data, int size);
+        void enqueue(const char *data, int size);
+        void processQueue(qint64 clock = 0);
         void initSoundfont();
+        void sendEvent(const MIDISong &song, const SongEvent &ev);
 
     public Q_SLOTS:
         void run();
@@ -94,6 +116,15 @@ namespace drumstick { namespace rt {
         EAS_DATA_HANDLE m_easData;
         EAS_HANDLE m_streamHandle;
         QString m_soundfont;
+        /* MIDI queue, from the controller thread into the rendering loop */
+        MIDIRing m_queue;
+        QMutex m_producer; // the ring has a single producer
+        QVector<char> m_message;
+        qint64 m_period{0};
+        std::atomic<quint64> m_queued{0};
+        std::atomic<quint64> m_dequeued{0};
+        std::atomic<quint64> m_late{0};
+        std::atomic<quint64> m_overruns{0};
         /* pulseaudio */
         int m_bufferTime{DEF_BUFFERTIME};
         pa_simple *m_pulseHandle;
@@ -105,6 +136,7 @@ namespace drumstick { namespace rt {
         int m_reverbAmt{DEF_REVERBAMT};
         int m_chorusType{DEF_CHORUSTYPE};
         int m_chorusAmt{DEF_CHORUSAMT};
+        bool m_timestamped{DEF_TIMESTAMPED};
     };
 
 }} /* drumstick::rt */
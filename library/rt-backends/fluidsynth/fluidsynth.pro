@@ -3,14 +3,17 @@ TARGET = $$qtLibraryTarget(drumstick-rt-fluidsynth)
 DESTDIR = ../../../build/lib/drumstick2
 include (../../../global.pri)
 CONFIG += c++11 plugin #create_prl
-DEPENDPATH += . ../../include
-INCLUDEPATH += . ../../include
+DEPENDPATH += . ../../include ../common
+INCLUDEPATH += . ../../include ../common
 QT -= gui
 
-HEADERS += fluidsynthengine.h \
-           fluidsynthoutput.h
+HEADERS += ../common/midiring.h \
+           ../common/wavewriter.h \
+           fluidsynthengine.h \
+           fluidsynthoutput.h \
+           soundfontcache.h
 
-SOURCES += fluidsynthoutput.cpp fluidsynthengine.cpp
+SOURCES += fluidsynthoutput.cpp fluidsynthengine.cpp soundfontcache.cpp
 
 LIBS += -L$$OUT_PWD/../../../build/lib -ldrumstick-rt
 
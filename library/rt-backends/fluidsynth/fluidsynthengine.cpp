@@ -21,9 +21,13 @@
 #include <QFileInfo>
 #include <QSettings>
 #include <QStandardPaths>
+#include <QVarLengthArray>
 #include <QVersionNumber>
 #include <drumstick/rtmidioutput.h>
+#include <cmath>
+#include <cstring>
 #include "fluidsynthengine.h"
+#include "wavewriter.h"
 
 namespace drumstick { namespace rt {
 
@@ -46,6 +50,12 @@ const QString FluidSynthEngine::QSTR_CHORUS = QStringLiteral("Chorus");
 const QString FluidSynthEngine::QSTR_REVERB = QStringLiteral("Reverb");
 const QString FluidSynthEngine::QSTR_GAIN = QStringLiteral("Gain");
 const QString FluidSynthEngine::QSTR_POLYPHONY = QStringLiteral("Polyphony");
+const QString FluidSynthEngine::QSTR_TIMESTAMPED = QStringLiteral("TimestampedMIDI");
+const QString FluidSynthEngine::QSTR_SHAREDSOUNDFONTS = QStringLiteral("SharedSoundFonts");
+const QString FluidSynthEngine::QSTR_DYNAMICSAMPLES = QStringLiteral("DynamicSampleLoading");
+const QString FluidSynthEngine::QSTR_CPUCORES = QStringLiteral("CpuCores");
+const QString FluidSynthEngine::QSTR_RENDERCPUCORES = QStringLiteral("RenderCpuCores");
+const QString FluidSynthEngine::QSTR_TELEMETRY = QStringLiteral("AudioTelemetry");
 
 const QString FluidSynthEngine::QSTR_CHORUS_DEPTH = QStringLiteral("chorus_depth");
 const QString FluidSynthEngine::QSTR_CHORUS_LEVEL = QStringLiteral("chorus_level");
@@ -73,6 +83,16 @@ const int FluidSynthEngine::DEFAULT_CHORUS = 0;
 const int FluidSynthEngine::DEFAULT_REVERB = 1;
 const double FluidSynthEngine::DEFAULT_GAIN = 1.0;
 const int FluidSynthEngine::DEFAULT_POLYPHONY = 256;
+const int FluidSynthEngine::MAX_RENDER_TAIL = 10;
+const bool FluidSynthEngine::DEFAULT_TIMESTAMPED = false;
+const bool FluidSynthEngine::DEFAULT_SHAREDSOUNDFONTS = false;
+const bool FluidSynthEngine::DEFAULT_DYNAMICSAMPLES = false;
+const int FluidSynthEngine::DEFAULT_CPUCORES = 1;
+const int FluidSynthEngine::DEFAULT_RENDERCPUCORES = 1;
+const bool FluidSynthEngine::DEFAULT_TELEMETRY = false;
+
+static const quint32 MIDI_QUEUE_CAPACITY = 1u << 18;
+static const qint64 XRUN_WINDOW = 1000000; // microseconds of audio
 
 static void
 SynthEngine_log_function(int level, const char* message, void* data)
@@ -81,20 +101,35 @@ SynthEngine_log_function(int level, const char* message, void* data)
     classInstance->appendDiagnostics(level, message);
 }
 
-FluidSynthEngine::FluidSynthEngine(QObject *parent)
+static int
+SynthEngine_audio_function(void *data, int len, int nfx, float *fx[], int nout, float *out[])
+{
+    FluidSynthEngine* classInstance = static_cast<FluidSynthEngine*>(data);
+    return classInstance->processAudio(len, nfx, fx, nout, out);
+}
+
+FluidSynthEngine::FluidSynthEngine(QObject *parent, bool offline)
     : QObject(parent),
       m_settings(nullptr),
       m_synth(nullptr),
-      m_driver(nullptr)
+      m_driver(nullptr),
+      m_offline(offline),
+      m_status(false),
+      m_queue(MIDI_QUEUE_CAPACITY),
+      m_message(MIDIRing::MAX_MESSAGE)
 {
     //qDebug() << Q_FUNC_INFO;
     m_runtimeLibraryVersion = ::fluid_version_str();
+    m_keyPressure = QVersionNumber::fromString(m_runtimeLibraryVersion) >= QVersionNumber(2,0,0);
     //qDebug() << "Compiled FluidSynth Version:" << QSTR_FLUIDSYNTH_VERSION;
     //qDebug() << "Runtime FluidSynth Version:" << m_runtimeLibraryVersion;
     //::fluid_set_log_function(fluid_log_level::FLUID_DBG, &SynthEngine_log_function, this);
-    ::fluid_set_log_function(fluid_log_level::FLUID_ERR, &SynthEngine_log_function, this);
-    ::fluid_set_log_function(fluid_log_level::FLUID_WARN, &SynthEngine_log_function, this);
-    ::fluid_set_log_function(fluid_log_level::FLUID_INFO, &SynthEngine_log_function, this);
+    if (!m_offline) {
+        // the log functions are global, owned by the live engine
+        ::fluid_set_log_function(fluid_log_level::FLUID_ERR, &SynthEngine_log_function, this);
+        ::fluid_set_log_function(fluid_log_level::FLUID_WARN, &SynthEngine_log_function, this);
+        ::fluid_set_log_function(fluid_log_level::FLUID_INFO, &SynthEngine_log_function, this);
+    }
 }
 
 FluidSynthEngine::~FluidSynthEngine()
@@ -110,10 +145,21 @@ void FluidSynthEngine::uninitialize()
         ::delete_fluid_audio_driver(m_driver);
         m_driver = nullptr;
     }
+    m_queueing = false;
+    m_queue.reset();
+    m_lastCallback = 0;
+    m_instrumented = false;
+    m_audioStart = 0;
+    m_audioFrames = 0;
+    m_minLag = 0;
+    m_loadFactor = 0.0;
+    m_voiceSteals = 0;
+    m_xruns = 0;
     if (m_synth != nullptr) {
         ::delete_fluid_synth(m_synth);
         m_synth = nullptr;
     }
+    unloadSoundFonts();
     if (m_settings != nullptr) {
         ::delete_fluid_settings(m_settings);
         m_settings = nullptr;
@@ -151,38 +197,93 @@ void FluidSynthEngine::initializeSynth()
     ::fluid_settings_setint(m_settings, "synth.reverb.active", fs_reverb);
     ::fluid_settings_setnum(m_settings, "synth.gain", fs_gain);
     ::fluid_settings_setint(m_settings, "synth.polyphony", fs_polyphony);
+    ::fluid_settings_setint(m_settings, "synth.dynamic-sample-loading", fs_dynamicSamples ? 1 : 0);
+    // several offline engines render at once, so they don't inherit CpuCores
+    ::fluid_settings_setint(m_settings, "synth.cpu-cores", m_offline ? fs_renderCpuCores : fs_cpuCores);
     m_synth = ::new_fluid_synth(m_settings);
-    m_driver = ::new_fluid_audio_driver(m_settings, m_synth);
+    if (fs_sharedSoundFonts && m_synth != nullptr) {
+        // tried before the default loader, reading the files from the cache
+        fluid_sfloader_t *loader = ::new_fluid_defsfloader(m_settings);
+        SoundFontCache::instance()->installCallbacks(loader);
+        ::fluid_synth_add_sfloader(m_synth, loader);
+    }
+    if (!m_offline) {
+        if (fs_telemetry || fs_timestamped) {
+            // our own audio callback, when the driver supports it
+            ::fluid_settings_getnum(m_settings, "synth.sample-rate", &m_audioRate);
+            m_driver = ::new_fluid_audio_driver2(m_settings, &SynthEngine_audio_function, this);
+            m_instrumented = (m_driver != nullptr);
+            m_queueing = m_instrumented && fs_timestamped;
+        }
+        if (m_driver == nullptr) {
+            m_driver = ::new_fluid_audio_driver(m_settings, m_synth);
+        }
+    }
 }
 
 void FluidSynthEngine::setInstrument(int channel, int pgm)
 {
+    if (queueMessage(MIDI_STATUS_PROGRAMCHANGE + channel, pgm)) {
+        return;
+    }
     ::fluid_synth_program_change(m_synth, channel, pgm);
 }
 
 void FluidSynthEngine::noteOn(int channel, int midiNote, int velocity)
 {
+    if (queueMessage(MIDI_STATUS_NOTEON + channel, midiNote, velocity)) {
+        return;
+    }
+    if (velocity > 0) {
+        countVoiceSteal();
+    }
     ::fluid_synth_noteon(m_synth, channel, midiNote, velocity);
 }
 
 void FluidSynthEngine::noteOff(int channel, int midiNote, int /*velocity*/)
 {
+    if (queueMessage(MIDI_STATUS_NOTEOFF + channel, midiNote)) {
+        return;
+    }
     ::fluid_synth_noteoff(m_synth, channel, midiNote);
 }
 
-void FluidSynthEngine::loadSoundFont()
+void FluidSynthEngine::unloadSoundFonts()
 {
-    if (!m_sfids.isEmpty()) {
+    if (m_synth != nullptr && !m_sfids.isEmpty()) {
         foreach (const int id, m_sfids) {
             if (id > -1) {
                 ::fluid_synth_sfunload(m_synth, unsigned(id), 1);
             }
         }
-        m_sfids.clear();
     }
+    m_sfids.clear();
+    foreach (SoundFontCache::SoundFont *sf, m_sfcache) {
+        SoundFontCache::instance()->release(sf);
+    }
+    m_sfcache.clear();
+}
+
+/*
+ * With shared soundfonts, each file is pinned in the process wide cache for
+ * the life of the engine, and loaded by its canonical path, which is also
+ * the key of the FluidSynth sample cache. This way, the sample data of a
+ * soundfont is kept once in memory, regardless of the number of engines.
+ */
+void FluidSynthEngine::loadSoundFont()
+{
+    unloadSoundFonts();
     const QStringList soundfonts = m_soundFont.split(';', Qt::SkipEmptyParts);
     foreach (const QString &sf, soundfonts) {
-        int id = ::fluid_synth_sfload(m_synth, qPrintable(sf), 1);
+        QString fileName = sf;
+        if (fs_sharedSoundFonts) {
+            SoundFontCache::SoundFont *cached = SoundFontCache::instance()->acquire(sf);
+            if (cached != nullptr) {
+                m_sfcache.append(cached);
+                fileName = cached->path;
+            }
+        }
+        int id = ::fluid_synth_sfload(m_synth, qPrintable(fileName), 1);
         if (id > -1) {
             m_sfids.append(id);
         }
@@ -215,7 +316,7 @@ void FluidSynthEngine::initialize()
         m_soundFont = m_defSoundFont;
     }
     loadSoundFont();
-    m_status = (m_synth != nullptr) && (m_driver != nullptr) && (!m_sfids.isEmpty());
+    m_status = (m_synth != nullptr) && (m_offline || m_driver != nullptr) && (!m_sfids.isEmpty());
 }
 
 void FluidSynthEngine::panic()
@@ -225,21 +326,33 @@ void FluidSynthEngine::panic()
 
 void FluidSynthEngine::controlChange(const int channel, const int midiCtl, const int value)
 {
+    if (queueMessage(MIDI_STATUS_CONTROLCHANGE + channel, midiCtl, value)) {
+        return;
+    }
     ::fluid_synth_cc(m_synth, channel, midiCtl, value);
 }
 
 void FluidSynthEngine::bender(const int channel, const int value)
 {
+    if (queueMessage(MIDI_STATUS_PITCHBEND + channel, MIDI_LSB(value + 8192), MIDI_MSB(value + 8192))) {
+        return;
+    }
     ::fluid_synth_pitch_bend(m_synth, channel, value + 8192);
 }
 
 void FluidSynthEngine::channelPressure(const int channel, const int value)
 {
+    if (queueMessage(MIDI_STATUS_CHANNELPRESSURE + channel, value)) {
+        return;
+    }
     ::fluid_synth_channel_pressure(m_synth, channel, value);
 }
 
 void FluidSynthEngine::keyPressure(const int channel, const int midiNote, const int value)
 {
+    if (queueMessage(MIDI_STATUS_KEYPRESURE + channel, midiNote, value)) {
+        return;
+    }
     static const QVersionNumber versionCheck(2,0,0);
     QVersionNumber fluidVersion = QVersionNumber::fromString(getLibVersion());
     if (fluidVersion >= versionCheck) {
@@ -249,6 +362,15 @@ void FluidSynthEngine::keyPressure(const int channel, const int midiNote, const
 
 void FluidSynthEngine::sysex(const QByteArray &data)
 {
+    if (m_queueing) {
+        QByteArray d(data);
+        if (!d.startsWith(char(MIDI_STATUS_SYSEX))) {
+            d.prepend(char(MIDI_STATUS_SYSEX));
+        }
+        QMutexLocker locker(&m_producer);
+        m_queue.write(MIDIRing::now(), 0, d.constData(), quint32(d.size()));
+        return;
+    }
     const unsigned char SYSEX = 0xf0;
     const unsigned char EOX = 0xf7;
     QByteArray d(data);
@@ -306,6 +428,35 @@ bool FluidSynthEngine::getStatus()
     return m_status;
 }
 
+/**
+ * Returns the average rendering time divided by the audio period, where 1.0
+ * means that the synthesizer uses all the available time. Without the audio
+ * callback, it is the CPU load estimated by FluidSynth.
+ */
+double FluidSynthEngine::getLoadFactor()
+{
+    if (m_instrumented) {
+        return m_loadFactor;
+    }
+    return m_synth == nullptr ? 0.0 : ::fluid_synth_get_cpu_load(m_synth) / 100.0;
+}
+
+int FluidSynthEngine::getActiveVoices()
+{
+    return m_synth == nullptr ? 0 : ::fluid_synth_get_active_voice_count(m_synth);
+}
+
+/*
+ * FluidSynth does not report the voices it steals, so the note-on messages
+ * received at full polyphony are counted instead.
+ */
+void FluidSynthEngine::countVoiceSteal()
+{
+    if (m_synth != nullptr && ::fluid_synth_get_active_voice_count(m_synth) >= fs_polyphony) {
+        ++m_voiceSteals;
+    }
+}
+
 void FluidSynthEngine::writeSettings(QSettings *settings)
 {
     if (settings != nullptr) {
@@ -331,11 +482,263 @@ void FluidSynthEngine::writeSettings(QSettings *settings)
         settings->setValue(QSTR_CHORUS_LEVEL, fs_chorus_level);
         settings->setValue(QSTR_CHORUS_NR, fs_chorus_nr);
         settings->setValue(QSTR_CHORUS_SPEED, fs_chorus_speed);
+        settings->setValue(QSTR_TIMESTAMPED, fs_timestamped);
+        settings->setValue(QSTR_SHAREDSOUNDFONTS, fs_sharedSoundFonts);
+        settings->setValue(QSTR_DYNAMICSAMPLES, fs_dynamicSamples);
+        settings->setValue(QSTR_CPUCORES, fs_cpuCores);
+        settings->setValue(QSTR_RENDERCPUCORES, fs_renderCpuCores);
+        settings->setValue(QSTR_TELEMETRY, fs_telemetry);
 
         settings->endGroup();
     }
 }
 
+/**
+ * Copies the synthesizer settings and soundfonts of another engine,
+ * without initializing this one.
+ */
+void FluidSynthEngine::copySettings(const FluidSynthEngine *other)
+{
+    m_soundFont = other->m_soundFont;
+    m_defSoundFont = other->m_defSoundFont;
+    fs_audiodriver = other->fs_audiodriver;
+    fs_periodSize = other->fs_periodSize;
+    fs_periods = other->fs_periods;
+    fs_sampleRate = other->fs_sampleRate;
+    fs_chorus = other->fs_chorus;
+    fs_reverb = other->fs_reverb;
+    fs_gain = other->fs_gain;
+    fs_polyphony = other->fs_polyphony;
+    fs_reverb_damp = other->fs_reverb_damp;
+    fs_reverb_level = other->fs_reverb_level;
+    fs_reverb_size = other->fs_reverb_size;
+    fs_reverb_width = other->fs_reverb_width;
+    fs_chorus_depth = other->fs_chorus_depth;
+    fs_chorus_level = other->fs_chorus_level;
+    fs_chorus_nr = other->fs_chorus_nr;
+    fs_chorus_speed = other->fs_chorus_speed;
+    fs_timestamped = other->fs_timestamped;
+    fs_sharedSoundFonts = other->fs_sharedSoundFonts;
+    fs_dynamicSamples = other->fs_dynamicSamples;
+    fs_cpuCores = other->fs_cpuCores;
+    fs_renderCpuCores = other->fs_renderCpuCores;
+    fs_telemetry = other->fs_telemetry;
+}
+
+/**
+ * Renders a song into a WAVE file as fast as possible. Requires an offline
+ * engine, already initialized. The synthesizer is driven directly with
+ * fluid_synth_write_float(), splitting the render calls at the frame of
+ * each event. After the last event, the rendering continues until all
+ * the voices are released, up to MAX_RENDER_TAIL seconds.
+ */
+bool FluidSynthEngine::renderSong(const MIDISong &song, const QString &fileName)
+{
+    if (!m_offline || !m_status) {
+        m_diagnostics << tr("Error: the engine is not ready for offline rendering");
+        return false;
+    }
+    WaveWriter writer(fileName, qRound(fs_sampleRate));
+    if (!writer.open()) {
+        m_diagnostics << tr("Error: %1").arg(writer.errorString());
+        return false;
+    }
+    ::fluid_synth_system_reset(m_synth);
+    const int block = qMax(64, fs_periodSize);
+    QVector<float> buffer(block * 2);
+    qint64 position = 0;
+    auto render = [&](int frames) {
+        ::fluid_synth_write_float(m_synth, frames, buffer.data(), 0, 2, buffer.data(), 1, 2);
+        writer.write(buffer.constData(), frames);
+        position += frames;
+    };
+    for (int i = 0; i < song.count(); ++i) {
+        const SongEvent &ev = song.at(i);
+        const qint64 frame = std::llround(ev.time * fs_sampleRate / 1000000.0);
+        while (position < frame) {
+            render(static_cast<int>(qMin<qint64>(block, frame - position)));
+        }
+        sendEvent(song, ev);
+    }
+    const qint64 tailEnd = position + static_cast<qint64>(fs_sampleRate * MAX_RENDER_TAIL);
+    while (position < tailEnd && ::fluid_synth_get_active_voice_count(m_synth) > 0) {
+        render(block);
+    }
+    return writer.close();
+}
+
+void FluidSynthEngine::sendEvent(const MIDISong &song, const SongEvent &ev)
+{
+    const int chan = ev.status & MIDI_CHANNEL_MASK;
+    switch (ev.status & MIDI_STATUS_MASK) {
+    case MIDI_STATUS_NOTEOFF:
+        noteOff(chan, ev.data1, ev.data2);
+        break;
+    case MIDI_STATUS_NOTEON:
+        noteOn(chan, ev.data1, ev.data2);
+        break;
+    case MIDI_STATUS_KEYPRESURE:
+        keyPressure(chan, ev.data1, ev.data2);
+        break;
+    case MIDI_STATUS_CONTROLCHANGE:
+        controlChange(chan, ev.data1, ev.data2);
+        break;
+    case MIDI_STATUS_PROGRAMCHANGE:
+        setInstrument(chan, ev.data1);
+        break;
+    case MIDI_STATUS_CHANNELPRESSURE:
+        channelPressure(chan, ev.data1);
+        break;
+    case MIDI_STATUS_PITCHBEND:
+        bender(chan, ev.data1 + ev.data2 * 0x80 - 8192);
+        break;
+    default:
+        if (ev.status == MIDI_STATUS_SYSEX) {
+            sysex(song.sysexData(ev));
+        }
+        break;
+    }
+}
+
+/*
+ * With timestamped MIDI, the messages are stamped when received and queued
+ * for the audio callback, instead of being applied by the caller thread.
+ * The callers may run in several threads, so the producers are serialized
+ * by a mutex that the audio callback never takes.
+ */
+bool FluidSynthEngine::queueMessage(int m0, int m1, int m2)
+{
+    if (!m_queueing) {
+        return false;
+    }
+    const char m[3] = { char(m0), char(m1), char(m2) };
+    QMutexLocker locker(&m_producer);
+    m_queue.write(MIDIRing::now(), 0, m, sizeof(m)); // dropped if full
+    return true;
+}
+
+void FluidSynthEngine::dispatchMessage(const char *data, int size)
+{
+    const int status = quint8(data[0]);
+    const int chan = status & MIDI_CHANNEL_MASK;
+    const int d1 = size > 1 ? quint8(data[1]) : 0;
+    const int d2 = size > 2 ? quint8(data[2]) : 0;
+    switch (status & MIDI_STATUS_MASK) {
+    case MIDI_STATUS_NOTEOFF:
+        ::fluid_synth_noteoff(m_synth, chan, d1);
+        break;
+    case MIDI_STATUS_NOTEON:
+        if (d2 > 0) {
+            countVoiceSteal();
+        }
+        ::fluid_synth_noteon(m_synth, chan, d1, d2);
+        break;
+    case MIDI_STATUS_KEYPRESURE:
+        if (m_keyPressure) {
+            ::fluid_synth_key_pressure(m_synth, chan, d1, d2);
+        }
+        break;
+    case MIDI_STATUS_CONTROLCHANGE:
+        ::fluid_synth_cc(m_synth, chan, d1, d2);
+        break;
+    case MIDI_STATUS_PROGRAMCHANGE:
+        ::fluid_synth_program_change(m_synth, chan, d1);
+        break;
+    case MIDI_STATUS_CHANNELPRESSURE:
+        ::fluid_synth_channel_pressure(m_synth, chan, d1);
+        break;
+    case MIDI_STATUS_PITCHBEND:
+        ::fluid_synth_pitch_bend(m_synth, chan, d1 + d2 * 0x80);
+        break;
+    default:
+        if (status == MIDI_STATUS_SYSEX) {
+            // without the leading 0xf0 and the trailing 0xf7
+            const int length = size - (quint8(data[size - 1]) == MIDI_STATUS_ENDSYSEX ? 2 : 1);
+            if (length > 0) {
+                ::fluid_synth_sysex(m_synth, data + 1, length, nullptr, nullptr, nullptr, 0);
+            }
+        }
+        break;
+    }
+}
+
+void FluidSynthEngine::renderFrames(int from, int to, int nfx, float *fx[], int nout, float *out[])
+{
+    QVarLengthArray<float*, 16> fxp(nfx), outp(nout);
+    for (int i = 0; i < nfx; ++i) {
+        fxp[i] = fx[i] + from;
+    }
+    for (int i = 0; i < nout; ++i) {
+        outp[i] = out[i] + from;
+    }
+    ::fluid_synth_process(m_synth, to - from, nfx, fxp.data(), nout, outp.data());
+}
+
+/**
+ * Audio callback. With timestamped MIDI, the messages received during
+ * the previous callback period are applied at the proportional frame of
+ * this block, splitting the fluid_synth_process() calls at each message.
+ * This keeps the relative timing of the messages, with a constant latency
+ * of one audio period, instead of quantizing them to the period size.
+ * FluidSynth still starts the voices at its internal 64 frames boundaries.
+ * Otherwise, the queue is empty and the whole block is rendered at once.
+ *
+ * The callback also measures the load factor, and estimates the xruns: an
+ * xrun is counted each time a callback comes later than the audio clock
+ * predicts by more than the buffer time. The audio clock is anchored again
+ * at the earliest callback of each XRUN_WINDOW, so the drift between the
+ * sound card and the system clock is not counted as xruns.
+ */
+int FluidSynthEngine::processAudio(int len, int nfx, float *fx[], int nout, float *out[])
+{
+    const qint64 now = MIDIRing::now();
+    const qint64 bufferTime = qint64(1e6 * fs_periods * fs_periodSize / m_audioRate);
+    const qint64 audioTime = qint64(1e6 * m_audioFrames / m_audioRate);
+    const qint64 lag = now - m_audioStart - audioTime;
+    if (m_audioStart == 0 || lag > bufferTime) {
+        if (m_audioStart > 0) {
+            ++m_xruns;
+        }
+        m_audioStart = now;
+        m_audioFrames = 0;
+        m_minLag = 0;
+    } else if (audioTime >= XRUN_WINDOW) {
+        m_audioStart += audioTime + qMin(m_minLag, lag);
+        m_audioFrames = 0;
+        m_minLag = lag - qMin(m_minLag, lag);
+    } else {
+        m_minLag = qMin(m_minLag, lag);
+    }
+    m_audioFrames += len;
+    const qint64 blockStart = m_lastCallback > 0 ? m_lastCallback : now;
+    const qint64 span = now - blockStart;
+    m_lastCallback = now;
+    for (int i = 0; i < nfx; ++i) {
+        std::memset(fx[i], 0, len * sizeof(float));
+    }
+    for (int i = 0; i < nout; ++i) {
+        std::memset(out[i], 0, len * sizeof(float));
+    }
+    int position = 0;
+    MIDIRing::Header h;
+    while (m_queue.peek(h) && h.sent < now) {
+        int frame = span > 0 ? int((h.sent - blockStart) * len / span) : 0;
+        frame = qBound(position, frame, len - 1);
+        if (frame > position) {
+            renderFrames(position, frame, nfx, fx, nout, out);
+            position = frame;
+        }
+        m_queue.read(h, m_message.data());
+        dispatchMessage(m_message.constData(), int(h.size));
+    }
+    if (position < len) {
+        renderFrames(position, len, nfx, fx, nout, out);
+    }
+    const double load = (MIDIRing::now() - now) * m_audioRate / (1e6 * len);
+    m_loadFactor = m_loadFactor + 0.1 * (load - m_loadFactor);
+    return FLUID_OK;
+}
+
 void FluidSynthEngine::scanSoundFonts(const QDir &initialDir)
 {
     QDir dir(initialDir);
@@ -412,6 +815,12 @@ void FluidSynthEngine::readSettings(QSettings *settings)
     fs_chorus_level = settings->value(QSTR_CHORUS_LEVEL, DEFAULT_CHORUS_LEVEL).toDouble();
     fs_chorus_nr = settings->value(QSTR_CHORUS_NR, DEFAULT_CHORUS_NR).toInt();
     fs_chorus_speed = settings->value(QSTR_CHORUS_SPEED, DEFAULT_CHORUS_SPEED).toDouble();
+    fs_timestamped = settings->value(QSTR_TIMESTAMPED, DEFAULT_TIMESTAMPED).toBool();
+    fs_sharedSoundFonts = settings->value(QSTR_SHAREDSOUNDFONTS, DEFAULT_SHAREDSOUNDFONTS).toBool();
+    fs_dynamicSamples = settings->value(QSTR_DYNAMICSAMPLES, DEFAULT_DYNAMICSAMPLES).toBool();
+    fs_cpuCores = qBound(1, settings->value(QSTR_CPUCORES, DEFAULT_CPUCORES).toInt(), 256);
+    fs_renderCpuCores = qBound(1, settings->value(QSTR_RENDERCPUCORES, DEFAULT_RENDERCPUCORES).toInt(), 256);
+    fs_telemetry = settings->value(QSTR_TELEMETRY, DEFAULT_TELEMETRY).toBool();
 
     settings->endGroup();
     //qDebug() << Q_FUNC_INFO << "audioDriver:" << fs_audiodriver << "buffer" << fs_periodSize << '*' << fs_periods;
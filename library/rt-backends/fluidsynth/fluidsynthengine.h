@@ -25,8 +25,15 @@
 #include <QDir>
 #include <QSettings>
 #include <QMutex>
+#include <QVector>
+#include <atomic>
 #include <drumstick/rtmidioutput.h>
+#include <drumstick/rtmidisequencer.h>
 #include <fluidsynth.h>
+#include "midiring.h"
+#include "soundfontcache.h"
+
+class RtTest;
 
 namespace drumstick { namespace rt {
 
@@ -36,7 +43,7 @@ class FluidSynthEngine : public QObject
     Q_PROPERTY(QString soundFont READ soundFont WRITE setSoundFont)
 
 public:
-    explicit FluidSynthEngine(QObject *parent = nullptr);
+    explicit FluidSynthEngine(QObject *parent = nullptr, bool offline = false);
     virtual ~FluidSynthEngine();
 
     QString soundFont() const { return m_soundFont; }
@@ -66,9 +73,19 @@ public:
     QStringList getDiagnostics();
     QString getLibVersion();
     bool getStatus();
+    int getCpuCores() const { return fs_cpuCores; }
+    double getLoadFactor();
+    int getActiveVoices();
+    quint64 getVoiceSteals() const { return m_voiceSteals; }
+    quint64 getXruns() const { return m_xruns; }
 
     Q_INVOKABLE void writeSettings(QSettings *settings);
 
+    void copySettings(const FluidSynthEngine *other);
+    bool isOffline() const { return m_offline; }
+    bool renderSong(const MIDISong &song, const QString &fileName);
+    int processAudio(int len, int nfx, float *fx[], int nout, float *out[]);
+
     static const QString QSTR_FLUIDSYNTH_VERSION;
 
     static const QString QSTR_FLUIDSYNTH;
@@ -86,6 +103,12 @@ public:
     static const QString QSTR_REVERB;
     static const QString QSTR_GAIN;
     static const QString QSTR_POLYPHONY;
+    static const QString QSTR_TIMESTAMPED;
+    static const QString QSTR_SHAREDSOUNDFONTS;
+    static const QString QSTR_DYNAMICSAMPLES;
+    static const QString QSTR_CPUCORES;
+    static const QString QSTR_RENDERCPUCORES;
+    static const QString QSTR_TELEMETRY;
     static const QString QSTR_DEFAULT_AUDIODRIVER;
     static const QString QSTR_BUFFERTIME;
 	static const QString QSTR_PULSEAUDIO;
@@ -107,6 +130,13 @@ public:
     static const int DEFAULT_REVERB;
     static const double DEFAULT_GAIN;
     static const int DEFAULT_POLYPHONY;
+    static const int MAX_RENDER_TAIL;
+    static const bool DEFAULT_TIMESTAMPED;
+    static const bool DEFAULT_SHAREDSOUNDFONTS;
+    static const bool DEFAULT_DYNAMICSAMPLES;
+    static const int DEFAULT_CPUCORES;
+    static const int DEFAULT_RENDERCPUCORES;
+    static const bool DEFAULT_TELEMETRY;
 
     static constexpr qreal DEFAULT_REVERB_DAMP = 0.3;
     static constexpr qreal DEFAULT_REVERB_LEVEL = 0.7;
@@ -119,13 +149,22 @@ public:
     static constexpr qreal DEFAULT_CHORUS_SPEED = 0.2;
 
 private:
+    friend class ::RtTest;
+
     void scanSoundFonts(const QDir &dir);
     void retrieveAudioDrivers();
     void initializeSynth();
     void loadSoundFont();
+    void unloadSoundFonts();
     void retrieveDefaultSoundfont();
+    void sendEvent(const MIDISong &song, const SongEvent &ev);
+    bool queueMessage(int m0, int m1 = 0, int m2 = 0);
+    void dispatchMessage(const char *data, int size);
+    void countVoiceSteal();
+    void renderFrames(int from, int to, int nfx, float *fx[], int nout, float *out[]);
 
     QList<int> m_sfids;
+    QList<SoundFontCache::SoundFont*> m_sfcache;
     MIDIConnection m_currentConnection;
     QString m_runtimeLibraryVersion;
     QString m_soundFont;
@@ -153,9 +192,34 @@ private:
     qreal fs_chorus_level{DEFAULT_CHORUS_LEVEL};
     int fs_chorus_nr{DEFAULT_CHORUS_NR};
     qreal fs_chorus_speed{DEFAULT_CHORUS_SPEED};
-
+    bool fs_timestamped{DEFAULT_TIMESTAMPED};
+    bool fs_sharedSoundFonts{DEFAULT_SHAREDSOUNDFONTS};
+    bool fs_dynamicSamples{DEFAULT_DYNAMICSAMPLES};
+    int fs_cpuCores{DEFAULT_CPUCORES};
+    int fs_renderCpuCores{DEFAULT_RENDERCPUCORES}; // offline engines run in parallel
+    bool fs_telemetry{DEFAULT_TELEMETRY};
+
+    bool m_offline;
     bool m_status;
     QStringList m_diagnostics;
+
+    /* timestamped MIDI, from the caller threads into the audio callback */
+    bool m_queueing{false};
+    MIDIRing m_queue;
+    QMutex m_producer; // the ring has a single producer
+    QVector<char> m_message;
+    qint64 m_lastCallback{0};
+    bool m_keyPressure{false};
+
+    /* telemetry, written by the audio callback */
+    bool m_instrumented{false};
+    double m_audioRate{DEFAULT_SAMPLERATE};
+    qint64 m_audioStart{0};
+    qint64 m_audioFrames{0};
+    qint64 m_minLag{0};
+    std::atomic<double> m_loadFactor{0.0};
+    std::atomic<quint64> m_voiceSteals{0};
+    std::atomic<quint64> m_xruns{0};
 };
 
 }} // namespace drumstick::rt
@@ -19,6 +19,7 @@
 #include <QCoreApplication>
 
 #include "fluidsynthoutput.h"
+#include "soundfontcache.h"
 #ifdef USE_PIPEWIRE
 #include <pipewire/pipewire.h>
 #endif
@@ -81,6 +82,41 @@ QString FluidSynthOutput::getSoundFont()
     return m_synth->soundFont();
 }
 
+int FluidSynthOutput::getCachedSoundFonts()
+{
+    return SoundFontCache::instance()->count();
+}
+
+qlonglong FluidSynthOutput::getCachedBytes()
+{
+    return SoundFontCache::instance()->mappedBytes();
+}
+
+int FluidSynthOutput::getCpuCores()
+{
+    return m_synth->getCpuCores();
+}
+
+double FluidSynthOutput::getLoadFactor()
+{
+    return m_synth->getLoadFactor();
+}
+
+int FluidSynthOutput::getActiveVoices()
+{
+    return m_synth->getActiveVoices();
+}
+
+qulonglong FluidSynthOutput::getVoiceSteals()
+{
+    return m_synth->getVoiceSteals();
+}
+
+qulonglong FluidSynthOutput::getXruns()
+{
+    return m_synth->getXruns();
+}
+
 void FluidSynthOutput::initialize(QSettings *settings)
 {
     //qDebug() << Q_FUNC_INFO;
@@ -179,6 +215,28 @@ void FluidSynthOutput::sendSystemMsg(const int status)
     Q_UNUSED(status)
 }
 
+/**
+ * Renders a song into a WAVE file, without any audio driver. Each call
+ * uses its own synthesizer with the settings of this backend, so it may
+ * be invoked from several threads at once.
+ */
+bool FluidSynthOutput::renderSong(const MIDISong &song, const QString &fileName)
+{
+    FluidSynthEngine engine(nullptr, true);
+    engine.copySettings(m_synth);
+    engine.initialize();
+    return engine.renderSong(song, fileName);
+}
+
+/**
+ * Reads the settings without starting the synthesizer, which is useful
+ * before renderSong() on hosts without audio devices.
+ */
+void FluidSynthOutput::readSettings(QSettings *settings)
+{
+    m_synth->readSettings(settings);
+}
+
 void FluidSynthOutput::writeSettings(QSettings *settings)
 {
     m_synth->writeSettings(settings);
@@ -38,6 +38,13 @@ namespace rt {
         Q_PROPERTY(QString libversion READ getLibVersion)
         Q_PROPERTY(bool status READ getStatus)
         Q_PROPERTY(QString soundfont READ getSoundFont)
+        Q_PROPERTY(int cachedSoundFonts READ getCachedSoundFonts)
+        Q_PROPERTY(qlonglong cachedBytes READ getCachedBytes)
+        Q_PROPERTY(int cpuCores READ getCpuCores)
+        Q_PROPERTY(double loadFactor READ getLoadFactor)
+        Q_PROPERTY(int activeVoices READ getActiveVoices)
+        Q_PROPERTY(qulonglong voiceSteals READ getVoiceSteals)
+        Q_PROPERTY(qulonglong xruns READ getXruns)
 
     public:
         explicit FluidSynthOutput(QObject *parent = nullptr);
@@ -46,6 +53,8 @@ namespace rt {
         void start();
         void stop();
 
+        Q_INVOKABLE bool renderSong(const drumstick::rt::MIDISong &song, const QString &fileName);
+
         // MIDIOutput interface
     public:
         virtual void initialize(QSettings* settings) override;
@@ -69,6 +78,7 @@ namespace rt {
         virtual void sendSysex(const QByteArray &data) override;
         virtual void sendSystemMsg(const int status) override;
 
+        void readSettings(QSettings *settings);
         void writeSettings(QSettings *settings);
 
     private:
@@ -80,6 +90,13 @@ namespace rt {
         QString getLibVersion();
         bool getStatus();
         QString getSoundFont();
+        int getCachedSoundFonts();
+        qlonglong getCachedBytes();
+        int getCpuCores();
+        double getLoadFactor();
+        int getActiveVoices();
+        qulonglong getVoiceSteals();
+        qulonglong getXruns();
     };
 
 }} // namespace drumstick::rt
@@ -0,0 +1,197 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <cstdio>
+#include <cstring>
+#include "soundfontcache.h"
+
+namespace drumstick { namespace rt {
+
+namespace {
+    struct FileHandle {
+        SoundFontCache::SoundFont *sf;
+        qint64 pos;
+    };
+}
+
+SoundFontCache *SoundFontCache::instance()
+{
+    static SoundFontCache cache;
+    return &cache;
+}
+
+SoundFontCache::~SoundFontCache()
+{
+    qDeleteAll(m_fonts);
+}
+
+/**
+ * Returns the cached soundfont file, mapping it into memory if needed, and
+ * increments its reference count. Returns nullptr if the file can't be read.
+ */
+SoundFontCache::SoundFont *SoundFontCache::acquire(const QString &fileName)
+{
+    QMutexLocker locker(&m_mutex);
+    return acquireLocked(fileName);
+}
+
+/**
+ * Decrements the reference count of a soundfont file, and unmaps it when
+ * no engine uses it anymore.
+ */
+void SoundFontCache::release(SoundFontCache::SoundFont *sf)
+{
+    QMutexLocker locker(&m_mutex);
+    releaseLocked(sf);
+}
+
+/**
+ * Sets the file callbacks of a FluidSynth loader to read from the cache.
+ */
+void SoundFontCache::installCallbacks(fluid_sfloader_t *loader)
+{
+    ::fluid_sfloader_set_callbacks(loader, &fileOpen, &fileRead, &fileSeek, &fileTell, &fileClose);
+}
+
+int SoundFontCache::count()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_fonts.count();
+}
+
+qint64 SoundFontCache::mappedBytes()
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 total = 0;
+    foreach(const SoundFont *sf, m_fonts) {
+        total += sf->size;
+    }
+    return total;
+}
+
+SoundFontCache::SoundFont *SoundFontCache::acquireLocked(const QString &fileName)
+{
+    QFileInfo info(fileName);
+    const QString path = info.canonicalFilePath();
+    if (path.isEmpty() || !info.isReadable()) {
+        return nullptr;
+    }
+    const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+    SoundFont *sf = m_fonts.value(path, nullptr);
+    if (sf != nullptr && sf->mtime == mtime && sf->size == info.size()) {
+        sf->refs++;
+        return sf;
+    }
+    // a new file, or a modified one: the old entry stays alive for its users
+    if (sf != nullptr) {
+        m_fonts.remove(path);
+    }
+    sf = new SoundFont;
+    sf->path = path;
+    sf->mtime = mtime;
+    sf->size = info.size();
+    sf->refs = 1;
+    sf->file.setFileName(path);
+    if (!sf->file.open(QIODevice::ReadOnly)) {
+        delete sf;
+        return nullptr;
+    }
+    sf->data = reinterpret_cast<const char *>(sf->file.map(0, sf->size));
+    if (sf->data == nullptr) {
+        sf->buffer = sf->file.readAll();
+        sf->data = sf->buffer.constData();
+        sf->size = sf->buffer.size();
+    }
+    m_fonts.insert(path, sf);
+    return sf;
+}
+
+void SoundFontCache::releaseLocked(SoundFontCache::SoundFont *sf)
+{
+    if (sf == nullptr || --sf->refs > 0) {
+        return;
+    }
+    if (m_fonts.value(sf->path) == sf) {
+        m_fonts.remove(sf->path);
+    }
+    delete sf;
+}
+
+void *SoundFontCache::fileOpen(const char *fileName)
+{
+    SoundFontCache *cache = instance();
+    QMutexLocker locker(&cache->m_mutex);
+    SoundFont *sf = cache->acquireLocked(QString::fromLocal8Bit(fileName));
+    if (sf == nullptr) {
+        return nullptr;
+    }
+    return new FileHandle{sf, 0};
+}
+
+int SoundFontCache::fileRead(void *buf, fluid_long_long_t count, void *handle)
+{
+    FileHandle *h = static_cast<FileHandle *>(handle);
+    if (count < 0 || h->pos + count > h->sf->size) {
+        return FLUID_FAILED;
+    }
+    std::memcpy(buf, h->sf->data + h->pos, size_t(count));
+    h->pos += count;
+    return FLUID_OK;
+}
+
+int SoundFontCache::fileSeek(void *handle, fluid_long_long_t offset, int origin)
+{
+    FileHandle *h = static_cast<FileHandle *>(handle);
+    qint64 pos;
+    switch (origin) {
+    case SEEK_SET:
+        pos = offset;
+        break;
+    case SEEK_CUR:
+        pos = h->pos + offset;
+        break;
+    case SEEK_END:
+        pos = h->sf->size + offset;
+        break;
+    default:
+        return FLUID_FAILED;
+    }
+    if (pos < 0 || pos > h->sf->size) {
+        return FLUID_FAILED;
+    }
+    h->pos = pos;
+    return FLUID_OK;
+}
+
+fluid_long_long_t SoundFontCache::fileTell(void *handle)
+{
+    return static_cast<FileHandle *>(handle)->pos;
+}
+
+int SoundFontCache::fileClose(void *handle)
+{
+    FileHandle *h = static_cast<FileHandle *>(handle);
+    instance()->release(h->sf);
+    delete h;
+    return FLUID_OK;
+}
+
+}} // namespace drumstick::rt
@@ -0,0 +1,80 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SOUNDFONTCACHE_H
+#define SOUNDFONTCACHE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <fluidsynth.h>
+
+namespace drumstick { namespace rt {
+
+/*
+ * Process wide cache of soundfont files, shared by all the FluidSynth
+ * engines. Each file is mapped into memory once, keyed by its canonical path
+ * and modification time, and reference counted by the engines that use it.
+ * The FluidSynth loaders read the files through the cache with custom file
+ * callbacks. Because the engines load the soundfonts by their canonical
+ * path, the FluidSynth sample cache, keyed by file name and modification
+ * time as well, shares the sample data among all the synthesizers.
+ */
+class SoundFontCache
+{
+public:
+    struct SoundFont {
+        QString path;
+        qint64 mtime;
+        qint64 size;
+        const char *data;
+        int refs;
+        QFile file;
+        QByteArray buffer; // when the file cannot be mapped
+    };
+
+    static SoundFontCache *instance();
+
+    SoundFont *acquire(const QString &fileName);
+    void release(SoundFont *sf);
+    void installCallbacks(fluid_sfloader_t *loader);
+
+    int count();
+    qint64 mappedBytes();
+
+private:
+    SoundFontCache() = default;
+    ~SoundFontCache();
+    SoundFont *acquireLocked(const QString &fileName);
+    void releaseLocked(SoundFont *sf);
+
+    static void *fileOpen(const char *fileName);
+    static int fileRead(void *buf, fluid_long_long_t count, void *handle);
+    static int fileSeek(void *handle, fluid_long_long_t offset, int origin);
+    static fluid_long_long_t fileTell(void *handle);
+    static int fileClose(void *handle);
+
+    QMutex m_mutex;
+    QHash<QString, SoundFont*> m_fonts;
+};
+
+}} // namespace drumstick::rt
+
+#endif // SOUNDFONTCACHE_H
@@ -0,0 +1,24 @@
+TEMPLATE = lib
+CONFIG += c++11 plugin
+static {
+    CONFIG += staticlib create_prl
+}
+TARGET = drumstick-rt-loopback-in
+DESTDIR = ../../../build/lib/drumstick2
+DEPENDPATH += . ../../include ../common
+INCLUDEPATH += . ../../include ../common
+include (../../../global.pri)
+QT -= gui
+
+HEADERS += ../common/midiparser.h \
+           ../common/midithru.h \
+           ../common/midiring.h \
+           ../common/midiringprovider.h \
+           loopbackinput.h
+
+SOURCES += loopbackinput.cpp \
+           ../common/midiparser.cpp \
+           ../common/midithru.cpp
+
+macx:!static:LIBS += -F$$OUT_PWD/../../../build/lib -framework drumstick-rt
+else:LIBS += -L$$OUT_PWD/../../../build/lib -l$$drumstickLib(drumstick-rt)
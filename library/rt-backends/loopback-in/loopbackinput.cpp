@@ -0,0 +1,243 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QThread>
+#include <atomic>
+#include <drumstick/backendmanager.h>
+#include "loopbackinput.h"
+#include "midiring.h"
+#include "midiringprovider.h"
+#include "midiparser.h"
+
+namespace drumstick { namespace rt {
+
+const QString LoopbackInput::DEFAULT_PUBLIC_NAME = QStringLiteral("MIDI In");
+const QString LoopbackInput::QSTR_LOOPBACK = QStringLiteral("Loopback");
+
+class LoopbackInput::LoopbackInputPrivate : public QThread
+{
+public:
+    LoopbackInput *m_inp;
+    MIDIOutput *m_out;
+    MIDIParser *m_parser;
+    MIDIRing *m_ring;
+    bool m_thruEnabled;
+    bool m_status;
+    QString m_publicName;
+    MIDIConnection m_currentInput;
+    QStringList m_diagnostics;
+    std::atomic<bool> m_running;
+    std::atomic<quint64> m_received;
+    std::atomic<qint64> m_maxLatency;
+    std::atomic<qint64> m_totalLatency;
+    char m_buffer[MIDIRing::MAX_MESSAGE];
+
+    explicit LoopbackInputPrivate(LoopbackInput *inp) :
+        m_inp(inp),
+        m_out(nullptr),
+        m_parser(new MIDIParser(inp)),
+        m_ring(nullptr),
+        m_thruEnabled(false),
+        m_status(false),
+        m_publicName(DEFAULT_PUBLIC_NAME),
+        m_running(false),
+        m_received(0),
+        m_maxLatency(0),
+        m_totalLatency(0)
+    { }
+
+    ~LoopbackInputPrivate()
+    {
+        close();
+        delete m_parser;
+    }
+
+    void open(const MIDIConnection& conn)
+    {
+        close();
+        m_diagnostics.clear();
+        MIDIOutput *peer = lastBackendManagerInstance()->outputBackendByName(QSTR_LOOPBACK);
+        if (peer == nullptr) {
+            m_status = false;
+            m_diagnostics << QStringLiteral("Loopback output backend not found");
+            return;
+        }
+        MIDIRingProvider *provider = qobject_cast<MIDIRingProvider *>(peer);
+        m_ring = (provider != nullptr) ? provider->ring() : nullptr;
+        if (m_ring == nullptr) {
+            m_status = false;
+            m_diagnostics << QStringLiteral("Loopback output backend without a ring buffer");
+            return;
+        }
+        m_ring->reset();
+        m_received = 0;
+        m_maxLatency = 0;
+        m_totalLatency = 0;
+        m_currentInput = conn;
+        m_status = true;
+        m_running = true;
+        start(QThread::HighPriority);
+    }
+
+    void close()
+    {
+        if (m_running.exchange(false)) {
+            m_ring->wakeUp();
+            wait();
+        }
+        m_ring = nullptr;
+        m_currentInput = MIDIConnection();
+        m_status = false;
+    }
+
+    void setMIDIThruDevice(MIDIOutput *device)
+    {
+        m_out = device;
+        m_parser->setMIDIThruDevice(device);
+    }
+
+    void run() override
+    {
+        MIDIRing::Header h;
+        while (m_running.load(std::memory_order_acquire)) {
+            if (!m_ring->peek(h)) {
+                m_ring->wait(10);
+                continue;
+            }
+            qint64 now = MIDIRing::now();
+            if (h.due > now) {
+                // artificial latency: records are queued in due order
+                QThread::usleep(static_cast<unsigned long>(qMin<qint64>(h.due - now, 10000)));
+                continue;
+            }
+            m_ring->read(h, m_buffer);
+            for (quint32 i = 0; i < h.size; ++i) {
+                m_parser->parse(static_cast<unsigned char>(m_buffer[i]));
+            }
+            const qint64 latency = now - h.sent;
+            m_totalLatency.fetch_add(latency, std::memory_order_relaxed);
+            if (latency > m_maxLatency.load(std::memory_order_relaxed)) {
+                m_maxLatency.store(latency, std::memory_order_relaxed);
+            }
+            m_received.fetch_add(1, std::memory_order_release);
+        }
+    }
+};
+
+LoopbackInput::LoopbackInput(QObject *parent) : MIDIInput(parent),
+    d(new LoopbackInputPrivate(this))
+{ }
+
+LoopbackInput::~LoopbackInput()
+{
+    delete d;
+}
+
+void LoopbackInput::initialize(QSettings *settings)
+{
+    Q_UNUSED(settings)
+}
+
+QString LoopbackInput::backendName()
+{
+    return QSTR_LOOPBACK;
+}
+
+QString LoopbackInput::publicName()
+{
+    return d->m_publicName;
+}
+
+void LoopbackInput::setPublicName(QString name)
+{
+    d->m_publicName = name;
+}
+
+QList<MIDIConnection> LoopbackInput::connections(bool advanced)
+{
+    Q_UNUSED(advanced)
+    return QList<MIDIConnection>{ MIDIConnection(QSTR_LOOPBACK, QSTR_LOOPBACK) };
+}
+
+void LoopbackInput::setExcludedConnections(QStringList conns)
+{
+    Q_UNUSED(conns)
+}
+
+void LoopbackInput::open(const MIDIConnection& name)
+{
+    d->open(name);
+}
+
+void LoopbackInput::close()
+{
+    d->close();
+}
+
+MIDIConnection LoopbackInput::currentConnection()
+{
+    return d->m_currentInput;
+}
+
+void LoopbackInput::setMIDIThruDevice(MIDIOutput *device)
+{
+    d->setMIDIThruDevice(device);
+}
+
+void LoopbackInput::enableMIDIThru(bool enable)
+{
+    d->m_thruEnabled = enable;
+}
+
+bool LoopbackInput::isEnabledMIDIThru()
+{
+    return d->m_thruEnabled && (d->m_out != nullptr);
+}
+
+QStringList LoopbackInput::getDiagnostics()
+{
+    return d->m_diagnostics;
+}
+
+QString LoopbackInput::getLibVersion()
+{
+    return QT_STRINGIFY(VERSION);
+}
+
+bool LoopbackInput::getStatus()
+{
+    return d->m_status;
+}
+
+qulonglong LoopbackInput::getReceived()
+{
+    return d->m_received.load(std::memory_order_acquire);
+}
+
+qlonglong LoopbackInput::getMaxLatency()
+{
+    return d->m_maxLatency;
+}
+
+qlonglong LoopbackInput::getAvgLatency()
+{
+    const quint64 received = d->m_received;
+    return received > 0 ? d->m_totalLatency / qint64(received) : 0;
+}
+
+}}
@@ -0,0 +1,20 @@
+TEMPLATE = lib
+CONFIG += c++11 plugin
+static {
+    CONFIG += staticlib create_prl
+}
+TARGET = drumstick-rt-loopback-out
+DESTDIR = ../../../build/lib/drumstick2
+DEPENDPATH += . ../../include ../common
+INCLUDEPATH += . ../../include ../common
+include (../../../global.pri)
+QT -= gui
+
+HEADERS += ../common/midiring.h \
+           ../common/midiringprovider.h \
+           loopbackoutput.h
+
+SOURCES += loopbackoutput.cpp
+
+macx:!static:LIBS += -F$$OUT_PWD/../../../build/lib -framework drumstick-rt
+else:LIBS += -L$$OUT_PWD/../../../build/lib -l$$drumstickLib(drumstick-rt)
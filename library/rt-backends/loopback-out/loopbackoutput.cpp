@@ -0,0 +1,310 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QSettings>
+#include <atomic>
+#include <limits>
+#include "loopbackoutput.h"
+#include "midiring.h"
+
+namespace drumstick { namespace rt {
+
+const QString LoopbackOutput::DEFAULT_PUBLIC_NAME = QStringLiteral("MIDI Out");
+const QString LoopbackOutput::QSTR_LOOPBACK = QStringLiteral("Loopback");
+const QString LoopbackOutput::QSTR_LATENCY = QStringLiteral("latency");
+const QString LoopbackOutput::QSTR_LOSS = QStringLiteral("loss");
+
+class LoopbackOutput::LoopbackOutputPrivate
+{
+public:
+    MIDIRing *m_ring;
+    QMutex m_mutex; // serializes the producers of the single producer ring
+    QString m_publicName;
+    MIDIConnection m_currentOutput;
+    QRandomGenerator m_random;
+    std::atomic<bool> m_open;
+    std::atomic<int> m_latency;
+    std::atomic<quint32> m_lossThreshold;
+    std::atomic<quint64> m_sent;
+    std::atomic<quint64> m_lost;
+    std::atomic<quint64> m_overruns;
+    double m_loss;
+
+    LoopbackOutputPrivate() :
+        m_ring(new MIDIRing),
+        m_publicName(DEFAULT_PUBLIC_NAME),
+        m_random(0x4c4f4f50),
+        m_open(false),
+        m_latency(0),
+        m_lossThreshold(0),
+        m_sent(0),
+        m_lost(0),
+        m_overruns(0),
+        m_loss(0.0)
+    { }
+
+    ~LoopbackOutputPrivate()
+    {
+        delete m_ring;
+    }
+
+    void setLoss(double percent)
+    {
+        m_loss = qBound(0.0, percent, 100.0);
+        m_lossThreshold = static_cast<quint32>(m_loss / 100.0 * std::numeric_limits<quint32>::max());
+    }
+
+    void initialize(QSettings* settings)
+    {
+        if (settings != nullptr) {
+            settings->beginGroup(QSTR_LOOPBACK);
+            m_latency = qMax(0, settings->value(QSTR_LATENCY, 0).toInt());
+            setLoss(settings->value(QSTR_LOSS, 0.0).toDouble());
+            settings->endGroup();
+        }
+    }
+
+    void writeSettings(QSettings *settings)
+    {
+        if (settings != nullptr) {
+            settings->beginGroup(QSTR_LOOPBACK);
+            settings->setValue(QSTR_LATENCY, m_latency.load());
+            settings->setValue(QSTR_LOSS, m_loss);
+            settings->endGroup();
+        }
+    }
+
+    void open(const MIDIConnection& conn)
+    {
+        m_currentOutput = conn;
+        m_sent = 0;
+        m_lost = 0;
+        m_overruns = 0;
+        m_open = true;
+    }
+
+    void close()
+    {
+        m_open = false;
+        m_currentOutput = MIDIConnection();
+    }
+
+    void sendMessage(const char *data, quint32 size)
+    {
+        if (!m_open.load(std::memory_order_relaxed)) {
+            return;
+        }
+        QMutexLocker locker(&m_mutex);
+        const quint32 threshold = m_lossThreshold.load(std::memory_order_relaxed);
+        if (threshold > 0 && m_random.generate() < threshold) {
+            m_lost.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        const qint64 now = MIDIRing::now();
+        if (m_ring->write(now, now + m_latency.load(std::memory_order_relaxed), data, size)) {
+            m_sent.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void sendMessage(int m0)
+    {
+        const char m[1] = { static_cast<char>(m0) };
+        sendMessage(m, sizeof(m));
+    }
+
+    void sendMessage(int m0, int m1)
+    {
+        const char m[2] = { static_cast<char>(m0), static_cast<char>(m1) };
+        sendMessage(m, sizeof(m));
+    }
+
+    void sendMessage(int m0, int m1, int m2)
+    {
+        const char m[3] = { static_cast<char>(m0), static_cast<char>(m1), static_cast<char>(m2) };
+        sendMessage(m, sizeof(m));
+    }
+};
+
+LoopbackOutput::LoopbackOutput(QObject *parent) : MIDIOutput(parent),
+    d(new LoopbackOutputPrivate)
+{ }
+
+LoopbackOutput::~LoopbackOutput()
+{
+    delete d;
+}
+
+void LoopbackOutput::initialize(QSettings *settings)
+{
+    d->initialize(settings);
+}
+
+void LoopbackOutput::writeSettings(QSettings *settings)
+{
+    d->writeSettings(settings);
+}
+
+QString LoopbackOutput::backendName()
+{
+    return QSTR_LOOPBACK;
+}
+
+QString LoopbackOutput::publicName()
+{
+    return d->m_publicName;
+}
+
+void LoopbackOutput::setPublicName(QString name)
+{
+    d->m_publicName = name;
+}
+
+QList<MIDIConnection> LoopbackOutput::connections(bool advanced)
+{
+    Q_UNUSED(advanced)
+    return QList<MIDIConnection>{ MIDIConnection(QSTR_LOOPBACK, QSTR_LOOPBACK) };
+}
+
+void LoopbackOutput::setExcludedConnections(QStringList conns)
+{
+    Q_UNUSED(conns)
+}
+
+void LoopbackOutput::open(const MIDIConnection& name)
+{
+    d->open(name);
+}
+
+void LoopbackOutput::close()
+{
+    d->close();
+}
+
+MIDIConnection LoopbackOutput::currentConnection()
+{
+    return d->m_currentOutput;
+}
+
+void LoopbackOutput::sendNoteOff(int chan, int note, int vel)
+{
+    d->sendMessage(MIDI_STATUS_NOTEOFF + chan, note, vel);
+}
+
+void LoopbackOutput::sendNoteOn(int chan, int note, int vel)
+{
+    d->sendMessage(MIDI_STATUS_NOTEON + chan, note, vel);
+}
+
+void LoopbackOutput::sendKeyPressure(int chan, int note, int value)
+{
+    d->sendMessage(MIDI_STATUS_KEYPRESURE + chan, note, value);
+}
+
+void LoopbackOutput::sendController(int chan, int control, int value)
+{
+    d->sendMessage(MIDI_STATUS_CONTROLCHANGE + chan, control, value);
+}
+
+void LoopbackOutput::sendProgram(int chan, int program)
+{
+    d->sendMessage(MIDI_STATUS_PROGRAMCHANGE + chan, program);
+}
+
+void LoopbackOutput::sendChannelPressure(int chan, int value)
+{
+    d->sendMessage(MIDI_STATUS_CHANNELPRESSURE + chan, value);
+}
+
+void LoopbackOutput::sendPitchBend(int chan, int v)
+{
+    // -8192 <= v <= 8191; 0 <= value <= 16384
+    int value = 8192 + v;
+    d->sendMessage(MIDI_STATUS_PITCHBEND + chan, MIDI_LSB(value), MIDI_MSB(value));
+}
+
+void LoopbackOutput::sendSysex(const QByteArray &data)
+{
+    d->sendMessage(data.constData(), static_cast<quint32>(data.size()));
+}
+
+void LoopbackOutput::sendSystemMsg(const int status)
+{
+    d->sendMessage(status);
+}
+
+QStringList LoopbackOutput::getDiagnostics()
+{
+    return QStringList();
+}
+
+QString LoopbackOutput::getLibVersion()
+{
+    return QT_STRINGIFY(VERSION);
+}
+
+bool LoopbackOutput::getStatus()
+{
+    return true;
+}
+
+int LoopbackOutput::getLatency()
+{
+    return d->m_latency;
+}
+
+void LoopbackOutput::setLatency(int usecs)
+{
+    d->m_latency = qMax(0, usecs);
+}
+
+double LoopbackOutput::getLoss()
+{
+    return d->m_loss;
+}
+
+void LoopbackOutput::setLoss(double percent)
+{
+    d->setLoss(percent);
+}
+
+qulonglong LoopbackOutput::getSent()
+{
+    return d->m_sent;
+}
+
+qulonglong LoopbackOutput::getLost()
+{
+    return d->m_lost;
+}
+
+qulonglong LoopbackOutput::getOverruns()
+{
+    return d->m_overruns;
+}
+
+MIDIRing *LoopbackOutput::ring()
+{
+    return d->m_ring;
+}
+
+}}
@@ -0,0 +1,98 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LOOPBACKOUTPUT_H
+#define LOOPBACKOUTPUT_H
+
+#include <QObject>
+#include <drumstick/rtmidioutput.h>
+#include "midiringprovider.h"
+
+namespace drumstick { namespace rt {
+
+    class LoopbackOutput : public MIDIOutput, public MIDIRingProvider
+    {
+        Q_OBJECT
+        Q_PLUGIN_METADATA(IID "net.sourceforge.drumstick.rt.MIDIOutput/2.0")
+        Q_INTERFACES(drumstick::rt::MIDIOutput drumstick::rt::MIDIRingProvider)
+        Q_PROPERTY(QStringList diagnostics READ getDiagnostics)
+        Q_PROPERTY(QString libversion READ getLibVersion)
+        Q_PROPERTY(bool status READ getStatus)
+        Q_PROPERTY(int latency READ getLatency WRITE setLatency)
+        Q_PROPERTY(double loss READ getLoss WRITE setLoss)
+        Q_PROPERTY(qulonglong sent READ getSent)
+        Q_PROPERTY(qulonglong lost READ getLost)
+        Q_PROPERTY(qulonglong overruns READ getOverruns)
+
+    public:
+        explicit LoopbackOutput(QObject *parent = nullptr);
+        virtual ~LoopbackOutput();
+
+        static const QString DEFAULT_PUBLIC_NAME;
+        static const QString QSTR_LOOPBACK;
+        static const QString QSTR_LATENCY;
+        static const QString QSTR_LOSS;
+
+        // MIDIOutput interface
+    public:
+        virtual void initialize(QSettings* settings) override;
+        virtual QString backendName() override;
+        virtual QString publicName() override;
+        virtual void setPublicName(QString name) override;
+        virtual QList<MIDIConnection> connections(bool advanced) override;
+        virtual void setExcludedConnections(QStringList conns) override;
+        virtual void open(const MIDIConnection& name) override;
+        virtual void close() override;
+        virtual MIDIConnection currentConnection() override;
+
+        // MIDIRingProvider interface
+        virtual MIDIRing *ring() override;
+
+    public Q_SLOTS:
+        virtual void sendNoteOff(int chan, int note, int vel) override;
+        virtual void sendNoteOn(int chan, int note, int vel) override;
+        virtual void sendKeyPressure(int chan, int note, int value) override;
+        virtual void sendController(int chan, int control, int value) override;
+        virtual void sendProgram(int chan, int program) override;
+        virtual void sendChannelPressure(int chan, int value) override;
+        virtual void sendPitchBend(int chan, int value) override;
+        virtual void sendSysex(const QByteArray &data) override;
+        virtual void sendSystemMsg(const int status) override;
+
+        void writeSettings(QSettings *settings);
+
+    private:
+        class LoopbackOutputPrivate;
+        LoopbackOutputPrivate * const d;
+
+    private:
+        QStringList getDiagnostics();
+        QString getLibVersion();
+        bool getStatus();
+        int getLatency();
+        void setLatency(int usecs);
+        double getLoss();
+        void setLoss(double percent);
+        qulonglong getSent();
+        qulonglong getLost();
+        qulonglong getOverruns();
+    };
+
+}}
+
+#endif // LOOPBACKOUTPUT_H
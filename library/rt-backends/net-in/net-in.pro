@@ -11,12 +11,16 @@ include (../../../global.pri)
 QT -= gui
 
 HEADERS += ../common/midiparser.h \
+           ../common/midithru.h \
+           ../common/midiring.h \
+           ../common/netmidiframe.h \
            netmidiinput.h \
            netmidiinput_p.h
 
 SOURCES += netmidiinput.cpp \
            netmidiinput_p.cpp \
-           ../common/midiparser.cpp
+           ../common/midiparser.cpp \
+           ../common/midithru.cpp
 
 QT += network
 macx:!static:LIBS += -F$$OUT_PWD/../../../build/lib -framework drumstick-rt
@@ -101,6 +101,7 @@ bool NetMIDIInput::isEnabledMIDIThru()
 
 QStringList NetMIDIInput::getDiagnostics()
 {
+    QMutexLocker locker(&d->m_mutex);
     return d->m_diagnostics;
 }
 
@@ -109,6 +110,105 @@ bool NetMIDIInput::getStatus()
     return d->m_status;
 }
 
+bool NetMIDIInput::getThruQueued()
+{
+    return d->m_forwarder.isEnabled();
+}
+
+void NetMIDIInput::setThruQueued(bool queued)
+{
+    d->m_forwarder.setEnabled(queued);
+}
+
+int NetMIDIInput::getThruLatencyBudget()
+{
+    return d->m_forwarder.latencyBudget();
+}
+
+void NetMIDIInput::setThruLatencyBudget(int usecs)
+{
+    d->m_forwarder.setLatencyBudget(usecs);
+}
+
+qulonglong NetMIDIInput::getThruForwarded()
+{
+    return d->m_forwarder.forwarded();
+}
+
+qulonglong NetMIDIInput::getThruOverruns()
+{
+    return d->m_forwarder.overruns();
+}
+
+qulonglong NetMIDIInput::getThruDropped()
+{
+    return d->m_forwarder.dropped();
+}
+
+bool NetMIDIInput::getBatchReceive()
+{
+    return d->m_batchReceive;
+}
+
+void NetMIDIInput::setBatchReceive(bool enable)
+{
+#if defined(Q_OS_LINUX)
+    d->m_batchReceive = enable;
+#else
+    Q_UNUSED(enable)
+#endif
+}
+
+qulonglong NetMIDIInput::getDatagrams()
+{
+    return d->m_datagrams;
+}
+
+qulonglong NetMIDIInput::getTruncated()
+{
+    return d->m_truncated;
+}
+
+qulonglong NetMIDIInput::getFramesReceived()
+{
+    return d->m_framesReceived;
+}
+
+qulonglong NetMIDIInput::getFramesLost()
+{
+    return d->m_framesLost;
+}
+
+qulonglong NetMIDIInput::getFramesReordered()
+{
+    return d->m_framesReordered;
+}
+
+int NetMIDIInput::getPlayoutDelay()
+{
+    return d->m_playoutDelay;
+}
+
+void NetMIDIInput::setPlayoutDelay(int usecs)
+{
+    d->m_playoutDelay = qBound(0, usecs, 1000000);
+}
+
+qlonglong NetMIDIInput::getJitter()
+{
+    return d->m_playout != nullptr ? d->m_playout->m_jitter.load() : 0;
+}
+
+qulonglong NetMIDIInput::getLateDrops()
+{
+    return d->m_playout != nullptr ? d->m_playout->m_lateDrops.load() : 0;
+}
+
+int NetMIDIInput::getBufferDepth()
+{
+    return d->m_playout != nullptr ? d->m_playout->m_depth.load() : 0;
+}
+
 } // namespace rt
 } // namespace drumstick
 
@@ -36,6 +36,21 @@ namespace rt {
         Q_INTERFACES(drumstick::rt::MIDIInput)
         Q_PROPERTY(QStringList diagnostics READ getDiagnostics)
         Q_PROPERTY(bool status READ getStatus)
+        Q_PROPERTY(bool thruQueued READ getThruQueued WRITE setThruQueued)
+        Q_PROPERTY(int thruLatencyBudget READ getThruLatencyBudget WRITE setThruLatencyBudget)
+        Q_PROPERTY(qulonglong thruForwarded READ getThruForwarded)
+        Q_PROPERTY(qulonglong thruOverruns READ getThruOverruns)
+        Q_PROPERTY(qulonglong thruDropped READ getThruDropped)
+        Q_PROPERTY(bool batchReceive READ getBatchReceive WRITE setBatchReceive)
+        Q_PROPERTY(qulonglong datagrams READ getDatagrams)
+        Q_PROPERTY(qulonglong truncated READ getTruncated)
+        Q_PROPERTY(qulonglong framesReceived READ getFramesReceived)
+        Q_PROPERTY(qulonglong framesLost READ getFramesLost)
+        Q_PROPERTY(qulonglong framesReordered READ getFramesReordered)
+        Q_PROPERTY(int playoutDelay READ getPlayoutDelay WRITE setPlayoutDelay)
+        Q_PROPERTY(qlonglong jitter READ getJitter)
+        Q_PROPERTY(qulonglong lateDrops READ getLateDrops)
+        Q_PROPERTY(int bufferDepth READ getBufferDepth)
 
     public:
         explicit NetMIDIInput(QObject *parent = nullptr);
@@ -70,6 +85,25 @@ namespace rt {
     private:
         QStringList getDiagnostics();
         bool getStatus();
+        bool getThruQueued();
+        void setThruQueued(bool queued);
+        int getThruLatencyBudget();
+        void setThruLatencyBudget(int usecs);
+        qulonglong getThruForwarded();
+        qulonglong getThruOverruns();
+        qulonglong getThruDropped();
+        bool getBatchReceive();
+        void setBatchReceive(bool enable);
+        qulonglong getDatagrams();
+        qulonglong getTruncated();
+        qulonglong getFramesReceived();
+        qulonglong getFramesLost();
+        qulonglong getFramesReordered();
+        int getPlayoutDelay();
+        void setPlayoutDelay(int usecs);
+        qlonglong getJitter();
+        qulonglong getLateDrops();
+        int getBufferDepth();
     };
 
 }}
@@ -20,64 +20,297 @@
 
 #include "netmidiinput.h"
 #include "netmidiinput_p.h"
+#include "netmidiframe.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#if defined(Q_OS_LINUX)
+#include <poll.h>
+#include <sys/socket.h>
+#endif
 
 namespace drumstick { namespace rt {
 
+NetMIDIReceiver::NetMIDIReceiver(NetMIDIInputPrivate *owner):
+    m_owner(owner),
+    m_stop(false),
+    m_status(false)
+{ }
+
+bool NetMIDIReceiver::startReceiving()
+{
+    m_stop = false;
+    start(QThread::TimeCriticalPriority);
+    m_started.acquire();
+    if (!m_status) {
+        wait();
+    }
+    return m_status;
+}
+
+void NetMIDIReceiver::stop()
+{
+    m_stop = true;
+    wait();
+}
+
+void NetMIDIReceiver::run()
+{
+    // the socket belongs to this thread, without an event loop
+    QUdpSocket socket;
+    m_status = m_owner->bindSocket(&socket);
+    m_started.release();
+    if (!m_status) {
+        return;
+    }
+#if defined(Q_OS_LINUX)
+    std::vector<char> buffer(SLOTS * SLOT_SIZE);
+    std::vector<iovec> iov(SLOTS);
+    std::vector<mmsghdr> msgs(SLOTS);
+    for (int i = 0; i < SLOTS; ++i) {
+        iov[i].iov_base = buffer.data() + i * SLOT_SIZE;
+        iov[i].iov_len = SLOT_SIZE;
+        msgs[i].msg_hdr = msghdr();
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    pollfd pfd;
+    pfd.fd = static_cast<int>(socket.socketDescriptor());
+    pfd.events = POLLIN;
+    while (!m_stop) {
+        pfd.revents = 0;
+        // the timeout bounds the latency of stop()
+        if (::poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        int n;
+        do {
+            n = ::recvmmsg(pfd.fd, msgs.data(), SLOTS, MSG_DONTWAIT, nullptr);
+            for (int i = 0; i < n; ++i) {
+                if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                    m_owner->m_truncated++;
+                    continue;
+                }
+                m_owner->processDatagram(buffer.data() + i * SLOT_SIZE,
+                                         static_cast<int>(msgs[i].msg_len));
+            }
+        } while (n == SLOTS && !m_stop);
+    }
+#endif
+}
+
+NetMIDIPlayout::NetMIDIPlayout(MIDIParser *parser, int delay):
+    m_jitter(0),
+    m_lateDrops(0),
+    m_overruns(0),
+    m_depth(0),
+    m_parser(parser),
+    m_stop(false),
+    m_delay(delay),
+    m_synced(false),
+    m_offset(0),
+    m_windowMin(0),
+    m_windowCount(0),
+    m_lastTransit(0),
+    m_jitterEstimate(0.0)
+{ }
+
+bool NetMIDIPlayout::schedule(qint64 stamp, const char *data, int size)
+{
+    const qint64 now = MIDIRing::now();
+    qint64 due = now;
+    if (stamp >= 0) {
+        const qint64 transit = now - stamp;
+        if (!m_synced) {
+            m_synced = true;
+            m_offset = m_windowMin = m_lastTransit = transit;
+        }
+        // interarrival jitter, as in RFC 3550
+        m_jitterEstimate += (qAbs(transit - m_lastTransit) - m_jitterEstimate) / 16.0;
+        m_jitter = static_cast<qint64>(m_jitterEstimate);
+        m_lastTransit = transit;
+        m_offset = qMin(m_offset, transit);
+        m_windowMin = qMin(m_windowMin, transit);
+        if (++m_windowCount == OFFSET_WINDOW) {
+            // follows the drift between both clocks
+            m_offset = m_windowMin;
+            m_windowMin = transit;
+            m_windowCount = 0;
+        }
+        due = stamp + m_offset + m_delay;
+        if (due < now) {
+            m_lateDrops++;
+            return false;
+        }
+    }
+    if (!m_ring.write(now, due, data, static_cast<quint32>(size))) {
+        m_overruns++;
+        return false;
+    }
+    m_depth++;
+    return true;
+}
+
+void NetMIDIPlayout::stop()
+{
+    m_stop = true;
+    m_ring.wakeUp();
+    wait();
+    m_ring.reset();
+    m_depth = 0;
+}
+
+void NetMIDIPlayout::run()
+{
+    using namespace std::chrono;
+    struct Pending {
+        qint64 due;
+        quint64 serial;
+        QByteArray data;
+    };
+    // datagrams delayed by the network may arrive after a later one
+    auto later = [](const Pending &a, const Pending &b) {
+        return a.due > b.due || (a.due == b.due && a.serial > b.serial);
+    };
+    std::vector<Pending> pending;
+    pending.reserve(OFFSET_WINDOW);
+    quint64 serial = 0;
+    while (!m_stop) {
+        MIDIRing::Header h;
+        while (m_ring.peek(h)) {
+            pending.push_back({h.due, serial++, QByteArray(static_cast<int>(h.size), '\0')});
+            m_ring.read(h, pending.back().data.data());
+            std::push_heap(pending.begin(), pending.end(), later);
+        }
+        if (pending.empty()) {
+            m_ring.wait(50);
+            continue;
+        }
+        const qint64 remaining = pending.front().due - MIDIRing::now();
+        if (remaining > 2000) {
+            // wakes up early when another datagram arrives
+            m_ring.wait(static_cast<int>(qMin(remaining - 1000, qint64(50000)) / 1000));
+            continue;
+        }
+        if (remaining > 0) {
+            // high resolution sleep
+            std::this_thread::sleep_for(microseconds(remaining));
+            continue;
+        }
+        std::pop_heap(pending.begin(), pending.end(), later);
+        m_depth--;
+        m_parser->parse(pending.back().data.constData(), pending.back().data.size());
+        pending.pop_back();
+    }
+}
+
 NetMIDIInputPrivate::NetMIDIInputPrivate(QObject *parent) : QObject(parent),
     m_inp(qobject_cast<NetMIDIInput *>(parent)),
     m_out(nullptr),
     m_socket(nullptr),
     m_parser(nullptr),
+    m_receiver(nullptr),
+    m_playout(nullptr),
     m_thruEnabled(false),
     m_port(0),
     m_publicName(NetMIDIInput::DEFAULT_PUBLIC_NAME),
     m_groupAddress(QHostAddress(NetMIDIInput::STR_ADDRESS_IPV4)),
     m_ipv6(false),
-    m_status(false)
+    m_status(false),
+    m_batchReceive(false),
+    m_playoutDelay(0),
+    m_sequenced(false),
+    m_nextSequence(0),
+    m_datagrams(0),
+    m_truncated(0),
+    m_framesReceived(0),
+    m_framesLost(0),
+    m_framesReordered(0)
 {
     for(int i=NetMIDIInput::MULTICAST_PORT; i<NetMIDIInput::LAST_PORT; ++i) {
         m_inputDevices << MIDIConnection(QString::number(i), i);
     }
 }
 
+bool NetMIDIInputPrivate::bindSocket(QUdpSocket *socket)
+{
+    bool res = socket->bind(m_ipv6 ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4, m_port, QUdpSocket::ShareAddress);
+    if (res) {
+#ifdef Q_OS_WIN
+        // https://docs.microsoft.com/es-es/windows/desktop/WinSock/ip-multicast-2
+        socket->setSocketOption(QAbstractSocket::MulticastLoopbackOption, 0);
+#endif
+        if (m_iface.isValid()) {
+            res = socket->joinMulticastGroup(m_groupAddress, m_iface);
+        } else {
+            res = socket->joinMulticastGroup(m_groupAddress);
+        }
+        return socket->isValid();
+    }
+    // called by the receiver thread, too
+    QMutexLocker locker(&m_mutex);
+    m_diagnostics << QString("Socket error. err: %1 = %2").arg(socket->error()).arg(socket->errorString());
+    return false;
+}
+
 void NetMIDIInputPrivate::open(const MIDIConnection& portName)
 {
     int p = portName.second.toInt();
     if (p >= NetMIDIInput::MULTICAST_PORT && p < NetMIDIInput::LAST_PORT && m_status)
     {
         //qDebug() << Q_FUNC_INFO << portName;
-        m_socket = new QUdpSocket();
         m_parser = new MIDIParser(m_inp);
+        m_parser->setMIDIThruDevice(m_out);
+        m_parser->setThruForwarder(&m_forwarder);
         m_port = static_cast<quint16>(p);
         m_currentInput = portName;
-        bool res = m_socket->bind(m_ipv6 ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4, m_port, QUdpSocket::ShareAddress);
-        if (res) {
-#ifdef Q_OS_WIN
-            // https://docs.microsoft.com/es-es/windows/desktop/WinSock/ip-multicast-2
-            m_socket->setSocketOption(QAbstractSocket::MulticastLoopbackOption, 0);
+        m_sequenced = false;
+        m_nextSequence = 0;
+        m_datagrams = 0;
+        m_truncated = 0;
+        m_framesReceived = 0;
+        m_framesLost = 0;
+        m_framesReordered = 0;
+        if (m_playoutDelay > 0) {
+            m_playout = new NetMIDIPlayout(m_parser, m_playoutDelay);
+            m_playout->start(QThread::TimeCriticalPriority);
+        }
+#if defined(Q_OS_LINUX)
+        if (m_batchReceive) {
+            m_receiver = new NetMIDIReceiver(this);
+            m_status = m_receiver->startReceiving();
+            return;
+        }
 #endif
-            if (m_iface.isValid()) {
-                res = m_socket->joinMulticastGroup(m_groupAddress, m_iface);
-            } else {
-                res = m_socket->joinMulticastGroup(m_groupAddress);
-            }
+        m_socket = new QUdpSocket();
+        m_status = bindSocket(m_socket);
+        if (m_status) {
             connect(m_socket, &QUdpSocket::readyRead, this, &NetMIDIInputPrivate::processIncomingMessages);
-            m_status = m_socket->isValid();
-        } else {
-            m_status = false;
-            m_diagnostics << QString("Socket error. err: %1 = %2").arg(m_socket->error()).arg(m_socket->errorString());
         }
     }
 }
 
 void NetMIDIInputPrivate::close()
 {
+    if (m_receiver != nullptr) {
+        m_receiver->stop();
+        delete m_receiver;
+        m_receiver = nullptr;
+    }
     delete m_socket;
-    delete m_parser;
     m_socket = nullptr;
+    if (m_playout != nullptr) {
+        m_playout->stop();
+        delete m_playout;
+        m_playout = nullptr;
+    }
+    delete m_parser;
     m_parser = nullptr;
     m_currentInput = MIDIConnection();
     m_status = false;
+    QMutexLocker locker(&m_mutex);
     m_diagnostics.clear();
 }
 
@@ -85,11 +318,18 @@ void NetMIDIInputPrivate::initialize(QSettings *settings)
 {
     if (settings != nullptr) {
         m_status = false;
-        m_diagnostics.clear();
+        {
+            QMutexLocker locker(&m_mutex);
+            m_diagnostics.clear();
+        }
         settings->beginGroup("Network");
         QString ifaceName = settings->value("interface", QString()).toString();
         m_ipv6 = settings->value("ipv6", false).toBool();
         QString address = settings->value("address", m_ipv6 ? NetMIDIInput::STR_ADDRESS_IPV6 : NetMIDIInput::STR_ADDRESS_IPV4).toString();
+#if defined(Q_OS_LINUX)
+        m_batchReceive = settings->value("batchReceive", false).toBool();
+#endif
+        m_playoutDelay = qBound(0, settings->value("playoutDelay", 0).toInt(), 1000000);
         settings->endGroup();
         if (!ifaceName.isEmpty()) {
             m_iface = QNetworkInterface::interfaceFromName(ifaceName);
@@ -101,6 +341,7 @@ void NetMIDIInputPrivate::initialize(QSettings *settings)
         }
         m_status = m_groupAddress.isMulticast();
         if (!m_status) {
+            QMutexLocker locker(&m_mutex);
             m_diagnostics << QString("Invalid multicast address: %1").arg(address);
         }
     }
@@ -113,6 +354,10 @@ void NetMIDIInputPrivate::writeSettings(QSettings *settings)
         settings->setValue("interface", m_iface.name());
         settings->setValue("ipv6", m_ipv6);
         settings->setValue("address", m_groupAddress.toString());
+#if defined(Q_OS_LINUX)
+        settings->setValue("batchReceive", m_batchReceive);
+#endif
+        settings->setValue("playoutDelay", m_playoutDelay);
         settings->endGroup();
     }
 }
@@ -120,20 +365,61 @@ void NetMIDIInputPrivate::writeSettings(QSettings *settings)
 void NetMIDIInputPrivate::setMIDIThruDevice(MIDIOutput* device)
 {
     m_out = device;
+    m_forwarder.setOutput(device);
     if (m_parser != nullptr) {
         m_parser->setMIDIThruDevice(device);
     }
 }
 
+void NetMIDIInputPrivate::processDatagram(const char *data, int size)
+{
+    m_datagrams++;
+    if (m_parser == nullptr) {
+        return;
+    }
+    qint64 stamp = -1;
+    if (NetMIDIFrame::isFramed(data, size)) {
+        NetMIDIFrame frame;
+        frame.read(data);
+        m_framesReceived++;
+        if (m_sequenced) {
+            // serial number arithmetic, tolerating the wrap around
+            const qint32 delta = static_cast<qint32>(frame.sequence - m_nextSequence);
+            if (delta < -RESYNC_DISTANCE) {
+                // the sender was restarted
+                m_nextSequence = frame.sequence + 1;
+            } else if (delta < 0) {
+                // a late frame, already counted as lost when the gap was found
+                m_framesReordered++;
+                if (m_framesLost > 0) {
+                    m_framesLost--;
+                }
+            } else {
+                m_framesLost += static_cast<quint32>(delta);
+                m_nextSequence = frame.sequence + 1;
+            }
+        } else {
+            m_sequenced = true;
+            m_nextSequence = frame.sequence + 1;
+        }
+        stamp = frame.timestamp;
+        data += NetMIDIFrame::HEADER_SIZE;
+        size -= NetMIDIFrame::HEADER_SIZE;
+    }
+    if (m_playout != nullptr) {
+        m_playout->schedule(stamp, data, size);
+    } else {
+        m_parser->parse(data, size);
+    }
+}
+
 void NetMIDIInputPrivate::processIncomingMessages()
 {
+    // m_datagram keeps its capacity between datagrams
     while (m_socket->hasPendingDatagrams()) {
-        QByteArray datagram;
-        datagram.resize(static_cast<int>(m_socket->pendingDatagramSize()));
-        m_socket->readDatagram(datagram.data(), datagram.size());
-        if (m_parser != nullptr) {
-            m_parser->parse(datagram);
-        }
+        m_datagram.resize(static_cast<int>(m_socket->pendingDatagramSize()));
+        m_socket->readDatagram(m_datagram.data(), m_datagram.size());
+        processDatagram(m_datagram.constData(), m_datagram.size());
     }
 }
 
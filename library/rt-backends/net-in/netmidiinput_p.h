@@ -19,25 +19,102 @@
 #ifndef NETMIDIINPUT_P_H
 #define NETMIDIINPUT_P_H
 
+#include <QMutex>
 #include <QObject>
+#include <QSemaphore>
+#include <QThread>
 #include <QUdpSocket>
 #include <QNetworkInterface>
+#include <atomic>
 #include "midiparser.h"
+#include "midiring.h"
+#include "midithru.h"
 
 namespace drumstick {
 namespace rt {
 
 class MIDIOutput;
 class NetMIDIInput;
+class NetMIDIInputPrivate;
+
+/*
+ * Linux only: drains the socket with recvmmsg() into a preallocated array
+ * of receive slots, and parses the datagrams in place on its own thread.
+ * The input signals are emitted from this thread, so it is not used unless
+ * the "batchReceive" setting is enabled.
+ */
+class NetMIDIReceiver : public QThread
+{
+public:
+    static const int SLOTS = 64;
+    static const int SLOT_SIZE = 9216;
+
+    explicit NetMIDIReceiver(NetMIDIInputPrivate *owner);
+    bool startReceiving();
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    NetMIDIInputPrivate *m_owner;
+    QSemaphore m_started;
+    std::atomic<bool> m_stop;
+    bool m_status;
+};
+
+/*
+ * Jitter buffer: the datagrams with a sender timestamp are released by
+ * this thread at the sender time plus the estimated clock offset plus a
+ * fixed target delay. The offset is the minimum transit time observed in
+ * a sliding window of datagrams. Datagrams arriving out of order are
+ * released in timestamp order, datagrams arriving after their playout time
+ * are dropped, and raw datagrams are released immediately.
+ */
+class NetMIDIPlayout : public QThread
+{
+public:
+    static const int OFFSET_WINDOW = 256;
+
+    NetMIDIPlayout(MIDIParser *parser, int delay);
+    bool schedule(qint64 stamp, const char *data, int size);
+    void stop();
+
+    std::atomic<qint64> m_jitter;
+    std::atomic<quint64> m_lateDrops;
+    std::atomic<quint64> m_overruns;
+    std::atomic<int> m_depth;
+
+protected:
+    void run() override;
+
+private:
+    MIDIParser *m_parser;
+    MIDIRing m_ring;
+    std::atomic<bool> m_stop;
+    qint64 m_delay;
+    bool m_synced;
+    qint64 m_offset;
+    qint64 m_windowMin;
+    int m_windowCount;
+    qint64 m_lastTransit;
+    double m_jitterEstimate;
+};
 
 class NetMIDIInputPrivate : public QObject
 {
     Q_OBJECT
 public:
+    // a sequence number this far behind the expected one means a new sender
+    static const qint32 RESYNC_DISTANCE = 1024;
+
     NetMIDIInput *m_inp;
     MIDIOutput *m_out;
     QUdpSocket *m_socket;
     MIDIParser *m_parser;
+    NetMIDIReceiver *m_receiver;
+    NetMIDIPlayout *m_playout;
+    MIDIThruForwarder m_forwarder;
     int m_thruEnabled;
     quint16 m_port;
     QString m_publicName;
@@ -48,7 +125,18 @@ public:
     QNetworkInterface m_iface;
     bool m_ipv6;
     bool m_status;
+    bool m_batchReceive;
+    int m_playoutDelay;
+    QMutex m_mutex; // guards m_diagnostics
     QStringList m_diagnostics;
+    QByteArray m_datagram;
+    bool m_sequenced;
+    quint32 m_nextSequence;
+    std::atomic<quint64> m_datagrams;
+    std::atomic<quint64> m_truncated;
+    std::atomic<quint64> m_framesReceived;
+    std::atomic<quint64> m_framesLost;
+    std::atomic<quint64> m_framesReordered;
 
     explicit NetMIDIInputPrivate(QObject *parent = nullptr);
 
@@ -57,6 +145,8 @@ public:
     void initialize(QSettings* settings);
     void setMIDIThruDevice(MIDIOutput* device);
     void writeSettings(QSettings *settings);
+    bool bindSocket(QUdpSocket *socket);
+    void processDatagram(const char *data, int size);
 
 public Q_SLOTS:
     void processIncomingMessages();
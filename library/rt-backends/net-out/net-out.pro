@@ -9,10 +9,11 @@ DEPENDPATH += . ../../include
 INCLUDEPATH += . ../../include
 include (../../../global.pri)
 DEPENDPATH += ../../include
-INCLUDEPATH += ../../include
+INCLUDEPATH += ../../include ../common
 QT -= gui
 
-HEADERS += netmidioutput.h
+HEADERS += netmidioutput.h \
+    ../common/netmidiframe.h
 SOURCES += netmidioutput.cpp
 
 QT += network
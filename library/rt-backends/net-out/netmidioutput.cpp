@@ -17,9 +17,14 @@
 */
 
 #include "netmidioutput.h"
+#include "netmidiframe.h"
+#include <QMutex>
 #include <QNetworkInterface>
 #include <QSettings>
+#include <QThread>
 #include <QUdpSocket>
+#include <QWaitCondition>
+#include <atomic>
 
 namespace drumstick { namespace rt {
 
@@ -29,9 +34,131 @@ const QString NetMIDIOutput::STR_ADDRESS_IPV6 = QStringLiteral("ff12::37");
 const int NetMIDIOutput::MULTICAST_PORT = 21928;
 const int NetMIDIOutput::LAST_PORT = 21948;
 
+/*
+ * In coalescing mode, the messages arriving within a time window are packed
+ * into a single framed datagram, written by this thread.
+ */
+class NetMIDISender : public QThread
+{
+public:
+    QHostAddress m_groupAddress;
+    QNetworkInterface m_iface;
+    quint16 m_port{0};
+    bool m_ipv6{false};
+    int m_window{NetMIDIFrame::DEFAULT_WINDOW};
+    int m_maxPayload{NetMIDIFrame::DEFAULT_MAX_DATAGRAM - NetMIDIFrame::HEADER_SIZE};
+    QMutex m_mutex;
+    QWaitCondition m_wakeup;
+    QByteArray m_pending;
+    QList<QPair<qint64, QByteArray>> m_ready;
+    qint64 m_firstStamp{0};
+    bool m_stop{false};
+    quint32 m_sequence{0};
+    std::atomic<quint64> m_datagrams{0};
+    std::atomic<quint64> m_messages{0};
+    QString m_error;
+
+    void append(const char *data, int size)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_pending.isEmpty() && m_pending.size() + size > m_maxPayload) {
+            flushPending();
+        }
+        // a message longer than the payload, like a long sysex, is split into
+        // consecutive datagrams, joined again by the receiver's MIDI parser
+        while (size > m_maxPayload) {
+            beginPending();
+            m_pending.append(data, m_maxPayload);
+            flushPending();
+            data += m_maxPayload;
+            size -= m_maxPayload;
+        }
+        beginPending();
+        m_pending.append(data, size);
+        m_messages++;
+    }
+
+    void beginPending()
+    {
+        if (m_pending.isEmpty()) {
+            m_pending.reserve(m_maxPayload);
+            m_firstStamp = NetMIDIFrame::now();
+            m_wakeup.wakeOne();
+        }
+    }
+
+    void flushPending()
+    {
+        m_ready << qMakePair(m_firstStamp, m_pending);
+        m_pending.clear();
+        m_wakeup.wakeOne();
+    }
+
+    void stop()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stop = true;
+        m_wakeup.wakeOne();
+        locker.unlock();
+        wait();
+    }
+
+    void run() override
+    {
+        QUdpSocket socket;
+        if (!socket.bind(m_ipv6 ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4, socket.localPort())) {
+            m_error = QString("Socket error: %1 = %2").arg(socket.error()).arg(socket.errorString());
+            return;
+        }
+        socket.setSocketOption(QAbstractSocket::MulticastTtlOption, 1);
+#ifdef Q_OS_UNIX
+        socket.setSocketOption(QAbstractSocket::MulticastLoopbackOption, 0);
+#endif
+        if (m_iface.isValid()) {
+            socket.setMulticastInterface(m_iface);
+        }
+        QByteArray datagram;
+        datagram.reserve(m_maxPayload + NetMIDIFrame::HEADER_SIZE);
+        QList<QPair<qint64, QByteArray>> outgoing;
+        QMutexLocker locker(&m_mutex);
+        for (;;) {
+            if (m_ready.isEmpty()) {
+                if (m_pending.isEmpty()) {
+                    if (m_stop) {
+                        break;
+                    }
+                    m_wakeup.wait(&m_mutex);
+                    continue;
+                }
+                // on stop, the coalescing window is cut short
+                const qint64 remaining = m_firstStamp + m_window - NetMIDIFrame::now();
+                if (remaining > 0 && !m_stop) {
+                    m_wakeup.wait(&m_mutex, static_cast<unsigned long>((remaining + 999) / 1000));
+                    continue;
+                }
+                m_ready << qMakePair(m_firstStamp, m_pending);
+                m_pending.clear();
+            }
+            outgoing.swap(m_ready);
+            locker.unlock();
+            for (const auto &payload : std::as_const(outgoing)) {
+                NetMIDIFrame frame{m_sequence++, payload.first};
+                datagram.resize(NetMIDIFrame::HEADER_SIZE);
+                frame.write(datagram.data());
+                datagram.append(payload.second);
+                socket.writeDatagram(datagram, m_groupAddress, m_port);
+                m_datagrams++;
+            }
+            outgoing.clear();
+            locker.relock();
+        }
+    }
+};
+
 class NetMIDIOutput::NetMIDIOutputPrivate
 {
 public:
+    NetMIDIOutput *m_out;
     QUdpSocket *m_socket;
     QString m_publicName;
     QHostAddress m_groupAddress;
@@ -43,13 +170,22 @@ public:
     bool m_ipv6;
     bool m_status;
     QStringList m_diagnostics;
+    bool m_rawMode;
+    int m_window;
+    int m_maxDatagram;
+    NetMIDISender *m_sender;
 
-    NetMIDIOutputPrivate() :
+    explicit NetMIDIOutputPrivate(NetMIDIOutput *out) :
+        m_out(out),
         m_socket(nullptr),
         m_publicName(DEFAULT_PUBLIC_NAME),
         m_groupAddress(QHostAddress(STR_ADDRESS_IPV4)),
         m_port(0),
-        m_ipv6(false)
+        m_ipv6(false),
+        m_rawMode(true),
+        m_window(NetMIDIFrame::DEFAULT_WINDOW),
+        m_maxDatagram(NetMIDIFrame::DEFAULT_MAX_DATAGRAM),
+        m_sender(nullptr)
     {
         for(int i=MULTICAST_PORT; i<LAST_PORT; ++i) {
             m_outputDevices << MIDIConnection(QString::number(i), i);
@@ -70,6 +206,11 @@ public:
             QString ifaceName = settings->value("interface", QString()).toString();
             m_ipv6 = settings->value("ipv6", false).toBool();
             QString address = settings->value("address", m_ipv6 ? STR_ADDRESS_IPV6 : STR_ADDRESS_IPV4).toString();
+            m_rawMode = settings->value("rawMode", true).toBool();
+            m_window = qBound(0, settings->value("coalesceWindow", NetMIDIFrame::DEFAULT_WINDOW).toInt(), 100000);
+            m_maxDatagram = qBound(NetMIDIFrame::HEADER_SIZE + 16,
+                                   settings->value("maxDatagram", NetMIDIFrame::DEFAULT_MAX_DATAGRAM).toInt(),
+                                   65000);
             settings->endGroup();
             if (!ifaceName.isEmpty()) {
                 m_iface = QNetworkInterface::interfaceFromName(ifaceName);
@@ -93,6 +234,9 @@ public:
             settings->setValue("interface", m_iface.name());
             settings->setValue("ipv6", m_ipv6);
             settings->setValue("address", m_groupAddress.toString());
+            settings->setValue("rawMode", m_rawMode);
+            settings->setValue("coalesceWindow", m_window);
+            settings->setValue("maxDatagram", m_maxDatagram);
             settings->endGroup();
         }
     }
@@ -101,7 +245,20 @@ public:
     {
         //qDebug() << Q_FUNC_INFO << portName;
         int p = portName.second.toInt();
-        if (p >= MULTICAST_PORT && p < LAST_PORT && m_status)
+        if (p >= MULTICAST_PORT && p < LAST_PORT && m_status && !m_rawMode)
+        {
+            m_sender = new NetMIDISender;
+            m_sender->m_groupAddress = m_groupAddress;
+            m_sender->m_iface = m_iface;
+            m_sender->m_port = static_cast<quint16>(p);
+            m_sender->m_ipv6 = m_ipv6;
+            m_sender->m_window = m_window;
+            m_sender->m_maxPayload = m_maxDatagram - NetMIDIFrame::HEADER_SIZE;
+            m_sender->start(QThread::HighPriority);
+            m_port = static_cast<quint16>(p);
+            m_currentOutput = portName;
+        }
+        else if (p >= MULTICAST_PORT && p < LAST_PORT && m_status)
         {
             m_socket = new QUdpSocket();
             bool res = m_socket->bind(m_ipv6 ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4, m_socket->localPort());
@@ -125,43 +282,63 @@ public:
 
     void close()
     {
+        // the sender error is kept for getDiagnostics() after closing
+        m_diagnostics.clear();
+        if (m_sender != nullptr) {
+            m_sender->stop();
+            if (!m_sender->m_error.isEmpty()) {
+                m_diagnostics << m_sender->m_error;
+            }
+            delete m_sender;
+            m_sender = nullptr;
+        }
         delete m_socket;
         m_socket = nullptr;
         m_currentOutput = MIDIConnection();
         m_status = false;
-        m_diagnostics.clear();
     }
 
     void sendMessage(int m0)
     {
-        QByteArray m;
-        m.resize(1);
-        m[0] = static_cast<char>(m0);
-        sendMessage(m);
+        const char m[1] = { static_cast<char>(m0) };
+        sendMessage(m, sizeof(m));
     }
 
     void sendMessage(int m0, int m1)
     {
-        QByteArray m;
-        m.resize(2);
-        m[0] = static_cast<char>(m0);
-        m[1] = static_cast<char>(m1);
-        sendMessage(m);
+        const char m[2] = { static_cast<char>(m0), static_cast<char>(m1) };
+        sendMessage(m, sizeof(m));
     }
 
     void sendMessage(int m0, int m1, int m2)
     {
-        QByteArray m;
-        m.resize(3);
-        m[0] = static_cast<char>(m0);
-        m[1] = static_cast<char>(m1);
-        m[2] = static_cast<char>(m2);
-        sendMessage(m);
+        const char m[3] = { static_cast<char>(m0), static_cast<char>(m1), static_cast<char>(m2) };
+        sendMessage(m, sizeof(m));
     }
 
     void sendMessage(const QByteArray& message )
     {
-        //qDebug() << Q_FUNC_INFO << message.toHex() << m_groupAddress << m_port;
+        sendMessage(message.constData(), message.size());
+    }
+
+    void sendMessage(const char *message, int size)
+    {
+        //qDebug() << Q_FUNC_INFO << QByteArray(message, size).toHex() << m_groupAddress << m_port;
+        if (m_sender != nullptr) {
+            m_sender->append(message, size);
+            return;
+        }
+        if (m_socket != nullptr && m_socket->thread() != QThread::currentThread()) {
+            // the socket can only be used from its own thread (MIDI thru forwarder)
+            QMetaObject::invokeMethod(m_out, "writeMessage", Qt::QueuedConnection,
+                                      Q_ARG(QByteArray, QByteArray(message, size)));
+            return;
+        }
+        writeDatagram(message, size);
+    }
+
+    void writeDatagram(const char *message, int size)
+    {
         if (m_socket == nullptr) {
             m_diagnostics << "udp socket is null";
             return;
@@ -169,7 +346,7 @@ public:
             m_diagnostics << QString("udp socket has invalid state: %1 Error: %2 %3").arg(m_socket->state()).arg(m_socket->error()).arg(m_socket->errorString());
             return;
         }
-        auto res = m_socket->writeDatagram(message, m_groupAddress, m_port);
+        auto res = m_socket->writeDatagram(message, size, m_groupAddress, m_port);
         //qDebug() << Q_FUNC_INFO << "writeDatagram:" << res;
         if (res < 0) {
             m_diagnostics << QString("Error: %1 %2").arg(m_socket->error()).arg(m_socket->errorString());
@@ -178,7 +355,7 @@ public:
 };
 
 NetMIDIOutput::NetMIDIOutput(QObject *parent) : MIDIOutput(parent),
-  d(new NetMIDIOutputPrivate)
+  d(new NetMIDIOutputPrivate(this))
 { }
 
 NetMIDIOutput::~NetMIDIOutput()
@@ -284,6 +461,11 @@ void NetMIDIOutput::writeSettings(QSettings *settings)
     d->writeSettings(settings);
 }
 
+void NetMIDIOutput::writeMessage(const QByteArray &message)
+{
+    d->writeDatagram(message.constData(), message.size());
+}
+
 QStringList NetMIDIOutput::getDiagnostics()
 {
     return d->m_diagnostics;
@@ -294,6 +476,16 @@ bool NetMIDIOutput::getStatus()
     return d->m_status;
 }
 
+qulonglong NetMIDIOutput::getDatagrams()
+{
+    return d->m_sender != nullptr ? d->m_sender->m_datagrams.load() : 0;
+}
+
+qulonglong NetMIDIOutput::getMessages()
+{
+    return d->m_sender != nullptr ? d->m_sender->m_messages.load() : 0;
+}
+
 } // namespace rt
 } // namespace drumstick
 
@@ -32,6 +32,8 @@ namespace drumstick { namespace rt {
         Q_INTERFACES(drumstick::rt::MIDIOutput)
         Q_PROPERTY(QStringList diagnostics READ getDiagnostics)
         Q_PROPERTY(bool status READ getStatus)
+        Q_PROPERTY(qulonglong datagrams READ getDatagrams)
+        Q_PROPERTY(qulonglong messages READ getMessages)
 
     public:
         explicit NetMIDIOutput(QObject *parent = nullptr);
@@ -68,6 +70,9 @@ namespace drumstick { namespace rt {
 
         void writeSettings(QSettings *settings);
 
+    private Q_SLOTS:
+        void writeMessage(const QByteArray &message);
+
     private:
         class NetMIDIOutputPrivate;
         NetMIDIOutputPrivate * const d;
@@ -75,6 +80,8 @@ namespace drumstick { namespace rt {
     private:
         QStringList getDiagnostics();
         bool getStatus();
+        qulonglong getDatagrams();
+        qulonglong getMessages();
     };
 
 }}
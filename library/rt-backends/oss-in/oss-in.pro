@@ -11,11 +11,14 @@ INCLUDEPATH += ../../include ../common
 QT -= gui
 
 HEADERS += ../common/midiparser.h \
+           ../common/midithru.h \
+           ../common/midiring.h \
            ossinput_p.h \
            ossinput.h
 
 SOURCES += ossinput.cpp \
            ossinput_p.cpp \
-           ../common/midiparser.cpp
+           ../common/midiparser.cpp \
+           ../common/midithru.cpp
 
 LIBS += -L$$OUT_PWD/../../../build/lib -ldrumstick-rt
@@ -33,7 +33,11 @@ OSSInput::~OSSInput()
 
 void OSSInput::initialize(QSettings *settings)
 {
-    Q_UNUSED(settings)
+    if (settings != nullptr) {
+        settings->beginGroup("OSS");
+        d->m_readerThread = settings->value("readerThread", false).toBool();
+        settings->endGroup();
+    }
 }
 
 QString OSSInput::backendName()
@@ -93,5 +97,70 @@ bool OSSInput::isEnabledMIDIThru()
     return d->m_thruEnabled && (d->m_out != nullptr);
 }
 
+bool OSSInput::getThruQueued()
+{
+    return d->m_forwarder.isEnabled();
+}
+
+void OSSInput::setThruQueued(bool queued)
+{
+    d->m_forwarder.setEnabled(queued);
+}
+
+int OSSInput::getThruLatencyBudget()
+{
+    return d->m_forwarder.latencyBudget();
+}
+
+void OSSInput::setThruLatencyBudget(int usecs)
+{
+    d->m_forwarder.setLatencyBudget(usecs);
+}
+
+qulonglong OSSInput::getThruForwarded()
+{
+    return d->m_forwarder.forwarded();
+}
+
+qulonglong OSSInput::getThruOverruns()
+{
+    return d->m_forwarder.overruns();
+}
+
+qulonglong OSSInput::getThruDropped()
+{
+    return d->m_forwarder.dropped();
+}
+
+QStringList OSSInput::getDiagnostics()
+{
+    return d->m_diagnostics;
+}
+
+bool OSSInput::getStatus()
+{
+    return d->m_fd >= 0;
+}
+
+bool OSSInput::getReaderThread()
+{
+    return d->m_readerThread;
+}
+
+void OSSInput::setReaderThread(bool enable)
+{
+    d->m_readerThread = enable;
+}
+
+qulonglong OSSInput::getReads()
+{
+    return d->m_reads;
+}
+
+qulonglong OSSInput::getBytes()
+{
+    return d->m_bytes;
+}
+
 } // namespace rt
 } // namespace drumstick
@@ -31,6 +31,16 @@ namespace drumstick { namespace rt {
         Q_OBJECT
         Q_PLUGIN_METADATA(IID "net.sourceforge.drumstick.rt.MIDIInput/2.0")
         Q_INTERFACES(drumstick::rt::MIDIInput)
+        Q_PROPERTY(bool thruQueued READ getThruQueued WRITE setThruQueued)
+        Q_PROPERTY(int thruLatencyBudget READ getThruLatencyBudget WRITE setThruLatencyBudget)
+        Q_PROPERTY(qulonglong thruForwarded READ getThruForwarded)
+        Q_PROPERTY(qulonglong thruOverruns READ getThruOverruns)
+        Q_PROPERTY(qulonglong thruDropped READ getThruDropped)
+        Q_PROPERTY(QStringList diagnostics READ getDiagnostics)
+        Q_PROPERTY(bool status READ getStatus)
+        Q_PROPERTY(bool readerThread READ getReaderThread WRITE setReaderThread)
+        Q_PROPERTY(qulonglong reads READ getReads)
+        Q_PROPERTY(qulonglong bytes READ getBytes)
     public:
         explicit OSSInput(QObject *parent = nullptr);
         virtual ~OSSInput();
@@ -54,6 +64,21 @@ namespace drumstick { namespace rt {
         virtual bool isEnabledMIDIThru() override;
     private:
         OSSInputPrivate *d;
+
+    private:
+        bool getThruQueued();
+        void setThruQueued(bool queued);
+        int getThruLatencyBudget();
+        void setThruLatencyBudget(int usecs);
+        qulonglong getThruForwarded();
+        qulonglong getThruOverruns();
+        qulonglong getThruDropped();
+        QStringList getDiagnostics();
+        bool getStatus();
+        bool getReaderThread();
+        void setReaderThread(bool enable);
+        qulonglong getReads();
+        qulonglong getBytes();
     };
 
 }}
@@ -19,21 +19,60 @@
 #include <QDir>
 #include <QFile>
 #include <QObject>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
 #include "ossinput.h"
 #include "ossinput_p.h"
 
 namespace drumstick { namespace rt {
 
+OSSReader::OSSReader(OSSInputPrivate *owner):
+    m_owner(owner),
+    m_stop(false)
+{ }
+
+void OSSReader::stop()
+{
+    m_stop = true;
+    wait();
+}
+
+void OSSReader::run()
+{
+    char buffer[OSSInputPrivate::BUFFER_SIZE];
+    pollfd pfd;
+    pfd.fd = m_owner->m_fd;
+    pfd.events = POLLIN;
+    while (!m_stop) {
+        pfd.revents = 0;
+        // the timeout bounds the latency of stop()
+        if (::poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        if ((pfd.revents & POLLIN) == 0 || !m_owner->readAvailable(buffer)) {
+            // hang up, or the device is gone
+            break;
+        }
+    }
+}
+
 OSSInputPrivate::OSSInputPrivate(QObject *parent) : QObject(parent),
     m_inp(qobject_cast<OSSInput *>(parent)),
     m_out(nullptr),
-    m_device(nullptr),
+    m_fd(-1),
     m_notifier(nullptr),
+    m_reader(nullptr),
     m_parser(nullptr),
     m_thruEnabled(false),
     m_advanced(false),
-    m_publicName(OSSInput::DEFAULT_PUBLIC_NAME)
+    m_readerThread(false),
+    m_publicName(OSSInput::DEFAULT_PUBLIC_NAME),
+    m_reads(0),
+    m_bytes(0)
 {
     reloadDeviceList();
 }
@@ -59,25 +98,41 @@ void OSSInputPrivate::reloadDeviceList(bool advanced)
 
 void OSSInputPrivate::open(const MIDIConnection& portName)
 {
-    QFile *f = new QFile(portName.second.toString());
+    m_diagnostics.clear();
+    m_fd = ::open(QFile::encodeName(portName.second.toString()).constData(), O_RDONLY | O_NONBLOCK | O_NOCTTY);
+    if (m_fd < 0) {
+        m_diagnostics << QString("Error opening %1: %2").arg(portName.second.toString(), QString::fromLocal8Bit(std::strerror(errno)));
+        return;
+    }
     m_currentInput = portName;
-    m_device = f;
-    m_device->open( QIODevice::ReadOnly | QIODevice::Unbuffered );
-    m_notifier = new QSocketNotifier(f->handle(), QSocketNotifier::Read);
+    m_reads = 0;
+    m_bytes = 0;
     m_parser = new MIDIParser(m_inp);
-    m_buffer.clear();
-    connect(m_notifier, &QSocketNotifier::activated, this, &OSSInputPrivate::processIncomingMessages);
+    m_parser->setMIDIThruDevice(m_out);
+    m_parser->setThruForwarder(&m_forwarder);
+    if (m_readerThread) {
+        m_reader = new OSSReader(this);
+        m_reader->start(QThread::TimeCriticalPriority);
+    } else {
+        m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read);
+        connect(m_notifier, &QSocketNotifier::activated, this, &OSSInputPrivate::processIncomingMessages);
+    }
     //qDebug() << Q_FUNC_INFO << portName;
 }
 
 void OSSInputPrivate::close()
 {
-    if (m_device != nullptr) {
-        m_device->close();
+    if (m_fd >= 0) {
+        if (m_reader != nullptr) {
+            m_reader->stop();
+            delete m_reader;
+            m_reader = nullptr;
+        }
         delete m_notifier;
-        delete m_device;
+        m_notifier = nullptr;
+        ::close(m_fd);
+        m_fd = -1;
         delete m_parser;
-        m_device = nullptr;
         m_parser = nullptr;
     }
     m_currentInput = MIDIConnection();
@@ -86,18 +141,41 @@ void OSSInputPrivate::close()
 void OSSInputPrivate::setMIDIThruDevice(MIDIOutput* device)
 {
     m_out = device;
+    m_forwarder.setOutput(device);
     if (m_parser != nullptr) {
         m_parser->setMIDIThruDevice(device);
     }
 }
 
+/*
+ * Reads everything available without blocking, parsing each span in one
+ * call. Returns false at end of file or on a read error.
+ */
+bool OSSInputPrivate::readAvailable(char *buffer)
+{
+    for(;;) {
+        const ssize_t n = ::read(m_fd, buffer, BUFFER_SIZE);
+        if (n > 0) {
+            m_reads++;
+            m_bytes += static_cast<quint64>(n);
+            if (m_parser != nullptr) {
+                m_parser->parse(buffer, static_cast<int>(n));
+            }
+            if (n < BUFFER_SIZE) {
+                return true;
+            }
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+}
+
 void OSSInputPrivate::processIncomingMessages(int)
 {
-    char ch;
-    m_device->getChar(&ch);
-    if (m_parser != nullptr) {
-        uchar uch = static_cast<unsigned>(ch);
-        m_parser->parse(uch);
+    if (!readAvailable(m_buffer)) {
+        m_notifier->setEnabled(false);
     }
 }
 
@@ -20,41 +20,69 @@
 #define OSSINPUT_P_H
 
 #include <QObject>
-#include <QIODevice>
 #include <QSocketNotifier>
 #include <QStringList>
-#include <QByteArray>
+#include <QThread>
+#include <atomic>
 #include "midiparser.h"
+#include "midithru.h"
 
 namespace drumstick {
 namespace rt {
 
 class MIDIOutput;
 class OSSInput;
+class OSSInputPrivate;
+
+/*
+ * Optional reader thread, waiting on the device with poll() instead of
+ * the QSocketNotifier of the event loop.
+ */
+class OSSReader : public QThread
+{
+public:
+    explicit OSSReader(OSSInputPrivate *owner);
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    OSSInputPrivate *m_owner;
+    std::atomic<bool> m_stop;
+};
 
 class OSSInputPrivate : public QObject
 {
     Q_OBJECT
 public:
+    static const int BUFFER_SIZE = 4096;
+
     OSSInput *m_inp;
     MIDIOutput *m_out;
-    QIODevice *m_device;
+    int m_fd;
     QSocketNotifier *m_notifier;
+    OSSReader *m_reader;
     MIDIParser *m_parser;
+    MIDIThruForwarder m_forwarder;
     bool m_thruEnabled;
     bool m_advanced;
+    bool m_readerThread;
     QString m_publicName;
     MIDIConnection m_currentInput;
     QList<MIDIConnection> m_inputDevices;
     QStringList m_excludedNames;
-    QByteArray m_buffer;
+    QStringList m_diagnostics;
+    std::atomic<quint64> m_reads;
+    std::atomic<quint64> m_bytes;
+    char m_buffer[BUFFER_SIZE];
 
     explicit OSSInputPrivate(QObject *parent = nullptr);
     void reloadDeviceList(bool advanced = false);
     void open(const MIDIConnection& portName);
     void close();
-    //void parse();
     void setMIDIThruDevice(MIDIOutput* device);
+    bool readAvailable(char *buffer);
 
 public Q_SLOTS:
     void processIncomingMessages(int);
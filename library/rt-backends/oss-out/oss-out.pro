@@ -6,11 +6,12 @@ CONFIG += c++11 plugin
 static {
     CONFIG += staticlib create_prl
 }
-DEPENDPATH += ../../include
-INCLUDEPATH += ../../include
+DEPENDPATH += ../../include ../common
+INCLUDEPATH += ../../include ../common
 QT -= gui
 
-HEADERS += ossoutput.h
+HEADERS += ../common/midiring.h \
+           ossoutput.h
 SOURCES += ossoutput.cpp
 
 LIBS += -L$$OUT_PWD/../../../build/lib -ldrumstick-rt
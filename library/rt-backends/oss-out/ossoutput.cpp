@@ -18,27 +18,146 @@
 
 #include <QDir>
 #include <QFile>
-
+#include <QMutex>
+#include <QThread>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "midiring.h"
 #include "ossoutput.h"
 
 namespace drumstick { namespace rt {
 
 const QString OSSOutput::DEFAULT_PUBLIC_NAME = QStringLiteral("MIDI Out");
 
+/*
+ * Optionally applies running status, omitting the status byte of a
+ * channel message when it repeats the previous one.
+ */
+class OSSRunningStatus
+{
+public:
+    std::atomic<bool> m_enabled{false};
+    int m_last{0};
+
+    void append(QByteArray &out, const char *data, int size)
+    {
+        const int status = static_cast<unsigned char>(data[0]);
+        if (status >= MIDI_STATUS_REALTIME || status < MIDI_STATUS_NOTEOFF) {
+            // realtime messages and sysex continuations do not affect the running status
+        } else if (status >= MIDI_STATUS_SYSEX) {
+            m_last = 0;
+        } else if (m_enabled && status == m_last) {
+            out.append(data + 1, size - 1);
+            return;
+        } else {
+            m_last = status;
+        }
+        out.append(data, size);
+    }
+};
+
+/*
+ * Buffered mode: messages are queued into a MIDIRing by the senders, and
+ * this thread flushes everything queued with a single write() per wakeup.
+ * When stopped, it drains the queue before leaving, waiting for a blocked
+ * device at most DRAIN_TIMEOUT microseconds.
+ */
+class OSSWriter : public QThread
+{
+public:
+    static const int WRITE_SIZE = 4096;
+    static const qint64 DRAIN_TIMEOUT = 1000000;
+
+    int m_fd{-1};
+    MIDIRing m_ring{1u << 18};
+    OSSRunningStatus m_running;
+    std::atomic<bool> m_stop{false};
+    std::atomic<qint64> m_deadline{0};
+    std::atomic<quint64> m_writes{0};
+
+    void stop()
+    {
+        m_deadline = MIDIRing::now() + DRAIN_TIMEOUT;
+        m_stop = true;
+        m_ring.wakeUp();
+        wait();
+    }
+
+    void run() override
+    {
+        QByteArray out;
+        out.reserve(WRITE_SIZE);
+        QByteArray message(static_cast<int>(MIDIRing::MAX_MESSAGE), '\0');
+        MIDIRing::Header h;
+        for (;;) {
+            if (!m_ring.peek(h)) {
+                if (m_stop) {
+                    break;
+                }
+                m_ring.wait(50);
+                continue;
+            }
+            out.clear();
+            do {
+                m_ring.read(h, message.data());
+                m_running.append(out, message.constData(), static_cast<int>(h.size));
+            } while (m_ring.peek(h) && out.size() + static_cast<int>(h.size) <= WRITE_SIZE);
+            writeAll(out);
+        }
+    }
+
+    void writeAll(const QByteArray &data)
+    {
+        int done = 0;
+        while (done < data.size()) {
+            const ssize_t n = ::write(m_fd, data.constData() + done, static_cast<size_t>(data.size() - done));
+            if (n > 0) {
+                done += static_cast<int>(n);
+                m_writes++;
+            } else if (n < 0 && errno == EAGAIN) {
+                if (m_stop && MIDIRing::now() > m_deadline) {
+                    break;
+                }
+                pollfd pfd{m_fd, POLLOUT, 0};
+                ::poll(&pfd, 1, 50);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                break;
+            }
+        }
+    }
+};
+
 class OSSOutput::OSSOutputPrivate
 {
 public:
     bool m_advanced;
-    QIODevice *m_device;
+    int m_fd;
     QString m_publicName;
     MIDIConnection m_currentOutput;
     QList<MIDIConnection> m_outputDevices;
     QStringList m_excludedNames;
+    bool m_buffered;
+    QMutex m_mutex; // serializes the senders
+    OSSRunningStatus m_running;
+    OSSWriter *m_writer;
+    QByteArray m_out;
+    std::atomic<quint64> m_overruns;
+    std::atomic<quint64> m_writes;
 
     OSSOutputPrivate() :
         m_advanced(false),
-        m_device(nullptr),
-        m_publicName(DEFAULT_PUBLIC_NAME)
+        m_fd(-1),
+        m_publicName(DEFAULT_PUBLIC_NAME),
+        m_buffered(false),
+        m_writer(nullptr),
+        m_overruns(0),
+        m_writes(0)
     {
         reloadDeviceList();
     }
@@ -70,56 +189,102 @@ public:
     void open(const MIDIConnection& portName)
     {
         //qDebug() << Q_FUNC_INFO << portName;
-        m_device = new QFile(portName.second.toString());
-        m_device->open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+        QMutexLocker locker(&m_mutex);
+        // the writer thread waits for a blocked device with poll(), and gives up when stopped
+        const int flags = O_WRONLY | O_NOCTTY | (m_buffered ? O_NONBLOCK : 0);
+        m_fd = ::open(QFile::encodeName(portName.second.toString()).constData(), flags);
+        if (m_fd < 0) {
+            return;
+        }
         m_currentOutput = portName;
+        m_running.m_last = 0;
+        m_overruns = 0;
+        m_writes = 0;
+        if (m_buffered) {
+            m_writer = new OSSWriter;
+            m_writer->m_fd = m_fd;
+            m_writer->m_running.m_enabled = m_running.m_enabled.load();
+            m_writer->start(QThread::HighPriority);
+        }
     }
 
     void close()
     {
-        if (m_device != nullptr) {
-            m_device->close();
-            delete m_device;
-            m_device = nullptr;
+        OSSWriter *writer;
+        int fd;
+        {
+            // detached under the lock, so the senders never wait for the drain
+            QMutexLocker locker(&m_mutex);
+            writer = m_writer;
+            m_writer = nullptr;
+            fd = m_fd;
+            m_fd = -1;
+            m_currentOutput = MIDIConnection();
+        }
+        if (writer != nullptr) {
+            writer->stop();
+            m_writes += writer->m_writes;
+            delete writer;
         }
-        m_currentOutput = MIDIConnection();
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    quint32 queueDepth()
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_writer != nullptr ? m_writer->m_ring.used() : 0;
+    }
+
+    quint64 writes()
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_writes + (m_writer != nullptr ? m_writer->m_writes.load() : 0);
     }
 
     void sendMessage(int m0)
     {
-        QByteArray m;
-        m.resize(1);
-        m[0] = m0;
-        sendMessage(m);
+        const char m[1] = { static_cast<char>(m0) };
+        sendMessage(m, sizeof(m));
     }
 
     void sendMessage(int m0, int m1)
     {
-        QByteArray m;
-        m.resize(2);
-        m[0] = m0;
-        m[1] = m1;
-        sendMessage(m);
+        const char m[2] = { static_cast<char>(m0), static_cast<char>(m1) };
+        sendMessage(m, sizeof(m));
     }
 
     void sendMessage(int m0, int m1, int m2)
     {
-        QByteArray m;
-        m.resize(3);
-        m[0] = m0;
-        m[1] = m1;
-        m[2] = m2;
-        sendMessage(m);
+        const char m[3] = { static_cast<char>(m0), static_cast<char>(m1), static_cast<char>(m2) };
+        sendMessage(m, sizeof(m));
     }
 
     void sendMessage(const QByteArray& message )
     {
-        if (m_device == nullptr) {
+        sendMessage(message.constData(), message.size());
+    }
+
+    void sendMessage(const char *message, int size)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_fd < 0 || size <= 0) {
             //qDebug() << "device is null";
             return;
         }
-        m_device->write(message);
-        //m_device->flush();
+        if (m_writer != nullptr) {
+            // never blocks the caller
+            if (!m_writer->m_ring.write(0, 0, message, static_cast<quint32>(size))) {
+                m_overruns++;
+            }
+            return;
+        }
+        m_out.clear();
+        m_running.append(m_out, message, size);
+        if (::write(m_fd, m_out.constData(), static_cast<size_t>(m_out.size())) > 0) {
+            m_writes++;
+        }
     }
 };
 
@@ -134,7 +299,12 @@ OSSOutput::~OSSOutput()
 
 void OSSOutput::initialize(QSettings *settings)
 {
-    Q_UNUSED(settings)
+    if (settings != nullptr) {
+        settings->beginGroup("OSS");
+        d->m_buffered = settings->value("bufferedWriter", false).toBool();
+        d->m_running.m_enabled = settings->value("runningStatus", false).toBool();
+        settings->endGroup();
+    }
 }
 
 QString OSSOutput::backendName()
@@ -224,5 +394,49 @@ void OSSOutput::sendSystemMsg(const int status)
     d->sendMessage(status);
 }
 
+bool OSSOutput::getBufferedWriter()
+{
+    return d->m_buffered;
+}
+
+void OSSOutput::setBufferedWriter(bool enable)
+{
+    d->m_buffered = enable;
+}
+
+bool OSSOutput::getRunningStatus()
+{
+    return d->m_running.m_enabled;
+}
+
+void OSSOutput::setRunningStatus(bool enable)
+{
+    QMutexLocker locker(&d->m_mutex);
+    d->m_running.m_enabled = enable;
+    if (d->m_writer != nullptr) {
+        d->m_writer->m_running.m_enabled = enable;
+    }
+}
+
+bool OSSOutput::getStatus()
+{
+    return d->m_fd >= 0;
+}
+
+int OSSOutput::getQueueDepth()
+{
+    return static_cast<int>(d->queueDepth());
+}
+
+qulonglong OSSOutput::getOverruns()
+{
+    return d->m_overruns;
+}
+
+qulonglong OSSOutput::getWrites()
+{
+    return d->writes();
+}
+
 } // namespace rt
 } // namespace drumstick
@@ -29,6 +29,12 @@ namespace drumstick { namespace rt {
         Q_OBJECT
         Q_PLUGIN_METADATA(IID "net.sourceforge.drumstick.rt.MIDIOutput/2.0")
         Q_INTERFACES(drumstick::rt::MIDIOutput)
+        Q_PROPERTY(bool bufferedWriter READ getBufferedWriter WRITE setBufferedWriter)
+        Q_PROPERTY(bool runningStatus READ getRunningStatus WRITE setRunningStatus)
+        Q_PROPERTY(bool status READ getStatus)
+        Q_PROPERTY(int queueDepth READ getQueueDepth)
+        Q_PROPERTY(qulonglong overruns READ getOverruns)
+        Q_PROPERTY(qulonglong writes READ getWrites)
     public:
         explicit OSSOutput(QObject *parent = nullptr);
         virtual ~OSSOutput();
@@ -59,6 +65,15 @@ namespace drumstick { namespace rt {
         virtual void sendSystemMsg(const int status) override;
 
     private:
+        bool getBufferedWriter();
+        void setBufferedWriter(bool enable);
+        bool getRunningStatus();
+        void setRunningStatus(bool enable);
+        bool getStatus();
+        int getQueueDepth();
+        qulonglong getOverruns();
+        qulonglong getWrites();
+
         class OSSOutputPrivate;
         OSSOutputPrivate *d;
     };
@@ -4,6 +4,10 @@ TEMPLATE = subdirs
 #    SUBDIRS += dummy-in dummy-out
 #}
 
+loopback {
+    SUBDIRS += loopback-in loopback-out
+}
+
 linux {
     SUBDIRS += alsa-in alsa-out
 }
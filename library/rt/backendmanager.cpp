@@ -17,10 +17,18 @@
 */
 
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QLibraryInfo>
 #include <QPluginLoader>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QtGlobal>
+#include <functional>
 #include <drumstick/backendmanager.h>
 
 /**
@@ -44,14 +52,38 @@ namespace drumstick { namespace rt {
  *
  * MIDIOutput: for plugins that can consume MIDI events
  *
+ * Backends are discovered reading only the plugin metadata, and they are
+ * instantiated on demand. The backend names learned when a plugin is
+ * instantiated for the first time are kept in a disk cache, keyed by the
+ * library path and modification time, so later runs don't need to load
+ * any plugin library until a backend is requested by its name.
+ *
  * @}
  */
 
     class BackendManager::BackendManagerPrivate {
     public:
+        struct BackendEntry {
+            QString key;         // library path, or "static:" + class name
+            QString path;
+            QString iid;
+            QString name;
+            int staticIndex{-1};
+            QObject *instance{nullptr};
+        };
+
         QList<QPluginLoader *> m_loaders;
         QList<MIDIInput *> m_inputsList;
         QList<MIDIOutput *> m_outputsList;
+        QList<BackendEntry> m_entries;
+        QJsonObject m_cache;
+        bool m_cacheLoaded{false};
+        bool m_cacheDirty{false};
+        bool m_allInputs{false};
+        bool m_allOutputs{false};
+        QString m_nameIn;
+        QString m_nameOut;
+        QStringList m_excludedNames;
         static BackendManager *m_instance;
 
         QString m_inputBackend{QLatin1String("Network")};
@@ -85,6 +117,152 @@ namespace drumstick { namespace rt {
             m_inputsList.clear();
             m_outputsList.clear();
             m_loaders.clear();
+            m_entries.clear();
+            m_allInputs = false;
+            m_allOutputs = false;
+        }
+
+        static QString cacheFileName()
+        {
+            return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+                   + QDir::separator() + QSTR_DRUMSTICK + QDir::separator()
+                   + QLatin1String("backends.json");
+        }
+
+        void loadCache()
+        {
+            if (!m_cacheLoaded) {
+                m_cacheLoaded = true;
+                QFile file(cacheFileName());
+                if (file.open(QIODevice::ReadOnly)) {
+                    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+                    if (root.value(QLatin1String("version")).toString() == QSTR_DRUMSTICK_VERSION) {
+                        m_cache = root.value(QLatin1String("plugins")).toObject();
+                    }
+                }
+            }
+        }
+
+        void saveCache()
+        {
+            if (m_cacheDirty) {
+                m_cacheDirty = false;
+                QString fileName = cacheFileName();
+                QDir().mkpath(QFileInfo(fileName).absolutePath());
+                QSaveFile file(fileName);
+                if (file.open(QIODevice::WriteOnly)) {
+                    QJsonObject root{{QLatin1String("version"), QSTR_DRUMSTICK_VERSION},
+                                     {QLatin1String("plugins"), m_cache}};
+                    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+                    file.commit();
+                }
+            }
+        }
+
+        static bool isBackendIID(const QString &iid)
+        {
+            return iid == QLatin1String(qobject_interface_iid<MIDIInput *>())
+                || iid == QLatin1String(qobject_interface_iid<MIDIOutput *>());
+        }
+
+        static bool isInputIID(const QString &iid)
+        {
+            return iid == QLatin1String(qobject_interface_iid<MIDIInput *>());
+        }
+
+        void adopt(QObject *obj)
+        {
+            MIDIInput *input = qobject_cast<MIDIInput *>(obj);
+            if (input != nullptr) {
+                if (!m_inputsList.contains(input)) {
+                    if (!m_nameIn.isEmpty()) {
+                        input->setPublicName(m_nameIn);
+                    }
+                    input->setExcludedConnections(m_excludedNames);
+                    m_inputsList << input;
+                }
+            } else {
+                MIDIOutput *output = qobject_cast<MIDIOutput *>(obj);
+                if (output != nullptr && !m_outputsList.contains(output)) {
+                    if (!m_nameOut.isEmpty()) {
+                        output->setPublicName(m_nameOut);
+                    }
+                    output->setExcludedConnections(m_excludedNames);
+                    m_outputsList << output;
+                }
+            }
+        }
+
+        QObject *instantiate(BackendEntry &entry)
+        {
+            if (entry.instance == nullptr) {
+                QObject *obj{nullptr};
+                if (entry.staticIndex >= 0) {
+                    obj = QPluginLoader::staticPlugins().at(entry.staticIndex).instance();
+                } else {
+                    QPluginLoader *loader = new QPluginLoader(entry.path);
+                    //qDebug() << "plugin loader created:" << loader->fileName();
+                    m_loaders << loader;
+                    obj = loader->instance();
+                }
+                if (obj != nullptr) {
+                    adopt(obj);
+                    entry.instance = obj;
+                    MIDIInput *input = qobject_cast<MIDIInput *>(obj);
+                    MIDIOutput *output = qobject_cast<MIDIOutput *>(obj);
+                    entry.name = (input != nullptr) ? input->backendName()
+                               : (output != nullptr) ? output->backendName() : QString();
+                }
+            }
+            return entry.instance;
+        }
+
+        void discover(const QString &key, const QString &path, qint64 mtime,
+                      std::function<QJsonObject()> metaData, int staticIndex)
+        {
+            auto found = std::find_if(m_entries.constBegin(), m_entries.constEnd(),
+                                      [=](const BackendEntry &e) { return e.key == key; });
+            if (found != m_entries.constEnd()) {
+                return;
+            }
+            BackendEntry entry;
+            entry.key = key;
+            entry.path = path;
+            entry.staticIndex = staticIndex;
+            QJsonObject cached = m_cache.value(key).toObject();
+            if (!cached.isEmpty() && qint64(cached.value(QLatin1String("mtime")).toDouble()) == mtime) {
+                entry.iid = cached.value(QLatin1String("iid")).toString();
+                entry.name = cached.value(QLatin1String("name")).toString();
+            } else {
+                entry.iid = metaData().value(QLatin1String("IID")).toString();
+                if (isBackendIID(entry.iid)) {
+                    // the backend name is only known by the plugin instance
+                    if (instantiate(entry) == nullptr) {
+                        return;
+                    }
+                }
+                m_cache.insert(key, QJsonObject{{QLatin1String("mtime"), double(mtime)},
+                                                {QLatin1String("iid"), entry.iid},
+                                                {QLatin1String("name"), entry.name}});
+                m_cacheDirty = true;
+            }
+            if (isBackendIID(entry.iid) && !entry.name.isEmpty()) {
+                auto dup = std::find_if(m_entries.constBegin(), m_entries.constEnd(),
+                                        [&](const BackendEntry &e) { return e.iid == entry.iid && e.name == entry.name; });
+                if (dup == m_entries.constEnd()) {
+                    m_entries << entry;
+                }
+            }
+        }
+
+        BackendEntry *findEntry(const QString &name, bool input)
+        {
+            for (BackendEntry &e : m_entries) {
+                if (e.name == name && isInputIID(e.iid) == input) {
+                    return &e;
+                }
+            }
+            return nullptr;
         }
 
         void appendDir(const QString &candidate, QStringList &result)
@@ -95,16 +273,6 @@ namespace drumstick { namespace rt {
                 result << checked.absolutePath();
             }
         }
-
-        bool isLoaderNeeded(const QString &fileName)
-        {
-            auto it = std::find_if(m_loaders.constBegin(),
-                                   m_loaders.constEnd(),
-                                   [=](QPluginLoader *loader) {
-                                       return loader->fileName() == fileName;
-                                   });
-            return it == m_loaders.constEnd();
-        }
     };
 
     /**
@@ -128,6 +296,9 @@ namespace drumstick { namespace rt {
     BackendManager::~BackendManager()
     {
         //qDebug() << Q_FUNC_INFO;
+        if (BackendManager::BackendManagerPrivate::m_instance == this) {
+            BackendManager::BackendManagerPrivate::m_instance = nullptr;
+        }
     }
 
     /**
@@ -216,64 +387,34 @@ namespace drumstick { namespace rt {
         paths << defaultPaths();
 
         //qDebug() << Q_FUNC_INFO << "names:" << names << "paths:" << paths;
+        d->m_nameIn = name_in;
+        d->m_nameOut = name_out;
+        d->m_excludedNames = names;
+        d->loadCache();
 
-        // Dynamic backends
+        // Dynamic backends: only the metadata is read here
         foreach(const QString& dir, paths) {
             QDir pluginsDir(dir);
-            foreach (QString fileName, pluginsDir.entryList(QDir::Files)) {
-                auto absolutePath = pluginsDir.absoluteFilePath(fileName);
-                if (QLibrary::isLibrary(absolutePath) && d->isLoaderNeeded(absolutePath)) {
-                    QPluginLoader *loader = new QPluginLoader(absolutePath);
-                    //qDebug() << "plugin loader created:" << loader->fileName();
-                    d->m_loaders << loader;
-                    QObject *obj = loader->instance();
-                    if (obj != nullptr) {
-                        MIDIInput *input = qobject_cast<MIDIInput *>(obj);
-                        if (input != nullptr && !d->m_inputsList.contains(input)) {
-                            //qDebug() << "input plugin instantiated:" << name_in;
-                            if (!name_in.isEmpty()) {
-                                input->setPublicName(name_in);
-                            }
-                            input->setExcludedConnections(names);
-                            d->m_inputsList << input;
-                        } else {
-                            MIDIOutput *output = qobject_cast<MIDIOutput *>(obj);
-                            if (output != nullptr && !d->m_outputsList.contains(output)) {
-                                //qDebug() << "output plugin instantiated:" << name_out;
-                                if (!name_out.isEmpty()) {
-                                    output->setPublicName(name_out);
-                                }
-                                output->setExcludedConnections(names);
-                                d->m_outputsList << output;
-                            }
-                        }
-                    }
+            foreach (const QFileInfo& info, pluginsDir.entryInfoList(QDir::Files)) {
+                auto absolutePath = info.absoluteFilePath();
+                if (QLibrary::isLibrary(absolutePath)) {
+                    d->discover(absolutePath, absolutePath,
+                                info.lastModified().toMSecsSinceEpoch(),
+                                [=] { return QPluginLoader(absolutePath).metaData(); }, -1);
                 }
             }
         }
 
         // Static backends
-        foreach(QObject* obj, QPluginLoader::staticInstances()) {
-            if (obj != nullptr) {
-                MIDIInput *input = qobject_cast<MIDIInput*>(obj);
-                if (input != nullptr && !d->m_inputsList.contains(input)) {
-                    if (!name_in.isEmpty()) {
-                        input->setPublicName(name_in);
-                    }
-                    input->setExcludedConnections(names);
-                    d->m_inputsList << input;
-                } else {
-                    MIDIOutput *output = qobject_cast<MIDIOutput*>(obj);
-                    if (output != nullptr && !d->m_outputsList.contains(output)) {
-                        if (!name_out.isEmpty()) {
-                            output->setPublicName(name_out);
-                        }
-                        output->setExcludedConnections(names);
-                        d->m_outputsList << output;
-                    }
-                }
-            }
+        const auto staticPlugins = QPluginLoader::staticPlugins();
+        const qint64 appTime = QFileInfo(QCoreApplication::applicationFilePath()).lastModified().toMSecsSinceEpoch();
+        for (int i = 0; i < staticPlugins.count(); ++i) {
+            QJsonObject metaData = staticPlugins.at(i).metaData();
+            QString key = QLatin1String("static:") + QCoreApplication::applicationFilePath()
+                          + QLatin1Char(':') + metaData.value(QLatin1String("className")).toString();
+            d->discover(key, QString(), appTime, [=] { return metaData; }, i);
         }
+        d->saveCache();
 
         foreach (MIDIInput *in, d->m_inputsList) {
             if (!name_in.isEmpty()) {
@@ -292,14 +433,54 @@ namespace drumstick { namespace rt {
 
     QList<MIDIInput*> BackendManager::availableInputs()
     {
+        if (!d->m_allInputs) {
+            for (auto &entry : d->m_entries) {
+                if (entry.instance == nullptr && BackendManagerPrivate::isInputIID(entry.iid)) {
+                    d->instantiate(entry);
+                }
+            }
+            d->m_allInputs = true;
+            d->saveCache();
+        }
         return d->m_inputsList;
     }
 
     QList<MIDIOutput*> BackendManager::availableOutputs()
     {
+        if (!d->m_allOutputs) {
+            for (auto &entry : d->m_entries) {
+                if (entry.instance == nullptr && !BackendManagerPrivate::isInputIID(entry.iid)) {
+                    d->instantiate(entry);
+                }
+            }
+            d->m_allOutputs = true;
+            d->saveCache();
+        }
         return d->m_outputsList;
     }
 
+    QStringList BackendManager::availableInputNames()
+    {
+        QStringList result;
+        for (const auto &entry : std::as_const(d->m_entries)) {
+            if (BackendManagerPrivate::isInputIID(entry.iid)) {
+                result << entry.name;
+            }
+        }
+        return result;
+    }
+
+    QStringList BackendManager::availableOutputNames()
+    {
+        QStringList result;
+        for (const auto &entry : std::as_const(d->m_entries)) {
+            if (!BackendManagerPrivate::isInputIID(entry.iid)) {
+                result << entry.name;
+            }
+        }
+        return result;
+    }
+
     MIDIInput* BackendManager::inputBackendByName(const QString name)
     {
         foreach (MIDIInput* i, d->m_inputsList) {
@@ -307,6 +488,10 @@ namespace drumstick { namespace rt {
                 return i;
             }
         }
+        auto entry = d->findEntry(name, true);
+        if (entry != nullptr) {
+            return qobject_cast<MIDIInput*>(d->instantiate(*entry));
+        }
         return nullptr;
     }
 
@@ -317,6 +502,10 @@ namespace drumstick { namespace rt {
                 return i;
             }
         }
+        auto entry = d->findEntry(name, false);
+        if (entry != nullptr) {
+            return qobject_cast<MIDIOutput*>(d->instantiate(*entry));
+        }
         return nullptr;
     }
 
@@ -325,13 +514,10 @@ namespace drumstick { namespace rt {
         QStringList names{name};
         names << d->m_inputBackend;
         names.removeDuplicates();
-        if (!names.isEmpty()) {
-            foreach(const QString& n, names) {
-                foreach(MIDIInput* input, d->m_inputsList) {
-                    if (input->backendName() == n)  {
-                        return input;
-                    }
-                }
+        foreach(const QString& n, names) {
+            MIDIInput *input = inputBackendByName(n);
+            if (input != nullptr) {
+                return input;
             }
         }
         return nullptr;
@@ -342,13 +528,10 @@ namespace drumstick { namespace rt {
         QStringList names{name};
         names << d->m_outputBackends;
         names.removeDuplicates();
-        if (!names.isEmpty()) {
-            foreach(const QString& n, names) {
-                foreach(MIDIOutput* output, d->m_outputsList) {
-                    if (output->backendName() == n)  {
-                        return output;
-                    }
-                }
+        foreach(const QString& n, names) {
+            MIDIOutput *output = outputBackendByName(n);
+            if (output != nullptr) {
+                return output;
             }
         }
         return nullptr;
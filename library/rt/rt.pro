@@ -17,10 +17,12 @@ HEADERS += \
     ../include/drumstick/rtmidiinput.h \
     ../include/drumstick/rtmidioutput.h \
     ../include/drumstick/backendmanager.h \
+    ../include/drumstick/rtmidisequencer.h \
     ../include/drumstick/macros.h
 
 SOURCES += \
-    backendmanager.cpp
+    backendmanager.cpp \
+    rtmidisequencer.cpp
 
 macx:!static {
     TARGET = drumstick-rt
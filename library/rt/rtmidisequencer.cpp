@@ -0,0 +1,730 @@
+/*
+    Drumstick RT (realtime MIDI In/Out)
+    Copyright (C) 2009-2025 Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <drumstick/rtmidisequencer.h>
+
+/**
+ * @file rtmidisequencer.cpp
+ * Implementation of a realtime MIDI song sequencer
+ */
+
+namespace drumstick { namespace rt {
+
+const int MIDISong::DEFAULT_DIVISION = 120;
+const int MIDISong::DEFAULT_TEMPO = 500000;
+
+/**
+ * @brief MIDISong constructor
+ */
+MIDISong::MIDISong():
+    m_division(DEFAULT_DIVISION),
+    m_tracks(0)
+{ }
+
+/**
+ * @brief Removes all the events and tempo changes
+ */
+void MIDISong::clear()
+{
+    m_division = DEFAULT_DIVISION;
+    m_tracks = 0;
+    m_events.clear();
+    m_tempos.clear();
+    m_sysex.clear();
+}
+
+/**
+ * @brief Sets the song resolution
+ * @param division ticks per quarter note
+ */
+void MIDISong::setDivision(int division)
+{
+    m_division = division > 0 ? division : DEFAULT_DIVISION;
+}
+
+/**
+ * @brief Gets the song resolution
+ * @return ticks per quarter note
+ */
+int MIDISong::division() const
+{
+    return m_division;
+}
+
+/**
+ * @brief Appends a channel or system message
+ * @param tick musical time
+ * @param track track number
+ * @param status MIDI status byte, including the channel
+ * @param data1 first data byte
+ * @param data2 second data byte
+ */
+void MIDISong::addMessage(quint64 tick, int track, int status, int data1, int data2)
+{
+    SongEvent ev;
+    ev.tick = tick;
+    ev.time = 0;
+    ev.track = static_cast<quint16>(track);
+    ev.status = static_cast<quint8>(status);
+    ev.data1 = static_cast<quint8>(data1);
+    ev.data2 = static_cast<quint8>(data2);
+    ev.extra = -1;
+    m_events.append(ev);
+    m_tracks = qMax(m_tracks, track + 1);
+}
+
+/**
+ * @brief Appends a pitch bend message
+ * @param tick musical time
+ * @param track track number
+ * @param chan MIDI channel
+ * @param value pitch bend value, between -8192 and 8191
+ */
+void MIDISong::addPitchBend(quint64 tick, int track, int chan, int value)
+{
+    int v = qBound(0, value + 8192, 16383);
+    addMessage(tick, track, MIDI_STATUS_PITCHBEND + chan, MIDI_LSB(v), MIDI_MSB(v));
+}
+
+/**
+ * @brief Appends a system exclusive message
+ * @param tick musical time
+ * @param track track number
+ * @param data the message payload
+ */
+void MIDISong::addSysex(quint64 tick, int track, const QByteArray &data)
+{
+    addMessage(tick, track, MIDI_STATUS_SYSEX);
+    m_events.last().extra = m_sysex.count();
+    m_sysex.append(data);
+}
+
+/**
+ * @brief Appends a tempo change to the tempo map
+ * @param tick musical time
+ * @param tempo microseconds per quarter note
+ */
+void MIDISong::addTempo(quint64 tick, int tempo)
+{
+    if (tempo > 0) {
+        SongTempo t;
+        t.tick = tick;
+        t.time = 0;
+        t.tempo = static_cast<quint32>(tempo);
+        m_tempos.append(t);
+    }
+}
+
+/**
+ * @brief Sorts the events and computes the absolute time of each one
+ *
+ * This method must be called after the last event is appended and before
+ * the song is given to a MIDISequencer. Events having the same tick keep
+ * their insertion order.
+ */
+void MIDISong::finalize()
+{
+    std::stable_sort(m_events.begin(), m_events.end(),
+                     [](const SongEvent &a, const SongEvent &b) { return a.tick < b.tick; });
+    std::stable_sort(m_tempos.begin(), m_tempos.end(),
+                     [](const SongTempo &a, const SongTempo &b) { return a.tick < b.tick; });
+
+    QVector<SongTempo> tempos;
+    tempos.reserve(m_tempos.count() + 1);
+    if (m_tempos.isEmpty() || m_tempos.first().tick > 0) {
+        tempos.append(SongTempo{0, 0, static_cast<quint32>(DEFAULT_TEMPO)});
+    }
+    for (const SongTempo &t : std::as_const(m_tempos)) {
+        if (!tempos.isEmpty() && tempos.last().tick == t.tick) {
+            tempos.last().tempo = t.tempo;
+        } else {
+            tempos.append(t);
+        }
+    }
+    for (int i = 1; i < tempos.count(); ++i) {
+        const SongTempo &prev = tempos.at(i - 1);
+        tempos[i].time = prev.time + qint64(tempos.at(i).tick - prev.tick) * prev.tempo / m_division;
+    }
+    m_tempos = tempos;
+
+    int t = 0;
+    for (SongEvent &ev : m_events) {
+        while (t + 1 < m_tempos.count() && m_tempos.at(t + 1).tick <= ev.tick) {
+            ++t;
+        }
+        const SongTempo &seg = m_tempos.at(t);
+        ev.time = seg.time + qint64(ev.tick - seg.tick) * seg.tempo / m_division;
+    }
+}
+
+/**
+ * @brief Checks if the song has no events
+ * @return true if the song is empty
+ */
+bool MIDISong::isEmpty() const
+{
+    return m_events.isEmpty();
+}
+
+/**
+ * @brief Gets the number of events
+ * @return number of events
+ */
+int MIDISong::count() const
+{
+    return m_events.count();
+}
+
+/**
+ * @brief Gets the number of tracks
+ * @return one more than the highest track number used
+ */
+int MIDISong::tracks() const
+{
+    return m_tracks;
+}
+
+/**
+ * @brief Gets an event
+ * @param index event index, between 0 and count() - 1
+ * @return the event record
+ */
+const SongEvent &MIDISong::at(int index) const
+{
+    return m_events.at(index);
+}
+
+/**
+ * @brief Gets the payload of a system exclusive event
+ * @param ev a system exclusive event of this song
+ * @return the sysex data, or an empty array
+ */
+QByteArray MIDISong::sysexData(const SongEvent &ev) const
+{
+    if (ev.extra >= 0 && ev.extra < m_sysex.count()) {
+        return m_sysex.at(ev.extra);
+    }
+    return QByteArray();
+}
+
+/**
+ * @brief Finds the first event at or after some musical time
+ * @param tick musical time
+ * @return event index, or count() if there are no more events
+ */
+int MIDISong::indexOf(quint64 tick) const
+{
+    auto it = std::lower_bound(m_events.constBegin(), m_events.constEnd(), tick,
+                               [](const SongEvent &ev, quint64 t) { return ev.tick < t; });
+    return static_cast<int>(it - m_events.constBegin());
+}
+
+/**
+ * @brief Gets the song length
+ * @return musical time of the last event
+ */
+quint64 MIDISong::lengthTicks() const
+{
+    return m_events.isEmpty() ? 0 : m_events.last().tick;
+}
+
+/**
+ * @brief Gets the song duration
+ * @return absolute time of the last event, in microseconds
+ */
+qint64 MIDISong::lengthTime() const
+{
+    return m_events.isEmpty() ? 0 : m_events.last().time;
+}
+
+/**
+ * @brief Converts musical time to absolute time using the tempo map
+ * @param tick musical time
+ * @return absolute time in microseconds
+ */
+qint64 MIDISong::tickToTime(quint64 tick) const
+{
+    if (m_tempos.isEmpty()) {
+        return qint64(tick) * DEFAULT_TEMPO / m_division;
+    }
+    auto it = std::upper_bound(m_tempos.constBegin(), m_tempos.constEnd(), tick,
+                               [](quint64 t, const SongTempo &seg) { return t < seg.tick; });
+    const SongTempo &seg = *(it == m_tempos.constBegin() ? it : it - 1);
+    return seg.time + qint64(tick - seg.tick) * seg.tempo / m_division;
+}
+
+/**
+ * @brief Converts absolute time to musical time using the tempo map
+ * @param usecs absolute time in microseconds
+ * @return musical time
+ */
+quint64 MIDISong::timeToTick(qint64 usecs) const
+{
+    if (m_tempos.isEmpty()) {
+        return quint64(usecs * m_division / DEFAULT_TEMPO);
+    }
+    auto it = std::upper_bound(m_tempos.constBegin(), m_tempos.constEnd(), usecs,
+                               [](qint64 t, const SongTempo &seg) { return t < seg.time; });
+    const SongTempo &seg = *(it == m_tempos.constBegin() ? it : it - 1);
+    return seg.tick + quint64((usecs - seg.time) * m_division / seg.tempo);
+}
+
+/**
+ * @brief Gets the tempo at some musical time
+ * @param tick musical time
+ * @return microseconds per quarter note
+ */
+int MIDISong::tempoAt(quint64 tick) const
+{
+    if (m_tempos.isEmpty()) {
+        return DEFAULT_TEMPO;
+    }
+    auto it = std::upper_bound(m_tempos.constBegin(), m_tempos.constEnd(), tick,
+                               [](quint64 t, const SongTempo &seg) { return t < seg.tick; });
+    return static_cast<int>((it == m_tempos.constBegin() ? it : it - 1)->tempo);
+}
+
+/**
+ * @brief Gets the tempo map computed by finalize()
+ * @return list of tempo changes
+ */
+const QVector<SongTempo> &MIDISong::tempoMap() const
+{
+    return m_tempos;
+}
+
+class MIDISequencer::MIDISequencerPrivate
+{
+public:
+    MIDIOutput *m_out{nullptr};
+    MIDISong m_song;
+    QMutex m_mutex;
+    QWaitCondition m_wakeup;
+    bool m_stopped{true};
+    bool m_seekRequest{false};
+    bool m_tempoChanged{false};
+    bool m_loop{false};
+    quint64 m_seekTick{0};
+    quint64 m_loopStart{0};
+    quint64 m_loopEnd{0};
+    double m_tempoFactor{1.0};
+    std::atomic<quint64> m_position{0};
+    // resized by setSong() while stopped; the playback thread reads the flags without locking
+    std::vector<std::atomic<bool>> m_muted;
+    std::vector<std::atomic<bool>> m_solo;
+    std::atomic<int> m_soloCount{0};
+
+    bool isAudible(int track) const
+    {
+        if (track < 0 || track >= int(m_muted.size())) {
+            return true;
+        }
+        if (m_soloCount.load(std::memory_order_relaxed) > 0) {
+            return m_solo[track].load(std::memory_order_relaxed);
+        }
+        return !m_muted[track].load(std::memory_order_relaxed);
+    }
+
+    void allNotesOff(MIDIOutput *out)
+    {
+        for (int chan = 0; chan < MIDI_STD_CHANNELS; ++chan) {
+            out->sendController(chan, MIDI_CONTROL_ALL_NOTES_OFF, 0);
+            out->sendController(chan, MIDI_CONTROL_ALL_SOUNDS_OFF, 0);
+        }
+    }
+
+    void dispatch(MIDIOutput *out, const SongEvent &ev)
+    {
+        // muted tracks lose only their note-ons, so no notes are left hanging
+        const int chan = ev.status & MIDI_CHANNEL_MASK;
+        switch (ev.status & MIDI_STATUS_MASK) {
+        case MIDI_STATUS_NOTEOFF:
+            out->sendNoteOff(chan, ev.data1, ev.data2);
+            break;
+        case MIDI_STATUS_NOTEON:
+            if (ev.data2 == 0 || isAudible(ev.track)) {
+                out->sendNoteOn(chan, ev.data1, ev.data2);
+            }
+            break;
+        case MIDI_STATUS_KEYPRESURE:
+            if (isAudible(ev.track)) {
+                out->sendKeyPressure(chan, ev.data1, ev.data2);
+            }
+            break;
+        case MIDI_STATUS_CONTROLCHANGE:
+            out->sendController(chan, ev.data1, ev.data2);
+            break;
+        case MIDI_STATUS_PROGRAMCHANGE:
+            out->sendProgram(chan, ev.data1);
+            break;
+        case MIDI_STATUS_CHANNELPRESSURE:
+            out->sendChannelPressure(chan, ev.data1);
+            break;
+        case MIDI_STATUS_PITCHBEND:
+            out->sendPitchBend(chan, ev.data1 + ev.data2 * 0x80 - 8192);
+            break;
+        default:
+            if (ev.status == MIDI_STATUS_SYSEX) {
+                out->sendSysex(m_song.sysexData(ev));
+            } else {
+                out->sendSystemMsg(ev.status);
+            }
+            break;
+        }
+    }
+};
+
+/**
+ * @brief MIDISequencer constructor
+ * @param parent QObject parent
+ */
+MIDISequencer::MIDISequencer(QObject *parent) : QThread(parent),
+    d{new MIDISequencerPrivate}
+{ }
+
+/**
+ * @brief MIDISequencer destructor
+ */
+MIDISequencer::~MIDISequencer()
+{
+    if (isRunning()) {
+        stop();
+    }
+}
+
+/**
+ * @brief Sets the MIDI output; it is used from the next start()
+ * @param output a MIDIOutput instance, already opened
+ */
+void MIDISequencer::setOutput(MIDIOutput *output)
+{
+    QMutexLocker locker(&d->m_mutex);
+    d->m_out = output;
+}
+
+/**
+ * @brief Gets the MIDI output
+ * @return the MIDIOutput instance
+ */
+MIDIOutput *MIDISequencer::output() const
+{
+    return d->m_out;
+}
+
+/**
+ * @brief Sets the song to be played, stopping the current playback
+ *
+ * The position is rewound to the start, and all tracks are unmuted.
+ * @param song a finalized MIDISong
+ */
+void MIDISequencer::setSong(const MIDISong &song)
+{
+    if (isRunning()) {
+        stop();
+    }
+    QMutexLocker locker(&d->m_mutex);
+    d->m_song = song;
+    d->m_position = 0;
+    d->m_muted = std::vector<std::atomic<bool>>(song.tracks());
+    d->m_solo = std::vector<std::atomic<bool>>(song.tracks());
+    d->m_soloCount = 0;
+}
+
+/**
+ * @brief Gets the current song
+ * @return a shallow copy of the song
+ */
+MIDISong MIDISequencer::song() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return d->m_song;
+}
+
+/**
+ * @brief Moves the playback position
+ *
+ * While playing, all notes are turned off and the playback continues
+ * from the new position without interruption.
+ * @param tick musical time
+ */
+void MIDISequencer::seek(quint64 tick)
+{
+    QMutexLocker locker(&d->m_mutex);
+    if (isRunning() && !d->m_stopped) {
+        d->m_seekTick = tick;
+        d->m_seekRequest = true;
+        d->m_wakeup.wakeAll();
+    } else {
+        d->m_position = tick;
+    }
+}
+
+/**
+ * @brief Gets the playback position
+ * @return musical time of the last event played
+ */
+quint64 MIDISequencer::position() const
+{
+    return d->m_position;
+}
+
+/**
+ * @brief Enables or disables looping
+ * @param enabled looping is enabled
+ * @param startTick loop start point
+ * @param endTick loop end point; zero means the end of the song
+ */
+void MIDISequencer::setLoop(bool enabled, quint64 startTick, quint64 endTick)
+{
+    QMutexLocker locker(&d->m_mutex);
+    d->m_loop = enabled;
+    d->m_loopStart = startTick;
+    d->m_loopEnd = endTick;
+    d->m_wakeup.wakeAll();
+}
+
+/**
+ * @brief Checks if looping is enabled
+ * @return looping status
+ */
+bool MIDISequencer::isLooping() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return d->m_loop;
+}
+
+/**
+ * @brief Sets the tempo scale factor
+ * @param factor 1.0 is the original tempo, 2.0 is twice faster
+ */
+void MIDISequencer::setTempoFactor(double factor)
+{
+    QMutexLocker locker(&d->m_mutex);
+    d->m_tempoFactor = qBound(0.01, factor, 100.0);
+    d->m_tempoChanged = true;
+    d->m_wakeup.wakeAll();
+}
+
+/**
+ * @brief Gets the tempo scale factor
+ * @return tempo factor
+ */
+double MIDISequencer::tempoFactor() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return d->m_tempoFactor;
+}
+
+/**
+ * @brief Gets the effective tempo at the current position
+ * @return microseconds per quarter note, scaled by the tempo factor
+ */
+int MIDISequencer::currentTempo() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return qRound(d->m_song.tempoAt(d->m_position) / d->m_tempoFactor);
+}
+
+/**
+ * @brief Mutes or unmutes a track
+ * @param track track number
+ * @param muted mute status
+ */
+void MIDISequencer::setTrackMuted(int track, bool muted)
+{
+    QMutexLocker locker(&d->m_mutex);
+    if (track >= 0 && track < int(d->m_muted.size())) {
+        d->m_muted[track] = muted;
+    }
+}
+
+/**
+ * @brief Checks if a track is muted
+ * @param track track number
+ * @return mute status
+ */
+bool MIDISequencer::isTrackMuted(int track) const
+{
+    QMutexLocker locker(&d->m_mutex);
+    if (track >= 0 && track < int(d->m_muted.size())) {
+        return d->m_muted[track];
+    }
+    return false;
+}
+
+/**
+ * @brief Sets the solo status of a track. When any track is soloed,
+ * only the soloed tracks are heard.
+ * @param track track number
+ * @param solo solo status
+ */
+void MIDISequencer::setTrackSolo(int track, bool solo)
+{
+    QMutexLocker locker(&d->m_mutex);
+    if (track >= 0 && track < int(d->m_solo.size())) {
+        if (d->m_solo[track].exchange(solo) != solo) {
+            d->m_soloCount += solo ? 1 : -1;
+        }
+    }
+}
+
+/**
+ * @brief Checks if a track is soloed
+ * @param track track number
+ * @return solo status
+ */
+bool MIDISequencer::isTrackSolo(int track) const
+{
+    QMutexLocker locker(&d->m_mutex);
+    if (track >= 0 && track < int(d->m_solo.size())) {
+        return d->m_solo[track];
+    }
+    return false;
+}
+
+/**
+ * @brief Stops the playback and waits for the thread to finish
+ */
+void MIDISequencer::stop()
+{
+    QMutexLocker locker(&d->m_mutex);
+    d->m_stopped = true;
+    d->m_wakeup.wakeAll();
+    locker.unlock();
+    wait();
+}
+
+/**
+ * @brief Starts the playback thread from the current position
+ * @param priority Thread priority, default is TimeCriticalPriority
+ */
+void MIDISequencer::start(QThread::Priority priority)
+{
+    QMutexLocker locker(&d->m_mutex);
+    d->m_stopped = false;
+    d->m_seekRequest = false;
+    d->m_tempoChanged = false;
+    locker.unlock();
+    QThread::start(priority);
+}
+
+/**
+ * @brief Playback thread loop
+ */
+void MIDISequencer::run()
+{
+    QMutexLocker locker(&d->m_mutex);
+    MIDIOutput *out = d->m_out;
+    const MIDISong &song = d->m_song;
+    if (out == nullptr || song.isEmpty()) {
+        locker.unlock();
+        Q_EMIT playbackFinished();
+        return;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    quint64 tick = d->m_position;
+    int index = song.indexOf(tick);
+    qint64 songAnchor = song.tickToTime(tick);
+    qint64 wallAnchor = 0;
+    double factor = d->m_tempoFactor;
+    bool finished = false;
+
+    while (!d->m_stopped) {
+        const qint64 now = clock.nsecsElapsed() / 1000;
+        if (d->m_seekRequest) {
+            d->m_seekRequest = false;
+            index = song.indexOf(d->m_seekTick);
+            songAnchor = song.tickToTime(d->m_seekTick);
+            wallAnchor = now;
+            d->m_position = d->m_seekTick;
+            locker.unlock();
+            d->allNotesOff(out);
+            locker.relock();
+        }
+        if (d->m_tempoChanged) {
+            d->m_tempoChanged = false;
+            songAnchor += qint64((now - wallAnchor) * factor);
+            wallAnchor = now;
+            factor = d->m_tempoFactor;
+        }
+
+        const quint64 loopEnd = (d->m_loopEnd > 0) ? d->m_loopEnd : song.lengthTicks();
+        const bool looping = d->m_loop && (loopEnd > d->m_loopStart);
+        const bool atEnd = (index >= song.count());
+        qint64 due;
+        if (looping && (atEnd || song.at(index).tick >= loopEnd)) {
+            due = wallAnchor + qint64((song.tickToTime(loopEnd) - songAnchor) / factor);
+            if (due <= now) {
+                index = song.indexOf(d->m_loopStart);
+                songAnchor = song.tickToTime(d->m_loopStart);
+                wallAnchor = due;
+                d->m_position = d->m_loopStart;
+                locker.unlock();
+                d->allNotesOff(out);
+                locker.relock();
+                continue;
+            }
+        } else if (atEnd) {
+            finished = true;
+            break;
+        } else {
+            due = wallAnchor + qint64((song.at(index).time - songAnchor) / factor);
+            if (due <= now) {
+                const SongEvent &ev = song.at(index++);
+                d->m_position = ev.tick;
+                locker.unlock();
+                d->dispatch(out, ev);
+                locker.relock();
+                continue;
+            }
+        }
+
+        // sleep on the wait condition, and spin the last millisecond with usleep
+        const qint64 remaining = due - now;
+        if (remaining > 2000) {
+            d->m_wakeup.wait(&d->m_mutex, static_cast<unsigned long>((remaining - 1000) / 1000));
+        } else {
+            locker.unlock();
+            QThread::usleep(static_cast<unsigned long>(remaining));
+            locker.relock();
+        }
+    }
+
+    if (finished) {
+        d->m_position = 0;
+    }
+    locker.unlock();
+    d->allNotesOff(out);
+    if (finished) {
+        Q_EMIT playbackFinished();
+    } else {
+        Q_EMIT playbackStopped();
+    }
+}
+
+} // namespace rt
+} // namespace drumstick
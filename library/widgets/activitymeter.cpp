@@ -0,0 +1,404 @@
+/*
+    MIDI Virtual Piano Keyboard
+    Copyright (C) 2008-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QTimer>
+#include <QtMath>
+#include <atomic>
+#include <drumstick/activitymeter.h>
+#include <drumstick/pianopalette.h>
+#include <drumstick/rtmidiinput.h>
+
+/**
+ * @file activitymeter.cpp
+ * Implementation of the MIDI Channel Activity Meter Widget
+ */
+
+namespace drumstick { namespace widgets {
+
+using namespace drumstick::rt;
+
+const int ActivityMeter::DEFAULT_FRAME_RATE = 30;
+const int ActivityMeter::DEFAULT_DECAY_TIME = 300;
+
+static const int CHANNELS = 16;
+static const double MAX_RATE = 1000.0; // messages per second at full scale
+static const double MIN_LEVEL = 0.005;
+
+class ActivityMeter::ActivityMeterPrivate
+{
+public:
+    struct Counters {
+        std::atomic<quint32> notes{0};
+        std::atomic<quint32> controllers{0};
+        std::atomic<int> peak{0};
+    };
+
+    struct Levels {
+        double notes{0.0};
+        double controllers{0.0};
+        double peak{0.0};
+    };
+
+    ActivityMeterPrivate():
+        m_frameRate(DEFAULT_FRAME_RATE),
+        m_decayTime(DEFAULT_DECAY_TIME),
+        m_active(false),
+        m_lastFrame(0),
+        m_palette(PAL_CHANNELS)
+    {
+        m_clock.start();
+    }
+
+    static double rateLevel(double rate)
+    {
+        return qMin(1.0, std::log10(1.0 + rate) / std::log10(1.0 + MAX_RATE));
+    }
+
+    /*
+     * Consumes the counters accumulated since the previous frame, and
+     * computes the new levels with an exponential decay.
+     */
+    void computeLevels()
+    {
+        const qint64 now = m_clock.nsecsElapsed();
+        const double dt = qMax<qint64>(now - m_lastFrame, 1000000) / 1e9;
+        const double decay = std::exp(-dt * 1000.0 / m_decayTime);
+        m_lastFrame = now;
+        m_active = false;
+        for (int i = 0; i < CHANNELS; ++i) {
+            Counters &c = m_counters[i];
+            Levels &l = m_levels[i];
+            const quint32 notes = c.notes.exchange(0, std::memory_order_relaxed);
+            const quint32 controllers = c.controllers.exchange(0, std::memory_order_relaxed);
+            const int peak = c.peak.exchange(0, std::memory_order_relaxed);
+            l.notes = qMax(l.notes * decay, notes > 0 ? rateLevel(notes / dt) : 0.0);
+            l.controllers = qMax(l.controllers * decay, controllers > 0 ? rateLevel(controllers / dt) : 0.0);
+            l.peak = qMax(l.peak * decay, peak / 127.0);
+            if (l.notes < MIN_LEVEL && l.controllers < MIN_LEVEL && l.peak < MIN_LEVEL) {
+                l = Levels();
+            } else {
+                m_active = true;
+            }
+        }
+    }
+
+    /*
+     * Flags new counts, and starts the frame timer if it was stopped. The
+     * flag and the timer state use sequentially consistent accesses, paired
+     * with the timer stopping itself.
+     */
+    void notify()
+    {
+        m_pending.store(true);
+        if (!m_scheduled.load() && !m_scheduled.exchange(true)) {
+            QMetaObject::invokeMethod(&m_timer, "start", Qt::QueuedConnection);
+        }
+    }
+
+    int m_frameRate;
+    int m_decayTime;
+    bool m_active;
+    qint64 m_lastFrame;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    PianoPalette m_palette;
+    Counters m_counters[CHANNELS];
+    Levels m_levels[CHANNELS];
+    std::atomic<bool> m_pending{false};
+    std::atomic<bool> m_scheduled{false}; // the frame timer runs, or is about to
+    std::atomic<quint64> m_totalNotes{0};
+    std::atomic<quint64> m_totalControllers{0};
+};
+
+/**
+ * Constructor.
+ * @param parent Widget's parent
+ */
+ActivityMeter::ActivityMeter(QWidget *parent)
+    : QWidget(parent), d(new ActivityMeterPrivate)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    d->m_timer.setTimerType(Qt::PreciseTimer);
+    d->m_timer.setInterval(1000 / d->m_frameRate);
+    connect(&d->m_timer, &QTimer::timeout, this, [this]{
+        if (!isVisible()) {
+            // restarted by showEvent()
+            d->m_timer.stop();
+            return;
+        }
+        if (d->m_pending.exchange(false) || d->m_active) {
+            update();
+            return;
+        }
+        // idle: every level has decayed to zero
+        d->m_timer.stop();
+        d->m_scheduled.store(false);
+        if (d->m_pending.load() && !d->m_scheduled.exchange(true)) {
+            d->m_timer.start();
+        }
+    });
+}
+
+/**
+ * Destructor.
+ */
+ActivityMeter::~ActivityMeter() = default;
+
+/**
+ * Counts a note on message. This function is thread safe.
+ * @param channel MIDI channel
+ * @param velocity MIDI velocity; zero means note off, and it is ignored
+ */
+void ActivityMeter::countNoteOn(int channel, int velocity)
+{
+    if (velocity <= 0) {
+        return;
+    }
+    ActivityMeterPrivate::Counters &c = d->m_counters[channel & 0x0f];
+    c.notes.fetch_add(1, std::memory_order_relaxed);
+    int peak = c.peak.load(std::memory_order_relaxed);
+    while (velocity > peak && !c.peak.compare_exchange_weak(peak, velocity, std::memory_order_relaxed)) { }
+    d->m_totalNotes.fetch_add(1, std::memory_order_relaxed);
+    d->notify();
+}
+
+/**
+ * Counts a controller, program, pitch bend or pressure message. This
+ * function is thread safe.
+ * @param channel MIDI channel
+ */
+void ActivityMeter::countController(int channel)
+{
+    d->m_counters[channel & 0x0f].controllers.fetch_add(1, std::memory_order_relaxed);
+    d->m_totalControllers.fetch_add(1, std::memory_order_relaxed);
+    d->notify();
+}
+
+/**
+ * Counts a raw MIDI channel message. System messages are ignored. This
+ * function is thread safe.
+ * @param status MIDI status byte
+ * @param data1 First MIDI data byte
+ * @param data2 Second MIDI data byte
+ */
+void ActivityMeter::countMessage(int status, int data1, int data2)
+{
+    Q_UNUSED(data1)
+    const int channel = status & 0x0f;
+    switch (status & 0xf0) {
+    case MIDI_STATUS_NOTEON:
+        countNoteOn(channel, data2);
+        break;
+    case MIDI_STATUS_KEYPRESURE:
+    case MIDI_STATUS_CONTROLCHANGE:
+    case MIDI_STATUS_PROGRAMCHANGE:
+    case MIDI_STATUS_CHANNELPRESSURE:
+    case MIDI_STATUS_PITCHBEND:
+        countController(channel);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Counts the channel messages received by a MIDI input, with direct
+ * connections from the input thread.
+ * @param input MIDI input backend
+ */
+void ActivityMeter::attachInput(MIDIInput *input)
+{
+    if (input == nullptr) {
+        return;
+    }
+    connect(input, &MIDIInput::midiNoteOn, this, [this](int chan, int, int vel) {
+        countNoteOn(chan, vel);
+    }, Qt::DirectConnection);
+    connect(input, &MIDIInput::midiKeyPressure, this, [this](int chan, int, int) {
+        countController(chan);
+    }, Qt::DirectConnection);
+    connect(input, &MIDIInput::midiController, this, [this](int chan, int, int) {
+        countController(chan);
+    }, Qt::DirectConnection);
+    connect(input, &MIDIInput::midiProgram, this, [this](int chan, int) {
+        countController(chan);
+    }, Qt::DirectConnection);
+    connect(input, &MIDIInput::midiChannelPressure, this, [this](int chan, int) {
+        countController(chan);
+    }, Qt::DirectConnection);
+    connect(input, &MIDIInput::midiPitchBend, this, [this](int chan, int) {
+        countController(chan);
+    }, Qt::DirectConnection);
+}
+
+/**
+ * Stops counting the messages of a MIDI input.
+ * @param input MIDI input backend
+ */
+void ActivityMeter::detachInput(MIDIInput *input)
+{
+    if (input != nullptr) {
+        input->disconnect(this);
+    }
+}
+
+/**
+ * Returns the maximum number of frames per second.
+ * @return the frame rate
+ */
+int ActivityMeter::frameRate() const
+{
+    return d->m_frameRate;
+}
+
+/**
+ * Assigns the maximum number of frames per second.
+ * @param fps The frame rate, between 1 and 120
+ */
+void ActivityMeter::setFrameRate(int fps)
+{
+    d->m_frameRate = qBound(1, fps, 120);
+    d->m_timer.setInterval(1000 / d->m_frameRate);
+}
+
+/**
+ * Returns the time constant of the level decay.
+ * @return the decay time in milliseconds
+ */
+int ActivityMeter::decayTime() const
+{
+    return d->m_decayTime;
+}
+
+/**
+ * Assigns the time constant of the level decay.
+ * @param msecs The decay time in milliseconds
+ */
+void ActivityMeter::setDecayTime(int msecs)
+{
+    d->m_decayTime = qMax(1, msecs);
+}
+
+/**
+ * Returns the number of note on messages counted since the last reset.
+ * @return the number of notes
+ */
+quint64 ActivityMeter::totalNotes() const
+{
+    return d->m_totalNotes.load(std::memory_order_relaxed);
+}
+
+/**
+ * Returns the number of controller messages counted since the last reset.
+ * @return the number of controller messages
+ */
+quint64 ActivityMeter::totalControllers() const
+{
+    return d->m_totalControllers.load(std::memory_order_relaxed);
+}
+
+/**
+ * Clears the counters and the levels.
+ */
+void ActivityMeter::reset()
+{
+    for (auto &c : d->m_counters) {
+        c.notes.store(0, std::memory_order_relaxed);
+        c.controllers.store(0, std::memory_order_relaxed);
+        c.peak.store(0, std::memory_order_relaxed);
+    }
+    for (auto &l : d->m_levels) {
+        l = ActivityMeterPrivate::Levels();
+    }
+    d->m_totalNotes.store(0, std::memory_order_relaxed);
+    d->m_totalControllers.store(0, std::memory_order_relaxed);
+    d->m_active = false;
+    update();
+}
+
+/**
+ * Returns the recommended size of the widget.
+ * @return the recommended size
+ */
+QSize ActivityMeter::sizeHint() const
+{
+    return QSize(CHANNELS * 16, 80);
+}
+
+/**
+ * Returns the minimum recommended size of the widget.
+ * @return the minimum recommended size
+ */
+QSize ActivityMeter::minimumSizeHint() const
+{
+    return QSize(CHANNELS * 6, 32);
+}
+
+/**
+ * Starts the frame timer, stopped while the widget is hidden.
+ * @param event The show event
+ */
+void ActivityMeter::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    d->m_scheduled.store(true);
+    d->m_timer.start();
+}
+
+/**
+ * Paints one column for each MIDI channel: the note density bar in the
+ * channel color, the controller activity bar, and the peak velocity line.
+ * @param event The paint event
+ */
+void ActivityMeter::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    d->computeLevels();
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().color(QPalette::Base));
+    const QFontMetrics fm(font());
+    const int labels = fm.height();
+    const double width = double(rect().width()) / CHANNELS;
+    const double height = qMax(1, rect().height() - labels);
+    const QColor controllerColor = palette().color(QPalette::Highlight);
+    const QPen peakPen(palette().color(QPalette::Text), 2);
+    for (int i = 0; i < CHANNELS; ++i) {
+        const ActivityMeterPrivate::Levels &l = d->m_levels[i];
+        const double x = i * width;
+        const double bar = width / 3;
+        if (l.notes > 0) {
+            painter.fillRect(QRectF(x + 1, height * (1 - l.notes), bar * 2 - 1, height * l.notes),
+                             d->m_palette.getColor(i));
+        }
+        if (l.controllers > 0) {
+            painter.fillRect(QRectF(x + bar * 2, height * (1 - l.controllers), bar - 1, height * l.controllers),
+                             controllerColor);
+        }
+        if (l.peak > 0) {
+            const double y = height * (1 - l.peak);
+            painter.setPen(peakPen);
+            painter.drawLine(QPointF(x + 1, y), QPointF(x + width - 1, y));
+        }
+        painter.setPen(palette().color(QPalette::Text));
+        painter.drawText(QRectF(x, height, width, labels), Qt::AlignCenter, QString::number(i + 1));
+    }
+}
+
+}} // namespace drumstick::widgets
@@ -22,6 +22,7 @@
 #include <QMessageBox>
 #include <QPushButton>
 #include <QStandardPaths>
+#include <QThread>
 #include <QToolButton>
 #include <QToolTip>
 #include <QVersionNumber>
@@ -51,6 +52,7 @@ const QString FluidSettingsDialog::QSTR_REVERB = QStringLiteral("Reverb");
 const QString FluidSettingsDialog::QSTR_GAIN = QStringLiteral("Gain");
 const QString FluidSettingsDialog::QSTR_POLYPHONY = QStringLiteral("Polyphony");
 const QString FluidSettingsDialog::QSTR_BUFFERTIME = QStringLiteral("BufferTime");
+const QString FluidSettingsDialog::QSTR_CPUCORES = QStringLiteral("CpuCores");
 const QString FluidSettingsDialog::QSTR_PULSEAUDIO = QStringLiteral("pulseaudio");
 const QString FluidSettingsDialog::QSTR_CHORUS_DEPTH = QStringLiteral("chorus_depth");
 const QString FluidSettingsDialog::QSTR_CHORUS_LEVEL = QStringLiteral("chorus_level");
@@ -124,6 +126,9 @@ FluidSettingsDialog::FluidSettingsDialog(QWidget *parent) :
     ui->bufferTime->blockSignals(true);
     ui->periodSize->blockSignals(true);
     ui->periods->blockSignals(true);
+    ui->cpuCores->setMaximum(qMax(1, QThread::idealThreadCount()));
+    m_performanceTimer.setInterval(500);
+    connect(&m_performanceTimer, &QTimer::timeout, this, &FluidSettingsDialog::updatePerformance);
 }
 
 FluidSettingsDialog::~FluidSettingsDialog()
@@ -170,9 +175,37 @@ void FluidSettingsDialog::accept()
 void FluidSettingsDialog::showEvent(QShowEvent *event)
 {
     readSettings();
+    m_performanceTimer.start();
     event->accept();
 }
 
+void FluidSettingsDialog::hideEvent(QHideEvent *event)
+{
+    m_performanceTimer.stop();
+    event->accept();
+}
+
+/**
+ * Shows the rendering load, active voices, voice steals and xruns reported
+ * by the FluidSynth backend, while the dialog is visible.
+ */
+void FluidSettingsDialog::updatePerformance()
+{
+    if (m_driver != nullptr) {
+        QVariant load = m_driver->property("loadFactor");
+        QVariant voices = m_driver->property("activeVoices");
+        QVariant steals = m_driver->property("voiceSteals");
+        QVariant xruns = m_driver->property("xruns");
+        if (load.isValid() && voices.isValid() && steals.isValid() && xruns.isValid()) {
+            ui->lblPerformance->setText(tr("Load: %1% Voices: %2 Steals: %3 Xruns: %4")
+                                        .arg(load.toDouble() * 100.0, 0, 'f', 1)
+                                        .arg(voices.toInt())
+                                        .arg(steals.toULongLong())
+                                        .arg(xruns.toULongLong()));
+        }
+    }
+}
+
 QString FluidSettingsDialog::defaultAudioDriver() const
 {
     const QString QSTR_DEFAULT_AUDIODRIVER =
@@ -267,6 +300,7 @@ void FluidSettingsDialog::readSettings()
     ui->sampleRate->setCurrentText(settings->value(QSTR_SAMPLERATE, DEFAULT_SAMPLERATE).toString());
     ui->gain->setValue(settings->value(QSTR_GAIN, DEFAULT_GAIN).toDouble());
     ui->polyphony->setValue(settings->value(QSTR_POLYPHONY, DEFAULT_POLYPHONY).toInt());
+    ui->cpuCores->setValue(settings->value(QSTR_CPUCORES, DEFAULT_CPUCORES).toInt());
     ui->soundFont->setText( settings->value(QSTR_INSTRUMENTSDEFINITION, m_defSoundFont).toString() );
 
     ui->chorus_depth->setValue(settings->value(QSTR_CHORUS_DEPTH, DEFAULT_CHORUS_DEPTH).toDouble()
@@ -308,6 +342,7 @@ void FluidSettingsDialog::writeSettings()
     int     reverb(DEFAULT_REVERB);
     double  gain(DEFAULT_GAIN);
     int     polyphony(DEFAULT_POLYPHONY);
+    int     cpuCores(DEFAULT_CPUCORES);
 
     double chorus_depth(DEFAULT_CHORUS_DEPTH);
     double chorus_level(DEFAULT_CHORUS_LEVEL);
@@ -332,6 +367,7 @@ void FluidSettingsDialog::writeSettings()
     reverb = (ui->reverb->isChecked() ? 1 : 0);
     gain = ui->gain->value();
     polyphony = ui->polyphony->value();
+    cpuCores = ui->cpuCores->value();
 
     chorus_depth = ui->chorus_depth->value() / CHORUS_REVERB_VALUE_SCALE;
     chorus_level = ui->chorus_level->value() / CHORUS_REVERB_VALUE_SCALE;
@@ -353,6 +389,7 @@ void FluidSettingsDialog::writeSettings()
     settings->setValue(QSTR_REVERB, reverb);
     settings->setValue(QSTR_GAIN, gain);
     settings->setValue(QSTR_POLYPHONY, polyphony);
+    settings->setValue(QSTR_CPUCORES, cpuCores);
     settings->setValue(QSTR_CHORUS_DEPTH, chorus_depth);
     settings->setValue(QSTR_CHORUS_LEVEL, chorus_level);
     settings->setValue(QSTR_CHORUS_NR, chorus_nr);
@@ -376,6 +413,7 @@ void FluidSettingsDialog::restoreDefaults()
     ui->sampleRate->setCurrentText(QString::number(DEFAULT_SAMPLERATE));
     ui->gain->setValue(DEFAULT_GAIN);
     ui->polyphony->setValue(DEFAULT_POLYPHONY);
+    ui->cpuCores->setValue(DEFAULT_CPUCORES);
     ui->soundFont->setText(m_defSoundFont);
     ui->chorus_depth->setValue(DEFAULT_CHORUS_DEPTH * CHORUS_REVERB_VALUE_SCALE);
     ui->chorus_level->setValue(DEFAULT_CHORUS_LEVEL * CHORUS_REVERB_VALUE_SCALE);
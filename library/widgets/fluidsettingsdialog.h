@@ -20,8 +20,10 @@
 #define FLUIDSETTINGSDIALOG_H
 
 #include <QDialog>
+#include <QHideEvent>
 #include <QShowEvent>
 #include <QSettings>
+#include <QTimer>
 
 /**
  * @file fluidsettingsdialog.h
@@ -56,11 +58,13 @@ public:
 public Q_SLOTS:
     void accept() override;
     void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
     void restoreDefaults();
     void showFileDialog();
     void audioDriverChanged(const QString &text);
     void bufferTimeChanged(int value);
     void bufferSizeChanged();
+    void updatePerformance();
 
 public:
     static const QString QSTR_PREFERENCES;
@@ -76,6 +80,7 @@ public:
     static const QString QSTR_GAIN;
     static const QString QSTR_POLYPHONY;
     static const QString QSTR_BUFFERTIME;
+    static const QString QSTR_CPUCORES;
 
     static const QString QSTR_CHORUS_DEPTH;
     static const QString QSTR_CHORUS_LEVEL;
@@ -94,6 +99,7 @@ public:
     static const int DEFAULT_REVERB = 1;
     static constexpr double DEFAULT_GAIN = 1.0;
     static const int DEFAULT_POLYPHONY = 256;
+    static const int DEFAULT_CPUCORES = 1;
     static const QString QSTR_PULSEAUDIO;
 
     static constexpr qreal DEFAULT_CHORUS_DEPTH = 4.25;
@@ -118,6 +124,7 @@ private:
     Ui::FluidSettingsDialog *ui;
     drumstick::rt::MIDIOutput *m_driver;
     QString m_defSoundFont;
+    QTimer m_performanceTimer;
 };
 
 }} // namespace drumstick::widgets
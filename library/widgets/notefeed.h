@@ -0,0 +1,147 @@
+/*
+    Virtual Piano Widget for Qt
+    Copyright (C) 2008-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef NOTEFEED_H_
+#define NOTEFEED_H_
+
+#include <QColor>
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * @file notefeed.h
+ * Declaration of the NoteFeed class
+ */
+
+namespace drumstick { namespace widgets {
+
+    /*
+     * Lock-free store of the last state of each MIDI note, written from any
+     * thread and consumed by the GUI thread once per display frame. Each
+     * state packs the on flag, the velocity and an optional highlight color.
+     * A frame is scheduled only when a note is posted, and the framed
+     * consumer stops after a frame without changes.
+     */
+    class NoteFeed
+    {
+    public:
+        static constexpr quint64 STATE_ON = Q_UINT64_C(1) << 40;
+        static constexpr quint64 STATE_COLOR = Q_UINT64_C(1) << 41;
+
+        NoteFeed()
+        {
+            clear();
+        }
+
+        static quint64 noteState(const bool on, const int vel, const QColor &color = QColor())
+        {
+            quint64 state = quint64(qBound(-1, vel, 127) + 1) << 32;
+            if (on) {
+                state |= STATE_ON;
+            }
+            if (color.isValid()) {
+                state |= STATE_COLOR | color.rgba();
+            }
+            return state;
+        }
+
+        static int velocity(const quint64 state)
+        {
+            return int((state >> 32) & 0xff) - 1;
+        }
+
+        /*
+         * Stores the state of a note and marks it as changed. Returns true
+         * when the caller must schedule a frame, because none is pending.
+         * The dirty mask and the scheduled flag are sequentially consistent,
+         * pairing with stopFrames().
+         */
+        bool post(const int note, const quint64 state)
+        {
+            if ((note < 0) || (note > 127)) {
+                return false;
+            }
+            m_state[note].store(state, std::memory_order_release);
+            m_dirty[note >> 6].fetch_or(Q_UINT64_C(1) << (note & 63));
+            return !m_scheduled.load() && !m_scheduled.exchange(true);
+        }
+
+        void clear()
+        {
+            for (auto &dirty : m_dirty) {
+                dirty.store(0, std::memory_order_relaxed);
+            }
+            for (auto &state : m_state) {
+                state.store(0, std::memory_order_relaxed);
+            }
+            m_scheduled.store(false, std::memory_order_relaxed);
+        }
+
+        void setFramed(const bool framed)
+        {
+            m_framed.store(framed, std::memory_order_relaxed);
+        }
+
+        /*
+         * Called by the frame timer after a frame without changes. Returns
+         * true when the timer may stop, because the next post() schedules a
+         * new frame, or false when a note was posted meanwhile.
+         */
+        bool stopFrames()
+        {
+            m_scheduled.store(false);
+            if ((m_dirty[0].load() | m_dirty[1].load()) == 0) {
+                return true;
+            }
+            return m_scheduled.exchange(true);
+        }
+
+        /*
+         * Calls f(note, state) for each note changed since the last call, and
+         * returns the number of notes. Without frames, every call ends the
+         * scheduled one; the framed consumer uses stopFrames() instead.
+         */
+        template<typename F> int consume(F f)
+        {
+            int count = 0;
+            if (!m_framed.load(std::memory_order_relaxed)) {
+                m_scheduled.store(false);
+            }
+            for (int w = 0; w < 2; ++w) {
+                quint64 bits = m_dirty[w].exchange(0);
+                while (bits != 0) {
+                    int note = w * 64 + qCountTrailingZeroBits(bits);
+                    bits &= bits - 1;
+                    f(note, m_state[note].load(std::memory_order_acquire));
+                    ++count;
+                }
+            }
+            return count;
+        }
+
+    private:
+        std::atomic<quint64> m_state[128];
+        std::atomic<quint64> m_dirty[2];
+        std::atomic<bool> m_scheduled{false};
+        std::atomic<bool> m_framed{false};
+    };
+
+}} // namespace drumstick::widgets
+
+#endif /*NOTEFEED_H_*/
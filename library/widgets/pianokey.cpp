@@ -17,8 +17,11 @@
 */
 
 #include <QApplication>
+#include <QHash>
 #include <QPainter>
 #include <QPalette>
+#include <QPixmapCache>
+#include <QtMath>
 #include <drumstick/pianopalette.h>
 
 #include "pianokey.h"
@@ -44,24 +47,61 @@ PianoKey::PianoKey(const QRectF &rect, const bool black, const int note)
     setFlag(QGraphicsItem::ItemClipsChildrenToShape);
 }
 
+/**
+ * Paints the key with a single blit of a pre-rendered image, taken from the
+ * global QPixmapCache. The images are keyed by the key type, the fill color,
+ * the key picture and the size in device pixels, which accounts for the view
+ * scale and the device pixel ratio. Non solid brushes are painted directly.
+ */
 void PianoKey::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
 {
-    static const QPen blackPen(Qt::black, 1);
-    painter->setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+    QBrush brush = m_brush;
     if (m_pressed) {
         if (m_selectedBrush.style() != Qt::NoBrush) {
-            painter->setBrush(m_selectedBrush);
+            brush = m_selectedBrush;
         } else {
-            painter->setBrush(QApplication::palette().highlight());
+            brush = QApplication::palette().highlight();
         }
-    } else {
-        painter->setBrush(m_brush);
     }
+    const QPixmap keyPixmap = m_usePixmap ? getPixmap() : QPixmap();
+    const QTransform &t = painter->worldTransform();
+    const qreal dpr = painter->device()->devicePixelRatioF();
+    const QSize size(qCeil(rect().width() * qSqrt(t.m11() * t.m11() + t.m12() * t.m12()) * dpr),
+                     qCeil(rect().height() * qSqrt(t.m21() * t.m21() + t.m22() * t.m22()) * dpr));
+    painter->setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+    if (brush.style() != Qt::SolidPattern || size.isEmpty() || size.width() > 4096 || size.height() > 4096) {
+        paintKey(painter, brush, keyPixmap);
+        return;
+    }
+    const QString cacheKey = QStringLiteral("drumstick-key-%1-%2-%3x%4-%5")
+            .arg(getType())
+            .arg(brush.color().rgba(), 8, 16, QLatin1Char('0'))
+            .arg(size.width())
+            .arg(size.height())
+            .arg(keyPixmap.cacheKey());
+    QPixmap image;
+    if (!QPixmapCache::find(cacheKey, &image)) {
+        image = QPixmap(size);
+        image.fill(Qt::transparent);
+        QPainter p(&image);
+        p.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+        p.scale(size.width() / rect().width(), size.height() / rect().height());
+        p.translate(-rect().topLeft());
+        paintKey(&p, brush, keyPixmap);
+        p.end();
+        QPixmapCache::insert(cacheKey, image);
+    }
+    painter->drawPixmap(rect(), image, image.rect());
+}
+
+void PianoKey::paintKey(QPainter *painter, const QBrush &brush, const QPixmap &pixmap) const
+{
+    static const QPen blackPen(Qt::black, 1);
+    painter->setBrush(brush);
     painter->setPen(blackPen);
     painter->drawRoundedRect(rect(), 20, 15, Qt::RelativeSize);
-    if (m_usePixmap) {
-        QPixmap p = getPixmap();
-        painter->drawPixmap(rect(), p, p.rect());
+    if (!pixmap.isNull()) {
+        painter->drawPixmap(rect(), pixmap, pixmap.rect());
     }
 }
 
@@ -73,20 +113,26 @@ void PianoKey::setPressed(bool p)
     }
 }
 
-const QPixmap& PianoKey::getPixmap() const
+QPixmap PianoKey::getPixmap() const
 {
-    static QPixmap blpixmap(QStringLiteral(":/vpiano/blkey.png"));
-    static QPixmap whpixmap(QStringLiteral(":/vpiano/whkey.png"));
-    static QColor bgColor;
-    if (!m_black && (bgColor != m_brush.color())) {
-        bgColor = m_brush.color();
-        paintPixmap(whpixmap, QColor::fromRgba(bgColor.rgba()^0xffffff));
-    }
-    if (m_pixmap.isNull()) {
-        return m_black ? blpixmap : whpixmap;
-    } else {
+    static const QPixmap blpixmap(QStringLiteral(":/vpiano/blkey.png"));
+    static const QPixmap whpixmap(QStringLiteral(":/vpiano/whkey.png"));
+    // white key pictures tinted with the inverse of each background color
+    static QHash<QRgb, QPixmap> whpixmaps;
+    if (!m_pixmap.isNull()) {
         return m_pixmap;
     }
+    if (m_black) {
+        return blpixmap;
+    }
+    const QRgb bgColor = m_brush.color().rgba();
+    auto it = whpixmaps.constFind(bgColor);
+    if (it == whpixmaps.constEnd()) {
+        QPixmap pixmap = whpixmap.copy();
+        paintPixmap(pixmap, QColor::fromRgba(bgColor^0xffffff));
+        it = whpixmaps.insert(bgColor, pixmap);
+    }
+    return it.value();
 }
 
 QRectF PianoKey::pixmapRect() const
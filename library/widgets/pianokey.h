@@ -51,7 +51,7 @@ namespace drumstick { namespace widgets {
         int getDegree() const { return m_note % 12; }
         int getType() const { return (m_black ? 1 : 0); }
         bool isBlack() const { return m_black; }
-        const QPixmap& getPixmap() const;
+        QPixmap getPixmap() const;
         void setPixmap(const QPixmap& p);
         QRectF pixmapRect() const;
         bool getUsePixmap() const;
@@ -61,6 +61,8 @@ namespace drumstick { namespace widgets {
         static const PianoPalette keyPalette;
 
     private:
+        void paintKey(QPainter *painter, const QBrush &brush, const QPixmap &pixmap) const;
+
         bool m_pressed;
         QBrush m_selectedBrush;
         QBrush m_brush;
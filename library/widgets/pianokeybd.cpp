@@ -213,6 +213,7 @@ public:
     int m_rotation;
     PianoScene *m_scene;
     KeyboardMap *m_rawMap;
+    NoteFeed m_feed;
 };
 
 /**
@@ -416,6 +417,7 @@ void PianoKeybd::initScene(int base, int num, int strt, const QColor& c)
 {
     d->m_scene = new PianoScene(base, num, strt, c, this);
     d->m_scene->setKeyboardMap(&g_DefaultKeyMap);
+    d->m_scene->setNoteFeed(&d->m_feed);
     connect(d->m_scene, &PianoScene::noteOn, this, &PianoKeybd::noteOn);
     connect(d->m_scene, &PianoScene::noteOff, this, &PianoKeybd::noteOff);
     connect(d->m_scene, &PianoScene::signalName, this, &PianoKeybd::signalName);
@@ -658,6 +660,33 @@ bool PianoKeybd::octaveSubscript() const
     return d->m_scene->octaveSubscript();
 }
 
+/**
+ * @brief Enables or disables the batched display of notes
+ *
+ * With a dense stream of notes, displaying each one immediately may saturate
+ * the GUI thread. In batched mode, showNoteOn() and showNoteOff() only store
+ * the state of each note, and the changed keys are displayed once per screen
+ * refresh, emitting a single signalName() per frame.
+ * @see isBatchedDisplay()
+ * @param enable or disable the batched display of notes
+ * @since 2.11
+ */
+void PianoKeybd::setBatchedDisplay(const bool enable)
+{
+    d->m_scene->setBatchedDisplay( enable );
+}
+
+/**
+ * @brief Returns whether the batched display of notes is enabled
+ * @see setBatchedDisplay()
+ * @return true if the batched display of notes is enabled
+ * @since 2.11
+ */
+bool PianoKeybd::isBatchedDisplay() const
+{
+    return d->m_scene->isBatchedDisplay();
+}
+
 /** 
  * @brief Sets the initial/starting note key
  * 
@@ -1071,6 +1100,50 @@ void PianoKeybd::showNoteOff(const int note, int vel)
     d->m_scene->showNoteOff(note, vel);
 }
 
+/**
+ * Highlights one note key with the specified velocity, from any thread.
+ *
+ * This method never blocks, and may be called from a MIDI input thread.
+ * The last state of each note is displayed on the next frame in batched
+ * mode, or by a single queued call to flushPendingNotes() otherwise, so the
+ * GUI cost does not depend on the rate of incoming notes.
+ * @see setBatchedDisplay(), postNoteOff()
+ * @param note The MIDI note number
+ * @param vel The MIDI note velocity
+ * @since 2.11
+ */
+void PianoKeybd::postNoteOn(const int note, int vel)
+{
+    if (d->m_feed.post(note, NoteFeed::noteState(true, vel))) {
+        QMetaObject::invokeMethod(this, "flushPendingNotes", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * Shows inactive one note key with the specified velocity, from any thread.
+ * @see postNoteOn()
+ * @param note The MIDI note number
+ * @param vel The MIDI note velocity
+ * @since 2.11
+ */
+void PianoKeybd::postNoteOff(const int note, int vel)
+{
+    if (d->m_feed.post(note, NoteFeed::noteState(false, vel))) {
+        QMetaObject::invokeMethod(this, "flushPendingNotes", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * Displays the notes posted since the last update, at once, or on the next
+ * frame in batched mode. It is called automatically by the first note posted
+ * after an idle period.
+ * @since 2.11
+ */
+void PianoKeybd::flushPendingNotes()
+{
+    d->m_scene->scheduleFrame();
+}
+
 /**
  * Assigns a typographic font for drawing the note labels over the piano keys.
  * @param font typographic font for drawing the note labels
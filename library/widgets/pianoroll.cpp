@@ -0,0 +1,567 @@
+/*
+    MIDI Virtual Piano Keyboard
+    Copyright (C) 2008-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCache>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPixmap>
+#include <QScrollBar>
+#include <QWheelEvent>
+#include <QtMath>
+#include <algorithm>
+#include <drumstick/pianoroll.h>
+
+/**
+ * @file pianoroll.cpp
+ * Implementation of the Piano Roll widget
+ */
+
+namespace drumstick { namespace widgets {
+
+const int PianoRoll::MIN_ZOOM_LEVEL = -24;
+const int PianoRoll::MAX_ZOOM_LEVEL = 16;
+
+static const int TILE_WIDTH = 256;
+static const int TILE_HEIGHT = 256;
+static const int TILE_CACHE_KB = 64 * 1024;
+static const int QUARTER_WIDTH = 32; // pixels per quarter note at zoom level 0
+static const int NOTES_PER_ROLL = 128;
+static const int MAX_ROW_HEIGHT = 64;
+
+class PianoRoll::PianoRollPrivate
+{
+public:
+    PianoRollPrivate():
+        m_division(120),
+        m_zoomLevel(0),
+        m_rowHeight(6),
+        m_follow(true),
+        m_sorted(true),
+        m_position(0),
+        m_palette(PAL_CHANNELS),
+        m_tileRatio(0.0),
+        m_tiles(TILE_CACHE_KB)
+    { }
+
+    quint64 noteEnd(const PianoRollNote &n) const
+    {
+        // zero length notes are displayed one tick long
+        return n.tick + qMax<quint64>(n.length, 1);
+    }
+
+    double pixelsPerTick() const
+    {
+        return QUARTER_WIDTH * qPow(2.0, m_zoomLevel / 4.0) / m_division;
+    }
+
+    void buildIndex()
+    {
+        if (!m_sorted) {
+            std::stable_sort(m_notes.begin(), m_notes.end(),
+                [](const PianoRollNote &a, const PianoRollNote &b) {
+                    return a.tick < b.tick;
+                });
+            m_sorted = true;
+        }
+        m_maxEnd.resize(m_notes.size());
+        quint64 maxEnd = 0;
+        for (int i = 0; i < m_notes.size(); ++i) {
+            maxEnd = qMax(maxEnd, noteEnd(m_notes[i]));
+            m_maxEnd[i] = maxEnd;
+        }
+        m_tiles.clear();
+    }
+
+    void notesInRange(quint64 from, quint64 to, QVector<int> &result) const
+    {
+        result.clear();
+        if (m_maxEnd.size() != m_notes.size()) {
+            return;
+        }
+        // the running maximum of the end times is sorted, as the start times
+        auto first = std::upper_bound(m_maxEnd.constBegin(), m_maxEnd.constEnd(), from);
+        auto last = std::lower_bound(m_notes.constBegin(), m_notes.constEnd(), to,
+            [](const PianoRollNote &n, quint64 t) {
+                return n.tick < t;
+            });
+        for (int i = int(first - m_maxEnd.constBegin()); i < int(last - m_notes.constBegin()); ++i) {
+            if (noteEnd(m_notes[i]) > from) {
+                result.append(i);
+            }
+        }
+    }
+
+    int rollHeight() const
+    {
+        return NOTES_PER_ROLL * m_rowHeight;
+    }
+
+    QPixmap *tile(int column, int row, const QPalette &palette)
+    {
+        const qint64 key = (qint64(m_zoomLevel - MIN_ZOOM_LEVEL) << 48) | (qint64(row) << 32) | column;
+        QPixmap *pixmap = m_tiles.object(key);
+        if (pixmap == nullptr) {
+            const QPixmap rendered = renderTile(column, row, palette);
+            const int cost = qCeil(rendered.width() * rendered.height() * 4 / 1024.0);
+            pixmap = new QPixmap(rendered);
+            if (!m_tiles.insert(key, pixmap, cost)) {
+                // deleted by the cache: drawn once from a pixmap that is not cached
+                m_uncached = rendered;
+                pixmap = &m_uncached;
+            }
+        }
+        return pixmap;
+    }
+
+    QPixmap renderTile(int column, int row, const QPalette &palette)
+    {
+        const int height = rollHeight();
+        const int top = row * TILE_HEIGHT;
+        const double ppt = pixelsPerTick();
+        const double left = double(column) * TILE_WIDTH;
+        const quint64 from = quint64(left / ppt);
+        const quint64 to = quint64((left + TILE_WIDTH) / ppt) + 1;
+        QPixmap pixmap(QSize(TILE_WIDTH, qMin(TILE_HEIGHT, height - top)) * m_tileRatio);
+        pixmap.setDevicePixelRatio(m_tileRatio);
+        pixmap.fill(palette.color(QPalette::Base));
+        QPainter painter(&pixmap);
+        painter.translate(0, -top);
+        for (int n = 0; n < NOTES_PER_ROLL; ++n) {
+            switch (n % 12) {
+            case 1: case 3: case 6: case 8: case 10:
+                painter.fillRect(0, (NOTES_PER_ROLL - 1 - n) * m_rowHeight, TILE_WIDTH, m_rowHeight,
+                                 palette.color(QPalette::AlternateBase));
+                break;
+            default:
+                break;
+            }
+        }
+        if (m_division * ppt >= 4.0) {
+            const QPen beatPen(palette.color(QPalette::Midlight), 0);
+            const QPen barPen(palette.color(QPalette::Mid), 0);
+            for (quint64 t = (from + m_division - 1) / m_division * m_division; t < to; t += m_division) {
+                const double x = t * ppt - left;
+                painter.setPen((t % (4 * m_division)) == 0 ? barPen : beatPen);
+                painter.drawLine(QPointF(x, 0), QPointF(x, height));
+            }
+        }
+        QVector<int> notes;
+        notesInRange(from, to, notes);
+        for (int i : std::as_const(notes)) {
+            const PianoRollNote &n = m_notes[i];
+            QColor color = m_palette.getColor(n.channel % m_palette.getNumColors());
+            color.setAlpha(96 + n.velocity);
+            const QRectF rect(n.tick * ppt - left, (NOTES_PER_ROLL - 1 - n.note) * m_rowHeight,
+                              qMax(1.0, n.length * ppt), m_rowHeight - 1);
+            painter.fillRect(rect, color);
+        }
+        painter.end();
+        return pixmap;
+    }
+
+    int m_division;
+    int m_zoomLevel;
+    int m_rowHeight;
+    bool m_follow;
+    bool m_sorted;
+    quint64 m_position;
+    PianoPalette m_palette;
+    qreal m_tileRatio;
+    QVector<PianoRollNote> m_notes;
+    QVector<quint64> m_maxEnd;
+    QCache<qint64, QPixmap> m_tiles;
+    QPixmap m_uncached;
+};
+
+/**
+ * Constructor.
+ * @param parent Widget's parent
+ */
+PianoRoll::PianoRoll(QWidget *parent)
+    : QAbstractScrollArea(parent), d(new PianoRollPrivate)
+{
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    viewport()->setAttribute(Qt::WA_OpaquePaintEvent);
+    horizontalScrollBar()->setSingleStep(TILE_WIDTH / 8);
+    verticalScrollBar()->setSingleStep(d->m_rowHeight);
+    setZoomLevel(0);
+}
+
+/**
+ * Destructor.
+ */
+PianoRoll::~PianoRoll() = default;
+
+/**
+ * Removes all the notes.
+ */
+void PianoRoll::clear()
+{
+    d->m_notes.clear();
+    d->m_sorted = true;
+    d->m_position = 0;
+    finalize();
+}
+
+/**
+ * Appends a note. Call finalize() after the last one.
+ * @param tick Start time in ticks
+ * @param length Duration in ticks
+ * @param note MIDI note number
+ * @param velocity MIDI velocity
+ * @param channel MIDI channel
+ * @param track Track number
+ */
+void PianoRoll::addNote(quint64 tick, quint64 length, int note, int velocity, int channel, int track)
+{
+    if (!d->m_notes.isEmpty() && tick < d->m_notes.constLast().tick) {
+        d->m_sorted = false;
+    }
+    d->m_notes.append(PianoRollNote{tick, length, quint16(track),
+                                    quint8(channel & 0x0f), quint8(note & 0x7f), quint8(velocity & 0x7f)});
+}
+
+/**
+ * Replaces all the notes, and builds the index.
+ * @param notes The new notes, in any order
+ */
+void PianoRoll::setNotes(const QVector<PianoRollNote> &notes)
+{
+    d->m_notes = notes;
+    d->m_sorted = false;
+    finalize();
+}
+
+/**
+ * Sorts the notes by time, builds the index of the time ranges and updates
+ * the display. It must be called after adding notes.
+ */
+void PianoRoll::finalize()
+{
+    d->buildIndex();
+    setZoomLevel(d->m_zoomLevel);
+}
+
+/**
+ * Returns the number of notes.
+ * @return the number of notes
+ */
+int PianoRoll::count() const
+{
+    return d->m_notes.size();
+}
+
+/**
+ * Returns a note, sorted by time after finalize().
+ * @param index The note index
+ * @return the note at this index
+ */
+const PianoRollNote &PianoRoll::noteAt(int index) const
+{
+    return d->m_notes.at(index);
+}
+
+/**
+ * Collects the indexes of the notes sounding in a time range, in
+ * O(log n + k) time for songs without very long notes.
+ * @param from The start of the range in ticks
+ * @param to The end of the range in ticks, not included
+ * @param result The indexes of the notes overlapping the range
+ */
+void PianoRoll::notesInRange(quint64 from, quint64 to, QVector<int> &result) const
+{
+    d->notesInRange(from, to, result);
+}
+
+/**
+ * Returns the end time of the last note.
+ * @return the song length in ticks
+ */
+quint64 PianoRoll::length() const
+{
+    return d->m_maxEnd.isEmpty() ? 0 : d->m_maxEnd.constLast();
+}
+
+/**
+ * Returns the resolution, in ticks per quarter note.
+ * @return the resolution
+ */
+int PianoRoll::division() const
+{
+    return d->m_division;
+}
+
+/**
+ * Assigns the resolution, in ticks per quarter note, used for the zoom
+ * levels and the beat lines.
+ * @param division The resolution
+ */
+void PianoRoll::setDivision(int division)
+{
+    if (division > 0 && division != d->m_division) {
+        d->m_division = division;
+        d->m_tiles.clear();
+        setZoomLevel(d->m_zoomLevel);
+    }
+}
+
+/**
+ * Returns the zoom level.
+ * @return the zoom level
+ */
+int PianoRoll::zoomLevel() const
+{
+    return d->m_zoomLevel;
+}
+
+/**
+ * Assigns the zoom level. Each level scales the time axis by the fourth
+ * root of two; at level zero, a quarter note is 32 pixels wide. The view
+ * keeps the time shown at the left side.
+ * @param level The zoom level, between MIN_ZOOM_LEVEL and MAX_ZOOM_LEVEL
+ */
+void PianoRoll::setZoomLevel(int level)
+{
+    const double leftTick = horizontalScrollBar()->value() / d->pixelsPerTick();
+    d->m_zoomLevel = qBound(MIN_ZOOM_LEVEL, level, MAX_ZOOM_LEVEL);
+    const double ppt = d->pixelsPerTick();
+    const int width = qCeil(length() * ppt);
+    const int height = NOTES_PER_ROLL * d->m_rowHeight;
+    horizontalScrollBar()->setRange(0, qMax(0, width - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    verticalScrollBar()->setRange(0, qMax(0, height - viewport()->height()));
+    verticalScrollBar()->setPageStep(viewport()->height());
+    horizontalScrollBar()->setValue(qRound(leftTick * ppt));
+    viewport()->update();
+}
+
+/**
+ * Returns the horizontal scale.
+ * @return the width of one tick in pixels
+ */
+double PianoRoll::pixelsPerTick() const
+{
+    return d->pixelsPerTick();
+}
+
+/**
+ * Returns the height of each note row.
+ * @return the row height in pixels
+ */
+int PianoRoll::rowHeight() const
+{
+    return d->m_rowHeight;
+}
+
+/**
+ * Assigns the height of each note row.
+ * @param height The row height in pixels, between 2 and 64
+ */
+void PianoRoll::setRowHeight(int height)
+{
+    height = qBound(2, height, MAX_ROW_HEIGHT);
+    if (height != d->m_rowHeight) {
+        d->m_rowHeight = height;
+        d->m_tiles.clear();
+        verticalScrollBar()->setSingleStep(height);
+        setZoomLevel(d->m_zoomLevel);
+    }
+}
+
+/**
+ * Returns whether the view scrolls to follow the position cursor.
+ * @return true if the view follows the position cursor
+ */
+bool PianoRoll::followPosition() const
+{
+    return d->m_follow;
+}
+
+/**
+ * Enables or disables the scrolling to follow the position cursor.
+ * @param enable true to follow the position cursor
+ */
+void PianoRoll::setFollowPosition(bool enable)
+{
+    d->m_follow = enable;
+}
+
+/**
+ * Returns the palette of note colors, one for each MIDI channel.
+ * @return the palette of note colors
+ */
+PianoPalette PianoRoll::notePalette() const
+{
+    return d->m_palette;
+}
+
+/**
+ * Assigns the palette of note colors. The channel number is used as the
+ * color index, modulo the number of colors of the palette.
+ * @param palette The palette of note colors
+ */
+void PianoRoll::setNotePalette(const PianoPalette &palette)
+{
+    if (palette.getNumColors() > 0 && palette != d->m_palette) {
+        d->m_palette = palette;
+        d->m_tiles.clear();
+        viewport()->update();
+    }
+}
+
+/**
+ * Returns the position cursor time.
+ * @return the position in ticks
+ */
+quint64 PianoRoll::position() const
+{
+    return d->m_position;
+}
+
+/**
+ * Moves the position cursor. When following the position, the view scrolls
+ * smoothly, keeping the cursor at one third of the viewport width. Only the
+ * cursor areas are repainted otherwise.
+ * @param tick The position in ticks
+ */
+void PianoRoll::setPosition(quint64 tick)
+{
+    if (tick == d->m_position) {
+        return;
+    }
+    const double ppt = d->pixelsPerTick();
+    const int oldX = qRound(d->m_position * ppt) - horizontalScrollBar()->value();
+    d->m_position = tick;
+    if (d->m_follow) {
+        const int newX = qRound(tick * ppt) - horizontalScrollBar()->value();
+        const int anchor = viewport()->width() / 3;
+        if (newX < 0 || newX > anchor) {
+            horizontalScrollBar()->setValue(qRound(tick * ppt) - anchor);
+        }
+    }
+    const int newX = qRound(tick * ppt) - horizontalScrollBar()->value();
+    viewport()->update(QRect(oldX - 2, 0, 5, viewport()->height()));
+    viewport()->update(QRect(newX - 2, 0, 5, viewport()->height()));
+}
+
+/**
+ * Increases the zoom level.
+ */
+void PianoRoll::zoomIn()
+{
+    setZoomLevel(d->m_zoomLevel + 1);
+}
+
+/**
+ * Decreases the zoom level.
+ */
+void PianoRoll::zoomOut()
+{
+    setZoomLevel(d->m_zoomLevel - 1);
+}
+
+/**
+ * Returns the recommended size of the widget.
+ * @return the recommended size
+ */
+QSize PianoRoll::sizeHint() const
+{
+    return QSize(TILE_WIDTH * 3, NOTES_PER_ROLL * d->m_rowHeight / 2);
+}
+
+/**
+ * Paints the visible area from the cached tiles, and the position cursor.
+ * @param event The paint event
+ */
+void PianoRoll::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    const QRect area = event->rect();
+    const int x0 = horizontalScrollBar()->value();
+    const int y0 = verticalScrollBar()->value();
+    const qreal ratio = devicePixelRatioF();
+    if (!qFuzzyCompare(ratio, d->m_tileRatio)) {
+        d->m_tiles.clear();
+        d->m_tileRatio = ratio;
+    }
+    painter.fillRect(area, palette().color(QPalette::Window));
+    const int first = (x0 + area.left()) / TILE_WIDTH;
+    const int last = (x0 + area.right()) / TILE_WIDTH;
+    const int top = (y0 + area.top()) / TILE_HEIGHT;
+    const int bottom = qMin(y0 + area.bottom(), d->rollHeight() - 1) / TILE_HEIGHT;
+    for (int j = top; j <= bottom; ++j) {
+        for (int i = first; i <= last; ++i) {
+            const QPixmap *tile = d->tile(i, j, palette());
+            painter.drawPixmap(i * TILE_WIDTH - x0, j * TILE_HEIGHT - y0, *tile);
+        }
+    }
+    const int x = qRound(d->m_position * d->pixelsPerTick()) - x0;
+    if (x >= area.left() - 1 && x <= area.right() + 1) {
+        painter.setPen(QPen(palette().color(QPalette::Highlight), 2));
+        painter.drawLine(x, area.top(), x, area.bottom());
+    }
+}
+
+/**
+ * Updates the scroll ranges when the widget is resized.
+ * @param event The resize event
+ */
+void PianoRoll::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    setZoomLevel(d->m_zoomLevel);
+}
+
+/**
+ * Zooms with the mouse wheel while pressing the Control key, and scrolls
+ * otherwise.
+ * @param event The wheel event
+ */
+void PianoRoll::wheelEvent(QWheelEvent *event)
+{
+    if (event->modifiers() & Qt::ControlModifier) {
+        const int delta = event->angleDelta().y();
+        if (delta > 0) {
+            zoomIn();
+        } else if (delta < 0) {
+            zoomOut();
+        }
+        event->accept();
+    } else {
+        QAbstractScrollArea::wheelEvent(event);
+    }
+}
+
+/**
+ * Emits positionRequested() with the time under the mouse when the left
+ * button is pressed.
+ * @param event The mouse event
+ */
+void PianoRoll::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        const int x = qMax(0, event->pos().x() + horizontalScrollBar()->value());
+        Q_EMIT positionRequested(quint64(x / d->pixelsPerTick()));
+        event->accept();
+    } else {
+        QAbstractScrollArea::mousePressEvent(event);
+    }
+}
+
+}} // namespace drumstick::widgets
@@ -24,6 +24,8 @@
 #include <QKeyEvent>
 #include <QPalette>
 #include <QPixmap>
+#include <QScreen>
+#include <QTimer>
 #include <QtMath>
 #if (QT_VERSION < QT_VERSION_CHECK(6,0,0))
 #include <QTouchDevice>
@@ -78,7 +80,10 @@ public:
         m_foregroundPalette(PianoPalette(PAL_FONT)),
         m_useKeyPix( true ),
         m_usingNativeFilter( false ),
-        m_octaveSubscript( true )
+        m_octaveSubscript( true ),
+        m_batched( false ),
+        m_feed( &m_ownFeed ),
+        m_applyingFrame( false )
     { }
 
     void saveData(QByteArray& buffer)
@@ -111,6 +116,7 @@ public:
         ds << m_keyPix[1];
         ds << m_usingNativeFilter;
         ds << m_octaveSubscript;
+        ds << m_batched;
     }
 
     void loadData(QByteArray& buffer)
@@ -144,8 +150,16 @@ public:
         ds >> m_keyPix[1];
         ds >> m_usingNativeFilter;
         ds >> m_octaveSubscript;
+        ds >> m_batched;
     }
 
+    QString signalText( PianoKey* key )
+    {
+        int n = key->getNote() + m_baseOctave*12 + m_transpose;
+        return QString("#%1 (%2)").arg(n).arg(noteName(key, false));
+    }
+
+
     QString noteName( PianoKey* key, bool richText )
     {
         Q_ASSERT(key != nullptr);
@@ -230,11 +244,29 @@ public:
     QPixmap m_keyPix[2];
     bool m_usingNativeFilter;
     bool m_octaveSubscript;
+    bool m_batched;
     /* not serialized */
     PianoKeybd* m_view;
     QMap<int, PianoKey *> m_touched;
+    QTimer m_frameTimer;
+    NoteFeed m_ownFeed;
+    NoteFeed *m_feed;
+    bool m_applyingFrame;
 };
 
+/* the velocity tint is quantized to 16 levels, to limit the cached key images */
+static QColor velocityColor(const QColor &color, const int vel)
+{
+    return color.lighter(200 - (vel | 0x07));
+}
+
+static int frameInterval()
+{
+    QScreen *screen = QGuiApplication::primaryScreen();
+    qreal rate = (screen != nullptr) ? screen->refreshRate() : 0.0;
+    return (rate > 0.0) ? qMax(1, qRound(1000.0 / rate)) : 16;
+}
+
 const int KEYWIDTH = 180;
 const int KEYHEIGHT = 720;
 
@@ -298,6 +330,14 @@ PianoScene::PianoScene ( const int baseOctave,
     }
     hideOrShowKeys();
     retranslate();
+    d->m_frameTimer.setTimerType(Qt::PreciseTimer);
+    d->m_frameTimer.setSingleShot(true);
+    connect(&d->m_frameTimer, &QTimer::timeout, this, [this] {
+        // one more frame while the notes keep changing
+        if ((flushPendingNotes() > 0) || !d->m_feed->stopFrames()) {
+            d->m_frameTimer.start(frameInterval());
+        }
+    });
 }
 
 /**
@@ -374,9 +414,9 @@ PianoPalette PianoScene::getHighlightPalette()
 void PianoScene::displayKeyOn(PianoKey* key)
 {
     key->setPressed(true);
-    int n = key->getNote() + d->m_baseOctave*12 + d->m_transpose;
-    QString s = QString("#%1 (%2)").arg(n).arg(d->noteName(key, false));
-    Q_EMIT signalName(s);
+    if (!d->m_applyingFrame) {
+        Q_EMIT signalName(d->signalText(key));
+    }
     KeyLabel* lbl = dynamic_cast<KeyLabel*>(key->childItems().constFirst());
     if (lbl != nullptr) {
         lbl->setDefaultTextColor(d->m_foregroundPalette.getColor(key->isBlack() ? 3 : 2));
@@ -396,7 +436,7 @@ void PianoScene::showKeyOn( PianoKey* key, QColor color, int vel )
 {
     //qDebug() << Q_FUNC_INFO << key->getNote() << vel << color << d->m_velocityTint;
     if (d->m_velocityTint && (vel >= 0) && (vel < 128) && color.isValid() ) {
-        QBrush hilightBrush(color.lighter(200 - vel));
+        QBrush hilightBrush(velocityColor(color, vel));
         key->setPressedBrush(hilightBrush);
     } else if (color.isValid()) {
         key->setPressedBrush(color);
@@ -424,7 +464,9 @@ void PianoScene::showKeyOff( PianoKey* key, int vel)
 {
     Q_UNUSED(vel)
     key->setPressed(false);
-    Q_EMIT signalName(QString());
+    if (!d->m_applyingFrame) {
+        Q_EMIT signalName(QString());
+    }
     KeyLabel* lbl = dynamic_cast<KeyLabel*>(key->childItems().constFirst());
     if (lbl != nullptr) {
         lbl->restoreColor();
@@ -443,6 +485,12 @@ void PianoScene::showKeyOff( PianoKey* key, int vel)
 void PianoScene::showNoteOn( const int note, QColor color, int vel )
 {
     //qDebug() << Q_FUNC_INFO << note << vel << color;
+    if (d->m_batched) {
+        if (color.isValid() && d->m_feed->post(note, NoteFeed::noteState(true, vel, color))) {
+            QMetaObject::invokeMethod(this, "scheduleFrame", Qt::QueuedConnection);
+        }
+        return;
+    }
     int n = note - d->m_baseOctave*12 - d->m_transpose;
     if ((note >= d->m_minNote) && (note <= d->m_maxNote) && d->m_keys.contains(n) && color.isValid())
         showKeyOn(d->m_keys.value(n), color, vel);
@@ -456,6 +504,12 @@ void PianoScene::showNoteOn( const int note, QColor color, int vel )
 void PianoScene::showNoteOn( const int note, int vel )
 {
     //qDebug() << Q_FUNC_INFO << note << vel;
+    if (d->m_batched) {
+        if (d->m_feed->post(note, NoteFeed::noteState(true, vel))) {
+            QMetaObject::invokeMethod(this, "scheduleFrame", Qt::QueuedConnection);
+        }
+        return;
+    }
     int n = note - d->m_baseOctave*12 - d->m_transpose;
     if ((note >= d->m_minNote) && (note <= d->m_maxNote) && d->m_keys.contains(n)) {
         showKeyOn(d->m_keys.value(n), vel);
@@ -469,6 +523,12 @@ void PianoScene::showNoteOn( const int note, int vel )
  */
 void PianoScene::showNoteOff( const int note, int vel )
 {
+    if (d->m_batched) {
+        if (d->m_feed->post(note, NoteFeed::noteState(false, vel))) {
+            QMetaObject::invokeMethod(this, "scheduleFrame", Qt::QueuedConnection);
+        }
+        return;
+    }
     int n = note - d->m_baseOctave*12 - d->m_transpose;
     if ((note >= d->m_minNote) && (note <= d->m_maxNote) && d->m_keys.contains(n)) {
         showKeyOff(d->m_keys.value(n), vel);
@@ -548,7 +608,7 @@ void PianoScene::setHighlightColorFromPolicy(PianoKey* key, int vel)
     }
     if (c.isValid()) {
         if (d->m_velocityTint && (vel >= 0) && (vel < 128)) {
-            QBrush h(c.lighter(200 - vel));
+            QBrush h(velocityColor(c, vel));
             key->setPressedBrush(h);
         } else {
             key->setPressedBrush(c);
@@ -806,6 +866,7 @@ bool PianoScene::event(QEvent *event)
  */
 void PianoScene::allKeysOff()
 {
+    d->m_feed->clear();
     foreach(PianoKey* key, d->m_keys) {
         key->setPressed(false);
     }
@@ -1407,6 +1468,8 @@ void PianoScene::saveData(QByteArray &ba)
 void PianoScene::loadData(QByteArray &ba)
 {
     d->loadData(ba);
+    d->m_feed->setFramed(d->m_batched);
+    scheduleFrame();
 }
 
 /**
@@ -1587,5 +1650,104 @@ bool PianoScene::octaveSubscript() const
     return d->m_octaveSubscript;
 }
 
+/**
+ * @brief Enables or disables the batched display of notes
+ *
+ * In batched mode, showNoteOn() and showNoteOff() only store the note state,
+ * and may be called from any thread. The changed keys are displayed once
+ * per screen refresh, emitting a single signalName() per frame. The frame
+ * timer runs only while the notes keep changing.
+ * @param enable the batched display of notes
+ */
+void PianoScene::setBatchedDisplay(const bool enable)
+{
+    if (d->m_batched != enable) {
+        d->m_batched = enable;
+        d->m_feed->setFramed(enable);
+        if (!enable) {
+            d->m_frameTimer.stop();
+        }
+        scheduleFrame();
+    }
+}
+
+/**
+ * @brief Assigns the store of note states shared with the view
+ *
+ * The view owns the store, so other threads may keep posting notes while
+ * the scene is replaced. A null pointer restores the scene own store.
+ * @param feed the store of note states
+ */
+void PianoScene::setNoteFeed(NoteFeed *feed)
+{
+    d->m_feed = (feed != nullptr) ? feed : &d->m_ownFeed;
+    d->m_feed->setFramed(d->m_batched);
+    // a frame scheduled on a previous scene may be lost
+    QMetaObject::invokeMethod(this, "scheduleFrame", Qt::QueuedConnection);
+}
+
+/**
+ * @brief Returns whether the batched display of notes is enabled
+ * @return true if the batched display of notes is enabled
+ */
+bool PianoScene::isBatchedDisplay() const
+{
+    return d->m_batched;
+}
+
+/**
+ * @brief Schedules the display of the posted notes
+ *
+ * Called once by the first note posted after an idle period. In batched
+ * mode, it starts the frame timer, otherwise the notes are displayed at once.
+ */
+void PianoScene::scheduleFrame()
+{
+    if (!d->m_batched) {
+        flushPendingNotes();
+    } else if (!d->m_frameTimer.isActive()) {
+        d->m_frameTimer.start(frameInterval());
+    }
+}
+
+/**
+ * @brief Displays the notes changed since the last frame
+ *
+ * Called by the frame timer in batched mode. Only the last state of each
+ * changed note is displayed, and signalName() is emitted once with the
+ * name of the last activated key, or an empty string.
+ * @return the number of changed notes
+ */
+int PianoScene::flushPendingNotes()
+{
+    PianoKey *lastOn = nullptr;
+    bool changed = false;
+    d->m_applyingFrame = true;
+    const int count = d->m_feed->consume([&](const int note, const quint64 state) {
+        PianoKey *key = d->m_keys.value(note - d->m_baseOctave*12 - d->m_transpose, nullptr);
+        if ((note < d->m_minNote) || (note > d->m_maxNote) || (key == nullptr)) {
+            return;
+        }
+        int vel = NoteFeed::velocity(state);
+        if ((state & NoteFeed::STATE_ON) == 0) {
+            showKeyOff(key, vel);
+        } else if ((state & NoteFeed::STATE_COLOR) != 0) {
+            showKeyOn(key, QColor::fromRgba(QRgb(state)), vel);
+            lastOn = key;
+        } else {
+            showKeyOn(key, vel);
+            lastOn = key;
+        }
+        changed = true;
+    });
+    d->m_applyingFrame = false;
+    if (lastOn != nullptr) {
+        Q_EMIT signalName(d->signalText(lastOn));
+    } else if (changed) {
+        Q_EMIT signalName(QString());
+    }
+    return count;
+}
+
 } // namespace widgets
 } // namespace drumstick
@@ -27,6 +27,7 @@
 #include <drumstick/pianopalette.h>
 #include "pianokey.h"
 #include "keylabel.h"
+#include "notefeed.h"
 
 /**
  * @file pianoscene.h
@@ -142,6 +143,14 @@ public:
     void setOctaveSubscript(const bool enable);
     bool octaveSubscript() const;
 
+    void setBatchedDisplay(const bool enable);
+    bool isBatchedDisplay() const;
+    void setNoteFeed(NoteFeed *feed);
+    int flushPendingNotes();
+
+public Q_SLOTS:
+    void scheduleFrame();
+
 Q_SIGNALS:
     /**
          * This signal is emitted for each Note On MIDI event created using
@@ -21,8 +21,10 @@ FORMS += \
     networksettingsdialog.ui
 
 HEADERS += \
+    ../include/drumstick/activitymeter.h \
     ../include/drumstick/pianokeybd.h \
     ../include/drumstick/pianopalette.h \
+    ../include/drumstick/pianoroll.h \
     ../include/drumstick/rtmidiinput.h \
     ../include/drumstick/rtmidioutput.h \
     ../include/drumstick/configurationdialogs.h \
@@ -30,15 +32,18 @@ HEADERS += \
     pianoscene.h \
     pianokey.h \
     keylabel.h \
+    notefeed.h \
     fluidsettingsdialog.h \
     networksettingsdialog.h
 
 SOURCES += \
+    activitymeter.cpp \
     configurationdialogs.cpp \
     pianokey.cpp \
     pianokeybd.cpp \
     pianoscene.cpp \
     pianopalette.cpp \
+    pianoroll.cpp \
     keylabel.cpp \
     fluidsettingsdialog.cpp \
     networksettingsdialog.cpp \
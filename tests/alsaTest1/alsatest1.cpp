@@ -20,6 +20,7 @@
 #include <QString>
 #include <QtTest>
 #include <drumstick/alsaevent.h>
+#include <drumstick/notepairing.h>
 
 using namespace drumstick::ALSA;
 
@@ -32,6 +33,8 @@ public:
 
 private Q_SLOTS:
     void testEvents();
+    void testNotePairing();
+    void testRepeatedNotes();
 };
 
 AlsaTest1::AlsaTest1() = default;
@@ -95,6 +98,82 @@ void AlsaTest1::testEvents()
     QCOMPARE(otherText.getLength(), (unsigned) text.length());
 }
 
+void AlsaTest1::testNotePairing()
+{
+    auto at = [](SequencerEvent* ev, int tick) {
+        ev->scheduleTick(0, tick, false);
+        return ev;
+    };
+    QList<SequencerEvent*> events;
+    events << at(new NoteOnEvent(0, 60, 100), 0)
+           << at(new ControllerEvent(0, 7, 100), 0)
+           << at(new NoteOnEvent(0, 60, 90), 10)   // overlapping, same pitch
+           << at(new NoteOffEvent(0, 60, 64), 20)
+           << at(new NoteOnEvent(0, 60, 0), 30)    // velocity zero note-off
+           << at(new NoteOffEvent(1, 62, 0), 30)   // without a note-on
+           << at(new NoteOnEvent(1, 64, 80), 40);  // without a note-off
+
+    NotePairing pairing;
+    QCOMPARE(pairing.pairNotes(events), 2);
+    QCOMPARE(pairing.unmatchedNoteOns(), 1);
+    QCOMPARE(pairing.unmatchedNoteOffs(), 1);
+    QCOMPARE(events.count(), 5);
+    QCOMPARE(events[0]->getSequencerType(), (snd_seq_event_type_t) SND_SEQ_EVENT_NOTE);
+    NoteEvent* first = static_cast<NoteEvent*>(events[0]);
+    QCOMPARE(first->getVelocity(), 100);
+    QCOMPARE(first->getDuration(), 20uL);
+    QCOMPARE((int) first->getHandle()->data.note.off_velocity, 64);
+    QCOMPARE(events[1]->getSequencerType(), (snd_seq_event_type_t) SND_SEQ_EVENT_CONTROLLER);
+    NoteEvent* second = static_cast<NoteEvent*>(events[2]);
+    QCOMPARE(second->getTick(), 10u);
+    QCOMPARE(second->getVelocity(), 90);
+    QCOMPARE(second->getDuration(), 20uL);
+    QCOMPARE(events[3]->getSequencerType(), (snd_seq_event_type_t) SND_SEQ_EVENT_NOTEOFF);
+    QCOMPARE(events[4]->getSequencerType(), (snd_seq_event_type_t) SND_SEQ_EVENT_NOTEON);
+
+    QCOMPARE(pairing.splitNotes(events), 2);
+    QCOMPARE(events.count(), 7);
+    const snd_seq_event_type_t types[] = { SND_SEQ_EVENT_NOTEON, SND_SEQ_EVENT_CONTROLLER,
+        SND_SEQ_EVENT_NOTEON, SND_SEQ_EVENT_NOTEOFF, SND_SEQ_EVENT_NOTEOFF,
+        SND_SEQ_EVENT_NOTEOFF, SND_SEQ_EVENT_NOTEON };
+    const unsigned int ticks[] = { 0, 0, 10, 20, 30, 30, 40 };
+    for (int i = 0; i < events.count(); ++i) {
+        QCOMPARE(events[i]->getSequencerType(), types[i]);
+        QCOMPARE(events[i]->getTick(), ticks[i]);
+    }
+    QCOMPARE(static_cast<KeyEvent*>(events[3])->getVelocity(), 64);
+    qDeleteAll(events);
+}
+
+void AlsaTest1::testRepeatedNotes()
+{
+    auto at = [](SequencerEvent* ev, int tick) {
+        ev->scheduleTick(0, tick, false);
+        return ev;
+    };
+    QList<SequencerEvent*> events;
+    events << at(new NoteOnEvent(0, 60, 100), 0)
+           << at(new NoteOnEvent(0, 60, 90), 20)   // before the note-off at the same tick
+           << at(new NoteOffEvent(0, 60, 0), 20)
+           << at(new NoteOffEvent(0, 60, 0), 40)
+           << at(new NoteOnEvent(0, 60, 80), 40)   // after the note-off at the same tick
+           << at(new NoteOffEvent(0, 60, 0), 60)
+           << at(new NoteOnEvent(1, 60, 80), 60);  // another channel
+
+    NotePairing pairing;
+    QCOMPARE(pairing.pairNotes(events), 3);
+    QCOMPARE(events.count(), 4);
+    const unsigned int ticks[] = { 0, 20, 40, 60 };
+    const unsigned long durations[] = { 19, 19, 20 };
+    for (int i = 0; i < 3; ++i) {
+        QCOMPARE(events[i]->getSequencerType(), (snd_seq_event_type_t) SND_SEQ_EVENT_NOTE);
+        QCOMPARE(events[i]->getTick(), ticks[i]);
+        QCOMPARE(static_cast<NoteEvent*>(events[i])->getDuration(), durations[i]);
+    }
+    QCOMPARE(events[3]->getTick(), ticks[3]);
+    qDeleteAll(events);
+}
+
 QTEST_APPLESS_MAIN(AlsaTest1)
 
 #include "alsatest1.moc"
@@ -0,0 +1,16 @@
+QT       += testlib
+QT       -= gui
+TARGET = guiplayertest
+CONFIG   += c++11 cmdline
+TEMPLATE = app
+SOURCES += \
+    guiplayertest.cpp \
+    ../../utils/guiplayer/player.cpp \
+    ../../utils/guiplayer/song.cpp
+HEADERS += \
+    ../../utils/guiplayer/player.h \
+    ../../utils/guiplayer/song.h
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
+INCLUDEPATH += . ../../library/include ../../utils/guiplayer
+LIBS = -L../../build/lib -ldrumstick-alsa -lasound
+DESTDIR = ../../build/bin
@@ -0,0 +1,184 @@
+/*
+    Copyright (C) 2008-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This file is part of the Drumstick project, see https://sf.net/p/drumstick
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QString>
+#include <QtTest>
+#include <drumstick/alsaevent.h>
+#include "player.h"
+#include "song.h"
+
+using namespace drumstick::ALSA;
+
+class GuiPlayerTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    GuiPlayerTest();
+
+private:
+    void buildSong(Song& song);
+
+private Q_SLOTS:
+    void testStateAt();
+    void testChase();
+};
+
+GuiPlayerTest::GuiPlayerTest() = default;
+
+/*
+ * A song longer than one checkpoint interval (16 beats of 120 ticks), with a
+ * reset all controllers after the first checkpoint
+ */
+void GuiPlayerTest::buildSong(Song& song)
+{
+    auto at = [&song](SequencerEvent* ev, int tick) {
+        ev->scheduleTick(0, tick, false);
+        song.append(ev);
+    };
+    song.setHeader(1, 1, 120);
+    at(new TempoEvent(0, 600000), 0);
+    at(new ControllerEvent(0, MIDI_CTL_MSB_MAIN_VOLUME, 90), 0);
+    at(new ControllerEvent(0, MIDI_CTL_MSB_PAN, 30), 0);
+    at(new ControllerEvent(0, MIDI_CTL_MSB_BANK, 1), 0);
+    at(new ProgramChangeEvent(0, 5), 0);
+    at(new ControllerEvent(0, MIDI_CTL_REGIST_PARM_NUM_MSB, 0), 10);
+    at(new ControllerEvent(0, MIDI_CTL_REGIST_PARM_NUM_LSB, 0), 10);
+    at(new ControllerEvent(0, MIDI_CTL_MSB_DATA_ENTRY, 12), 10);
+    at(new ControllerEvent(0, MIDI_CTL_SUSTAIN, 127), 100);
+    at(new ControllerEvent(0, MIDI_CTL_MSB_MODWHEEL, 40), 100);
+    at(new PitchBendEvent(0, 1000), 200);
+    at(new ChanPressEvent(0, 50), 200);
+    at(new ControllerEvent(0, MIDI_CTL_MSB_MAIN_VOLUME, 60), 3000);
+    at(new ControllerEvent(0, MIDI_CTL_RESET_CONTROLLERS, 0), 4000);
+    at(new NoteOnEvent(0, 60, 100), 5000);
+    at(new NoteOffEvent(0, 60, 0), 5100);
+    song.sort();
+}
+
+void GuiPlayerTest::testStateAt()
+{
+    Song song;
+    buildSong(song);
+
+    SongState state = song.stateAt(0);
+    QCOMPARE(state.index, 0);
+    QCOMPARE(state.tempoIndex, -1);
+    QCOMPARE((int) state.channel[0].controller[MIDI_CTL_MSB_MAIN_VOLUME], -1);
+    QCOMPARE((int) state.channel[0].program, -1);
+
+    state = song.stateAt(2500);
+    QCOMPARE(state.index, song.indexOf(2500));
+    QCOMPARE(state.tempoIndex, 0);
+    const ChannelState& c = state.channel[0];
+    QCOMPARE((int) c.controller[MIDI_CTL_MSB_MAIN_VOLUME], 90);
+    QCOMPARE((int) c.controller[MIDI_CTL_MSB_PAN], 30);
+    QCOMPARE((int) c.controller[MIDI_CTL_SUSTAIN], 127);
+    QCOMPARE((int) c.program, 5);
+    QCOMPARE((int) c.pitchBend, 1000);
+    QCOMPARE((int) c.pressure, 50);
+    QCOMPARE((int) c.rpn[0], 12 << 7);
+    QCOMPARE((int) state.channel[1].controller[MIDI_CTL_MSB_MAIN_VOLUME], -1);
+
+    QCOMPARE((int) song.stateAt(3500).channel[0].controller[MIDI_CTL_MSB_MAIN_VOLUME], 60);
+
+    // RP-015: only the performance controllers are reset
+    state = song.stateAt(4500);
+    const ChannelState& r = state.channel[0];
+    QCOMPARE((int) r.controller[MIDI_CTL_MSB_MAIN_VOLUME], 60);
+    QCOMPARE((int) r.controller[MIDI_CTL_MSB_PAN], 30);
+    QCOMPARE((int) r.controller[MIDI_CTL_MSB_BANK], 1);
+    QCOMPARE((int) r.controller[MIDI_CTL_SUSTAIN], 0);
+    QCOMPARE((int) r.controller[MIDI_CTL_MSB_MODWHEEL], 0);
+    QCOMPARE((int) r.controller[MIDI_CTL_MSB_EXPRESSION], 127);
+    QCOMPARE((int) r.controller[MIDI_CTL_REGIST_PARM_NUM_MSB], 127);
+    QCOMPARE((int) r.controller[MIDI_CTL_REGIST_PARM_NUM_LSB], 127);
+    QCOMPARE((int) r.program, 5);
+    QCOMPARE((int) r.pitchBend, 0);
+    QCOMPARE((int) r.pressure, 0);
+    QCOMPARE((int) r.rpn[0], 12 << 7);
+    QCOMPARE((int) r.rpnSelected, -1);
+}
+
+void GuiPlayerTest::testChase()
+{
+    Song song;
+    buildSong(song);
+    Player player(nullptr, 0);
+    player.setSong(&song);
+    player.setPosition(4500);
+
+    QList<snd_seq_event_t> chase;
+    while (player.hasNext()) {
+        snd_seq_event_t ev = *player.nextEvent()->getHandle();
+        if (ev.time.tick != 4500) {
+            // the first song record after the position
+            QCOMPARE(ev.type, (snd_seq_event_type_t) SND_SEQ_EVENT_NOTE);
+            QCOMPARE(ev.time.tick, 5000u);
+            break;
+        }
+        chase.append(ev);
+    }
+    QVERIFY(!chase.isEmpty());
+    QCOMPARE(chase.first().type, (snd_seq_event_type_t) SND_SEQ_EVENT_TEMPO);
+
+    QMap<int, int> controllers;
+    int program = -1;
+    int pitchBend = -1;
+    int pressure = -1;
+    foreach(const snd_seq_event_t& ev, chase.mid(1)) {
+        QCOMPARE((int) ev.data.control.channel, 0);
+        switch (ev.type) {
+        case SND_SEQ_EVENT_CONTROLLER:
+            // the data entry follows its parameter selection
+            if (ev.data.control.param == MIDI_CTL_MSB_DATA_ENTRY) {
+                QCOMPARE(controllers.value(MIDI_CTL_REGIST_PARM_NUM_MSB), 0);
+                QCOMPARE(controllers.value(MIDI_CTL_REGIST_PARM_NUM_LSB), 0);
+            }
+            controllers[ev.data.control.param] = ev.data.control.value;
+            break;
+        case SND_SEQ_EVENT_PGMCHANGE:
+            QCOMPARE(controllers.value(MIDI_CTL_MSB_BANK), 1);
+            program = ev.data.control.value;
+            break;
+        case SND_SEQ_EVENT_PITCHBEND:
+            pitchBend = ev.data.control.value;
+            break;
+        case SND_SEQ_EVENT_CHANPRESS:
+            pressure = ev.data.control.value;
+            break;
+        }
+    }
+    QCOMPARE(controllers.value(MIDI_CTL_MSB_MAIN_VOLUME), 60);
+    QCOMPARE(controllers.value(MIDI_CTL_MSB_PAN), 30);
+    QCOMPARE(controllers.value(MIDI_CTL_SUSTAIN), 0);
+    QCOMPARE(controllers.value(MIDI_CTL_MSB_EXPRESSION), 127);
+    QCOMPARE(controllers.value(MIDI_CTL_MSB_DATA_ENTRY), 12);
+    QVERIFY(!controllers.contains(MIDI_CTL_RESET_CONTROLLERS));
+    // the null RPN is selected at the end
+    QCOMPARE(controllers.value(MIDI_CTL_REGIST_PARM_NUM_MSB), 127);
+    QCOMPARE(controllers.value(MIDI_CTL_REGIST_PARM_NUM_LSB), 127);
+    QCOMPARE(program, 5);
+    QCOMPARE(pitchBend, 0);
+    QCOMPARE(pressure, 0);
+}
+
+QTEST_GUILESS_MAIN(GuiPlayerTest)
+
+#include "guiplayertest.moc"
@@ -9,6 +9,34 @@ DEFINES += SRCDIR=\\\"$$PWD/\\\"
 INCLUDEPATH += . ../../library/include/
 DESTDIR = ../../build/bin
 
+# the synthesizer engines are also tested below the plugin interface
+!macx {
+    packagesExist(fluidsynth) {
+        DEFINES += FLUIDSYNTH_ENGINE
+        INCLUDEPATH += ../../library/rt-backends/fluidsynth \
+                       ../../library/rt-backends/common
+        !static {
+            HEADERS += ../../library/rt-backends/fluidsynth/fluidsynthengine.h
+            SOURCES += ../../library/rt-backends/fluidsynth/fluidsynthengine.cpp \
+                       ../../library/rt-backends/fluidsynth/soundfontcache.cpp
+            CONFIG += link_pkgconfig
+            PKGCONFIG += fluidsynth
+        }
+    }
+    packagesExist(libpulse-simple):packagesExist(sonivox) {
+        DEFINES += EAS_RENDERER
+        INCLUDEPATH += ../../library/rt-backends/eassynth \
+                       ../../library/rt-backends/common
+        !static {
+            HEADERS += ../../library/rt-backends/eassynth/synthrenderer.h
+            SOURCES += ../../library/rt-backends/eassynth/synthrenderer.cpp \
+                       ../../library/rt-backends/eassynth/filewrapper.cpp
+            CONFIG += link_pkgconfig
+            PKGCONFIG += libpulse-simple sonivox
+        }
+    }
+}
+
 static {
     CONFIG += link_prl
     DEFINES += DRUMSTICK_STATIC
@@ -18,6 +46,12 @@ static {
     LIBS += -ldrumstick-rt-net-in \
             -ldrumstick-rt-net-out
 
+    loopback {
+        DEFINES += LOOPBACK_BACKEND
+        LIBS += -ldrumstick-rt-loopback-in \
+                -ldrumstick-rt-loopback-out
+    }
+
     packagesExist(fluidsynth) {
         DEFINES += FLUIDSYNTH_BACKEND
         LIBS += -ldrumstick-rt-fluidsynth
@@ -17,12 +17,43 @@
     with this program; If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QSettings>
 #include <QString>
 #include <QStringList>
+#include <QTemporaryDir>
+#include <QtEndian>
 #include <QtTest>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <drumstick/backendmanager.h>
 #include <drumstick/rtmidiinput.h>
 #include <drumstick/rtmidioutput.h>
+#include <drumstick/rtmidisequencer.h>
+
+#if defined(FLUIDSYNTH_ENGINE)
+#include <QSaveFile>
+#include "fluidsynthengine.h"
+#include "soundfontcache.h"
+#endif
+
+#if defined(EAS_RENDERER)
+#include "synthrenderer.h"
+#endif
+
+#if defined(Q_OS_LINUX)
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
 
 #if defined(LINUX_BACKEND)
 Q_IMPORT_PLUGIN(ALSAMIDIInput)
@@ -51,6 +82,11 @@ Q_IMPORT_PLUGIN(DummyInput)
 Q_IMPORT_PLUGIN(DummyOutput)
 #endif
 
+#if defined(LOOPBACK_BACKEND)
+Q_IMPORT_PLUGIN(LoopbackInput)
+Q_IMPORT_PLUGIN(LoopbackOutput)
+#endif
+
 #if defined(FLUIDSYNTH_BACKEND)
 Q_IMPORT_PLUGIN(FluidSynthOutput)
 #endif
@@ -62,6 +98,71 @@ Q_IMPORT_PLUGIN(OSSOutput)
 
 using namespace drumstick::rt;
 
+/*
+ * A MIDIOutput recording the messages it receives, with the elapsed time
+ */
+class RecordingOutput : public MIDIOutput
+{
+public:
+    struct Message {
+        qint64 time; // microseconds
+        int status;
+        int data1;
+        int data2;
+    };
+
+    RecordingOutput() { m_clock.start(); }
+
+    void initialize(QSettings*) override { }
+    QString backendName() override { return QStringLiteral("Recording"); }
+    QString publicName() override { return backendName(); }
+    void setPublicName(QString) override { }
+    QList<MIDIConnection> connections(bool) override { return QList<MIDIConnection>(); }
+    void setExcludedConnections(QStringList) override { }
+    void open(const MIDIConnection&) override { }
+    void close() override { }
+    MIDIConnection currentConnection() override { return MIDIConnection(); }
+
+    void sendNoteOff(int chan, int note, int vel) override { record(MIDI_STATUS_NOTEOFF + chan, note, vel); }
+    void sendNoteOn(int chan, int note, int vel) override { record(MIDI_STATUS_NOTEON + chan, note, vel); }
+    void sendKeyPressure(int chan, int note, int value) override { record(MIDI_STATUS_KEYPRESURE + chan, note, value); }
+    void sendController(int chan, int control, int value) override { record(MIDI_STATUS_CONTROLCHANGE + chan, control, value); }
+    void sendProgram(int chan, int program) override { record(MIDI_STATUS_PROGRAMCHANGE + chan, program, 0); }
+    void sendChannelPressure(int chan, int value) override { record(MIDI_STATUS_CHANNELPRESSURE + chan, value, 0); }
+    void sendPitchBend(int chan, int value) override { record(MIDI_STATUS_PITCHBEND + chan, value, 0); }
+    void sendSysex(const QByteArray&) override { record(MIDI_STATUS_SYSEX, 0, 0); }
+    void sendSystemMsg(const int status) override { record(status, 0, 0); }
+
+    QList<Message> noteOns()
+    {
+        QMutexLocker locker(&m_mutex);
+        QList<Message> result;
+        foreach(const Message& m, m_messages) {
+            if ((m.status & MIDI_STATUS_MASK) == MIDI_STATUS_NOTEON && m.data2 > 0) {
+                result << m;
+            }
+        }
+        return result;
+    }
+
+    void clear()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_messages.clear();
+    }
+
+private:
+    void record(int status, int data1, int data2)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_messages << Message{m_clock.nsecsElapsed() / 1000, status, data1, data2};
+    }
+
+    QMutex m_mutex;
+    QElapsedTimer m_clock;
+    QList<Message> m_messages;
+};
+
 class RtTest : public QObject
 {
     Q_OBJECT
@@ -74,6 +175,18 @@ private:
 
 private Q_SLOTS:
     void testRT();
+    void testSong();
+    void testSequencer();
+    void testLoopback();
+    void testNetReceive();
+    void testNetPlayout();
+    void testOSSInput();
+    void testOSSOutput();
+    void testEASRender();
+    void testRenderOnsets();
+    void testFluidSynthQueue();
+    void testEASQueue();
+    void testSoundFontCache();
 };
 
 RtTest::RtTest() = default;
@@ -94,6 +207,9 @@ void RtTest::testRT()
     }
 #endif
 
+    QVERIFY2(man.availableInputNames().length() > 0, "There aren't input backend names");
+    QVERIFY2(man.availableOutputNames().length() > 0, "There aren't output backend names");
+
     inputsList = man.availableInputs();
     QVERIFY2(inputsList.length() > 0, "There aren't input backends");
     foreach(MIDIInput* input, inputsList) {
@@ -121,6 +237,780 @@ void RtTest::testRT()
     }
 }
 
+void RtTest::testSong()
+{
+    MIDISong song;
+    song.setDivision(96);
+    song.addMessage(192, 1, MIDI_STATUS_NOTEOFF, 60, 0);
+    song.addMessage(0, 1, MIDI_STATUS_NOTEON, 60, 100);
+    song.addTempo(96, 250000);
+    song.addSysex(96, 0, QByteArray::fromHex("f07e7f0901f7"));
+    song.finalize();
+
+    QCOMPARE(song.count(), 3);
+    QCOMPARE(song.tracks(), 2);
+    QCOMPARE(song.at(0).status, quint8(MIDI_STATUS_NOTEON));
+    QCOMPARE(song.at(1).status, quint8(MIDI_STATUS_SYSEX));
+    QCOMPARE(song.sysexData(song.at(1)).size(), 6);
+    QCOMPARE(song.at(1).time, qint64(500000));
+    QCOMPARE(song.at(2).time, qint64(750000));
+    QCOMPARE(song.lengthTime(), qint64(750000));
+    QCOMPARE(song.timeToTick(625000), quint64(144));
+    QCOMPARE(song.tempoAt(100), 250000);
+    QCOMPARE(song.indexOf(97), 2);
+}
+
+void RtTest::testSequencer()
+{
+    // two tracks with a note every quarter, a quarter lasts 100 ms
+    MIDISong song;
+    song.setDivision(96);
+    song.addTempo(0, 100000);
+    for (int i = 0; i < 4; ++i) {
+        song.addMessage(i * 96, 0, MIDI_STATUS_NOTEON, 60 + i, 100);
+        song.addMessage(i * 96 + 48, 0, MIDI_STATUS_NOTEOFF, 60 + i, 0);
+        song.addMessage(i * 96, 1, MIDI_STATUS_NOTEON + 1, 70 + i, 100);
+        song.addMessage(i * 96 + 48, 1, MIDI_STATUS_NOTEOFF + 1, 70 + i, 0);
+    }
+    song.finalize();
+
+    RecordingOutput out;
+    MIDISequencer seq;
+    seq.setOutput(&out);
+    seq.setSong(song);
+    auto keys = [&out](int chan) {
+        QList<int> result;
+        foreach(const RecordingOutput::Message& m, out.noteOns()) {
+            if ((m.status & MIDI_CHANNEL_MASK) == chan) {
+                result << m.data1;
+            }
+        }
+        return result;
+    };
+
+    // playback
+    seq.start();
+    QVERIFY(seq.wait(5000));
+    QCOMPARE(keys(0), QList<int>({60, 61, 62, 63}));
+    QCOMPARE(keys(1), QList<int>({70, 71, 72, 73}));
+    QList<RecordingOutput::Message> notes = out.noteOns();
+    qint64 span = notes.last().time - notes.first().time;
+    QVERIFY2(span >= 290000 && span < 400000, qPrintable(QString::number(span)));
+    QCOMPARE(seq.position(), quint64(0));
+
+    // tempo scale
+    out.clear();
+    seq.setTempoFactor(2.0);
+    seq.start();
+    QVERIFY(seq.wait(5000));
+    notes = out.noteOns();
+    span = notes.last().time - notes.first().time;
+    QVERIFY2(span >= 140000 && span < 250000, qPrintable(QString::number(span)));
+    seq.setTempoFactor(1.0);
+
+    // mute and solo
+    out.clear();
+    seq.setTrackMuted(1, true);
+    QVERIFY(seq.isTrackMuted(1));
+    seq.start();
+    QVERIFY(seq.wait(5000));
+    QCOMPARE(keys(0).count(), 4);
+    QVERIFY(keys(1).isEmpty());
+    out.clear();
+    seq.setTrackMuted(1, false);
+    seq.setTrackSolo(1, true);
+    QVERIFY(seq.isTrackSolo(1));
+    seq.start();
+    QVERIFY(seq.wait(5000));
+    QVERIFY(keys(0).isEmpty());
+    QCOMPARE(keys(1).count(), 4);
+    seq.setTrackSolo(1, false);
+
+    // seek before starting
+    out.clear();
+    seq.seek(192);
+    seq.start();
+    QVERIFY(seq.wait(5000));
+    QCOMPARE(keys(0), QList<int>({62, 63}));
+
+    // loop over the first two quarters
+    out.clear();
+    seq.setLoop(true, 0, 192);
+    seq.start();
+    QTRY_VERIFY_WITH_TIMEOUT(keys(0).count() >= 6, 5000);
+    seq.stop();
+    QCOMPARE(keys(0).mid(0, 6), QList<int>({60, 61, 60, 61, 60, 61}));
+    seq.setLoop(false);
+}
+
+void RtTest::testLoopback()
+{
+    const int total = 2000000;
+    const int batch = 10000;
+    BackendManager man;
+    MIDIOutput *output = man.outputBackendByName(QStringLiteral("Loopback"));
+    MIDIInput *input = man.inputBackendByName(QStringLiteral("Loopback"));
+    if (output == nullptr || input == nullptr) {
+        QSKIP("Loopback backends not available");
+    }
+
+    std::atomic<int> notes{0};
+    auto conn = QObject::connect(input, &MIDIInput::midiNoteOn, input,
+                                 [&notes](int, int, int) { ++notes; }, Qt::DirectConnection);
+    auto received = [input] { return input->property("received").toULongLong(); };
+    auto sent = [output] { return output->property("sent").toULongLong(); };
+
+    // throughput, with back pressure to avoid ring overruns
+    output->setProperty("latency", 0);
+    output->setProperty("loss", 0.0);
+    output->open(output->connections(false).constFirst());
+    input->open(input->connections(false).constFirst());
+    QVERIFY2(input->property("status").toBool(), "Loopback input is not connected");
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < total; ++i) {
+        output->sendNoteOn(i % 16, i % 128, 1 + i % 127);
+        if (i % batch == batch - 1) {
+            while (sent() - received() > quint64(2 * batch)) {
+                QThread::yieldCurrentThread();
+            }
+        }
+    }
+    QTRY_VERIFY_WITH_TIMEOUT(received() == sent(), 30000);
+    qint64 elapsed = timer.nsecsElapsed();
+    qDebug() << "loopback:" << total << "messages in" << elapsed / 1000000 << "ms,"
+             << (total * 1e9 / elapsed) << "msg/s, average latency"
+             << input->property("avgLatency").toLongLong() << "us, max"
+             << input->property("maxLatency").toLongLong() << "us";
+    QCOMPARE(output->property("overruns").toULongLong(), 0ull);
+    QCOMPARE(sent(), quint64(total));
+    QCOMPARE(notes.load(), total);
+    input->close();
+    output->close();
+
+    // artificial latency and loss
+    const int count = 1000;
+    output->setProperty("latency", 2000);
+    output->setProperty("loss", 50.0);
+    output->open(output->connections(false).constFirst());
+    input->open(input->connections(false).constFirst());
+    for (int i = 0; i < count; ++i) {
+        output->sendController(0, 7, i % 128);
+    }
+    QTRY_VERIFY_WITH_TIMEOUT(received() == sent(), 5000);
+    const quint64 lost = output->property("lost").toULongLong();
+    QCOMPARE(sent() + lost, quint64(count));
+    QVERIFY(lost > 0 && lost < quint64(count));
+    QVERIFY(input->property("maxLatency").toLongLong() >= 2000);
+    input->close();
+    output->close();
+    output->setProperty("latency", 0);
+    output->setProperty("loss", 0.0);
+    QObject::disconnect(conn);
+}
+
+void RtTest::testNetReceive()
+{
+#if defined(Q_OS_LINUX)
+    const int port = 21947;
+    BackendManager man;
+    MIDIInput *input = man.inputBackendByName(QStringLiteral("Network"));
+    if (input == nullptr) {
+        QSKIP("Network backend not available");
+    }
+    QTemporaryDir dir;
+    QSettings settings(dir.filePath(QStringLiteral("rttest.ini")), QSettings::IniFormat);
+    std::atomic<int> notes{0};
+    auto conn = QObject::connect(input, &MIDIInput::midiNoteOn, input,
+                                 [&notes](int, int, int) { ++notes; }, Qt::DirectConnection);
+
+    // local multicast sender, looping back to this host
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    QVERIFY(fd >= 0);
+    unsigned char loop = 1;
+    ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    sockaddr_in group{};
+    group.sin_family = AF_INET;
+    group.sin_port = htons(port);
+    ::inet_pton(AF_INET, "225.0.0.37", &group.sin_addr);
+
+    // one message per datagram, increasing the rate until the first drop
+    const int rates[] = { 10000, 20000, 50000, 100000, 200000, 500000 };
+    for (bool batch : { false, true }) {
+        settings.setValue(QStringLiteral("Network/batchReceive"), batch);
+        input->initialize(&settings);
+        input->open(MIDIConnection(QString::number(port), port));
+        if (!input->property("status").toBool()) {
+            ::close(fd);
+            QSKIP("Multicast is not available");
+        }
+        int sustained = 0;
+        for (int rate : rates) {
+            const int count = rate / 4;
+            std::atomic<bool> done{false};
+            notes = 0;
+            std::thread sender([&] {
+                const char msg[3] = { char(MIDI_STATUS_NOTEON), 60, 100 };
+                QElapsedTimer timer;
+                timer.start();
+                for (int i = 0; i < count; ++i) {
+                    ::sendto(fd, msg, sizeof(msg), 0, reinterpret_cast<sockaddr *>(&group), sizeof(group));
+                    const qint64 due = qint64(i) * 1000000000 / rate;
+                    while (timer.nsecsElapsed() < due) {
+                        if (due - timer.nsecsElapsed() > 1000000) {
+                            QThread::usleep(500);
+                        }
+                    }
+                }
+                done = true;
+            });
+            // the event loop serves the unbatched receive path
+            while (!done) {
+                QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+            }
+            sender.join();
+            QTest::qWait(200);
+            if (notes < count) {
+                break;
+            }
+            sustained = rate;
+        }
+        input->close();
+        if (!batch && sustained == 0 && notes == 0) {
+            ::close(fd);
+            QSKIP("Multicast loopback is not routed on this host");
+        }
+        qDebug() << "network input, batchReceive:" << batch
+                 << "sustained" << sustained << "msg/s without drops";
+        if (batch) {
+            QVERIFY(sustained > 0);
+        }
+    }
+    ::close(fd);
+    QObject::disconnect(conn);
+#else
+    QSKIP("recvmmsg() batched receive is only available on Linux");
+#endif
+}
+
+void RtTest::testNetPlayout()
+{
+#if defined(Q_OS_LINUX)
+    using namespace std::chrono;
+    const int port = 21946;
+    const qint64 delay = 40000;
+    BackendManager man;
+    MIDIInput *input = man.inputBackendByName(QStringLiteral("Network"));
+    if (input == nullptr) {
+        QSKIP("Network backend not available");
+    }
+    auto now = [] {
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    };
+    QMutex mutex;
+    QList<QPair<int, qint64>> released;
+    auto conn = QObject::connect(input, &MIDIInput::midiNoteOn, input,
+                                 [&](int, int note, int) {
+                                     QMutexLocker locker(&mutex);
+                                     released << qMakePair(note, now());
+                                 }, Qt::DirectConnection);
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    QVERIFY(fd >= 0);
+    unsigned char loop = 1;
+    ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    sockaddr_in group{};
+    group.sin_family = AF_INET;
+    group.sin_port = htons(port);
+    ::inet_pton(AF_INET, "225.0.0.37", &group.sin_addr);
+    // a framed datagram: magic, sequence and sender timestamp, big endian
+    auto send = [&](quint32 sequence, qint64 stamp, int note) {
+        char datagram[19] = { 0, 'D', 'S', 'F' };
+        qToBigEndian<quint32>(sequence, datagram + 4);
+        qToBigEndian<qint64>(stamp, datagram + 8);
+        datagram[16] = char(MIDI_STATUS_NOTEON);
+        datagram[17] = char(note);
+        datagram[18] = 100;
+        ::sendto(fd, datagram, sizeof(datagram), 0, reinterpret_cast<sockaddr *>(&group), sizeof(group));
+    };
+    auto spinUntil = [&](qint64 time) {
+        while (now() < time) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 1);
+        }
+    };
+
+    input->setProperty("playoutDelay", int(delay));
+    input->open(MIDIConnection(QString::number(port), port));
+    if (!input->property("status").toBool()) {
+        ::close(fd);
+        QSKIP("Multicast is not available");
+    }
+    const qint64 t0 = now();
+    QMap<int, qint64> stamps{{60, t0}, {61, t0 + 5000}, {62, t0 + 10000}};
+    send(0, stamps[60], 60);
+    spinUntil(t0 + 10000);
+    // frame 1 arrives after frame 2, within the playout delay
+    send(2, stamps[62], 62);
+    send(1, stamps[61], 61);
+    // frame 3 arrives 100 ms after its playout time
+    send(3, t0 - 100000 - delay, 63);
+    int maxDepth = 0;
+    while (now() < t0 + 5000 + delay) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 1);
+        maxDepth = qMax(maxDepth, input->property("bufferDepth").toInt());
+    }
+    spinUntil(t0 + 10000 + 2 * delay);
+    if (input->property("datagrams").toULongLong() == 0) {
+        input->close();
+        ::close(fd);
+        QSKIP("Multicast loopback is not routed on this host");
+    }
+
+    QCOMPARE(input->property("framesReceived").toULongLong(), 4ull);
+    QCOMPARE(input->property("framesReordered").toULongLong(), 1ull);
+    QCOMPARE(input->property("lateDrops").toULongLong(), 1ull);
+    QVERIFY(maxDepth >= 2);
+    QCOMPARE(input->property("bufferDepth").toInt(), 0);
+    {
+        QMutexLocker locker(&mutex);
+        QCOMPARE(released.count(), 3);
+        for (int i = 0; i < released.count(); ++i) {
+            const int note = released[i].first;
+            const qint64 lag = released[i].second - stamps[note];
+            // released in timestamp order, at the stamp plus the delay, plus
+            // the transit time of the first frame used as the clock offset
+            QCOMPARE(note, 60 + i);
+            QVERIFY2(lag >= delay && lag < delay + 10000,
+                     qPrintable(QString("note %1 released after %2 us").arg(note).arg(lag)));
+        }
+    }
+    input->close();
+    input->setProperty("playoutDelay", 0);
+    ::close(fd);
+    QObject::disconnect(conn);
+#else
+    QSKIP("this test uses BSD sockets on Linux");
+#endif
+}
+
+void RtTest::testOSSInput()
+{
+#if defined(Q_OS_LINUX)
+    BackendManager man;
+    MIDIInput *input = man.inputBackendByName(QStringLiteral("OSS"));
+    if (input == nullptr) {
+        QSKIP("OSS backend not available");
+    }
+
+    // a raw mode pseudo terminal stands in for the device node
+    int master = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    QVERIFY(master >= 0);
+    QVERIFY(::grantpt(master) == 0 && ::unlockpt(master) == 0);
+    const QString slave = QString::fromLocal8Bit(::ptsname(master));
+    int keeper = ::open(::ptsname(master), O_RDWR | O_NOCTTY);
+    QVERIFY(keeper >= 0);
+    termios tio;
+    ::tcgetattr(keeper, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(keeper, TCSANOW, &tio);
+
+    const int sysexSize = 8192;
+    const int noteCount = 100;
+    QByteArray data(sysexSize, '\x55');
+    data[0] = char(MIDI_STATUS_SYSEX);
+    data[sysexSize - 1] = char(MIDI_STATUS_ENDSYSEX);
+    for (int i = 0; i < noteCount; ++i) {
+        data.append(char(MIDI_STATUS_NOTEON)).append(char(i)).append(char(100));
+    }
+
+    std::atomic<int> notes{0};
+    std::atomic<int> sysex{0};
+    auto conn1 = QObject::connect(input, &MIDIInput::midiNoteOn, input,
+                                  [&notes](int, int, int) { ++notes; }, Qt::DirectConnection);
+    auto conn2 = QObject::connect(input, &MIDIInput::midiSysex, input,
+                                  [&sysex](const QByteArray &d) { sysex = d.size(); }, Qt::DirectConnection);
+    for (bool thread : { false, true }) {
+        input->setProperty("readerThread", thread);
+        input->open(MIDIConnection(QStringLiteral("pty"), slave));
+        QVERIFY2(input->property("status").toBool(), "Cannot open the pseudo terminal");
+        notes = 0;
+        sysex = 0;
+        int written = 0;
+        while (written < data.size()) {
+            const ssize_t n = ::write(master, data.constData() + written, size_t(data.size() - written));
+            if (n > 0) {
+                written += int(n);
+            } else {
+                QVERIFY(errno == EAGAIN);
+                QTest::qWait(1);
+            }
+        }
+        QTRY_COMPARE(notes.load(), noteCount);
+        QCOMPARE(sysex.load(), sysexSize);
+        const quint64 reads = input->property("reads").toULongLong();
+        qDebug() << "OSS input, readerThread:" << thread << data.size() << "bytes in" << reads << "reads";
+        QCOMPARE(input->property("bytes").toULongLong(), quint64(data.size()));
+        QVERIFY(reads < quint64(data.size() / 16));
+        input->close();
+    }
+    QObject::disconnect(conn1);
+    QObject::disconnect(conn2);
+    ::close(keeper);
+    ::close(master);
+#else
+    QSKIP("pseudo terminals are used only on Linux");
+#endif
+}
+
+void RtTest::testOSSOutput()
+{
+#if defined(Q_OS_LINUX)
+    BackendManager man;
+    MIDIOutput *output = man.outputBackendByName(QStringLiteral("OSS"));
+    if (output == nullptr) {
+        QSKIP("OSS backend not available");
+    }
+
+    int master = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    QVERIFY(master >= 0);
+    QVERIFY(::grantpt(master) == 0 && ::unlockpt(master) == 0);
+    int keeper = ::open(::ptsname(master), O_RDWR | O_NOCTTY);
+    QVERIFY(keeper >= 0);
+    termios tio;
+    ::tcgetattr(keeper, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(keeper, TCSANOW, &tio);
+
+    output->setProperty("bufferedWriter", true);
+    output->setProperty("runningStatus", true);
+    output->open(MIDIConnection(QStringLiteral("pty"), QString::fromLocal8Bit(::ptsname(master))));
+    QVERIFY2(output->property("status").toBool(), "Cannot open the pseudo terminal");
+    output->sendNoteOn(0, 60, 100);
+    output->sendNoteOn(0, 62, 100);
+    output->sendSystemMsg(MIDI_STATUS_REALTIME);
+    output->sendNoteOn(0, 64, 100);
+    output->sendProgram(1, 5);
+    const QByteArray expected = QByteArray::fromHex("903c643e64f84064c105");
+    QByteArray received;
+    QTRY_VERIFY([&] {
+        char buffer[64];
+        const ssize_t n = ::read(master, buffer, sizeof(buffer));
+        if (n > 0) {
+            received.append(buffer, int(n));
+        }
+        return received.size() >= expected.size();
+    }());
+    QCOMPARE(received, expected);
+    QCOMPARE(output->property("overruns").toULongLong(), 0ull);
+    QCOMPARE(output->property("queueDepth").toInt(), 0);
+    output->close();
+    output->setProperty("bufferedWriter", false);
+    output->setProperty("runningStatus", false);
+    ::close(keeper);
+    ::close(master);
+#else
+    QSKIP("pseudo terminals are used only on Linux");
+#endif
+}
+
+void RtTest::testEASRender()
+{
+    BackendManager man;
+    MIDIOutput *output = man.outputBackendByName(QStringLiteral("SonivoxEAS"));
+    if (output == nullptr) {
+        QSKIP("SonivoxEAS backend not available");
+    }
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QSettings settings(dir.filePath("eas.ini"), QSettings::IniFormat);
+    QVERIFY(QMetaObject::invokeMethod(output, "readSettings", Qt::DirectConnection,
+                                      Q_ARG(QSettings*, &settings)));
+
+    MIDISong song;
+    song.setDivision(120);
+    for (int beat = 0; beat < 16; ++beat) {
+        song.addMessage(beat * 120, 1, MIDI_STATUS_NOTEON, 60 + beat % 12, 100);
+        song.addMessage(beat * 120 + 100, 1, MIDI_STATUS_NOTEOFF, 60 + beat % 12, 0);
+    }
+    song.finalize();
+
+    const QString fileName = dir.filePath("eas.wav");
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = false;
+    QVERIFY(QMetaObject::invokeMethod(output, "renderSong", Qt::DirectConnection,
+                                      Q_RETURN_ARG(bool, ok),
+                                      Q_ARG(drumstick::rt::MIDISong, song),
+                                      Q_ARG(QString, fileName)));
+    const double elapsed = timer.nsecsElapsed() / 1e9;
+    QVERIFY2(ok, "Offline rendering failed");
+    QFile wav(fileName);
+    QVERIFY(wav.open(QIODevice::ReadOnly));
+    const QByteArray header = wav.read(44);
+    QVERIFY(header.startsWith("RIFF") && header.mid(8, 4) == "WAVE");
+    const QByteArray samples = wav.readAll();
+    QVERIFY2(samples.count('\0') < samples.size(), "The rendered audio is silent");
+    qDebug() << "EAS render speed factor:" << (elapsed > 0 ? song.lengthTime() / 1e6 / elapsed : 0.0);
+}
+
+/*
+ * Renders a click track offline with each synthesizer backend, detects the
+ * onsets in the WAVE file, and checks the timing error of the onsets
+ * relative to the first one, which cancels the attack of the instrument.
+ * The tolerance is the rendering granularity of each synthesizer: 64 frames
+ * in FluidSynth, and one mix buffer in Sonivox EAS.
+ */
+void RtTest::testRenderOnsets()
+{
+    struct Synth { QString name; double tolerance; };
+    const QList<Synth> synths {
+        { QStringLiteral("FluidSynth"), 0.0025 },
+        { QStringLiteral("SonivoxEAS"), 0.0080 }
+    };
+    MIDISong song;
+    song.setDivision(480);
+    QList<quint64> ticks;
+    for (int i = 0; i < 12; ++i) {
+        // irregular spacing, not aligned to any buffer size
+        const quint64 tick = i * 600 + i * i * 7 + 1;
+        ticks << tick;
+        song.addMessage(tick, 1, MIDI_STATUS_NOTEON + MIDI_GM_STD_DRUM_CHANNEL, 76, 127);
+        song.addMessage(tick + 48, 1, MIDI_STATUS_NOTEOFF + MIDI_GM_STD_DRUM_CHANNEL, 76, 0);
+    }
+    song.finalize();
+
+    BackendManager man;
+    int tested = 0;
+    for (const Synth &synth : synths) {
+        MIDIOutput *output = man.outputBackendByName(synth.name);
+        if (output == nullptr) {
+            continue;
+        }
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QSettings settings(dir.filePath("onsets.ini"), QSettings::IniFormat);
+        settings.setValue(synth.name + "/Reverb", 0);
+        settings.setValue(synth.name + "/ReverbType", -1);
+        QMetaObject::invokeMethod(output, "readSettings", Qt::DirectConnection,
+                                  Q_ARG(QSettings*, &settings));
+        const QString fileName = dir.filePath("onsets.wav");
+        bool ok = false;
+        QMetaObject::invokeMethod(output, "renderSong", Qt::DirectConnection,
+                                  Q_RETURN_ARG(bool, ok),
+                                  Q_ARG(drumstick::rt::MIDISong, song),
+                                  Q_ARG(QString, fileName));
+        if (!ok) {
+            qDebug() << synth.name << "offline rendering is not available";
+            continue;
+        }
+
+        QFile wav(fileName);
+        QVERIFY(wav.open(QIODevice::ReadOnly));
+        const QByteArray header = wav.read(44);
+        const int channels = qFromLittleEndian<quint16>(header.constData() + 22);
+        const int rate = qFromLittleEndian<qint32>(header.constData() + 24);
+        const QByteArray data = wav.readAll();
+        const qint16 *samples = reinterpret_cast<const qint16 *>(data.constData());
+        const qint64 frames = data.size() / (2 * channels);
+        int peak = 0;
+        for (qint64 i = 0; i < frames * channels; ++i) {
+            peak = qMax(peak, qAbs(int(qFromLittleEndian(samples[i]))));
+        }
+        QVERIFY2(peak > 0, "The rendered audio is silent");
+
+        QList<qint64> onsets;
+        const qint64 refractory = rate * 3 / 10;
+        for (qint64 f = 0; f < frames; ++f) {
+            if (!onsets.isEmpty() && f - onsets.last() < refractory) {
+                continue;
+            }
+            for (int c = 0; c < channels; ++c) {
+                if (qAbs(int(qFromLittleEndian(samples[f * channels + c]))) > peak / 5) {
+                    onsets << f;
+                    break;
+                }
+            }
+        }
+        QCOMPARE(onsets.count(), ticks.count());
+        double offset = 0, maxError = 0;
+        for (int i = 0; i < onsets.count(); ++i) {
+            const double error = double(onsets[i]) / rate - song.tickToTime(ticks[i]) / 1e6;
+            if (i == 0) {
+                offset = error;
+            }
+            maxError = qMax(maxError, qAbs(error - offset));
+        }
+        qDebug() << synth.name << "maximum onset error:" << maxError * 1000 << "ms";
+        QVERIFY(maxError <= synth.tolerance);
+        tested++;
+    }
+    if (tested == 0) {
+        QSKIP("No synthesizer backend available for offline rendering");
+    }
+}
+
+/*
+ * Feeds the timestamped MIDI queue of a FluidSynth engine, and calls the
+ * audio callback directly, as the audio driver would. Each note is received
+ * at a different time during one period, and its onset must be rendered at
+ * the proportional frame of the next block, delayed at most by the internal
+ * 64 frames granularity of FluidSynth and the attack of the instrument.
+ */
+void RtTest::testFluidSynthQueue()
+{
+#if defined(FLUIDSYNTH_ENGINE)
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QSettings settings(dir.filePath("fluidsynth.ini"), QSettings::IniFormat);
+    settings.beginGroup(FluidSynthEngine::QSTR_PREFERENCES);
+    settings.setValue(FluidSynthEngine::QSTR_TIMESTAMPED, true);
+    settings.setValue(FluidSynthEngine::QSTR_CHORUS, 0);
+    settings.setValue(FluidSynthEngine::QSTR_REVERB, 0);
+    settings.endGroup();
+    FluidSynthEngine engine(nullptr, true);
+    engine.readSettings(&settings);
+    engine.initialize();
+    if (!engine.getStatus()) {
+        QSKIP("FluidSynth cannot be initialized without a soundfont");
+    }
+    // offline engines apply the messages at once, without a queue
+    engine.m_queueing = true;
+
+    const int len = 1024;
+    const qint64 period = 20000; // microseconds
+    QVector<float> left(len), right(len);
+    float *out[2] = { left.data(), right.data() };
+    for (int trial = 0; trial < 6; ++trial) {
+        engine.panic();
+        QCOMPARE(engine.processAudio(len, 0, nullptr, 2, out), int(FLUID_OK));
+        const qint64 blockStart = engine.m_lastCallback;
+        std::this_thread::sleep_for(std::chrono::microseconds(2000 + trial * 3000));
+        const qint64 before = MIDIRing::now();
+        engine.noteOn(MIDI_GM_STD_DRUM_CHANNEL, 76, 127);
+        const qint64 after = MIDIRing::now();
+        std::this_thread::sleep_for(std::chrono::microseconds(qMax(qint64(0), blockStart + period - after)));
+        QCOMPARE(engine.processAudio(len, 0, nullptr, 2, out), int(FLUID_OK));
+        MIDIRing::Header h;
+        QVERIFY2(!engine.m_queue.peek(h), "The message was not applied");
+
+        const qint64 span = engine.m_lastCallback - blockStart;
+        QVERIFY(span > 0);
+        const qint64 first = (before - blockStart) * len / span;
+        const qint64 last = (after - blockStart) * len / span;
+        int onset = -1;
+        for (int f = 0; f < len && onset < 0; ++f) {
+            if (qAbs(left[f]) > 1e-4f || qAbs(right[f]) > 1e-4f) {
+                onset = f;
+            }
+        }
+        qDebug() << "FluidSynth onset:" << onset << "expected:" << first << "to" << last;
+        QVERIFY2(onset >= 0, "The rendered block is silent");
+        QVERIFY(onset >= first);
+        QVERIFY(onset <= last + 128);
+    }
+#else
+    QSKIP("FluidSynth is not available");
+#endif
+}
+
+/*
+ * Feeds the MIDI queue of a Sonivox EAS renderer, and drains it with the
+ * clock of the blocks, as the rendering loop does with timestamped MIDI.
+ * A message is applied at the block nearest to its reception time plus the
+ * buffer time, and it is late when that block was already rendered.
+ */
+void RtTest::testEASQueue()
+{
+#if defined(EAS_RENDERER)
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QSettings settings(dir.filePath("eas.ini"), QSettings::IniFormat);
+    settings.beginGroup(SynthRenderer::QSTR_PREFERENCES);
+    settings.setValue(SynthRenderer::QSTR_BUFFERTIME, 60);
+    settings.setValue(SynthRenderer::QSTR_TIMESTAMPED, true);
+    settings.endGroup();
+    SynthRenderer renderer;
+    renderer.initialize(&settings);
+    if (!renderer.getStatus()) {
+        QSKIP("Sonivox EAS cannot be initialized");
+    }
+    const qint64 latency = 60000;
+    const qint64 period = renderer.m_period;
+    QVERIFY(period > 0 && period < 20000);
+
+    const qint64 t0 = MIDIRing::now();
+    renderer.sendMessage(MIDI_STATUS_NOTEON + MIDI_GM_STD_DRUM_CHANNEL, 76, 127);
+    const qint64 t1 = MIDIRing::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    const qint64 t2 = MIDIRing::now();
+    renderer.sendMessage(MIDI_STATUS_NOTEOFF + MIDI_GM_STD_DRUM_CHANNEL, 76, 0);
+    QCOMPARE(renderer.getQueueDepth(), 2);
+
+    // a block heard before the first message is due
+    renderer.processQueue(t0 + latency - period);
+    QCOMPARE(renderer.getQueueDepth(), 2);
+    // the block nearest to the first message, long before the second one
+    renderer.processQueue(t1 + latency);
+    QCOMPARE(renderer.getQueueDepth(), 1);
+    QCOMPARE(renderer.getLateMessages(), 0ull);
+    // a block heard long after the second message was due
+    renderer.processQueue(t2 + latency + 10 * period);
+    QCOMPARE(renderer.getQueueDepth(), 0);
+    QCOMPARE(renderer.getLateMessages(), 1ull);
+    QCOMPARE(renderer.getOverruns(), 0ull);
+#else
+    QSKIP("Sonivox EAS is not available");
+#endif
+}
+
+/*
+ * Acquires the same file twice, then replaces it with a new version, as an
+ * installer would, while the old one is still in use.
+ */
+void RtTest::testSoundFontCache()
+{
+#if defined(FLUIDSYNTH_ENGINE)
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("cache.sf2");
+    const QByteArray oldData(4096, 'a');
+    const QByteArray newData(8192, 'b');
+    QSaveFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(oldData);
+    QVERIFY(file.commit());
+
+    SoundFontCache *cache = SoundFontCache::instance();
+    const int initial = cache->count();
+    SoundFontCache::SoundFont *first = cache->acquire(fileName);
+    SoundFontCache::SoundFont *second = cache->acquire(fileName);
+    QVERIFY(first != nullptr);
+    QCOMPARE(second, first);
+    QCOMPARE(first->refs, 2);
+    QCOMPARE(cache->count(), initial + 1);
+    QCOMPARE(QByteArray(first->data, int(first->size)), oldData);
+
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(newData);
+    QVERIFY(file.commit());
+    SoundFontCache::SoundFont *modified = cache->acquire(fileName);
+    QVERIFY(modified != nullptr);
+    QVERIFY(modified != first);
+    QCOMPARE(cache->count(), initial + 1);
+    QCOMPARE(QByteArray(modified->data, int(modified->size)), newData);
+    QCOMPARE(QByteArray(first->data, int(first->size)), oldData);
+
+    cache->release(first);
+    cache->release(second);
+    QCOMPARE(cache->count(), initial + 1);
+    cache->release(modified);
+    QCOMPARE(cache->count(), initial);
+    QCOMPARE(cache->acquire(dir.filePath("missing.sf2")), static_cast<SoundFontCache::SoundFont*>(nullptr));
+#else
+    QSKIP("FluidSynth is not available");
+#endif
+}
+
 QString RtTest::joinConns(QList<MIDIConnection> conns)
 {
     QString res;
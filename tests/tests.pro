@@ -8,5 +8,6 @@ SUBDIRS += fileTest1 \
 linux {
     SUBDIRS += \
         alsaTest1 \
-        alsaTest2
+        alsaTest2 \
+        guiplayerTest
 }
@@ -22,7 +22,11 @@
 #include <QObject>
 #include <QString>
 #include <QtTest>
+#include <thread>
+#include <drumstick/activitymeter.h>
+#include <drumstick/pianokeybd.h>
 #include <drumstick/pianopalette.h>
+#include <drumstick/pianoroll.h>
 
 using namespace drumstick::widgets;
 
@@ -44,6 +48,12 @@ private Q_SLOTS:
     void testPaletteUnchanged();
     void testPaletteChanged();
 
+    void testBatchedDisplay();
+    void benchmarkChordTrill();
+    void testPostNotes();
+    void testPianoRollRange();
+    void testActivityMeter();
+
 private:
     QList<PianoPalette> m_paletteList {
         PianoPalette(PAL_SINGLE),
@@ -160,6 +170,111 @@ void WidgetsTest::testPaletteChanged()
     QCOMPARE(p, m_paletteList[PAL_KEYS]);
 }
 
+void WidgetsTest::testBatchedDisplay()
+{
+    PianoKeybd kbd;
+    QSignalSpy spy(&kbd, &PianoKeybd::signalName);
+    kbd.setBatchedDisplay(true);
+    QVERIFY(kbd.isBatchedDisplay());
+    kbd.showNoteOn(60, 100);
+    kbd.showNoteOn(64, 100);
+    kbd.showNoteOn(67, QColor(Qt::red), 100);
+    QCOMPARE(spy.count(), 0);
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.last().at(0).toString(), QStringLiteral("#67 (G4)"));
+    kbd.showNoteOff(60);
+    kbd.showNoteOff(64);
+    kbd.showNoteOff(67);
+    QTRY_COMPARE(spy.count(), 2);
+    QVERIFY(spy.last().at(0).toString().isEmpty());
+    kbd.setBatchedDisplay(false);
+    kbd.showNoteOn(60, 100);
+    QCOMPARE(spy.count(), 3);
+}
+
+void WidgetsTest::benchmarkChordTrill()
+{
+    const int chord[] = { 48, 52, 55, 59, 62, 64, 67, 71, 74, 76 };
+    PianoKeybd kbd;
+    kbd.resize(1600, 200);
+    kbd.show();
+    QPixmap frame(kbd.size() * 2);
+    frame.setDevicePixelRatio(2.0);
+    bool on = false;
+    QBENCHMARK {
+        on = !on;
+        for (int note : chord) {
+            if (on) {
+                kbd.showNoteOn(note, 100);
+            } else {
+                kbd.showNoteOff(note);
+            }
+        }
+        kbd.render(&frame);
+    }
+}
+
+void WidgetsTest::testPostNotes()
+{
+    PianoKeybd kbd;
+    QSignalSpy spy(&kbd, &PianoKeybd::signalName);
+    std::thread feeder([&kbd]{
+        for (int i = 0; i < 1000; ++i) {
+            kbd.postNoteOn(60 + i % 12, 100);
+            kbd.postNoteOff(60 + i % 12);
+        }
+        kbd.postNoteOn(72, 100);
+    });
+    feeder.join();
+    QTRY_VERIFY(spy.count() > 0);
+    QCOMPARE(spy.last().at(0).toString(), QStringLiteral("#72 (C5)"));
+    QVERIFY(spy.count() < 1000);
+}
+
+void WidgetsTest::testPianoRollRange()
+{
+    PianoRoll roll;
+    roll.addNote(480, 120, 64, 100);
+    roll.addNote(0, 1920, 48, 80);   // long note, sounding across the ranges
+    roll.addNote(240, 120, 62, 100);
+    roll.addNote(960, 0, 67, 100);   // zero length
+    roll.finalize();
+    QCOMPARE(roll.count(), 4);
+    QCOMPARE(roll.length(), quint64(1920));
+    QCOMPARE(roll.noteAt(0).note, quint8(48));
+    QCOMPARE(roll.noteAt(1).tick, quint64(240));
+    QVector<int> hits;
+    roll.notesInRange(360, 480, hits);
+    QCOMPARE(hits, QVector<int>({0}));
+    roll.notesInRange(300, 481, hits);
+    QCOMPARE(hits, QVector<int>({0, 1, 2}));
+    roll.notesInRange(960, 961, hits);
+    QCOMPARE(hits, QVector<int>({0, 3}));
+    roll.notesInRange(1920, 4000, hits);
+    QVERIFY(hits.isEmpty());
+}
+
+void WidgetsTest::testActivityMeter()
+{
+    ActivityMeter meter;
+    meter.resize(meter.sizeHint());
+    std::thread feeder([&meter]{
+        for (int i = 0; i < 10000; ++i) {
+            meter.countMessage(0x92, 60, 1 + i % 100);
+            meter.countMessage(0x82, 60, 0);
+            meter.countMessage(0xb5, 7, 100);
+            meter.countMessage(0xf8);
+        }
+    });
+    feeder.join();
+    QCOMPARE(meter.totalNotes(), quint64(10000));
+    QCOMPARE(meter.totalControllers(), quint64(10000));
+    QImage frame = meter.grab().toImage();
+    QVERIFY(!frame.isNull());
+    meter.reset();
+    QCOMPARE(meter.totalNotes(), quint64(0));
+}
+
 QTEST_MAIN(WidgetsTest)
 
 #include "widgetstest.moc"
@@ -16,6 +16,7 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <QActionGroup>
 #include <QApplication>
 #include <QCloseEvent>
 #include <QDebug>
@@ -24,11 +25,13 @@
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QInputDialog>
+#include <QMenuBar>
 #include <QMessageBox>
 #include <QMimeData>
 #include <QSettings>
 #include <QStatusBar>
-#include <QTextCodec>
+#include <QThread>
+#include <QTimer>
 #include <QToolTip>
 #include <QUrl>
 #include <qmath.h>
@@ -38,22 +41,22 @@
 #include "player.h"
 #include "playerabout.h"
 #include "song.h"
+#include "songloader.h"
 #include "ui_guiplayer.h"
 #include <drumstick/alsaclient.h>
 #include <drumstick/alsaevent.h>
 #include <drumstick/alsaport.h>
 #include <drumstick/alsaqueue.h>
-#include <drumstick/qsmf.h>
-#include <drumstick/qwrk.h>
-#include <drumstick/rmid.h>
 #include <drumstick/sequencererror.h>
+#if defined(PIANOROLL)
+#include <drumstick/pianoroll.h>
+#endif
 
 DISABLE_WARNING_PUSH
 DISABLE_WARNING_DEPRECATED_DECLARATIONS
 
 using namespace drumstick;
 using namespace ALSA;
-using namespace File;
 
 const QString GUIPlayer::QSTR_DOMAIN = QStringLiteral("drumstick.sourceforge.net");
 const QString GUIPlayer::QSTR_APPNAME = QStringLiteral("drumstick-guiplayer");
@@ -63,19 +66,21 @@ GUIPlayer::GUIPlayer(QWidget *parent, Qt::WindowFlags flags)
     m_portId(-1),
     m_queueId(-1),
     m_initialTempo(0),
-    m_currentTrack(0),
+    m_loadRequest(0),
     m_tempoFactor(1.0),
     m_tick(0),
     m_state(InvalidState),
-    m_smf(nullptr),
-    m_wrk(nullptr),
     m_Client(nullptr),
     m_Port(nullptr),
     m_Queue(nullptr),
     m_player(nullptr),
     m_ui(new Ui::GUIPlayerClass),
     m_pd(nullptr),
-    m_song(new Song)
+    m_song(new Song),
+    m_loader(nullptr),
+    m_loaderThread(nullptr),
+    m_roll(nullptr),
+    m_rollTimer(nullptr)
 {
     m_ui->setupUi(this);
     setAcceptDrops(true);
@@ -126,63 +131,33 @@ GUIPlayer::GUIPlayer(QWidget *parent, Qt::WindowFlags flags)
     m_queueId = m_Queue->getId();
     m_portId = m_Port->getPortId();
 
-    m_rmi = new Rmidi(this);
-    connect(m_rmi, &Rmidi::signalRiffData, this, &GUIPlayer::dataHandler);
-
-    m_smf = new QSmf(this);
-    connect(m_smf, &QSmf::signalSMFHeader, this, &GUIPlayer::smfHeaderEvent);
-    connect(m_smf, &QSmf::signalSMFNoteOn, this, &GUIPlayer::smfNoteOnEvent);
-    connect(m_smf, &QSmf::signalSMFNoteOff, this, &GUIPlayer::smfNoteOffEvent);
-    connect(m_smf, &QSmf::signalSMFKeyPress, this, &GUIPlayer::smfKeyPressEvent);
-    connect(m_smf, &QSmf::signalSMFCtlChange, this, &GUIPlayer::smfCtlChangeEvent);
-    connect(m_smf, &QSmf::signalSMFPitchBend, this, &GUIPlayer::smfPitchBendEvent);
-    connect(m_smf, &QSmf::signalSMFProgram, this, &GUIPlayer::smfProgramEvent);
-    connect(m_smf, &QSmf::signalSMFChanPress, this, &GUIPlayer::smfChanPressEvent);
-    connect(m_smf, &QSmf::signalSMFSysex, this, &GUIPlayer::smfSysexEvent);
-    connect(m_smf, &QSmf::signalSMFText, this, &GUIPlayer::smfUpdateLoadProgress);
-    connect(m_smf, &QSmf::signalSMFTempo, this, &GUIPlayer::smfTempoEvent);
-    connect(m_smf, &QSmf::signalSMFTrackStart, this, &GUIPlayer::smfUpdateLoadProgress);
-    connect(m_smf, &QSmf::signalSMFTrackStart, this, &GUIPlayer::smfTrackStarted);
-    connect(m_smf, &QSmf::signalSMFTrackEnd, this, &GUIPlayer::smfTrackEnded);
-    connect(m_smf, &QSmf::signalSMFendOfTrack, this, &GUIPlayer::smfUpdateLoadProgress);
-    connect(m_smf, &QSmf::signalSMFError, this, &GUIPlayer::smfErrorHandler);
-
-    m_wrk = new QWrk(this);
-    m_wrk->setTextCodec(QTextCodec::codecForLocale());
-    connect(m_wrk, &QWrk::signalWRKError, this, &GUIPlayer::wrkErrorHandler);
-    connect(m_wrk, &QWrk::signalWRKUnknownChunk, this, &GUIPlayer::wrkUpdateLoadProgress);
-    connect(m_wrk, &QWrk::signalWRKHeader, this, &GUIPlayer::wrkFileHeader);
-    connect(m_wrk, &QWrk::signalWRKEnd, this, &GUIPlayer::wrkEndOfFile);
-    connect(m_wrk, &QWrk::signalWRKStreamEnd, this, &GUIPlayer::wrkStreamEndEvent);
-    connect(m_wrk, &QWrk::signalWRKGlobalVars, this, &GUIPlayer::wrkUpdateLoadProgress);
-    connect(m_wrk, &QWrk::signalWRKTrack, this, &GUIPlayer::wrkTrackHeader);
-    connect(m_wrk, &QWrk::signalWRKTimeBase, this, &GUIPlayer::wrkTimeBase);
-    connect(m_wrk, &QWrk::signalWRKNote, this, &GUIPlayer::wrkNoteEvent);
-    connect(m_wrk, &QWrk::signalWRKKeyPress, this, &GUIPlayer::wrkKeyPressEvent);
-    connect(m_wrk, &QWrk::signalWRKCtlChange, this, &GUIPlayer::wrkCtlChangeEvent);
-    connect(m_wrk, &QWrk::signalWRKPitchBend, this, &GUIPlayer::wrkPitchBendEvent);
-    connect(m_wrk, &QWrk::signalWRKProgram, this, &GUIPlayer::wrkProgramEvent);
-    connect(m_wrk, &QWrk::signalWRKChanPress, this, &GUIPlayer::wrkChanPressEvent);
-    connect(m_wrk, &QWrk::signalWRKSysexEvent, this, &GUIPlayer::wrkSysexEvent);
-    connect(m_wrk, &QWrk::signalWRKSysex, this, &GUIPlayer::wrkSysexEventBank);
-    connect(m_wrk, &QWrk::signalWRKText, this, &GUIPlayer::wrkUpdateLoadProgress);
-    connect(m_wrk, &QWrk::signalWRKTimeSig, this, &GUIPlayer::wrkUpdateLoadProgress);
-    connect(m_wrk, &QWrk::signalWRKKeySig, this, &GUIPlayer::wrkUpdateLoadProgress);
-    connect(m_wrk, &QWrk::signalWRKTempo, this, &GUIPlayer::wrkTempoEvent);
-    connect(m_wrk, &QWrk::signalWRKTrackPatch, this, &GUIPlayer::wrkTrackPatch);
-    connect(m_wrk, &QWrk::signalWRKComments, this, &GUIPlayer::wrkUpdateLoadProgress);
-    connect(m_wrk, &QWrk::signalWRKVariableRecord, this, &GUIPlayer::wrkUpdateLoadProgress);
-    connect(m_wrk, &QWrk::signalWRKNewTrack, this, &GUIPlayer::wrkNewTrackHeader);
-    connect(m_wrk, &QWrk::signalWRKTrackName, this, &GUIPlayer::wrkUpdateLoadProgress);
-    connect(m_wrk, &QWrk::signalWRKTrackVol, this, &GUIPlayer::wrkTrackVol);
-    connect(m_wrk, &QWrk::signalWRKTrackBank, this, &GUIPlayer::wrkTrackBank);
-    connect(m_wrk, &QWrk::signalWRKSegment, this, &GUIPlayer::wrkUpdateLoadProgress);
-    connect(m_wrk, &QWrk::signalWRKChord, this, &GUIPlayer::wrkUpdateLoadProgress);
-    connect(m_wrk, &QWrk::signalWRKExpression, this, &GUIPlayer::wrkUpdateLoadProgress);
+    qRegisterMetaType<Song*>();
+    m_loaderThread = new QThread(this);
+    m_loader = new SongLoader(m_portId, m_queueId);
+    m_loader->moveToThread(m_loaderThread);
+    connect(m_loaderThread, &QThread::finished, m_loader, &QObject::deleteLater);
+    connect(m_loader, &SongLoader::loadProgress, this, &GUIPlayer::songLoadProgress);
+    connect(m_loader, &SongLoader::loadFinished, this, &GUIPlayer::songLoaded);
+    m_loaderThread->start(QThread::LowPriority);
 
     m_player = new Player(m_Client, m_portId);
     connect(m_player, &Player::playbackStopped, this, &GUIPlayer::playerStopped, Qt::QueuedConnection);
 
+#if defined(PIANOROLL)
+    m_roll = new drumstick::widgets::PianoRoll(this);
+    m_roll->setMinimumHeight(m_roll->sizeHint().height());
+    m_ui->gridLayout_2->addWidget(m_roll, 5, 0, 1, 3);
+    m_rollTimer = new QTimer(this);
+    m_rollTimer->setTimerType(Qt::PreciseTimer);
+    m_rollTimer->setInterval(30);
+    connect(m_rollTimer, &QTimer::timeout, this, [this]{
+        m_roll->setPosition(m_Queue->getStatus().getTickTime());
+    });
+    connect(m_roll, &drumstick::widgets::PianoRoll::positionRequested, this, &GUIPlayer::seek);
+#endif
+
+    createChannelsMenu();
+
     m_Client->setRealTimeInput(false);
     m_Client->startSequencerInput();
     tempoReset();
@@ -197,6 +172,9 @@ GUIPlayer::~GUIPlayer()
     m_Port->unsubscribeAll();
     m_Port->detach();
     m_Client->close();
+    m_loader->cancel();
+    m_loaderThread->quit();
+    m_loaderThread->wait();
     delete m_player;
     delete m_ui;
     delete m_song;
@@ -242,6 +220,9 @@ void GUIPlayer::updateState(PlayerState newState)
         m_ui->actionPause->setEnabled(true);
         m_ui->actionStop->setEnabled(true);
         statusBar()->showMessage("Playing");
+        if (m_rollTimer != nullptr) {
+            m_rollTimer->start();
+        }
         break;
     case PausedState:
         m_ui->actionPlay->setEnabled(false);
@@ -259,21 +240,28 @@ void GUIPlayer::updateState(PlayerState newState)
         statusBar()->showMessage("Not initialized");
         break;
     }
+    if (m_rollTimer != nullptr && newState != PlayingState) {
+        m_rollTimer->stop();
+        if (newState != PausedState) {
+            m_roll->setPosition(0);
+        }
+    }
     m_state = newState;
 }
 
 void GUIPlayer::play()
 {
     if (!m_song->isEmpty()) {
+        if (m_initialTempo == 0)
+            return;
+        // after a seek, the player sends the song tempo at that position
+        QueueTempo firstTempo = m_Queue->getTempo();
+        firstTempo.setPPQ(m_song->getDivision());
+        firstTempo.setTempo(m_initialTempo);
+        firstTempo.setTempoFactor(m_tempoFactor);
+        m_Queue->setTempo(firstTempo);
+        m_Client->drainOutput();
         if (m_player->getInitialPosition() == 0) {
-            if (m_initialTempo == 0)
-                return;
-            QueueTempo firstTempo = m_Queue->getTempo();
-            firstTempo.setPPQ(m_song->getDivision());
-            firstTempo.setTempo(m_initialTempo);
-            firstTempo.setTempoFactor(m_tempoFactor);
-            m_Queue->setTempo(firstTempo);
-            m_Client->drainOutput();
             m_player->sendVolumeEvents();
         }
         m_player->start();
@@ -307,19 +295,42 @@ void GUIPlayer::stop()
         updateState(StoppedState);
 }
 
-void GUIPlayer::progressDialogInit(const QString& type, int max)
+void GUIPlayer::seek(quint64 tick)
 {
-    m_pd = new QProgressDialog("", "", 0, max, this);
+    if (m_song->isEmpty() || m_state == InvalidState) {
+        return;
+    }
+    bool playing = m_player->isRunning();
+    if (playing) {
+        m_Queue->stop();
+        m_Queue->clear();
+        m_player->stop();
+    }
+    m_player->setPosition(tick);
+    if (m_roll != nullptr) {
+        m_roll->setPosition(tick);
+    }
+    if (playing) {
+        m_player->start();
+    }
+}
+
+void GUIPlayer::progressDialogInit(const QString& type)
+{
+    progressDialogClose();
+    m_pd = new QProgressDialog("", "Cancel", 0, 100, this);
     m_pd->setWindowTitle(QString("Loading %1 file...").arg(type));
+    m_pd->setAutoClose(false);
+    m_pd->setAutoReset(false);
     m_pd->setMinimumDuration(1000);
     m_pd->setValue(0);
+    connect(m_pd, &QProgressDialog::canceled, this, &GUIPlayer::cancelLoading);
 }
 
 void GUIPlayer::progressDialogUpdate(int pos)
 {
     if (m_pd != nullptr) {
         m_pd->setValue(pos);
-        qApp->processEvents();
     }
 }
 
@@ -332,57 +343,100 @@ void GUIPlayer::openFile(const QString& fileName)
 {
     QFileInfo finfo(fileName);
     if (finfo.exists()) {
-        m_song->clear();
-        m_loadingMessages.clear();
-        m_tick = 0;
-        m_initialTempo = 0;
-        m_currentTrack = 0;
-        try {
-            QString ext = finfo.suffix().toLower();
-            if (ext == "wrk") {
-                progressDialogInit("Cakewalk", finfo.size());
-                m_wrk->readFromFile(fileName);
-            }
-            else if (ext == "mid" || ext == "midi" || ext == "kar") {
-                progressDialogInit("MIDI", finfo.size());
-                m_smf->readFromFile(fileName);
-            }
-            else if (ext == "rmi") {
-                progressDialogInit("RIFF MIDI", finfo.size());
-                m_rmi->readFromFile(fileName);
-            }
-            progressDialogUpdate(finfo.size());
-            if (m_song->isEmpty()) {
-                m_ui->lblName->clear();
-            } else {
-                m_song->sort();
-                m_player->setSong(m_song);
-                m_ui->lblName->setText(finfo.fileName());
-                m_lastDirectory = finfo.absolutePath();
-            }
-        } catch (...) {
-            m_song->clear();
-            m_ui->lblName->clear();
+        QString ext = finfo.suffix().toLower();
+        if (ext == "wrk") {
+            progressDialogInit("Cakewalk");
         }
-        progressDialogClose();
-        if (m_initialTempo == 0) {
-            m_initialTempo = 500000;
+        else if (ext == "mid" || ext == "midi" || ext == "kar") {
+            progressDialogInit("MIDI");
         }
-        updateTimeLabel(0,0,0);
-        updateTempoLabel(6.0e7f / m_initialTempo);
-        m_ui->progressBar->setValue(0);
-        if (!m_loadingMessages.isEmpty()) {
-            m_loadingMessages.insert(0,
-                "Warning, this file may be non-standard or damaged.<br>");
-            QMessageBox::warning(this, QSTR_APPNAME, m_loadingMessages);
+        else if (ext == "rmi") {
+            progressDialogInit("RIFF MIDI");
         }
-        if (m_song->isEmpty())
-            updateState(EmptyState);
-        else
-            updateState(StoppedState);
+        // the current song keeps playing until the new one is loaded
+        m_loadRequest = m_loader->request(finfo.absoluteFilePath());
     }
 }
 
+void GUIPlayer::cancelLoading()
+{
+    m_loader->cancel();
+    m_loadRequest = 0;
+    progressDialogClose();
+}
+
+void GUIPlayer::songLoadProgress(int request, int percent)
+{
+    if (request == m_loadRequest) {
+        progressDialogUpdate(percent);
+    }
+}
+
+void GUIPlayer::songLoaded(int request, Song* song, const QString& messages)
+{
+    if (request != m_loadRequest) {
+        delete song; // canceled, or superseded by a newer request
+        return;
+    }
+    m_loadRequest = 0;
+    progressDialogClose();
+    stop();
+    Song* previous = m_song;
+    m_song = song;
+    m_player->setSong(m_song);
+    delete previous;
+    m_tick = m_song->getLastTick();
+    m_initialTempo = m_song->getInitialTempo();
+    fillPianoRoll();
+    if (m_song->isEmpty()) {
+        m_ui->lblName->clear();
+    } else {
+        QFileInfo finfo(m_song->getFileName());
+        m_ui->lblName->setText(finfo.fileName());
+        m_lastDirectory = finfo.absolutePath();
+    }
+    updateTimeLabel(0,0,0);
+    updateTempoLabel(6.0e7f / m_initialTempo);
+    m_ui->progressBar->setValue(0);
+    if (!messages.isEmpty()) {
+        QMessageBox::warning(this, QSTR_APPNAME,
+            "Warning, this file may be non-standard or damaged.<br>" + messages);
+    }
+    if (m_song->isEmpty())
+        updateState(EmptyState);
+    else
+        updateState(StoppedState);
+}
+
+void GUIPlayer::fillPianoRoll()
+{
+#if defined(PIANOROLL)
+    m_roll->clear();
+    m_roll->setDivision(m_song->getDivision());
+    SongIterator it(*m_song);
+    while (it.hasNext()) {
+        SequencerEvent* ev = it.next();
+        auto kev = static_cast<KeyEvent*>(ev);
+        const unsigned long tick = ev->getTick();
+        switch (ev->getSequencerType()) {
+        case SND_SEQ_EVENT_NOTE:
+            m_roll->addNote(tick, static_cast<NoteEvent*>(ev)->getDuration(),
+                            kev->getKey(), kev->getVelocity(), kev->getChannel());
+            break;
+        case SND_SEQ_EVENT_NOTEON:
+            // the song notes are already paired: this one has no note-off
+            if (kev->getVelocity() > 0) {
+                m_roll->addNote(tick, m_tick - tick, kev->getKey(), kev->getVelocity(), kev->getChannel());
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    m_roll->finalize();
+#endif
+}
+
 void GUIPlayer::open()
 {
     QString fileName = QFileDialog::getOpenFileName(this,
@@ -393,7 +447,6 @@ void GUIPlayer::open()
           "RIFF MIDI Files (*.rmi);;"
           "Cakewalk files (*.wrk)" );
     if (! fileName.isEmpty() ) {
-        stop();
         openFile(fileName);
     }
 }
@@ -465,19 +518,78 @@ void GUIPlayer::sequencerEvent(SequencerEvent *ev)
     delete ev;
 }
 
-void GUIPlayer::dataHandler(const QString &dataType, const QByteArray &data)
-{
-    if (dataType == "RMID") {
-        QDataStream ds(data);
-        m_smf->readFromStream(&ds);
-    }
-}
-
 void GUIPlayer::pitchShift(int value)
 {
     m_player->setPitchShift(value);
 }
 
+/*
+ * The menu of the transform stage parameters: velocity scaling, and muting
+ * and remapping the song channels
+ */
+void GUIPlayer::createChannelsMenu()
+{
+    QMenu* menu = new QMenu(tr("Channels"), this);
+    menuBar()->insertMenu(m_ui->menuHelp->menuAction(), menu);
+    QAction* velocity = menu->addAction(tr("Velocity Scale..."));
+    connect(velocity, &QAction::triggered, this, [this] {
+        bool ok = false;
+        int value = QInputDialog::getInt(this, tr("Velocity Scale"), tr("Note velocity (%):"),
+                                         static_cast<int>(m_player->getVelocityFactor()),
+                                         10, 200, 10, &ok);
+        if (ok) {
+            m_player->setVelocityFactor(value);
+        }
+    });
+    QMenu* muteMenu = menu->addMenu(tr("Mute"));
+    QMenu* remapMenu = menu->addMenu(tr("Remap"));
+    QList<QAction*> muteActions;
+    QList<QAction*> identityActions;
+    for (int chan = 0; chan < MIDI_CHANNELS; ++chan) {
+        QAction* mute = muteMenu->addAction(tr("Channel %1").arg(chan + 1));
+        mute->setCheckable(true);
+        connect(mute, &QAction::toggled, this, [this, chan](bool checked) {
+            m_player->setChannelMuted(chan, checked);
+        });
+        muteActions << mute;
+        QMenu* targetMenu = remapMenu->addMenu(tr("Channel %1").arg(chan + 1));
+        QActionGroup* group = new QActionGroup(targetMenu);
+        for (int out = 0; out < MIDI_CHANNELS; ++out) {
+            QAction* target = targetMenu->addAction(tr("To Channel %1").arg(out + 1));
+            target->setCheckable(true);
+            target->setChecked(out == chan);
+            group->addAction(target);
+            connect(target, &QAction::triggered, this, [this, chan, out] {
+                m_player->setChannelMap(chan, out);
+                // the channel state is sent again to the new output channel
+                if (m_player->isRunning()) {
+                    seek(m_Queue->getStatus().getTickTime());
+                }
+            });
+            if (out == chan) {
+                identityActions << target;
+            }
+        }
+    }
+    menu->addSeparator();
+    QAction* reset = menu->addAction(tr("Reset"));
+    connect(reset, &QAction::triggered, this, [this, muteActions, identityActions] {
+        m_player->setVelocityFactor(100);
+        bool remapped = false;
+        for (int chan = 0; chan < MIDI_CHANNELS; ++chan) {
+            muteActions[chan]->setChecked(false);
+            if (!identityActions[chan]->isChecked()) {
+                identityActions[chan]->setChecked(true);
+                m_player->setChannelMap(chan, chan);
+                remapped = true;
+            }
+        }
+        if (remapped && m_player->isRunning()) {
+            seek(m_Queue->getStatus().getTickTime());
+        }
+    });
+}
+
 void GUIPlayer::tempoReset()
 {
     m_ui->sliderTempo->setValue(100);
@@ -532,7 +644,6 @@ void GUIPlayer::dropEvent( QDropEvent * event )
                  fileName.endsWith(".kar", Qt::CaseInsensitive) ||
                  fileName.endsWith(".rmi", Qt::CaseInsensitive) ||
                  fileName.endsWith(".wrk", Qt::CaseInsensitive) ) {
-                stop();
                 event->accept();
                 openFile(fileName);
             } else {
@@ -590,333 +701,4 @@ void GUIPlayer::about()
     aboutDlg.exec();
 }
 
-/* **************************************** *
- * SMF (Standard MIDI file) format handling
- * **************************************** */
-
-void GUIPlayer::smfUpdateLoadProgress()
-{
-    progressDialogUpdate(m_smf->getFilePos());
-}
-
-void GUIPlayer::appendSMFEvent(SequencerEvent* ev)
-{
-    unsigned long tick = m_smf->getCurrentTime();
-    ev->setSource(m_portId);
-    if (ev->getSequencerType() != SND_SEQ_EVENT_TEMPO) {
-        ev->setSubscribers();
-    }
-    ev->scheduleTick(m_queueId, tick, false);
-    m_song->append(ev);
-    if (tick > m_tick)
-        m_tick = tick;
-    smfUpdateLoadProgress();
-}
-
-void GUIPlayer::smfHeaderEvent(int format, int ntrks, int division)
-{
-    m_song->setHeader(format, ntrks, division);
-    smfUpdateLoadProgress();
-}
-
-void GUIPlayer::smfNoteOnEvent(int chan, int pitch, int vol)
-{
-    SequencerEvent* ev = new NoteOnEvent (chan, pitch, vol);
-    appendSMFEvent(ev);
-}
-
-void GUIPlayer::smfNoteOffEvent(int chan, int pitch, int vol)
-{
-    SequencerEvent* ev = new NoteOffEvent (chan, pitch, vol);
-    appendSMFEvent(ev);
-}
-
-void GUIPlayer::smfKeyPressEvent(int chan, int pitch, int press)
-{
-    SequencerEvent* ev = new KeyPressEvent (chan, pitch, press);
-    appendSMFEvent(ev);
-}
-
-void GUIPlayer::smfCtlChangeEvent(int chan, int ctl, int value)
-{
-    SequencerEvent* ev = new ControllerEvent (chan, ctl, value);
-    appendSMFEvent(ev);
-}
-
-void GUIPlayer::smfPitchBendEvent(int chan, int value)
-{
-    SequencerEvent* ev = new PitchBendEvent (chan, value);
-    appendSMFEvent(ev);
-}
-
-void GUIPlayer::smfProgramEvent(int chan, int patch)
-{
-    SequencerEvent* ev = new ProgramChangeEvent (chan, patch);
-    appendSMFEvent(ev);
-}
-
-void GUIPlayer::smfChanPressEvent(int chan, int press)
-{
-    SequencerEvent* ev = new ChanPressEvent (chan, press);
-    appendSMFEvent(ev);
-}
-
-void GUIPlayer::smfSysexEvent(const QByteArray& data)
-{
-    SequencerEvent* ev = new SysExEvent (data);
-    appendSMFEvent(ev);
-}
-
-void GUIPlayer::smfTempoEvent(int tempo)
-{
-    if ( m_initialTempo == 0 ) {
-        m_initialTempo = tempo;
-    }
-    SequencerEvent* ev = new TempoEvent (m_queueId, tempo);
-    appendSMFEvent(ev);
-}
-
-void GUIPlayer::smfErrorHandler(const QString& errorStr)
-{
-    if (m_loadingMessages.length() < 1024)
-        m_loadingMessages.append(QString("%1 at file offset %2<br>")
-                                 .arg(errorStr).arg(m_smf->getFilePos()));
-}
-
-void GUIPlayer::smfTrackStarted()
-{
-    m_currentTrack++;
-}
-
-void GUIPlayer::smfTrackEnded()
-{
-    if (m_currentTrack == m_smf->getTracks()) {
-        SequencerEvent* ev = new SystemEvent(SND_SEQ_EVENT_ECHO);
-        appendSMFEvent(ev);
-    }
-}
-
-/* ********************************* *
- * Cakewalk WRK file format handling
- * ********************************* */
-
-void GUIPlayer::wrkUpdateLoadProgress()
-{
-    if (m_pd != nullptr) {
-        progressDialogUpdate(m_wrk->getFilePos());
-    }
-}
-
-void
-GUIPlayer::appendWRKEvent(unsigned long ticks, SequencerEvent* ev)
-{
-    ev->setSource(m_portId);
-    if (ev->getSequencerType() != SND_SEQ_EVENT_TEMPO) {
-        ev->setSubscribers();
-    }
-    ev->scheduleTick(m_queueId, ticks, false);
-    m_song->append(ev);
-    if (ticks > m_tick)
-        m_tick = ticks;
-    wrkUpdateLoadProgress();
-}
-
-void GUIPlayer::wrkErrorHandler(const QString& errorStr)
-{
-    if (m_loadingMessages.length() < 1024) {
-        m_loadingMessages.append(QString("%1 at file offset %2<br>")
-            .arg(errorStr).arg(m_wrk->getFilePos()));
-    }
-}
-
-void GUIPlayer::wrkFileHeader(int /*verh*/, int /*verl*/)
-{
-    m_song->setHeader(1, 0, 120);
-    wrkUpdateLoadProgress();
-//    qDebug() << Q_FUNC_INFO;
-}
-
-void GUIPlayer::wrkTimeBase(int timebase)
-{
-    m_song->setDivision(timebase);
-    wrkUpdateLoadProgress();
-//    qDebug() << Q_FUNC_INFO << timebase;
-}
-
-void GUIPlayer::wrkStreamEndEvent(long time)
-{
-    unsigned long ticks = time;
-    if (ticks > m_tick)
-        m_tick = ticks;
-    wrkUpdateLoadProgress();
-//    qDebug() << Q_FUNC_INFO << time;
-}
-
-void GUIPlayer::wrkTrackHeader( const QString& /*name1*/,
-                           const QString& /*name2*/,
-                           int trackno, int channel,
-                           int pitch, int velocity, int /*port*/,
-                           bool /*selected*/, bool /*muted*/, bool /*loop*/ )
-{
-    TrackMapRec rec;
-    rec.channel = channel;
-    rec.pitch = pitch;
-    rec.velocity = velocity;
-    m_trackMap[trackno] = rec;
-    wrkUpdateLoadProgress();
-//    qDebug() << Q_FUNC_INFO << trackno << channel << pitch << velocity;
-}
-
-void GUIPlayer::wrkNoteEvent(int track, long time, int chan, int pitch, int vol, int dur)
-{
-    TrackMapRec rec = m_trackMap[track];
-    int channel = (rec.channel > -1) ? rec.channel : chan;
-    int key = qBound(0, pitch + rec.pitch, 127);
-    int velocity = qBound(0, vol + rec.velocity, 127);
-    SequencerEvent* ev = new NoteEvent(channel, key, velocity, dur);
-    appendWRKEvent(time, ev);
-//    qDebug() << Q_FUNC_INFO << channel << key << velocity << dur;
-}
-
-void GUIPlayer::wrkKeyPressEvent(int track, long time, int chan, int pitch, int press)
-{
-    TrackMapRec rec = m_trackMap[track];
-    int key = pitch + rec.pitch;
-    int channel = (rec.channel > -1) ? rec.channel : chan;
-    SequencerEvent* ev = new KeyPressEvent(channel, key, press);
-    appendWRKEvent(time, ev);
-//    qDebug() << Q_FUNC_INFO;
-}
-
-void GUIPlayer::wrkCtlChangeEvent(int track, long time, int chan, int ctl, int value)
-{
-    TrackMapRec rec = m_trackMap[track];
-    int channel = (rec.channel > -1) ? rec.channel : chan;
-    SequencerEvent* ev = new ControllerEvent(channel, ctl, value);
-    appendWRKEvent(time, ev);
-//    qDebug() << Q_FUNC_INFO;
-}
-
-void GUIPlayer::wrkPitchBendEvent(int track, long time, int chan, int value)
-{
-    TrackMapRec rec = m_trackMap[track];
-    int channel = (rec.channel > -1) ? rec.channel : chan;
-    SequencerEvent* ev = new PitchBendEvent(channel, value);
-    appendWRKEvent(time, ev);
-//    qDebug() << Q_FUNC_INFO;
-}
-
-void GUIPlayer::wrkProgramEvent(int track, long time, int chan, int patch)
-{
-    TrackMapRec rec = m_trackMap[track];
-    int channel = (rec.channel > -1) ? rec.channel : chan;
-    SequencerEvent* ev = new ProgramChangeEvent(channel, patch);
-    appendWRKEvent(time, ev);
-//    qDebug() << Q_FUNC_INFO;
-}
-
-void GUIPlayer::wrkChanPressEvent(int track, long time, int chan, int press)
-{
-    TrackMapRec rec = m_trackMap[track];
-    int channel = (rec.channel > -1) ? rec.channel : chan;
-    SequencerEvent* ev = new ChanPressEvent(channel, press);
-    appendWRKEvent(time, ev);
-//    qDebug() << Q_FUNC_INFO;
-}
-
-void GUIPlayer::wrkSysexEvent(int track, long time, int bank)
-{
-    Q_UNUSED(track)
-    qDebug() << Q_FUNC_INFO;
-    if (m_savedSysexEvents.contains(bank)) {
-        SysExEvent* ev = m_savedSysexEvents[bank].clone();
-        appendWRKEvent(time, ev);
-        wrkUpdateLoadProgress();
-    }
-}
-
-void GUIPlayer::wrkSysexEventBank(int bank, const QString& /*name*/,
-        bool autosend, int /*port*/, const QByteArray& data)
-{
-    //qDebug() << Q_FUNC_INFO;
-    SysExEvent* ev = new SysExEvent(data);
-    if (autosend) {
-        appendWRKEvent(0, ev);
-    } else {
-        m_savedSysexEvents[bank] = *ev;
-        delete ev;
-    }
-    wrkUpdateLoadProgress();
-}
-
-void GUIPlayer::wrkTempoEvent(long time, int tempo)
-{
-    double bpm = tempo / 100.0;
-    if ( m_initialTempo < 0 )
-        m_initialTempo = qRound( bpm );
-    SequencerEvent* ev = new TempoEvent(m_queueId, qRound ( 6e7 / bpm ) );
-    appendWRKEvent(time, ev);
-//    qDebug() << Q_FUNC_INFO;
-}
-
-void GUIPlayer::wrkTrackPatch(int track, int patch)
-{
-    TrackMapRec rec = m_trackMap[track];
-    int channel = (rec.channel > -1) ? rec.channel : 0;
-    wrkProgramEvent(track, 0, channel, patch);
-//    qDebug() << Q_FUNC_INFO;
-}
-
-void GUIPlayer::wrkNewTrackHeader( const QString& /*name*/,
-                              int trackno, int channel,
-                              int pitch, int velocity, int /*port*/,
-                              bool /*selected*/, bool /*muted*/, bool /*loop*/ )
-{
-    TrackMapRec rec;
-    rec.channel = channel;
-    rec.pitch = pitch;
-    rec.velocity = velocity;
-    m_trackMap[trackno] = rec;
-    wrkUpdateLoadProgress();
-//    qDebug() << Q_FUNC_INFO << trackno << channel << pitch << velocity;
-}
-
-void GUIPlayer::wrkTrackVol(int track, int vol)
-{
-    int lsb, msb;
-    TrackMapRec rec = m_trackMap[track];
-    int channel = (rec.channel > -1) ? rec.channel : 0;
-    if (vol < 128)
-        wrkCtlChangeEvent(track, 0, channel, MIDI_CTL_MSB_MAIN_VOLUME, vol);
-    else {
-        lsb = vol % 0x80;
-        msb = vol / 0x80;
-        wrkCtlChangeEvent(track, 0, channel, MIDI_CTL_LSB_MAIN_VOLUME, lsb);
-        wrkCtlChangeEvent(track, 0, channel, MIDI_CTL_MSB_MAIN_VOLUME, msb);
-    }
-//    qDebug() << Q_FUNC_INFO;
-}
-
-void GUIPlayer::wrkTrackBank(int track, int bank)
-{
-    // assume GM/GS bank method
-    int lsb, msb;
-    TrackMapRec rec = m_trackMap[track];
-    int channel = (rec.channel > -1) ? rec.channel : 0;
-    lsb = bank % 0x80;
-    msb = bank / 0x80;
-    wrkCtlChangeEvent(track, 0, channel, MIDI_CTL_MSB_BANK, msb);
-    wrkCtlChangeEvent(track, 0, channel, MIDI_CTL_LSB_BANK, lsb);
-//    qDebug() << Q_FUNC_INFO;
-}
-
-void GUIPlayer::wrkEndOfFile()
-{
-    if (m_initialTempo < 0)
-        m_initialTempo = 120;
-    SequencerEvent* ev = new SystemEvent(SND_SEQ_EVENT_ECHO);
-    appendWRKEvent(m_tick, ev);
-//    qDebug() << Q_FUNC_INFO;
-}
-
 DISABLE_WARNING_POP
@@ -35,10 +35,8 @@ namespace drumstick {
         class SequencerEvent;
         class SysExEvent;
     }
-    namespace File {
-        class QSmf;
-        class QWrk;
-        class Rmidi;
+    namespace widgets {
+        class PianoRoll;
     }
 }
 
@@ -46,9 +44,12 @@ namespace Ui {
     class GUIPlayerClass;
 }
 
+class QThread;
+class QTimer;
 class Player;
 class About;
 class Song;
+class SongLoader;
 
 class GUIPlayer : public QMainWindow
 {
@@ -66,9 +67,6 @@ public:
     GUIPlayer(QWidget *parent = nullptr, Qt::WindowFlags flags = Qt::Window);
     ~GUIPlayer();
 
-    void appendSMFEvent(drumstick::ALSA::SequencerEvent* ev);
-    void appendWRKEvent(unsigned long ticks, drumstick::ALSA::SequencerEvent* ev);
-
     void subscribe(const QString& portName);
     void updateTimeLabel(int mins, int secs, int cnts);
     void updateTempoLabel(float ftempo);
@@ -80,9 +78,11 @@ public:
     void writeSettings();
     void updateState(PlayerState newState);
 
-    void progressDialogInit(const QString& type, int max);
+    void progressDialogInit(const QString& type);
     void progressDialogUpdate(int pos);
     void progressDialogClose();
+    void fillPianoRoll();
+    void createChannelsMenu();
 
     static const QString QSTR_DOMAIN;
     static const QString QSTR_APPNAME;
@@ -92,6 +92,7 @@ public Q_SLOTS:
     void play();
     void pause();
     void stop();
+    void seek(quint64 tick);
     void open();
     void setup();
     void tempoReset();
@@ -103,65 +104,19 @@ public Q_SLOTS:
     void playerStopped();
     void sequencerEvent(drumstick::ALSA::SequencerEvent* ev);
 
-    /* RMI slots */
-    void dataHandler(const QString &dataType, const QByteArray &data);
-
-    /* SMF slots */
-    void smfHeaderEvent(int format, int ntrks, int division);
-    void smfNoteOnEvent(int chan, int pitch, int vol);
-    void smfNoteOffEvent(int chan, int pitch, int vol);
-    void smfKeyPressEvent(int chan, int pitch, int press);
-    void smfCtlChangeEvent(int chan, int ctl, int value);
-    void smfPitchBendEvent(int chan, int value);
-    void smfProgramEvent(int chan, int patch);
-    void smfChanPressEvent(int chan, int press);
-    void smfSysexEvent(const QByteArray& data);
-    void smfTempoEvent(int tempo);
-    void smfErrorHandler(const QString& errorStr);
-    void smfTrackStarted();
-    void smfTrackEnded();
-    void smfUpdateLoadProgress();
-
-    /* WRK slots */
-    void wrkUpdateLoadProgress();
-    void wrkErrorHandler(const QString& errorStr);
-    void wrkFileHeader(int verh, int verl);
-    void wrkEndOfFile();
-    void wrkStreamEndEvent(long time);
-    void wrkTrackHeader(const QString& name1, const QString& name2,
-                     int trackno, int channel, int pitch,
-                     int velocity, int port,
-                     bool selected, bool muted, bool loop);
-    void wrkTimeBase(int timebase);
-    void wrkNoteEvent(int track, long time, int chan, int pitch, int vol, int dur);
-    void wrkKeyPressEvent(int track, long time, int chan, int pitch, int press);
-    void wrkCtlChangeEvent(int track, long time, int chan, int ctl, int value);
-    void wrkPitchBendEvent(int track, long time, int chan, int value);
-    void wrkProgramEvent(int track, long time, int chan, int patch);
-    void wrkChanPressEvent(int track, long time, int chan, int press);
-    void wrkSysexEvent(int track, long time, int bank);
-    void wrkSysexEventBank(int bank, const QString& name, bool autosend, int port, const QByteArray& data);
-    void wrkTempoEvent(long time, int tempo);
-    void wrkTrackPatch(int track, int patch);
-    void wrkNewTrackHeader(const QString& name,
-                        int trackno, int channel, int pitch,
-                        int velocity, int port,
-                        bool selected, bool muted, bool loop);
-    void wrkTrackVol(int track, int vol);
-    void wrkTrackBank(int track, int bank);
+    void songLoadProgress(int request, int percent);
+    void songLoaded(int request, Song* song, const QString& messages);
+    void cancelLoading();
 
 private:
     int m_portId;
     int m_queueId;
     int m_initialTempo;
-    int m_currentTrack;
+    int m_loadRequest;
     float m_tempoFactor;
     unsigned long m_tick;
     PlayerState m_state;
 
-    drumstick::File::QSmf* m_smf;
-    drumstick::File::QWrk* m_wrk;
-    drumstick::File::Rmidi* m_rmi;
     drumstick::ALSA::MidiClient* m_Client;
     drumstick::ALSA::MidiPort* m_Port;
     drumstick::ALSA::MidiQueue* m_Queue;
@@ -169,19 +124,13 @@ private:
     Ui::GUIPlayerClass* m_ui;
     QPointer<QProgressDialog> m_pd;
     Song* m_song;
+    SongLoader* m_loader;
+    QThread* m_loaderThread;
+    drumstick::widgets::PianoRoll* m_roll;
+    QTimer* m_rollTimer;
 
     QString m_subscription;
     QString m_lastDirectory;
-    QString m_loadingMessages;
-
-    QHash<int, drumstick::ALSA::SysExEvent> m_savedSysexEvents;
-
-    struct TrackMapRec {
-        int channel;
-        int pitch;
-        int velocity;
-    };
-    QHash<int,TrackMapRec> m_trackMap;
 };
 
 #endif // INCLUDED_GUIPLAYER_H
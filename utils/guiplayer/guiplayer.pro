@@ -12,15 +12,17 @@ static {
 DESTDIR = ../../build/bin
 LRELEASE_DIR=.
 INCLUDEPATH += . ../../library/include
-LIBS = -L../../build/lib -ldrumstick-file -ldrumstick-alsa -lasound
+LIBS = -L../../build/lib -ldrumstick-file -ldrumstick-alsa -ldrumstick-widgets -lasound
+DEFINES += PIANOROLL
 include (../../global.pri)
 # Input
-HEADERS += player.h guiplayer.h song.h playerabout.h iconutils.h
+HEADERS += player.h guiplayer.h song.h songloader.h playerabout.h iconutils.h
 FORMS += guiplayer.ui playerabout.ui
 SOURCES += playermain.cpp \
     player.cpp \
     guiplayer.cpp \
     song.cpp \
+    songloader.cpp \
     iconutils.cpp \
     playerabout.cpp
 RESOURCES += guiplayer.qrc
@@ -19,23 +19,34 @@
 #include "player.h"
 #include "song.h"
 #include <cmath>
+#include <cstring>
 #include <drumstick/alsaclient.h>
 #include <drumstick/alsaqueue.h>
 
 using namespace drumstick::ALSA;
 
+static const quint16 NOT_SOUNDING = 0xffff;
+
 Player::Player(MidiClient *seq, int portId) 
     : SequencerOutputThread(seq, portId),
     m_song(nullptr),
-    m_songIterator(nullptr),
-    m_lastEvent(nullptr),
+    m_index(0),
+    m_chaseIndex(0),
     m_songPosition(0),
     m_echoResolution(0),
-    m_pitchShift(0),
-    m_volumeFactor(100)
+    m_transformVersion(0),
+    m_appliedVersion(0)
 {
-    for (int chan = 0; chan < MIDI_CHANNELS; ++chan)
-        m_volume[chan] = 100;
+    for (int chan = 0; chan < MIDI_CHANNELS; ++chan) {
+        m_volume[chan].store(100, std::memory_order_relaxed);
+        m_nextTransform.channelMap[chan] = chan;
+    }
+    m_nextTransform.pitchShift = 0;
+    m_nextTransform.volumeFactor = 100;
+    m_nextTransform.velocityFactor = 100;
+    m_nextTransform.mutedChannels = 0;
+    m_transform = m_nextTransform;
+    clearSounding();
 }
 
 Player::~Player()
@@ -43,74 +54,251 @@ Player::~Player()
     if (isRunning()) {
         stop();
     }
-    delete m_songIterator;
-    delete m_lastEvent;
 }
 
 void Player::setSong(Song* s)
 {
     m_song = s;
     if (m_song != nullptr) {
-        delete m_songIterator;
-        m_songIterator = new SongIterator(*m_song);
         m_echoResolution = m_song->getDivision() / 12;
         m_songPosition = 0;
+        m_index = 0;
+        m_chase.clear();
+        m_chaseIndex = 0;
+        clearSounding();
     }
 }
 
 void Player::resetPosition()
 {
-    if ((m_song != nullptr) && (m_songIterator != nullptr)) {
-        m_songIterator->toFront();
+    if (m_song != nullptr) {
+        m_index = 0;
         m_songPosition = 0;
+        m_chase.clear();
+        m_chaseIndex = 0;
+        clearSounding();
     }
 }
 
+/*
+ * Moves the playback position. The state of the channels and the tempo at
+ * that tick, taken from the nearest song checkpoint and the records after
+ * it, is sent before the first song record.
+ */
 void Player::setPosition(unsigned int pos)
 {
+    SongState state = m_song->stateAt(pos);
     m_songPosition = pos;
-    m_songIterator->toFront();
-    while (m_songIterator->hasNext() &&
-          (m_songIterator->next()->getTick() < pos)) { };
-    if (m_songIterator->hasPrevious())
-        m_songIterator->previous();
+    m_index = state.index;
+    clearSounding();
+    buildChase(state, pos);
 }
 
-bool Player::hasNext()
+void Player::appendChase(SequencerEvent& ev, unsigned int tick)
 {
-    auto res = m_songIterator->hasNext();
-    return res;
+    ev.setSource(m_PortId);
+    ev.setSubscribers();
+    ev.scheduleTick(m_QueueId, tick, false);
+    m_chase.append(*ev.getHandle());
 }
 
-SequencerEvent* Player::nextEvent()
+void Player::appendChase(int chan, int param, int value, unsigned int tick)
 {
-    delete m_lastEvent;
-    m_lastEvent = m_songIterator->next()->clone();
-    switch (m_lastEvent->getSequencerType()) {
-        case SND_SEQ_EVENT_NOTE:
-        case SND_SEQ_EVENT_NOTEON:
-        case SND_SEQ_EVENT_NOTEOFF:
-        case SND_SEQ_EVENT_KEYPRESS: {
-            KeyEvent* kev = static_cast<KeyEvent*>(m_lastEvent);
-            if (kev->getChannel() != MIDI_GM_DRUM_CHANNEL)
-                kev->setKey(kev->getKey() + m_pitchShift);
+    ControllerEvent ev(chan, param, value);
+    appendChase(ev, tick);
+}
+
+void Player::buildChase(const SongState& state, unsigned int tick)
+{
+    m_chase.clear();
+    m_chaseIndex = 0;
+    if (state.tempoIndex >= 0) {
+        snd_seq_event_t tempo = m_song->record(state.tempoIndex);
+        tempo.time.tick = tick;
+        m_chase.append(tempo);
+    }
+    for (int chan = 0; chan < MIDI_CHANNELS; ++chan) {
+        const ChannelState& c = state.channel[chan];
+        for (int param = 0; param < MIDI_CTL_ALL_SOUNDS_OFF; ++param) {
+            switch (param) {
+            case MIDI_CTL_MSB_BANK:
+            case MIDI_CTL_LSB_BANK:
+            case MIDI_CTL_MSB_DATA_ENTRY:
+            case MIDI_CTL_LSB_DATA_ENTRY:
+            case MIDI_CTL_DATA_INCREMENT:
+            case MIDI_CTL_DATA_DECREMENT:
+            case MIDI_CTL_NONREG_PARM_NUM_LSB:
+            case MIDI_CTL_NONREG_PARM_NUM_MSB:
+            case MIDI_CTL_REGIST_PARM_NUM_LSB:
+            case MIDI_CTL_REGIST_PARM_NUM_MSB:
+                break;
+            default:
+                if (c.controller[param] >= 0) {
+                    appendChase(chan, param, c.controller[param], tick);
+                }
+            }
         }
-        break;
-        case SND_SEQ_EVENT_CONTROLLER: {
-            ControllerEvent *cev = static_cast<ControllerEvent*>(m_lastEvent);
-            if (cev->getParam() == MIDI_CTL_MSB_MAIN_VOLUME) {
-                int chan = cev->getChannel();
-                int value = cev->getValue();
-                m_volume[chan] = value;
-                value = floor(value * m_volumeFactor / 100.0);
-                if (value < 0) value = 0;
-                if (value > 127) value = 127;
-                cev->setValue(value);
+        if (c.program >= 0) {
+            if (c.controller[MIDI_CTL_MSB_BANK] >= 0) {
+                appendChase(chan, MIDI_CTL_MSB_BANK, c.controller[MIDI_CTL_MSB_BANK], tick);
+            }
+            if (c.controller[MIDI_CTL_LSB_BANK] >= 0) {
+                appendChase(chan, MIDI_CTL_LSB_BANK, c.controller[MIDI_CTL_LSB_BANK], tick);
+            }
+            ProgramChangeEvent ev(chan, c.program);
+            appendChase(ev, tick);
+        }
+        bool rpn = false;
+        for (int n = 0; n < ChannelState::RPN_COUNT; ++n) {
+            if (c.rpn[n] >= 0) {
+                appendChase(chan, MIDI_CTL_REGIST_PARM_NUM_MSB, 0, tick);
+                appendChase(chan, MIDI_CTL_REGIST_PARM_NUM_LSB, n, tick);
+                appendChase(chan, MIDI_CTL_MSB_DATA_ENTRY, c.rpn[n] >> 7, tick);
+                appendChase(chan, MIDI_CTL_LSB_DATA_ENTRY, c.rpn[n] & 0x7f, tick);
+                rpn = true;
+            }
+        }
+        // restores the parameter selected by the song, or the null RPN
+        static const int selection[] = { MIDI_CTL_NONREG_PARM_NUM_MSB, MIDI_CTL_NONREG_PARM_NUM_LSB,
+                                         MIDI_CTL_REGIST_PARM_NUM_MSB, MIDI_CTL_REGIST_PARM_NUM_LSB };
+        bool selected = false;
+        for (int param : selection) {
+            if (c.controller[param] >= 0) {
+                appendChase(chan, param, c.controller[param], tick);
+                selected = true;
+            }
+        }
+        if (rpn && !selected) {
+            appendChase(chan, MIDI_CTL_REGIST_PARM_NUM_MSB, 0x7f, tick);
+            appendChase(chan, MIDI_CTL_REGIST_PARM_NUM_LSB, 0x7f, tick);
+        }
+        if (c.pressure >= 0) {
+            ChanPressEvent ev(chan, c.pressure);
+            appendChase(ev, tick);
+        }
+        if (c.pitchBend != ChannelState::PITCHBEND_UNSET) {
+            PitchBendEvent ev(chan, c.pitchBend);
+            appendChase(ev, tick);
+        }
+    }
+}
+
+void Player::clearSounding()
+{
+    std::memset(m_sounding, 0xff, sizeof(m_sounding));
+}
+
+/*
+ * Picks up the parameters modified since the last event, so the changes
+ * take effect after the events already buffered in the output pool
+ */
+void Player::updateTransform()
+{
+    int version = m_transformVersion.load(std::memory_order_acquire);
+    if (version != m_appliedVersion) {
+        QMutexLocker locker(&m_transformMutex);
+        m_transform = m_nextTransform;
+        m_appliedVersion = version;
+    }
+}
+
+bool Player::isMuted(const snd_seq_event_t& ev) const
+{
+    switch (ev.type) {
+    case SND_SEQ_EVENT_NOTE:
+    case SND_SEQ_EVENT_NOTEON:
+        return (ev.data.note.velocity > 0) &&
+               (m_transform.mutedChannels & (1 << (ev.data.note.channel & 0x0f)));
+    default:
+        return false;
+    }
+}
+
+int Player::scaled(int value, unsigned int factor)
+{
+    return qBound(0, static_cast<int>(floor(value * factor / 100.0)), 127);
+}
+
+/*
+ * Applies the transform stage to a copy of a song record, in place
+ */
+void Player::transform(snd_seq_event_t* ev)
+{
+    switch (ev->type) {
+    case SND_SEQ_EVENT_NOTE:
+    case SND_SEQ_EVENT_NOTEON:
+    case SND_SEQ_EVENT_NOTEOFF:
+    case SND_SEQ_EVENT_KEYPRESS: {
+        int chan = ev->data.note.channel & 0x0f;
+        int key = ev->data.note.note & 0x7f;
+        quint16& sounding = m_sounding[chan][key];
+        bool noteOn = (ev->type == SND_SEQ_EVENT_NOTEON) && (ev->data.note.velocity > 0);
+        if (noteOn || sounding == NOT_SOUNDING) {
+            int outChan = m_transform.channelMap[chan];
+            int outKey = key;
+            if (chan != MIDI_GM_DRUM_CHANNEL) {
+                outKey = qBound(0, key + m_transform.pitchShift, 127);
+            }
+            ev->data.note.channel = outChan;
+            ev->data.note.note = outKey;
+            if (noteOn) {
+                sounding = (outChan << 8) | outKey;
+            }
+        } else {
+            // the same output note as the note on, even if the parameters changed
+            ev->data.note.channel = sounding >> 8;
+            ev->data.note.note = sounding & 0xff;
+            if (ev->type != SND_SEQ_EVENT_KEYPRESS) {
+                sounding = NOT_SOUNDING;
             }
         }
+        if ((ev->type == SND_SEQ_EVENT_NOTE || noteOn) && m_transform.velocityFactor != 100) {
+            ev->data.note.velocity = qMax(1, scaled(ev->data.note.velocity, m_transform.velocityFactor));
+        }
+    }
+    break;
+    case SND_SEQ_EVENT_CONTROLLER: {
+        int chan = ev->data.control.channel & 0x0f;
+        if (ev->data.control.param == MIDI_CTL_MSB_MAIN_VOLUME) {
+            m_volume[chan].store(ev->data.control.value, std::memory_order_relaxed);
+            ev->data.control.value = scaled(ev->data.control.value, m_transform.volumeFactor);
+        }
+        ev->data.control.channel = m_transform.channelMap[chan];
+    }
+    break;
+    case SND_SEQ_EVENT_CONTROL14:
+    case SND_SEQ_EVENT_NONREGPARAM:
+    case SND_SEQ_EVENT_REGPARAM:
+    case SND_SEQ_EVENT_PGMCHANGE:
+    case SND_SEQ_EVENT_CHANPRESS:
+    case SND_SEQ_EVENT_PITCHBEND:
+        ev->data.control.channel = m_transform.channelMap[ev->data.control.channel & 0x0f];
         break;
     }
-    return m_lastEvent;
+}
+
+bool Player::hasNext()
+{
+    updateTransform();
+    if (m_chaseIndex < m_chase.size()) {
+        return true;
+    }
+    while (m_index < m_song->recordCount() && isMuted(m_song->record(m_index))) {
+        ++m_index;
+    }
+    return m_index < m_song->recordCount();
+}
+
+SequencerEvent* Player::nextEvent()
+{
+    // copies the compact record into the reusable event: no allocations
+    if (m_chaseIndex < m_chase.size()) {
+        *m_event.getHandle() = m_chase.at(m_chaseIndex++);
+    } else {
+        *m_event.getHandle() = m_song->record(m_index++);
+    }
+    transform(m_event.getHandle());
+    return &m_event;
 }
 
 unsigned int Player::getInitialPosition()
@@ -123,40 +311,70 @@ unsigned int Player::getEchoResolution()
     return m_echoResolution;
 }
 
-unsigned int Player::getPitchShift()
+int Player::getPitchShift()
 {
-    return m_pitchShift;
+    QMutexLocker locker(&m_transformMutex);
+    return m_nextTransform.pitchShift;
 }
 
 unsigned int Player::getVolumeFactor()
 {
-    return m_volumeFactor;
+    QMutexLocker locker(&m_transformMutex);
+    return m_nextTransform.volumeFactor;
 }
 
-void Player::setPitchShift(unsigned int pitch)
+unsigned int Player::getVelocityFactor()
 {
-    bool playing = isRunning();
-    if (playing) {
-        stop();
-        unsigned int pos = m_Queue->getStatus().getTickTime();
-        m_Queue->clear();
-        allNotesOff();
-        setPosition(pos);
+    QMutexLocker locker(&m_transformMutex);
+    return m_nextTransform.velocityFactor;
+}
+
+void Player::setPitchShift(int pitch)
+{
+    QMutexLocker locker(&m_transformMutex);
+    m_nextTransform.pitchShift = pitch;
+    m_transformVersion++;
+}
+
+void Player::setVelocityFactor(unsigned int vel)
+{
+    QMutexLocker locker(&m_transformMutex);
+    m_nextTransform.velocityFactor = vel;
+    m_transformVersion++;
+}
+
+void Player::setChannelMuted(int chan, bool muted)
+{
+    QMutexLocker locker(&m_transformMutex);
+    if (muted) {
+        m_nextTransform.mutedChannels |= (1 << (chan & 0x0f));
+    } else {
+        m_nextTransform.mutedChannels &= ~(1 << (chan & 0x0f));
     }
-    m_pitchShift = pitch;
-    if (playing)
-        start();
+    m_transformVersion++;
+}
+
+void Player::setChannelMap(int chan, int outChan)
+{
+    QMutexLocker locker(&m_transformMutex);
+    m_nextTransform.channelMap[chan & 0x0f] = outChan & 0x0f;
+    m_transformVersion++;
 }
 
 void Player::setVolumeFactor(unsigned int vol)
 {
-    m_volumeFactor = vol;
+    quint8 channelMap[MIDI_CHANNELS];
+    {
+        QMutexLocker locker(&m_transformMutex);
+        m_nextTransform.volumeFactor = vol;
+        m_transformVersion++;
+        std::memcpy(channelMap, m_nextTransform.channelMap, sizeof(channelMap));
+    }
+    // the song volume events are scaled by the transform stage, but the
+    // current volume of each channel is updated right now
     for(int chan = 0; chan < MIDI_CHANNELS; ++chan) {
-        int value = m_volume[chan];
-        value = floor(value * m_volumeFactor / 100.0);
-        if (value < 0) value = 0;
-        if (value > 127) value = 127;
-        sendController(chan, MIDI_CTL_MSB_MAIN_VOLUME, value);
+        sendController(channelMap[chan], MIDI_CTL_MSB_MAIN_VOLUME,
+                       scaled(m_volume[chan].load(std::memory_order_relaxed), vol));
     }
 }
 
@@ -179,11 +397,15 @@ void Player::allNotesOff()
 
 void Player::sendVolumeEvents()
 {
+    quint8 channelMap[MIDI_CHANNELS];
+    unsigned int factor;
+    {
+        QMutexLocker locker(&m_transformMutex);
+        factor = m_nextTransform.volumeFactor;
+        std::memcpy(channelMap, m_nextTransform.channelMap, sizeof(channelMap));
+    }
     for(int chan = 0; chan < MIDI_CHANNELS; ++chan) {
-        int value = m_volume[chan] = 100;
-        value = floor(value * m_volumeFactor / 100.0);
-        if (value < 0) value = 0;
-        if (value > 127) value = 127;
-        sendController(chan, MIDI_CTL_MSB_MAIN_VOLUME, value);
+        m_volume[chan].store(100, std::memory_order_relaxed);
+        sendController(channelMap[chan], MIDI_CTL_MSB_MAIN_VOLUME, scaled(100, factor));
     }
 }
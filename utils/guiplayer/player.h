@@ -19,6 +19,9 @@
 #ifndef INCLUDED_PLAYER_H
 #define INCLUDED_PLAYER_H
 
+#include <QMutex>
+#include <atomic>
+#include <drumstick/alsaevent.h>
 #include <drumstick/playthread.h>
 #include "song.h"
 
@@ -34,26 +37,56 @@ public:
     virtual unsigned int getInitialPosition() override;
     virtual unsigned int getEchoResolution() override;
 
-    unsigned int getPitchShift();
+    int getPitchShift();
     unsigned int getVolumeFactor();
+    unsigned int getVelocityFactor();
     void setSong(Song* s);
     void resetPosition();
     void setPosition(unsigned int pos);
-    void setPitchShift(unsigned int pitch);
+    void setPitchShift(int pitch);
     void setVolumeFactor(unsigned int vol);
+    void setVelocityFactor(unsigned int vel);
+    void setChannelMuted(int chan, bool muted);
+    void setChannelMap(int chan, int outChan);
     void sendController(int chan, int control, int value);
     void allNotesOff();
     void sendVolumeEvents();
 
 private:
+    /* parameters of the transform stage, applied to the song records */
+    struct Transform {
+        int pitchShift;
+        unsigned int volumeFactor;
+        unsigned int velocityFactor;
+        quint16 mutedChannels;
+        quint8 channelMap[MIDI_CHANNELS];
+    };
+
+    void buildChase(const SongState& state, unsigned int tick);
+    void appendChase(drumstick::ALSA::SequencerEvent& ev, unsigned int tick);
+    void appendChase(int chan, int param, int value, unsigned int tick);
+    void updateTransform();
+    void clearSounding();
+    void transform(snd_seq_event_t* ev);
+    bool isMuted(const snd_seq_event_t& ev) const;
+    static int scaled(int value, unsigned int factor);
+
     Song* m_song;
-    SongIterator* m_songIterator;
-    drumstick::ALSA::SequencerEvent* m_lastEvent;
+    drumstick::ALSA::SequencerEvent m_event;
+    int m_index;
+    QVector<snd_seq_event_t> m_chase;  // state restored before the song records
+    int m_chaseIndex;
     unsigned int m_songPosition;
     unsigned int m_echoResolution;
-    unsigned int m_pitchShift;
-    unsigned int m_volumeFactor;
-    int m_volume[MIDI_CHANNELS];
+    std::atomic<int> m_volume[MIDI_CHANNELS]; // written by the playback thread
+
+    Transform m_transform;       // used by the playback thread
+    Transform m_nextTransform;   // modified by the GUI thread
+    QMutex m_transformMutex;
+    std::atomic<int> m_transformVersion;
+    int m_appliedVersion;
+    /* output channel and key of each sounding note, per input channel and key */
+    quint16 m_sounding[MIDI_CHANNELS][128];
 };
 
 #endif /*INCLUDED_PLAYER_H*/
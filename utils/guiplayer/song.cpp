@@ -17,7 +17,10 @@
 */
 
 #include "song.h"
+#include <algorithm>
+#include <cstring>
 #include <drumstick/alsaevent.h>
+#include <drumstick/notepairing.h>
 
 using namespace drumstick::ALSA;
 
@@ -33,7 +36,153 @@ Song::~Song()
 
 void Song::sort() 
 {
-    std::sort(begin(), end(), eventLessThan);
+    std::stable_sort(begin(), end(), eventLessThan);
+    // notes with duration: the sequencer schedules the note-offs by itself
+    NotePairing().pairNotes(*this);
+    m_records.clear();
+    m_records.reserve(size());
+    foreach(SequencerEvent* ev, *this) {
+        m_records.append(*ev->getHandle());
+    }
+    // a snapshot of the channels state every few bars, for fast seeking
+    m_checkpoints.clear();
+    SongState state;
+    state.reset();
+    const unsigned long interval = qMax(1, m_division) * CHECKPOINT_BEATS;
+    unsigned long next = 0;
+    for (int i = 0; i < m_records.size(); ++i) {
+        while (m_records[i].time.tick >= next) {
+            state.tick = next;
+            state.index = i;
+            m_checkpoints.append(state);
+            next += interval;
+        }
+        state.apply(m_records[i], i);
+    }
+}
+
+/*
+ * Returns the state before the first record at or after the tick, from the
+ * nearest previous checkpoint and the records in between
+ */
+SongState Song::stateAt(unsigned long tick) const
+{
+    SongState state;
+    auto it = std::upper_bound(m_checkpoints.constBegin(), m_checkpoints.constEnd(), tick,
+        [](unsigned long t, const SongState& s) {
+            return t < s.tick;
+        });
+    if (it == m_checkpoints.constBegin()) {
+        state.reset();
+    } else {
+        state = *(it - 1);
+    }
+    int last = indexOf(tick);
+    for (int i = state.index; i < last; ++i) {
+        state.apply(m_records[i], i);
+    }
+    state.tick = tick;
+    state.index = last;
+    return state;
+}
+
+void SongState::reset()
+{
+    tick = 0;
+    index = 0;
+    tempoIndex = -1;
+    for (ChannelState& c : channel) {
+        std::memset(c.controller, -1, sizeof(c.controller));
+        c.program = -1;
+        c.pressure = -1;
+        c.pitchBend = ChannelState::PITCHBEND_UNSET;
+        std::fill(std::begin(c.rpn), std::end(c.rpn), -1);
+        c.rpnSelected = -1;
+    }
+}
+
+void SongState::apply(const snd_seq_event_t& ev, int i)
+{
+    switch (ev.type) {
+    case SND_SEQ_EVENT_CONTROLLER: {
+        ChannelState& c = channel[ev.data.control.channel & 0x0f];
+        int param = ev.data.control.param & 0x7f;
+        int value = ev.data.control.value & 0x7f;
+        c.controller[param] = value;
+        switch (param) {
+        case MIDI_CTL_REGIST_PARM_NUM_MSB:
+        case MIDI_CTL_REGIST_PARM_NUM_LSB: {
+            int msb = c.controller[MIDI_CTL_REGIST_PARM_NUM_MSB];
+            int lsb = c.controller[MIDI_CTL_REGIST_PARM_NUM_LSB];
+            c.rpnSelected = (msb == 0 && lsb >= 0 && lsb < ChannelState::RPN_COUNT) ? lsb : -1;
+        }
+        break;
+        case MIDI_CTL_NONREG_PARM_NUM_MSB:
+        case MIDI_CTL_NONREG_PARM_NUM_LSB:
+            c.rpnSelected = -1;
+            break;
+        case MIDI_CTL_MSB_DATA_ENTRY:
+            if (c.rpnSelected >= 0) {
+                qint16& v = c.rpn[c.rpnSelected];
+                v = (value << 7) | (v < 0 ? 0 : v & 0x7f);
+            }
+            break;
+        case MIDI_CTL_LSB_DATA_ENTRY:
+            if (c.rpnSelected >= 0) {
+                qint16& v = c.rpn[c.rpnSelected];
+                v = (v < 0 ? 0 : v & ~0x7f) | value;
+            }
+            break;
+        case MIDI_CTL_RESET_CONTROLLERS: {
+            // RP-015: volume, pan, bank select, the effect and sound
+            // controllers and the RPN values are left untouched
+            static const int resets[][2] = {
+                { MIDI_CTL_MSB_MODWHEEL, 0 },
+                { MIDI_CTL_MSB_EXPRESSION, 127 },
+                { MIDI_CTL_SUSTAIN, 0 },
+                { MIDI_CTL_PORTAMENTO, 0 },
+                { MIDI_CTL_SOSTENUTO, 0 },
+                { MIDI_CTL_SOFT_PEDAL, 0 },
+                { MIDI_CTL_NONREG_PARM_NUM_LSB, 127 },
+                { MIDI_CTL_NONREG_PARM_NUM_MSB, 127 },
+                { MIDI_CTL_REGIST_PARM_NUM_LSB, 127 },
+                { MIDI_CTL_REGIST_PARM_NUM_MSB, 127 } };
+            for (const auto& r : resets) {
+                c.controller[r[0]] = r[1];
+            }
+            c.pressure = 0;
+            c.pitchBend = 0;
+            c.rpnSelected = -1;
+        }
+        break;
+        }
+    }
+    break;
+    case SND_SEQ_EVENT_PGMCHANGE:
+        channel[ev.data.control.channel & 0x0f].program = ev.data.control.value & 0x7f;
+        break;
+    case SND_SEQ_EVENT_CHANPRESS:
+        channel[ev.data.control.channel & 0x0f].pressure = ev.data.control.value & 0x7f;
+        break;
+    case SND_SEQ_EVENT_PITCHBEND:
+        channel[ev.data.control.channel & 0x0f].pitchBend = ev.data.control.value;
+        break;
+    case SND_SEQ_EVENT_TEMPO:
+        tempoIndex = i;
+        break;
+    }
+}
+
+/*
+ * Returns the index of the first record at or after the tick
+ */
+int Song::indexOf(unsigned long tick) const
+{
+    auto it = std::lower_bound(m_records.constBegin(), m_records.constEnd(), tick,
+        [](const snd_seq_event_t& ev, unsigned long t) {
+            return ev.time.tick < t;
+        });
+    return int(it - m_records.constBegin());
 }
 
 void Song::clear()
@@ -44,6 +193,10 @@ void Song::clear()
     m_format = 0;
     m_ntrks = 0;
     m_division = 0;
+    m_initialTempo = 0;
+    m_lastTick = 0;
+    m_records.clear();
+    m_checkpoints.clear();
 }
 
 void Song::setHeader(int format, int ntrks, int division)
@@ -19,19 +19,55 @@
 #ifndef INCLUDED_SONG_H
 #define INCLUDED_SONG_H
 
+#include <QMetaType>
 #include <QStringList>
+#include <QVector>
+#include <alsa/asoundlib.h>
 
 namespace drumstick { namespace ALSA {
     class SequencerEvent;
 }}
 
+/*
+ * Controller, program, pressure, pitch bend and registered parameters of
+ * one MIDI channel. Unknown values are negative.
+ */
+struct ChannelState
+{
+    static const int RPN_COUNT = 6;
+    static const int PITCHBEND_UNSET = -0x8000;
+
+    qint8 controller[128];
+    qint8 program;
+    qint8 pressure;
+    qint16 pitchBend;
+    qint16 rpn[RPN_COUNT];  // 14 bit values of the registered parameters
+    qint16 rpnSelected;     // selected RPN, or -1 (also for NRPNs)
+};
+
+/*
+ * The state of all the channels and the tempo before a song record
+ */
+struct SongState
+{
+    unsigned long tick;
+    int index;              // first record after this state
+    int tempoIndex;         // last tempo record, or -1
+    ChannelState channel[MIDI_CHANNELS];
+
+    void reset();
+    void apply(const snd_seq_event_t& ev, int index);
+};
+
 class Song : public QList<drumstick::ALSA::SequencerEvent*>
 {
 public:
     Song() : QList<drumstick::ALSA::SequencerEvent*>(),
         m_format(0),
         m_ntrks(0),
-        m_division(0)
+        m_division(0),
+        m_initialTempo(0),
+        m_lastTick(0)
     { }
     virtual ~Song();
     
@@ -40,19 +76,37 @@ public:
     void setHeader(int format, int ntrks, int division);
     void setDivision(int division);
     void setFileName(const QString& fileName);
+    void setInitialTempo(int tempo) { m_initialTempo = tempo; }
+    void setLastTick(unsigned long tick) { m_lastTick = tick; }
     
     int getFormat() const { return m_format; }
     int getTracks() const { return m_ntrks; }
     int getDivision() const { return m_division; }
     QString getFileName() const { return m_fileName; }
+    int getInitialTempo() const { return m_initialTempo; }
+    unsigned long getLastTick() const { return m_lastTick; }
+
+    /* compact copies of the sorted events, for the playback thread */
+    int recordCount() const { return m_records.size(); }
+    const snd_seq_event_t& record(int i) const { return m_records.at(i); }
+    int indexOf(unsigned long tick) const;
+    SongState stateAt(unsigned long tick) const;
+
+    static const int CHECKPOINT_BEATS = 16;
 
 private:    
     int m_format;
     int m_ntrks;
     int m_division;    
+    int m_initialTempo;
+    unsigned long m_lastTick;
     QString m_fileName;
+    QVector<snd_seq_event_t> m_records;
+    QVector<SongState> m_checkpoints;
 };
 
+Q_DECLARE_METATYPE(Song*)
+
 typedef QListIterator<drumstick::ALSA::SequencerEvent*> SongIterator;
 
 #endif /*INCLUDED_SONG_H*/
@@ -0,0 +1,565 @@
+/*
+    SMF GUI Player test using the MIDI Sequencer C++ library
+    Copyright (C) 2006-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDataStream>
+#include <QFileInfo>
+#include <QTextCodec>
+#include <drumstick/alsaevent.h>
+#include <drumstick/qsmf.h>
+#include <drumstick/qwrk.h>
+#include <drumstick/rmid.h>
+
+#include "song.h"
+#include "songloader.h"
+
+DISABLE_WARNING_PUSH
+DISABLE_WARNING_DEPRECATED_DECLARATIONS
+
+using namespace drumstick;
+using namespace ALSA;
+using namespace File;
+
+SongLoader::SongLoader(int portId, int queueId)
+    : QObject(nullptr),
+    m_portId(portId),
+    m_queueId(queueId),
+    m_current(0),
+    m_latest(0),
+    m_canceled(false),
+    m_initialTempo(0),
+    m_currentTrack(0),
+    m_percent(0),
+    m_fileSize(0),
+    m_tick(0),
+    m_file(this),
+    m_riffData(this),
+    m_song(nullptr)
+{
+    m_rmi = new Rmidi(this);
+    connect(m_rmi, &Rmidi::signalRiffData, this, &SongLoader::dataHandler);
+
+    m_smf = new QSmf(this);
+    connect(m_smf, &QSmf::signalSMFHeader, this, &SongLoader::smfHeaderEvent);
+    connect(m_smf, &QSmf::signalSMFNoteOn, this, &SongLoader::smfNoteOnEvent);
+    connect(m_smf, &QSmf::signalSMFNoteOff, this, &SongLoader::smfNoteOffEvent);
+    connect(m_smf, &QSmf::signalSMFKeyPress, this, &SongLoader::smfKeyPressEvent);
+    connect(m_smf, &QSmf::signalSMFCtlChange, this, &SongLoader::smfCtlChangeEvent);
+    connect(m_smf, &QSmf::signalSMFPitchBend, this, &SongLoader::smfPitchBendEvent);
+    connect(m_smf, &QSmf::signalSMFProgram, this, &SongLoader::smfProgramEvent);
+    connect(m_smf, &QSmf::signalSMFChanPress, this, &SongLoader::smfChanPressEvent);
+    connect(m_smf, &QSmf::signalSMFSysex, this, &SongLoader::smfSysexEvent);
+    connect(m_smf, &QSmf::signalSMFText, this, &SongLoader::smfUpdateLoadProgress);
+    connect(m_smf, &QSmf::signalSMFTempo, this, &SongLoader::smfTempoEvent);
+    connect(m_smf, &QSmf::signalSMFTrackStart, this, &SongLoader::smfUpdateLoadProgress);
+    connect(m_smf, &QSmf::signalSMFTrackStart, this, &SongLoader::smfTrackStarted);
+    connect(m_smf, &QSmf::signalSMFTrackEnd, this, &SongLoader::smfTrackEnded);
+    connect(m_smf, &QSmf::signalSMFendOfTrack, this, &SongLoader::smfUpdateLoadProgress);
+    connect(m_smf, &QSmf::signalSMFError, this, &SongLoader::smfErrorHandler);
+
+    m_wrk = new QWrk(this);
+    m_wrk->setTextCodec(QTextCodec::codecForLocale());
+    connect(m_wrk, &QWrk::signalWRKError, this, &SongLoader::wrkErrorHandler);
+    connect(m_wrk, &QWrk::signalWRKUnknownChunk, this, &SongLoader::wrkUpdateLoadProgress);
+    connect(m_wrk, &QWrk::signalWRKHeader, this, &SongLoader::wrkFileHeader);
+    connect(m_wrk, &QWrk::signalWRKEnd, this, &SongLoader::wrkEndOfFile);
+    connect(m_wrk, &QWrk::signalWRKStreamEnd, this, &SongLoader::wrkStreamEndEvent);
+    connect(m_wrk, &QWrk::signalWRKGlobalVars, this, &SongLoader::wrkUpdateLoadProgress);
+    connect(m_wrk, &QWrk::signalWRKTrack, this, &SongLoader::wrkTrackHeader);
+    connect(m_wrk, &QWrk::signalWRKTimeBase, this, &SongLoader::wrkTimeBase);
+    connect(m_wrk, &QWrk::signalWRKNote, this, &SongLoader::wrkNoteEvent);
+    connect(m_wrk, &QWrk::signalWRKKeyPress, this, &SongLoader::wrkKeyPressEvent);
+    connect(m_wrk, &QWrk::signalWRKCtlChange, this, &SongLoader::wrkCtlChangeEvent);
+    connect(m_wrk, &QWrk::signalWRKPitchBend, this, &SongLoader::wrkPitchBendEvent);
+    connect(m_wrk, &QWrk::signalWRKProgram, this, &SongLoader::wrkProgramEvent);
+    connect(m_wrk, &QWrk::signalWRKChanPress, this, &SongLoader::wrkChanPressEvent);
+    connect(m_wrk, &QWrk::signalWRKSysexEvent, this, &SongLoader::wrkSysexEvent);
+    connect(m_wrk, &QWrk::signalWRKSysex, this, &SongLoader::wrkSysexEventBank);
+    connect(m_wrk, &QWrk::signalWRKText, this, &SongLoader::wrkUpdateLoadProgress);
+    connect(m_wrk, &QWrk::signalWRKTimeSig, this, &SongLoader::wrkUpdateLoadProgress);
+    connect(m_wrk, &QWrk::signalWRKKeySig, this, &SongLoader::wrkUpdateLoadProgress);
+    connect(m_wrk, &QWrk::signalWRKTempo, this, &SongLoader::wrkTempoEvent);
+    connect(m_wrk, &QWrk::signalWRKTrackPatch, this, &SongLoader::wrkTrackPatch);
+    connect(m_wrk, &QWrk::signalWRKComments, this, &SongLoader::wrkUpdateLoadProgress);
+    connect(m_wrk, &QWrk::signalWRKVariableRecord, this, &SongLoader::wrkUpdateLoadProgress);
+    connect(m_wrk, &QWrk::signalWRKNewTrack, this, &SongLoader::wrkNewTrackHeader);
+    connect(m_wrk, &QWrk::signalWRKTrackName, this, &SongLoader::wrkUpdateLoadProgress);
+    connect(m_wrk, &QWrk::signalWRKTrackVol, this, &SongLoader::wrkTrackVol);
+    connect(m_wrk, &QWrk::signalWRKTrackBank, this, &SongLoader::wrkTrackBank);
+    connect(m_wrk, &QWrk::signalWRKSegment, this, &SongLoader::wrkUpdateLoadProgress);
+    connect(m_wrk, &QWrk::signalWRKChord, this, &SongLoader::wrkUpdateLoadProgress);
+    connect(m_wrk, &QWrk::signalWRKExpression, this, &SongLoader::wrkUpdateLoadProgress);
+}
+
+SongLoader::~SongLoader()
+{
+    delete m_song;
+}
+
+/*
+ * Queues a load request, cancelling the one in progress. Called from the
+ * GUI thread; returns the request number, reported by the signals.
+ */
+int SongLoader::request(const QString& fileName)
+{
+    int request = ++m_latest;
+    QMetaObject::invokeMethod(this, "load", Qt::QueuedConnection,
+                              Q_ARG(QString, fileName), Q_ARG(int, request));
+    return request;
+}
+
+/*
+ * Cancels the load in progress. Thread safe.
+ */
+void SongLoader::cancel()
+{
+    ++m_latest;
+}
+
+/*
+ * Exceptions must not cross the signal dispatch, so a canceled load moves
+ * the devices being parsed to their end: the parsers leave their loops at
+ * once, the handlers ignore what they are still given, and the Song is
+ * discarded when the parser returns.
+ */
+bool SongLoader::canceled()
+{
+    if (!m_canceled && m_latest.load(std::memory_order_relaxed) != m_current) {
+        m_canceled = true;
+        m_file.seek(m_file.size());
+        if (m_riffData.isOpen()) {
+            m_riffData.seek(m_riffData.size());
+        }
+    }
+    return m_canceled;
+}
+
+void SongLoader::updateProgress(qint64 pos)
+{
+    if (canceled()) {
+        return;
+    }
+    if (m_fileSize > 0) {
+        int percent = static_cast<int>(qBound<qint64>(0, pos * 100 / m_fileSize, 100));
+        if (percent != m_percent) {
+            m_percent = percent;
+            Q_EMIT loadProgress(m_current, percent);
+        }
+    }
+}
+
+void SongLoader::load(const QString& fileName, int request)
+{
+    if (request != m_latest.load()) {
+        return; // superseded by a newer request
+    }
+    QFileInfo finfo(fileName);
+    m_current = request;
+    m_canceled = false;
+    m_song = new Song;
+    m_song->setFileName(fileName);
+    m_loadingMessages.clear();
+    m_savedSysexEvents.clear();
+    m_trackMap.clear();
+    m_tick = 0;
+    m_initialTempo = 0;
+    m_currentTrack = 0;
+    m_percent = 0;
+    m_fileSize = finfo.size();
+    m_file.setFileName(fileName);
+    if (m_file.open(QIODevice::ReadOnly)) {
+        QDataStream ds(&m_file);
+        try {
+            QString ext = finfo.suffix().toLower();
+            if (ext == "wrk") {
+                m_wrk->readFromStream(&ds);
+            }
+            else if (ext == "mid" || ext == "midi" || ext == "kar") {
+                m_smf->readFromStream(&ds);
+            }
+            else if (ext == "rmi") {
+                m_rmi->readFromStream(&ds);
+            }
+            if (!canceled() && !m_song->isEmpty()) {
+                m_song->sort();
+            }
+        } catch (...) {
+            m_song->clear();
+        }
+        m_file.close();
+    }
+    if (canceled()) {
+        delete m_song;
+        m_song = nullptr;
+        return;
+    }
+    if (m_initialTempo == 0) {
+        m_initialTempo = 500000;
+    }
+    m_song->setInitialTempo(m_initialTempo);
+    m_song->setLastTick(m_tick);
+    Song* song = m_song;
+    m_song = nullptr;
+    Q_EMIT loadFinished(request, song, m_loadingMessages);
+}
+
+void SongLoader::dataHandler(const QString &dataType, const QByteArray &data)
+{
+    if (dataType == "RMID" && !canceled()) {
+        m_riffData.setData(data);
+        m_riffData.open(QIODevice::ReadOnly);
+        QDataStream ds(&m_riffData);
+        m_smf->readFromStream(&ds);
+        m_riffData.close();
+    }
+}
+
+/* **************************************** *
+ * SMF (Standard MIDI file) format handling
+ * **************************************** */
+
+void SongLoader::smfUpdateLoadProgress()
+{
+    updateProgress(m_smf->getFilePos());
+}
+
+void SongLoader::appendSMFEvent(SequencerEvent* ev)
+{
+    if (canceled()) {
+        delete ev;
+        return;
+    }
+    unsigned long tick = m_smf->getCurrentTime();
+    ev->setSource(m_portId);
+    if (ev->getSequencerType() != SND_SEQ_EVENT_TEMPO) {
+        ev->setSubscribers();
+    }
+    ev->scheduleTick(m_queueId, tick, false);
+    m_song->append(ev);
+    if (tick > m_tick)
+        m_tick = tick;
+    smfUpdateLoadProgress();
+}
+
+void SongLoader::smfHeaderEvent(int format, int ntrks, int division)
+{
+    m_song->setHeader(format, ntrks, division);
+    smfUpdateLoadProgress();
+}
+
+void SongLoader::smfNoteOnEvent(int chan, int pitch, int vol)
+{
+    SequencerEvent* ev = new NoteOnEvent (chan, pitch, vol);
+    appendSMFEvent(ev);
+}
+
+void SongLoader::smfNoteOffEvent(int chan, int pitch, int vol)
+{
+    SequencerEvent* ev = new NoteOffEvent (chan, pitch, vol);
+    appendSMFEvent(ev);
+}
+
+void SongLoader::smfKeyPressEvent(int chan, int pitch, int press)
+{
+    SequencerEvent* ev = new KeyPressEvent (chan, pitch, press);
+    appendSMFEvent(ev);
+}
+
+void SongLoader::smfCtlChangeEvent(int chan, int ctl, int value)
+{
+    SequencerEvent* ev = new ControllerEvent (chan, ctl, value);
+    appendSMFEvent(ev);
+}
+
+void SongLoader::smfPitchBendEvent(int chan, int value)
+{
+    SequencerEvent* ev = new PitchBendEvent (chan, value);
+    appendSMFEvent(ev);
+}
+
+void SongLoader::smfProgramEvent(int chan, int patch)
+{
+    SequencerEvent* ev = new ProgramChangeEvent (chan, patch);
+    appendSMFEvent(ev);
+}
+
+void SongLoader::smfChanPressEvent(int chan, int press)
+{
+    SequencerEvent* ev = new ChanPressEvent (chan, press);
+    appendSMFEvent(ev);
+}
+
+void SongLoader::smfSysexEvent(const QByteArray& data)
+{
+    SequencerEvent* ev = new SysExEvent (data);
+    appendSMFEvent(ev);
+}
+
+void SongLoader::smfTempoEvent(int tempo)
+{
+    if ( m_initialTempo == 0 ) {
+        m_initialTempo = tempo;
+    }
+    SequencerEvent* ev = new TempoEvent (m_queueId, tempo);
+    appendSMFEvent(ev);
+}
+
+void SongLoader::smfErrorHandler(const QString& errorStr)
+{
+    if (m_loadingMessages.length() < 1024)
+        m_loadingMessages.append(QString("%1 at file offset %2<br>")
+                                 .arg(errorStr).arg(m_smf->getFilePos()));
+}
+
+void SongLoader::smfTrackStarted()
+{
+    m_currentTrack++;
+}
+
+void SongLoader::smfTrackEnded()
+{
+    if (m_currentTrack == m_smf->getTracks()) {
+        SequencerEvent* ev = new SystemEvent(SND_SEQ_EVENT_ECHO);
+        appendSMFEvent(ev);
+    }
+}
+
+/* ********************************* *
+ * Cakewalk WRK file format handling
+ * ********************************* */
+
+void SongLoader::wrkUpdateLoadProgress()
+{
+    updateProgress(m_wrk->getFilePos());
+}
+
+void
+SongLoader::appendWRKEvent(unsigned long ticks, SequencerEvent* ev)
+{
+    if (canceled()) {
+        delete ev;
+        return;
+    }
+    ev->setSource(m_portId);
+    if (ev->getSequencerType() != SND_SEQ_EVENT_TEMPO) {
+        ev->setSubscribers();
+    }
+    ev->scheduleTick(m_queueId, ticks, false);
+    m_song->append(ev);
+    if (ticks > m_tick)
+        m_tick = ticks;
+    wrkUpdateLoadProgress();
+}
+
+void SongLoader::wrkErrorHandler(const QString& errorStr)
+{
+    if (m_loadingMessages.length() < 1024) {
+        m_loadingMessages.append(QString("%1 at file offset %2<br>")
+            .arg(errorStr).arg(m_wrk->getFilePos()));
+    }
+}
+
+void SongLoader::wrkFileHeader(int /*verh*/, int /*verl*/)
+{
+    m_song->setHeader(1, 0, 120);
+    wrkUpdateLoadProgress();
+//    qDebug() << Q_FUNC_INFO;
+}
+
+void SongLoader::wrkTimeBase(int timebase)
+{
+    m_song->setDivision(timebase);
+    wrkUpdateLoadProgress();
+//    qDebug() << Q_FUNC_INFO << timebase;
+}
+
+void SongLoader::wrkStreamEndEvent(long time)
+{
+    unsigned long ticks = time;
+    if (ticks > m_tick)
+        m_tick = ticks;
+    wrkUpdateLoadProgress();
+//    qDebug() << Q_FUNC_INFO << time;
+}
+
+void SongLoader::wrkTrackHeader( const QString& /*name1*/,
+                           const QString& /*name2*/,
+                           int trackno, int channel,
+                           int pitch, int velocity, int /*port*/,
+                           bool /*selected*/, bool /*muted*/, bool /*loop*/ )
+{
+    TrackMapRec rec;
+    rec.channel = channel;
+    rec.pitch = pitch;
+    rec.velocity = velocity;
+    m_trackMap[trackno] = rec;
+    wrkUpdateLoadProgress();
+//    qDebug() << Q_FUNC_INFO << trackno << channel << pitch << velocity;
+}
+
+void SongLoader::wrkNoteEvent(int track, long time, int chan, int pitch, int vol, int dur)
+{
+    TrackMapRec rec = m_trackMap[track];
+    int channel = (rec.channel > -1) ? rec.channel : chan;
+    int key = qBound(0, pitch + rec.pitch, 127);
+    int velocity = qBound(0, vol + rec.velocity, 127);
+    SequencerEvent* ev = new NoteEvent(channel, key, velocity, dur);
+    appendWRKEvent(time, ev);
+//    qDebug() << Q_FUNC_INFO << channel << key << velocity << dur;
+}
+
+void SongLoader::wrkKeyPressEvent(int track, long time, int chan, int pitch, int press)
+{
+    TrackMapRec rec = m_trackMap[track];
+    int key = pitch + rec.pitch;
+    int channel = (rec.channel > -1) ? rec.channel : chan;
+    SequencerEvent* ev = new KeyPressEvent(channel, key, press);
+    appendWRKEvent(time, ev);
+//    qDebug() << Q_FUNC_INFO;
+}
+
+void SongLoader::wrkCtlChangeEvent(int track, long time, int chan, int ctl, int value)
+{
+    TrackMapRec rec = m_trackMap[track];
+    int channel = (rec.channel > -1) ? rec.channel : chan;
+    SequencerEvent* ev = new ControllerEvent(channel, ctl, value);
+    appendWRKEvent(time, ev);
+//    qDebug() << Q_FUNC_INFO;
+}
+
+void SongLoader::wrkPitchBendEvent(int track, long time, int chan, int value)
+{
+    TrackMapRec rec = m_trackMap[track];
+    int channel = (rec.channel > -1) ? rec.channel : chan;
+    SequencerEvent* ev = new PitchBendEvent(channel, value);
+    appendWRKEvent(time, ev);
+//    qDebug() << Q_FUNC_INFO;
+}
+
+void SongLoader::wrkProgramEvent(int track, long time, int chan, int patch)
+{
+    TrackMapRec rec = m_trackMap[track];
+    int channel = (rec.channel > -1) ? rec.channel : chan;
+    SequencerEvent* ev = new ProgramChangeEvent(channel, patch);
+    appendWRKEvent(time, ev);
+//    qDebug() << Q_FUNC_INFO;
+}
+
+void SongLoader::wrkChanPressEvent(int track, long time, int chan, int press)
+{
+    TrackMapRec rec = m_trackMap[track];
+    int channel = (rec.channel > -1) ? rec.channel : chan;
+    SequencerEvent* ev = new ChanPressEvent(channel, press);
+    appendWRKEvent(time, ev);
+//    qDebug() << Q_FUNC_INFO;
+}
+
+void SongLoader::wrkSysexEvent(int track, long time, int bank)
+{
+    Q_UNUSED(track)
+    if (m_savedSysexEvents.contains(bank)) {
+        SysExEvent* ev = m_savedSysexEvents[bank].clone();
+        appendWRKEvent(time, ev);
+        wrkUpdateLoadProgress();
+    }
+}
+
+void SongLoader::wrkSysexEventBank(int bank, const QString& /*name*/,
+        bool autosend, int /*port*/, const QByteArray& data)
+{
+    //qDebug() << Q_FUNC_INFO;
+    SysExEvent* ev = new SysExEvent(data);
+    if (autosend) {
+        appendWRKEvent(0, ev);
+    } else {
+        m_savedSysexEvents[bank] = *ev;
+        delete ev;
+    }
+    wrkUpdateLoadProgress();
+}
+
+void SongLoader::wrkTempoEvent(long time, int tempo)
+{
+    double bpm = tempo / 100.0;
+    if ( m_initialTempo < 0 )
+        m_initialTempo = qRound( bpm );
+    SequencerEvent* ev = new TempoEvent(m_queueId, qRound ( 6e7 / bpm ) );
+    appendWRKEvent(time, ev);
+//    qDebug() << Q_FUNC_INFO;
+}
+
+void SongLoader::wrkTrackPatch(int track, int patch)
+{
+    TrackMapRec rec = m_trackMap[track];
+    int channel = (rec.channel > -1) ? rec.channel : 0;
+    wrkProgramEvent(track, 0, channel, patch);
+//    qDebug() << Q_FUNC_INFO;
+}
+
+void SongLoader::wrkNewTrackHeader( const QString& /*name*/,
+                              int trackno, int channel,
+                              int pitch, int velocity, int /*port*/,
+                              bool /*selected*/, bool /*muted*/, bool /*loop*/ )
+{
+    TrackMapRec rec;
+    rec.channel = channel;
+    rec.pitch = pitch;
+    rec.velocity = velocity;
+    m_trackMap[trackno] = rec;
+    wrkUpdateLoadProgress();
+//    qDebug() << Q_FUNC_INFO << trackno << channel << pitch << velocity;
+}
+
+void SongLoader::wrkTrackVol(int track, int vol)
+{
+    int lsb, msb;
+    TrackMapRec rec = m_trackMap[track];
+    int channel = (rec.channel > -1) ? rec.channel : 0;
+    if (vol < 128)
+        wrkCtlChangeEvent(track, 0, channel, MIDI_CTL_MSB_MAIN_VOLUME, vol);
+    else {
+        lsb = vol % 0x80;
+        msb = vol / 0x80;
+        wrkCtlChangeEvent(track, 0, channel, MIDI_CTL_LSB_MAIN_VOLUME, lsb);
+        wrkCtlChangeEvent(track, 0, channel, MIDI_CTL_MSB_MAIN_VOLUME, msb);
+    }
+//    qDebug() << Q_FUNC_INFO;
+}
+
+void SongLoader::wrkTrackBank(int track, int bank)
+{
+    // assume GM/GS bank method
+    int lsb, msb;
+    TrackMapRec rec = m_trackMap[track];
+    int channel = (rec.channel > -1) ? rec.channel : 0;
+    lsb = bank % 0x80;
+    msb = bank / 0x80;
+    wrkCtlChangeEvent(track, 0, channel, MIDI_CTL_MSB_BANK, msb);
+    wrkCtlChangeEvent(track, 0, channel, MIDI_CTL_LSB_BANK, lsb);
+//    qDebug() << Q_FUNC_INFO;
+}
+
+void SongLoader::wrkEndOfFile()
+{
+    if (m_initialTempo < 0)
+        m_initialTempo = 120;
+    SequencerEvent* ev = new SystemEvent(SND_SEQ_EVENT_ECHO);
+    appendWRKEvent(m_tick, ev);
+//    qDebug() << Q_FUNC_INFO;
+}
+
+DISABLE_WARNING_POP
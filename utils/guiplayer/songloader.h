@@ -0,0 +1,146 @@
+/*
+    SMF GUI Player test using the MIDI Sequencer C++ library
+    Copyright (C) 2006-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCLUDED_SONGLOADER_H
+#define INCLUDED_SONGLOADER_H
+
+#include <QBuffer>
+#include <QFile>
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <atomic>
+#include <drumstick/alsaevent.h>
+
+namespace drumstick {
+    namespace File {
+        class QSmf;
+        class QWrk;
+        class Rmidi;
+    }
+}
+
+class Song;
+
+/*
+ * Parses SMF, WRK and RMI files into a new Song. It is meant to live in a
+ * worker thread: load requests are queued, and a newer request or cancel()
+ * makes the load in progress skip the rest of the file and drop the Song.
+ * The finished Song is handed over to the receiver of loadFinished(), which
+ * takes ownership.
+ */
+class SongLoader : public QObject
+{
+    Q_OBJECT
+public:
+    SongLoader(int portId, int queueId);
+    ~SongLoader();
+
+    int request(const QString& fileName);
+    void cancel();
+
+Q_SIGNALS:
+    void loadProgress(int request, int percent);
+    void loadFinished(int request, Song* song, const QString& messages);
+
+private Q_SLOTS:
+    void load(const QString& fileName, int request);
+
+    /* RMI slots */
+    void dataHandler(const QString &dataType, const QByteArray &data);
+
+    /* SMF slots */
+    void smfHeaderEvent(int format, int ntrks, int division);
+    void smfNoteOnEvent(int chan, int pitch, int vol);
+    void smfNoteOffEvent(int chan, int pitch, int vol);
+    void smfKeyPressEvent(int chan, int pitch, int press);
+    void smfCtlChangeEvent(int chan, int ctl, int value);
+    void smfPitchBendEvent(int chan, int value);
+    void smfProgramEvent(int chan, int patch);
+    void smfChanPressEvent(int chan, int press);
+    void smfSysexEvent(const QByteArray& data);
+    void smfTempoEvent(int tempo);
+    void smfErrorHandler(const QString& errorStr);
+    void smfTrackStarted();
+    void smfTrackEnded();
+    void smfUpdateLoadProgress();
+
+    /* WRK slots */
+    void wrkUpdateLoadProgress();
+    void wrkErrorHandler(const QString& errorStr);
+    void wrkFileHeader(int verh, int verl);
+    void wrkEndOfFile();
+    void wrkStreamEndEvent(long time);
+    void wrkTrackHeader(const QString& name1, const QString& name2,
+                     int trackno, int channel, int pitch,
+                     int velocity, int port,
+                     bool selected, bool muted, bool loop);
+    void wrkTimeBase(int timebase);
+    void wrkNoteEvent(int track, long time, int chan, int pitch, int vol, int dur);
+    void wrkKeyPressEvent(int track, long time, int chan, int pitch, int press);
+    void wrkCtlChangeEvent(int track, long time, int chan, int ctl, int value);
+    void wrkPitchBendEvent(int track, long time, int chan, int value);
+    void wrkProgramEvent(int track, long time, int chan, int patch);
+    void wrkChanPressEvent(int track, long time, int chan, int press);
+    void wrkSysexEvent(int track, long time, int bank);
+    void wrkSysexEventBank(int bank, const QString& name, bool autosend, int port, const QByteArray& data);
+    void wrkTempoEvent(long time, int tempo);
+    void wrkTrackPatch(int track, int patch);
+    void wrkNewTrackHeader(const QString& name,
+                        int trackno, int channel, int pitch,
+                        int velocity, int port,
+                        bool selected, bool muted, bool loop);
+    void wrkTrackVol(int track, int vol);
+    void wrkTrackBank(int track, int bank);
+
+private:
+    void appendSMFEvent(drumstick::ALSA::SequencerEvent* ev);
+    void appendWRKEvent(unsigned long ticks, drumstick::ALSA::SequencerEvent* ev);
+    void updateProgress(qint64 pos);
+    bool canceled();
+
+    int m_portId;
+    int m_queueId;
+    int m_current;
+    std::atomic<int> m_latest;
+    bool m_canceled;
+    int m_initialTempo;
+    int m_currentTrack;
+    int m_percent;
+    qint64 m_fileSize;
+    unsigned long m_tick;
+
+    drumstick::File::QSmf* m_smf;
+    drumstick::File::QWrk* m_wrk;
+    drumstick::File::Rmidi* m_rmi;
+    QFile m_file;       // the file being parsed
+    QBuffer m_riffData; // the SMF data of a RMI file
+    Song* m_song;
+    QString m_loadingMessages;
+
+    QHash<int, drumstick::ALSA::SysExEvent> m_savedSysexEvents;
+
+    struct TrackMapRec {
+        int channel;
+        int pitch;
+        int velocity;
+    };
+    QHash<int,TrackMapRec> m_trackMap;
+};
+
+#endif // INCLUDED_SONGLOADER_H
@@ -17,15 +17,20 @@
 */
 
 #include "playsmf.h"
+#include "songstream.h"
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QReadLocker>
+#include <QScopedPointer>
 #include <QTextStream>
+#include <QThread>
 #include <QWriteLocker>
 #include <QtAlgorithms>
 #include <csignal>
+#include <drumstick/notepairing.h>
 #include <drumstick/sequencererror.h>
 
 DISABLE_WARNING_PUSH
@@ -54,7 +59,7 @@ static inline bool eventLessThan(const SequencerEvent* s1, const SequencerEvent
 
 void Song::sort()
 {
-    std::sort(begin(), end(), eventLessThan);
+    std::stable_sort(begin(), end(), eventLessThan);
 }
 
 void Song::clear()
@@ -77,7 +82,8 @@ PlaySMF::PlaySMF() :
     m_portId(-1),
     m_queueId(-1),
     m_initialTempo(-1),
-    m_Stopped(true)
+    m_Stopped(true),
+    m_stats()
 {
     m_Client = new MidiClient(this);
     m_Client->open();
@@ -278,6 +284,7 @@ void PlaySMF::play(QString fileName)
     cout << "___time ch event__________ data____" << endl;
     m_engine->readFromFile(fileName);
     m_song.sort();
+    NotePairing().pairNotes(m_song);
     m_Client->setPoolOutput(100);
 
     QueueTempo firstTempo = m_Queue->getTempo();
@@ -312,6 +319,168 @@ void PlaySMF::play(QString fileName)
     }
 }
 
+/*
+ * Streaming playback: the tracks of each file are merged while playing, and
+ * the events are sent in batches covering the lookahead time (milliseconds)
+ * ahead of the queue position, with a single drain per batch. The files are
+ * played as a gapless playlist, reading the next one in a separate thread
+ * while the current one plays.
+ */
+void PlaySMF::stream(const QStringList& fileNames, int lookahead)
+{
+    if (fileNames.isEmpty()) {
+        return;
+    }
+    QElapsedTimer clock;
+    clock.start();
+    SongReader reader(m_queueId);
+    reader.read(fileNames.first());
+    QScopedPointer<TrackSong> song(reader.take());
+    m_stats.loadWait += clock.elapsed();
+    // all the songs are scheduled using the resolution of the first one
+    const int ppq = song->division() > 0 ? song->division() : 96;
+    m_Client->setPoolOutput(STREAM_POOL);
+    m_Client->setOutputBufferSize(STREAM_BUFFER);
+
+    QueueTempo firstTempo = m_Queue->getTempo();
+    firstTempo.setPPQ(ppq);
+    firstTempo.setTempo(static_cast<unsigned int>(song->initialTempo()));
+    m_Queue->setTempo(firstTempo);
+    m_Client->drainOutput();
+    cout << "Starting playback" << endl;
+    cout << "Press Ctrl+C to exit" << endl;
+    try {
+        unsigned int offset = 0;
+        m_Stopped = false;
+        m_Queue->start();
+        for (int i = 0; i < fileNames.count() && !stopped(); ++i) {
+            cout << "Playing song: " << fileNames[i] << endl;
+            foreach(const QString& warning, song->warnings()) {
+                cout << "*** Warning! " << warning << endl;
+            }
+            if (i + 1 < fileNames.count()) {
+                reader.read(fileNames[i + 1]);
+            }
+            m_stats.loadTime += song->loadTime();
+            if (song->division() > 0) {
+                offset = streamSong(*song, offset, ppq, lookahead);
+                m_stats.files++;
+            }
+            if (i + 1 < fileNames.count()) {
+                QElapsedTimer waiting;
+                waiting.start();
+                song.reset(reader.take());
+                m_stats.loadWait += waiting.elapsed();
+            }
+        }
+        if (stopped()) {
+            m_Queue->clear();
+            shutupSound();
+        } else {
+            m_Client->drainOutput();
+            m_Client->synchronizeOutput();
+        }
+        m_Queue->stop();
+    } catch (const SequencerError& err) {
+        cerr << "SequencerError exception. Error code: " << err.code()
+             << " (" << err.qstrError() << ")" << endl;
+        cerr << "Location: " << err.location() << endl;
+        throw;
+    }
+    m_stats.playTime = clock.elapsed();
+}
+
+/*
+ * Sends the events of a song starting at the offset (in queue ticks), and
+ * returns the tick where the next song begins
+ */
+unsigned int PlaySMF::streamSong(const TrackSong& song, unsigned int offset, int ppq, int lookahead)
+{
+    const int division = song.division();
+    auto scaled = [=](unsigned long tick) {
+        return offset + static_cast<unsigned int>((tick * ppq + division / 2) / division);
+    };
+    const size_t bufferSize = m_Client->getOutputBufferSize();
+    unsigned long tempo = static_cast<unsigned long>(song.initialTempo());
+    QElapsedTimer timer;
+    TrackMerger merger(song);
+    if (offset > 0) {
+        // the tempo of the previous song does not apply to this one
+        TempoEvent ev(m_queueId, song.initialTempo());
+        ev.setSource(static_cast<unsigned char>(m_portId));
+        ev.scheduleTick(m_queueId, static_cast<int>(offset), false);
+        m_Client->output(&ev);
+    }
+    while (!stopped() && !merger.atEnd()) {
+        const unsigned int now = m_Queue->getStatus().getTickTime();
+        const unsigned long horizon = now + static_cast<unsigned long>(lookahead) * 1000 * ppq / qMax(1ul, tempo);
+        size_t used = 0;
+        int batch = 0;
+        while (!merger.atEnd()) {
+            const snd_seq_event_t& rec = merger.current();
+            const unsigned int tick = scaled(rec.time.tick);
+            if (tick > horizon) {
+                break;
+            }
+            const size_t size = sizeof(snd_seq_event_t) + (snd_seq_ev_is_variable(&rec) ? rec.data.ext.len : 0);
+            if (batch > 0 && used + size > bufferSize) {
+                break;
+            }
+            *m_event.getHandle() = rec;
+            m_event.setSource(static_cast<unsigned char>(m_portId));
+            if (rec.type == SND_SEQ_EVENT_TEMPO) {
+                tempo = static_cast<unsigned long>(rec.data.queue.param.value);
+            } else {
+                m_event.setSubscribers();
+            }
+            m_event.scheduleTick(m_queueId, static_cast<int>(tick), false);
+            if (size > bufferSize) {
+                m_Client->outputDirect(&m_event);
+            } else {
+                m_Client->outputBuffer(&m_event);
+            }
+            if (tick < now) {
+                m_stats.lateEvents++;
+            }
+            used += size;
+            batch++;
+            merger.next();
+        }
+        if (batch > 0) {
+            timer.start();
+            m_Client->drainOutput();
+            const qint64 drain = timer.nsecsElapsed();
+            m_stats.drainTime += drain;
+            m_stats.maxDrain = qMax(m_stats.maxDrain, drain);
+            m_stats.events += batch;
+            m_stats.batches++;
+            m_stats.maxBatch = qMax(m_stats.maxBatch, batch);
+        } else {
+            QThread::msleep(static_cast<unsigned long>(qMax(1, lookahead / 4)));
+        }
+    }
+    return scaled(song.length());
+}
+
+void PlaySMF::printStats()
+{
+    if (m_stats.files == 0) {
+        return;
+    }
+    cout << "Streaming statistics:" << endl;
+    cout << "  songs: " << m_stats.files
+         << ", events: " << m_stats.events
+         << ", elapsed: " << m_stats.playTime << " ms" << endl;
+    cout << "  batches: " << m_stats.batches
+         << ", average size: " << (m_stats.batches > 0 ? m_stats.events / m_stats.batches : 0)
+         << ", maximum size: " << m_stats.maxBatch << endl;
+    cout << "  drain time: " << m_stats.drainTime / 1000000 << " ms"
+         << ", maximum: " << m_stats.maxDrain / 1000 << " us" << endl;
+    cout << "  loading time: " << m_stats.loadTime << " ms"
+         << ", waiting for the songs: " << m_stats.loadWait << " ms" << endl;
+    cout << "  late events: " << m_stats.lateEvents << endl;
+}
+
 static PlaySMF* player = nullptr;
 
 void signalHandler(int sig)
@@ -347,6 +516,12 @@ int main(int argc, char **argv)
     auto versionOption = parser.addVersionOption();
     QCommandLineOption portOption({"p","port"}, "Destination, MIDI port.", "client:port");
     parser.addOption(portOption);
+    QCommandLineOption streamOption({"s","stream"}, "Streaming mode: merge the tracks while playing, "
+        "and play the files as a gapless playlist.");
+    parser.addOption(streamOption);
+    QCommandLineOption lookaheadOption({"l","lookahead"}, "Streaming lookahead in milliseconds (default 500).",
+        "ms", "500");
+    parser.addOption(lookaheadOption);
     parser.addPositionalArgument("file", "Input SMF File(s).", "files...");
     parser.process(app);
 
@@ -368,10 +543,22 @@ int main(int argc, char **argv)
             cerr << "No input files" << endl;
             parser.showHelp();
         }
-        foreach(const QString& f, files) {
-            QFileInfo file(f);
-            if (file.exists())
-                player->play(file.canonicalFilePath());
+        if (parser.isSet(streamOption)) {
+            QStringList playlist;
+            foreach(const QString& f, files) {
+                QFileInfo file(f);
+                if (file.exists())
+                    playlist << file.canonicalFilePath();
+            }
+            int lookahead = qBound(10, parser.value(lookaheadOption).toInt(), 10000);
+            player->stream(playlist, lookahead);
+            player->printStats();
+        } else {
+            foreach(const QString& f, files) {
+                QFileInfo file(f);
+                if (file.exists())
+                    player->play(file.canonicalFilePath());
+            }
         }
     } catch (const SequencerError& ex) {
         cerr << ERRORSTR << " Returned error was: " << ex.qstrError() << endl;
@@ -21,6 +21,7 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <QList>
 #include <QReadWriteLock>
 
@@ -30,6 +31,8 @@
 #include <drumstick/alsaqueue.h>
 #include <drumstick/alsaport.h>
 
+class TrackSong;
+
 class Song : public QList<drumstick::ALSA::SequencerEvent*>
 {
 public:
@@ -46,6 +49,8 @@ public:
     PlaySMF();
     virtual ~PlaySMF();
     void play(QString fileName);
+    void stream(const QStringList& fileNames, int lookahead);
+    void printStats();
     bool stopped();
     void stop();
     void appendEvent(drumstick::ALSA::SequencerEvent* ev);
@@ -71,6 +76,24 @@ public Q_SLOTS:
     void errorHandler(const QString& errorStr);
 
 private:
+    static const int STREAM_POOL = 2000;       // kernel output pool, in events
+    static const size_t STREAM_BUFFER = 32768; // library output buffer, in bytes
+
+    unsigned int streamSong(const TrackSong& song, unsigned int offset, int ppq, int lookahead);
+
+    struct StreamStats {
+        int files;
+        qint64 events;
+        qint64 batches;
+        int maxBatch;
+        qint64 lateEvents;
+        qint64 drainTime;   // nanoseconds
+        qint64 maxDrain;    // nanoseconds
+        qint64 loadTime;    // milliseconds
+        qint64 loadWait;    // milliseconds
+        qint64 playTime;    // milliseconds
+    };
+
     int m_division;
     int m_portId;
     int m_queueId;
@@ -78,6 +101,8 @@ private:
     bool m_Stopped;
     QReadWriteLock m_mutex;
     Song m_song;
+    StreamStats m_stats;
+    drumstick::ALSA::SequencerEvent m_event;
     drumstick::File::QSmf* m_engine;
     drumstick::ALSA::MidiClient* m_Client;
     drumstick::ALSA::MidiPort* m_Port;
@@ -10,5 +10,5 @@ INCLUDEPATH += . ../../library/include
 LIBS = -L../../build/lib -ldrumstick-alsa -ldrumstick-file -lasound
 include (../../global.pri)
 # Input
-HEADERS += playsmf.h
-SOURCES += playsmf.cpp
+HEADERS += playsmf.h songstream.h
+SOURCES += playsmf.cpp songstream.cpp
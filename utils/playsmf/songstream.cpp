@@ -0,0 +1,218 @@
+/*
+    Standard MIDI File player program
+    Copyright (C) 2006-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "songstream.h"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <drumstick/alsaevent.h>
+#include <drumstick/qsmf.h>
+
+using namespace drumstick;
+using namespace ALSA;
+using namespace File;
+
+/* ************** *
+ * TrackSong class
+ * ************** */
+
+TrackSong::TrackSong() :
+    m_division(-1),
+    m_initialTempo(-1),
+    m_length(0),
+    m_loadTime(0)
+{ }
+
+int TrackSong::eventCount() const
+{
+    int count = 0;
+    foreach(const QVector<snd_seq_event_t>& t, m_tracks) {
+        count += t.count();
+    }
+    return count;
+}
+
+/* *************** *
+ * SongReader class
+ * *************** */
+
+SongReader::SongReader(int queueId) :
+    m_queueId(queueId),
+    m_song(nullptr)
+{ }
+
+SongReader::~SongReader()
+{
+    wait();
+    delete m_song;
+}
+
+/*
+ * Starts reading a file. The song is retrieved later with take()
+ */
+void SongReader::read(const QString& fileName)
+{
+    wait();
+    delete m_song;
+    m_song = nullptr;
+    m_fileName = fileName;
+    start(QThread::LowPriority);
+}
+
+/*
+ * Waits until the file is read, and returns the new song
+ */
+TrackSong* SongReader::take()
+{
+    wait();
+    TrackSong* song = m_song;
+    m_song = nullptr;
+    return song;
+}
+
+void SongReader::run()
+{
+    QElapsedTimer clock;
+    clock.start();
+    TrackSong* song = new TrackSong;
+    QSmf smf;
+    QVector<snd_seq_event_t>* track = nullptr;
+
+    auto append = [&](SequencerEvent& ev) {
+        if (track == nullptr) {
+            song->m_tracks.append(QVector<snd_seq_event_t>());
+            track = &song->m_tracks.last();
+        }
+        snd_seq_event_t rec = *ev.getHandle();
+        rec.time.tick = static_cast<snd_seq_tick_time_t>(smf.getCurrentTime());
+        track->append(rec);
+    };
+
+    QObject::connect(&smf, &QSmf::signalSMFHeader, [&](int, int, int division) {
+        song->m_division = division;
+    });
+    QObject::connect(&smf, &QSmf::signalSMFTrackStart, [&] {
+        song->m_tracks.append(QVector<snd_seq_event_t>());
+        track = &song->m_tracks.last();
+    });
+    QObject::connect(&smf, &QSmf::signalSMFendOfTrack, [&] {
+        song->m_length = qMax(song->m_length, static_cast<unsigned long>(smf.getCurrentTime()));
+    });
+    QObject::connect(&smf, &QSmf::signalSMFNoteOn, [&](int chan, int pitch, int vol) {
+        NoteOnEvent ev(chan, pitch, vol);
+        append(ev);
+    });
+    QObject::connect(&smf, &QSmf::signalSMFNoteOff, [&](int chan, int pitch, int vol) {
+        NoteOffEvent ev(chan, pitch, vol);
+        append(ev);
+    });
+    QObject::connect(&smf, &QSmf::signalSMFKeyPress, [&](int chan, int pitch, int press) {
+        KeyPressEvent ev(chan, pitch, press);
+        append(ev);
+    });
+    QObject::connect(&smf, &QSmf::signalSMFCtlChange, [&](int chan, int ctl, int value) {
+        ControllerEvent ev(chan, ctl, value);
+        append(ev);
+    });
+    QObject::connect(&smf, &QSmf::signalSMFPitchBend, [&](int chan, int value) {
+        PitchBendEvent ev(chan, value);
+        append(ev);
+    });
+    QObject::connect(&smf, &QSmf::signalSMFProgram, [&](int chan, int patch) {
+        ProgramChangeEvent ev(chan, patch);
+        append(ev);
+    });
+    QObject::connect(&smf, &QSmf::signalSMFChanPress, [&](int chan, int press) {
+        ChanPressEvent ev(chan, press);
+        append(ev);
+    });
+    QObject::connect(&smf, &QSmf::signalSMFSysex, [&](const QByteArray& data) {
+        // the record points to a payload owned by the song
+        song->m_sysex.append(data);
+        SysExEvent ev(song->m_sysex.last());
+        append(ev);
+        snd_seq_event_t& rec = track->last();
+        rec.data.ext.len = static_cast<unsigned int>(song->m_sysex.last().size());
+        rec.data.ext.ptr = song->m_sysex.last().data();
+    });
+    QObject::connect(&smf, &QSmf::signalSMFTempo, [&](int tempo) {
+        if (song->m_initialTempo < 0) {
+            song->m_initialTempo = tempo;
+        }
+        TempoEvent ev(m_queueId, tempo);
+        append(ev);
+    });
+    QObject::connect(&smf, &QSmf::signalSMFError, [&](const QString& errorStr) {
+        song->m_warnings << QString("%1 at file offset %2").arg(errorStr).arg(smf.getFilePos());
+    });
+
+    try {
+        smf.readFromFile(m_fileName);
+    } catch (...) {
+        song->m_tracks.clear();
+    }
+    if (song->m_initialTempo < 0) {
+        song->m_initialTempo = 500000;
+    }
+    foreach(const QVector<snd_seq_event_t>& t, song->m_tracks) {
+        if (!t.isEmpty()) {
+            song->m_length = qMax(song->m_length, static_cast<unsigned long>(t.last().time.tick));
+        }
+    }
+    song->m_loadTime = clock.elapsed();
+    m_song = song;
+}
+
+/* **************** *
+ * TrackMerger class
+ * **************** */
+
+TrackMerger::TrackMerger(const TrackSong& song) :
+    m_song(song)
+{
+    m_heap.reserve(song.trackCount());
+    for (int i = 0; i < song.trackCount(); ++i) {
+        if (!song.track(i).isEmpty()) {
+            m_heap.push_back({song.track(i).first().time.tick, i, 0});
+        }
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), later);
+}
+
+bool TrackMerger::later(const TrackMerger::Cursor& a, const TrackMerger::Cursor& b)
+{
+    return a.tick > b.tick || (a.tick == b.tick && a.track > b.track);
+}
+
+const snd_seq_event_t& TrackMerger::current() const
+{
+    const Cursor& c = m_heap.front();
+    return m_song.track(c.track).at(c.index);
+}
+
+void TrackMerger::next()
+{
+    std::pop_heap(m_heap.begin(), m_heap.end(), later);
+    Cursor& c = m_heap.back();
+    const QVector<snd_seq_event_t>& events = m_song.track(c.track);
+    if (++c.index < events.count()) {
+        c.tick = events.at(c.index).time.tick;
+        std::push_heap(m_heap.begin(), m_heap.end(), later);
+    } else {
+        m_heap.pop_back();
+    }
+}
@@ -0,0 +1,109 @@
+/*
+    Standard MIDI File player program
+    Copyright (C) 2006-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SONGSTREAM_H_
+#define SONGSTREAM_H_
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <alsa/asoundlib.h>
+#include <vector>
+
+/*
+ * A song kept as one list of compact event records per track. The records
+ * of each track are already sorted by time in the file, so the tracks are
+ * merged while playing instead of sorting the whole song.
+ */
+class TrackSong
+{
+public:
+    TrackSong();
+
+    int division() const { return m_division; }
+    int initialTempo() const { return m_initialTempo; }
+    unsigned long length() const { return m_length; }
+    int trackCount() const { return m_tracks.count(); }
+    const QVector<snd_seq_event_t>& track(int i) const { return m_tracks.at(i); }
+    int eventCount() const;
+    const QStringList& warnings() const { return m_warnings; }
+    qint64 loadTime() const { return m_loadTime; }
+
+private:
+    friend class SongReader;
+
+    int m_division;
+    int m_initialTempo;
+    unsigned long m_length;
+    qint64 m_loadTime;
+    QVector<QVector<snd_seq_event_t>> m_tracks;
+    QList<QByteArray> m_sysex; // payloads of the sysex records
+    QStringList m_warnings;
+};
+
+/*
+ * Parses a SMF file into a new TrackSong in its own thread, so the next song
+ * of a playlist is ready when the current one ends.
+ */
+class SongReader : public QThread
+{
+public:
+    explicit SongReader(int queueId);
+    ~SongReader() override;
+
+    void read(const QString& fileName);
+    TrackSong* take();
+
+protected:
+    void run() override;
+
+private:
+    int m_queueId;
+    QString m_fileName;
+    TrackSong* m_song;
+};
+
+/*
+ * K-way merge of the tracks of a TrackSong, by time and then by track
+ * number, using a binary heap of track cursors.
+ */
+class TrackMerger
+{
+public:
+    explicit TrackMerger(const TrackSong& song);
+
+    bool atEnd() const { return m_heap.empty(); }
+    const snd_seq_event_t& current() const;
+    void next();
+
+private:
+    struct Cursor {
+        unsigned int tick;
+        int track;
+        int index;
+    };
+    static bool later(const Cursor& a, const Cursor& b);
+
+    const TrackSong& m_song;
+    std::vector<Cursor> m_heap;
+};
+
+#endif /*SONGSTREAM_H_*/
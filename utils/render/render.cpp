@@ -0,0 +1,268 @@
+/*
+    Offline MIDI rendering program
+    Copyright (C) 2006-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "render.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSettings>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtPlugin>
+#include <atomic>
+#include <drumstick/backendmanager.h>
+
+#if defined(FLUIDSYNTH_BACKEND)
+Q_IMPORT_PLUGIN(FluidSynthOutput)
+#endif
+
+#if defined(SONIVOX_BACKEND)
+Q_IMPORT_PLUGIN(SynthController)
+#endif
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+#define endl Qt::endl
+#endif
+
+using namespace drumstick::rt;
+using drumstick::File::QSmf;
+
+QTextStream cout(stdout, QIODevice::WriteOnly);
+QTextStream cerr(stderr, QIODevice::WriteOnly);
+static QMutex outputMutex;
+static std::atomic<int> failures{0};
+
+SongLoader::SongLoader():
+    m_engine(new QSmf(this)),
+    m_song(nullptr),
+    m_track(0)
+{
+    connect(m_engine, &QSmf::signalSMFHeader, this, &SongLoader::headerEvent);
+    connect(m_engine, &QSmf::signalSMFTrackStart, this, &SongLoader::trackStartEvent);
+    connect(m_engine, &QSmf::signalSMFNoteOn, this, &SongLoader::noteOnEvent);
+    connect(m_engine, &QSmf::signalSMFNoteOff, this, &SongLoader::noteOffEvent);
+    connect(m_engine, &QSmf::signalSMFKeyPress, this, &SongLoader::keyPressEvent);
+    connect(m_engine, &QSmf::signalSMFCtlChange, this, &SongLoader::ctlChangeEvent);
+    connect(m_engine, &QSmf::signalSMFPitchBend, this, &SongLoader::pitchBendEvent);
+    connect(m_engine, &QSmf::signalSMFProgram, this, &SongLoader::programEvent);
+    connect(m_engine, &QSmf::signalSMFChanPress, this, &SongLoader::chanPressEvent);
+    connect(m_engine, &QSmf::signalSMFSysex, this, &SongLoader::sysexEvent);
+    connect(m_engine, &QSmf::signalSMFTempo, this, &SongLoader::tempoEvent);
+    connect(m_engine, &QSmf::signalSMFError, this, &SongLoader::errorHandler);
+}
+
+bool SongLoader::load(const QString &fileName, MIDISong &song)
+{
+    m_song = &song;
+    m_track = 0;
+    m_error.clear();
+    song.clear();
+    m_engine->readFromFile(fileName);
+    song.finalize();
+    m_song = nullptr;
+    return m_error.isEmpty() && !song.isEmpty();
+}
+
+QString SongLoader::errorString() const
+{
+    return m_error.isEmpty() ? QStringLiteral("empty song") : m_error;
+}
+
+void SongLoader::headerEvent(int format, int ntrks, int division)
+{
+    Q_UNUSED(format)
+    Q_UNUSED(ntrks)
+    m_song->setDivision(division);
+}
+
+void SongLoader::trackStartEvent()
+{
+    m_track++;
+}
+
+void SongLoader::noteOnEvent(int chan, int pitch, int vol)
+{
+    m_song->addMessage(m_engine->getCurrentTime(), m_track, MIDI_STATUS_NOTEON + chan, pitch, vol);
+}
+
+void SongLoader::noteOffEvent(int chan, int pitch, int vol)
+{
+    m_song->addMessage(m_engine->getCurrentTime(), m_track, MIDI_STATUS_NOTEOFF + chan, pitch, vol);
+}
+
+void SongLoader::keyPressEvent(int chan, int pitch, int press)
+{
+    m_song->addMessage(m_engine->getCurrentTime(), m_track, MIDI_STATUS_KEYPRESURE + chan, pitch, press);
+}
+
+void SongLoader::ctlChangeEvent(int chan, int ctl, int value)
+{
+    m_song->addMessage(m_engine->getCurrentTime(), m_track, MIDI_STATUS_CONTROLCHANGE + chan, ctl, value);
+}
+
+void SongLoader::pitchBendEvent(int chan, int value)
+{
+    m_song->addPitchBend(m_engine->getCurrentTime(), m_track, chan, value);
+}
+
+void SongLoader::programEvent(int chan, int patch)
+{
+    m_song->addMessage(m_engine->getCurrentTime(), m_track, MIDI_STATUS_PROGRAMCHANGE + chan, patch);
+}
+
+void SongLoader::chanPressEvent(int chan, int press)
+{
+    m_song->addMessage(m_engine->getCurrentTime(), m_track, MIDI_STATUS_CHANNELPRESSURE + chan, press);
+}
+
+void SongLoader::sysexEvent(const QByteArray &data)
+{
+    m_song->addSysex(m_engine->getCurrentTime(), m_track, data);
+}
+
+void SongLoader::tempoEvent(int tempo)
+{
+    m_song->addTempo(m_engine->getCurrentTime(), tempo);
+}
+
+void SongLoader::errorHandler(const QString &errorStr)
+{
+    if (m_error.isEmpty()) {
+        m_error = QString("%1 at file offset %2").arg(errorStr).arg(m_engine->getFilePos());
+    }
+}
+
+RenderJob::RenderJob(MIDIOutput *backend, const QString &input, const QString &output):
+    m_backend(backend),
+    m_input(input),
+    m_output(output)
+{ }
+
+void RenderJob::run()
+{
+    SongLoader loader;
+    MIDISong song;
+    if (!loader.load(m_input, song)) {
+        QMutexLocker locker(&outputMutex);
+        cerr << m_input << ": " << loader.errorString() << endl;
+        failures++;
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = false;
+    QMetaObject::invokeMethod(m_backend, "renderSong", Qt::DirectConnection,
+                              Q_RETURN_ARG(bool, ok),
+                              Q_ARG(drumstick::rt::MIDISong, song),
+                              Q_ARG(QString, m_output));
+    const double elapsed = timer.nsecsElapsed() / 1e9;
+    QMutexLocker locker(&outputMutex);
+    if (ok) {
+        const double length = song.lengthTime() / 1e6;
+        cout << m_output << ": " << QString::number(length, 'f', 1) << " s rendered in "
+             << QString::number(elapsed, 'f', 2) << " s (x"
+             << QString::number(elapsed > 0 ? length / elapsed : 0.0, 'f', 1) << ")" << endl;
+    } else {
+        cerr << m_input << ": rendering failed" << endl;
+        failures++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const QString PGM_NAME = QStringLiteral("drumstick-render");
+    const QString PGM_DESCRIPTION = QStringLiteral("Drumstick command line utility for rendering SMF (Standard MIDI) files to WAVE audio files");
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("drumstick.sourceforge.net");
+    QCoreApplication::setOrganizationDomain("drumstick.sourceforge.net");
+    QCoreApplication::setApplicationName(PGM_NAME);
+    QCoreApplication::setApplicationVersion(QStringLiteral(QT_STRINGIFY(VERSION)));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(PGM_DESCRIPTION);
+    auto helpOption = parser.addHelpOption();
+    auto versionOption = parser.addVersionOption();
+    QCommandLineOption backendOption({"b", "backend"}, "Synthesizer backend name (default: FluidSynth).", "name", "FluidSynth");
+    QCommandLineOption dirOption({"o", "output-dir"}, "Output directory (default: the input file directory).", "dir");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Number of parallel renders (default: one per core).", "n",
+                                  QString::number(QThread::idealThreadCount()));
+    QCommandLineOption configOption({"c", "config"}, "Settings file, with the backend preferences.", "file");
+    QCommandLineOption soundfontOption({"s", "soundfont"}, "Soundfont (FluidSynth) or DLS (SonivoxEAS) file.", "file");
+    parser.addOption(backendOption);
+    parser.addOption(dirOption);
+    parser.addOption(jobsOption);
+    parser.addOption(configOption);
+    parser.addOption(soundfontOption);
+    parser.addPositionalArgument("file", "Input SMF file name.", "files...");
+    parser.process(app);
+
+    if (parser.isSet(versionOption) || parser.isSet(helpOption)) {
+        return 0;
+    }
+
+    QStringList fileNames, positionalArgs = parser.positionalArguments();
+    if (positionalArgs.isEmpty()) {
+        cerr << "Input file name(s) missing" << endl;
+        parser.showHelp();
+    }
+    foreach(const QString& a, positionalArgs) {
+        QFileInfo f(a);
+        if (f.exists())
+            fileNames += f.canonicalFilePath();
+        else
+            cerr << "File not found: " << a << endl;
+    }
+
+    QScopedPointer<QSettings> settings(parser.isSet(configOption) ?
+        new QSettings(parser.value(configOption), QSettings::IniFormat) : new QSettings());
+    if (parser.isSet(soundfontOption)) {
+        // the preferences group of the synthesizer backends is named after the backend
+        settings->setValue(parser.value(backendOption) + "/InstrumentsDefinition",
+                           QFileInfo(parser.value(soundfontOption)).absoluteFilePath());
+    }
+
+    BackendManager man;
+    man.refresh(settings.data());
+    MIDIOutput *output = man.outputBackendByName(parser.value(backendOption));
+    if (output == nullptr) {
+        cerr << "Backend not found: " << parser.value(backendOption) << endl;
+        return 1;
+    }
+    if (output->metaObject()->indexOfMethod("renderSong(drumstick::rt::MIDISong,QString)") < 0) {
+        cerr << "Backend " << output->backendName() << " does not support offline rendering" << endl;
+        return 1;
+    }
+    QMetaObject::invokeMethod(output, "readSettings", Qt::DirectConnection, Q_ARG(QSettings*, settings.data()));
+
+    QDir outDir(parser.value(dirOption));
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, parser.value(jobsOption).toInt()));
+    foreach(const QString& file, fileNames) {
+        QFileInfo info(file);
+        const QString wav = (parser.isSet(dirOption) ? outDir.absolutePath() : info.absolutePath())
+                + QDir::separator() + info.completeBaseName() + QStringLiteral(".wav");
+        pool.start(new RenderJob(output, file, wav));
+    }
+    pool.waitForDone();
+    return failures;
+}
@@ -0,0 +1,72 @@
+/*
+    Offline MIDI rendering program
+    Copyright (C) 2006-2025, Pedro Lopez-Cabanillas <plcl@users.sf.net>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RENDER_H_
+#define RENDER_H_
+
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+
+#include <drumstick/qsmf.h>
+#include <drumstick/rtmidioutput.h>
+#include <drumstick/rtmidisequencer.h>
+
+class SongLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    SongLoader();
+    bool load(const QString &fileName, drumstick::rt::MIDISong &song);
+    QString errorString() const;
+
+public Q_SLOTS:
+    void headerEvent(int format, int ntrks, int division);
+    void trackStartEvent();
+    void noteOnEvent(int chan, int pitch, int vol);
+    void noteOffEvent(int chan, int pitch, int vol);
+    void keyPressEvent(int chan, int pitch, int press);
+    void ctlChangeEvent(int chan, int ctl, int value);
+    void pitchBendEvent(int chan, int value);
+    void programEvent(int chan, int patch);
+    void chanPressEvent(int chan, int press);
+    void sysexEvent(const QByteArray &data);
+    void tempoEvent(int tempo);
+    void errorHandler(const QString &errorStr);
+
+private:
+    drumstick::File::QSmf *m_engine;
+    drumstick::rt::MIDISong *m_song;
+    int m_track;
+    QString m_error;
+};
+
+class RenderJob : public QRunnable
+{
+public:
+    RenderJob(drumstick::rt::MIDIOutput *backend, const QString &input, const QString &output);
+    void run() override;
+
+private:
+    drumstick::rt::MIDIOutput *m_backend;
+    QString m_input;
+    QString m_output;
+};
+
+#endif /*RENDER_H_*/
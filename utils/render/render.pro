@@ -0,0 +1,25 @@
+TEMPLATE = app
+TARGET = drumstick-render
+CONFIG += c++11 cmdline qt thread
+equals(QT_MAJOR_VERSION, 6) {
+    QT += core5compat
+}
+static {
+    CONFIG += link_prl
+    DEFINES += DRUMSTICK_STATIC
+}
+DESTDIR = ../../build/bin
+INCLUDEPATH += . ../../library/include
+include (../../global.pri)
+# Input
+HEADERS += render.h
+SOURCES += render.cpp
+
+macx:!static {
+    QMAKE_LFLAGS += -F$$OUT_PWD/../../build/lib -L$$OUT_PWD/../../build/lib
+    LIBS += -framework drumstick-file -framework drumstick-rt
+} else {
+    LIBS = -L$$OUT_PWD/../../build/lib \
+        -l$$drumstickLib(drumstick-file) \
+        -l$$drumstickLib(drumstick-rt)
+}
@@ -6,6 +6,7 @@ SUBDIRS += \
    dumprmi \
    dumpsmf \
    dumpwrk \
+   render \
    vpiano
 
 linux {
@@ -22,6 +22,7 @@
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QActionGroup>
+#include <QDockWidget>
 #if defined(Q_OS_MACOS)
 #include <CoreFoundation/CoreFoundation.h>
 #endif
@@ -45,6 +46,15 @@ VPiano::VPiano(QWidget *parent, Qt::WindowFlags flags)
     , m_midiOut{nullptr}
 {
     ui.setupUi(this);
+    ui.pianokeybd->setBatchedDisplay(true);
+
+    m_meter = new ActivityMeter(this);
+    QDockWidget* meterDock = new QDockWidget(tr("MIDI Input Activity"), this);
+    meterDock->setObjectName("meterDock");
+    meterDock->setWidget(m_meter);
+    addDockWidget(Qt::BottomDockWidgetArea, meterDock);
+    meterDock->hide();
+    ui.menuView->addAction(meterDock->toggleViewAction());
 
     connect(ui.pianokeybd, &PianoKeybd::noteOn, this, QOverload<int,int>::of(&VPiano::slotNoteOn));
     connect(ui.pianokeybd, &PianoKeybd::noteOff, this, QOverload<int,int>::of(&VPiano::slotNoteOff));
@@ -116,8 +126,6 @@ void VPiano::initialize()
     readSettings();
 
     m_manager->refresh(VPianoSettings::instance()->settingsMap());
-    m_inputs = m_manager->availableInputs();
-    m_outputs = m_manager->availableOutputs();
 
     m_midiIn = m_manager->findInput(VPianoSettings::instance()->lastInputBackend());
     if (m_midiIn == nullptr) {
@@ -131,12 +139,8 @@ void VPiano::initialize()
 
     drumstick::widgets::SettingsFactory settings;
     if (m_midiIn != nullptr) {
-        connect(m_midiIn, &MIDIInput::midiNoteOn,
-                this, QOverload<int,int,int>::of(&VPiano::slotNoteOn),
-                Qt::QueuedConnection);
-        connect(m_midiIn, &MIDIInput::midiNoteOff,
-                this, QOverload<int,int,int>::of(&VPiano::slotNoteOff),
-                Qt::QueuedConnection);
+        connectInput();
+        m_meter->attachInput(m_midiIn);
 
         if (m_midiIn != nullptr) {
             m_midiIn->initialize(settings.getQSettings());
@@ -224,23 +228,27 @@ void VPiano::slotNoteOff(const int midiNote, const int vel)
     m_midiOut->sendNoteOff(chan, midiNote, vel);
 }
 
-void VPiano::slotNoteOn(const int chan, const int note, const int vel)
+/*
+ * The notes are posted to the keyboard from the MIDI input thread, so the
+ * handlers only read the atomic copy of the input channel, never the
+ * settings object owned by the GUI thread.
+ */
+void VPiano::connectInput()
 {
-    if (VPianoSettings::instance()->inChannel() == chan) {
-        if (vel > 0) {
-            ui.pianokeybd->showNoteOn(note, vel);
-        } else {
-            ui.pianokeybd->showNoteOff(note);
+    connect(m_midiIn, &MIDIInput::midiNoteOn, this, [this](const int chan, const int note, const int vel) {
+        if (m_inChannel.load(std::memory_order_relaxed) == chan) {
+            if (vel > 0) {
+                ui.pianokeybd->postNoteOn(note, vel);
+            } else {
+                ui.pianokeybd->postNoteOff(note);
+            }
         }
-    }
-}
-
-void VPiano::slotNoteOff(const int chan, const int note, const int vel)
-{
-    Q_UNUSED(vel)
-    if (VPianoSettings::instance()->inChannel() == chan) {
-        ui.pianokeybd->showNoteOff(note);
-    }
+    }, Qt::DirectConnection);
+    connect(m_midiIn, &MIDIInput::midiNoteOff, this, [this](const int chan, const int note, const int) {
+        if (m_inChannel.load(std::memory_order_relaxed) == chan) {
+            ui.pianokeybd->postNoteOff(note);
+        }
+    }, Qt::DirectConnection);
 }
 
 void VPiano::slotAbout()
@@ -252,6 +260,8 @@ void VPiano::slotAbout()
 void VPiano::slotConnections()
 {
     Connections dlgConnections(this);
+    m_inputs = m_manager->availableInputs();
+    m_outputs = m_manager->availableOutputs();
     dlgConnections.setInputs(m_inputs);
     dlgConnections.setOutputs(m_outputs);
     dlgConnections.setInput(m_midiIn);
@@ -267,10 +277,9 @@ void VPiano::slotConnections()
         m_midiIn = dlgConnections.getInput();
         m_midiOut = dlgConnections.getOutput();
         if (m_midiIn != nullptr) {
-            connect(m_midiIn, &MIDIInput::midiNoteOn, this,
-                    QOverload<int,int,int>::of(&VPiano::slotNoteOn), Qt::QueuedConnection);
-            connect(m_midiIn, &MIDIInput::midiNoteOff, this,
-                    QOverload<int,int,int>::of(&VPiano::slotNoteOff), Qt::QueuedConnection);
+            connectInput();
+            m_meter->attachInput(m_midiIn);
+            m_meter->reset();
         }
     }
 }
@@ -288,6 +297,7 @@ void VPiano::slotPreferences()
         }
         ui.pianokeybd->setChannel(VPianoSettings::instance()->outChannel());
         ui.pianokeybd->setVelocity(VPianoSettings::instance()->velocity());
+        m_inChannel = VPianoSettings::instance()->inChannel();
     }
 }
 
@@ -301,6 +311,7 @@ void VPiano::writeSettings()
 void VPiano::readSettings()
 {
     VPianoSettings::instance()->ReadSettings();
+    m_inChannel = VPianoSettings::instance()->inChannel();
     restoreGeometry(VPianoSettings::instance()->geometry());
     restoreState(VPianoSettings::instance()->state());
 
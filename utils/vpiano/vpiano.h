@@ -21,7 +21,9 @@
 
 #include <QCloseEvent>
 #include <QMainWindow>
+#include <atomic>
 
+#include <drumstick/activitymeter.h>
 #include <drumstick/backendmanager.h>
 #include <drumstick/rtmidiinput.h>
 #include <drumstick/rtmidioutput.h>
@@ -47,9 +49,7 @@ public Q_SLOTS:
     void slotPreferences();
 
     void slotNoteOn(const int midiNote, const int vel);
-    void slotNoteOn(const int chan, const int note, const int vel);
     void slotNoteOff(const int midiNote, const int vel);
-    void slotNoteOff(const int chan, const int note, const int vel);
 
     void slotChangeFont();
     void slotNameOrientation(QAction* action);
@@ -68,6 +68,7 @@ public Q_SLOTS:
 
 private:
     void initialize();
+    void connectInput();
     void useCustomNoteNames();
 
     drumstick::rt::BackendManager *m_manager;
@@ -75,6 +76,8 @@ private:
     QList<drumstick::rt::MIDIOutput*> m_outputs;
     drumstick::rt::MIDIInput * m_midiIn;
     drumstick::rt::MIDIOutput* m_midiOut;
+    drumstick::widgets::ActivityMeter* m_meter;
+    std::atomic<int> m_inChannel{0};
     Ui::VPiano ui;
 
 //  QStringList m_names_s{"do", "do♯", "re", "re♯", "mi", "fa", "fa♯", "sol", "sol♯", "la", "la♯", "si"};